@@ -21,6 +21,11 @@
 
 #include "wfs_cfg.h"
 
+#define _FILE_OFFSET_BITS 64
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE	1	/* O_DIRECT */
+#endif
+
 #include <stdio.h>
 
 #ifdef HAVE_SYS_TYPES_H
@@ -81,7 +86,11 @@ Something wrong. Ext2/3/4 requested, but ext2fs.h or libext2fs missing.
 #endif
 
 #ifdef HAVE_UNISTD_H
-# include <unistd.h>	/* sync() */
+# include <unistd.h>	/* sync(), pread(), pwrite(), close() */
+#endif
+
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>	/* open(), O_DIRECT */
 #endif
 
 /*
@@ -106,6 +115,7 @@ Something wrong. Ext2/3/4 requested, but ext2fs.h or libext2fs missing.
 #include "wfs_util.h"
 #include "wfs_wiping.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 struct wfs_e234_block_data
 {
@@ -115,6 +125,8 @@ struct wfs_e234_block_data
 	wfs_wipedata_t wd;
 	unsigned int prev_percent;
 	unsigned int number_of_blocks_in_inode;
+	/* non-zero until the first block of the journal is skipped: */
+	int first_journ;
 };
 
 #if (defined TEST_COMPILE) && (defined WFS_ANSIC)
@@ -194,9 +206,7 @@ e2_do_block (
 	unsigned long int pat_no;
 	int returns = 0;
 	size_t buf_start = 0;
-	int selected[WFS_NPAT] = {0};
 	struct wfs_e234_block_data *bd;
-	static int first_journ = 1;
 	errcode_t * error_ret;
 	errcode_t e2error = 0;
 	wfs_errcode_t gerror = 0;
@@ -302,7 +312,7 @@ e2_do_block (
 		}
 		wfs_fill_buffer (pat_no, bd->wd.buf + buf_start /* buf OK */,
 			fs_block_size - buf_start,
-			selected, bd->wd.filesys);
+			bd->wd.filesys);
 		if ( sig_recvd != 0 )
 		{
 			returns = BLOCK_ABORT;
@@ -310,7 +320,7 @@ e2_do_block (
 		}
 		e2error = 0;
 		/* do NOT overwrite the first block of the journal */
-		if ( ((bd->wd.isjournal != 0) && (first_journ == 0))
+		if ( ((bd->wd.isjournal != 0) && (bd->first_journ == 0))
 			|| (bd->wd.isjournal == 0) )
 		{
 			e2error = io_channel_write_blk (
@@ -349,7 +359,7 @@ e2_do_block (
 				fs_block_size - buf_start);
 			e2error = 0;
 			/* do NOT overwrite the first block of the journal */
-			if ( (((bd->wd.isjournal != 0) && (first_journ == 0))
+			if ( (((bd->wd.isjournal != 0) && (bd->first_journ == 0))
 				|| (bd->wd.isjournal == 0))
 				&& (sig_recvd == 0) )
 			{
@@ -382,9 +392,9 @@ e2_do_block (
 	if ( (bd->wd.isjournal != 0) && (sig_recvd == 0) )
 	{
 		/* skip the first block of the journal */
-		if ( first_journ != 0 )
+		if ( bd->first_journ != 0 )
 		{
-			first_journ--;
+			bd->first_journ--;
 		}
 		else
 		{
@@ -564,7 +574,6 @@ e2_wipe_unrm_dir (
 	int changed = 0;
 	struct ext2_inode unrm_ino;
 	char* filename;
-	int selected[WFS_NPAT] = {0};
 	ext2_filsys e2fs;
 	errcode_t * error_ret;
 	errcode_t e2error = 0;
@@ -599,7 +608,7 @@ e2_wipe_unrm_dir (
 			{
 				wfs_fill_buffer (j, (unsigned char *)filename /* buf OK */,
 					(size_t) (DIRENT->name_len & 0xFF),
-					selected, wd->filesys);
+					wd->filesys);
 			}
 			else
 			{
@@ -616,7 +625,7 @@ e2_wipe_unrm_dir (
 		{
 			wfs_fill_buffer (j, (unsigned char *)filename /* buf OK */,
 				(size_t) (DIRENT->name_len & 0xFF),
-				selected, wd->filesys);
+				wd->filesys);
 			if ( j == wd->filesys.npasses-1 )
 			{
 				DIRENT->name_len = 0;
@@ -760,6 +769,7 @@ wfs_e234_wipe_part (
 	block_data.wd.total_fs = 0;	/* dummy value, unused */
 	block_data.wd.isjournal = 0;
 	block_data.wd.is_zero_pass = 0;
+	block_data.first_journ = 0;
 
 	e2error = ext2fs_open_inode_scan (e2fs, 0, &ino_scan);
 	if ( e2error != 0 )
@@ -949,6 +959,250 @@ wfs_e234_wipe_part (
 /* ======================================================================== */
 
 #ifdef WFS_WANT_WFS
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_e234_get_free_extents WFS_PARAMS ((
+	const ext2_filsys e2fs, wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Finds the free blocks on the given ext2/3/4 filesystem.
+ * \param e2fs The filesystem, with the block bitmap already read.
+ * \param map The map to put the free blocks in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_e234_get_free_extents (
+# ifdef WFS_ANSIC
+	const ext2_filsys e2fs, wfs_extent_map_t * const map)
+# else
+	e2fs, map)
+	const ext2_filsys e2fs;
+	wfs_extent_map_t * const map;
+# endif
+{
+	blk_t blno;
+	wfs_blkno_t run_start = 0;
+	wfs_blkno_t run_length = 0;
+	wfs_errcode_t ret_free = WFS_SUCCESS;
+
+	if ( (e2fs == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	for ( blno = 1; (blno < e2fs->super->s_blocks_count)
+		&& (sig_recvd == 0); blno++ )
+	{
+		if ( ext2fs_test_block_bitmap (e2fs->block_map, blno) == 0 )
+		{
+			if ( run_length == 0 )
+			{
+				run_start = blno;
+			}
+			run_length++;
+			continue;
+		}
+		if ( run_length != 0 )
+		{
+			ret_free = wfs_extmap_add (map, run_start, run_length);
+			run_length = 0;
+			if ( ret_free != WFS_SUCCESS )
+			{
+				return ret_free;
+			}
+		}
+	}
+	if ( run_length != 0 )
+	{
+		ret_free = wfs_extmap_add (map, run_start, run_length);
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_e234_read_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive blocks of an ext2/3/4 filesystem.
+ * \param data The filesystem (an 'ext2_filsys').
+ * \param buf The buffer for the data.
+ * \param start The first block to read.
+ * \param count The number of blocks to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_e234_read_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	ext2_filsys e2fs;
+	errcode_t e2error;
+
+	e2fs = (ext2_filsys) data;
+	if ( (e2fs == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	e2error = io_channel_read_blk (e2fs->io, (blk_t) start,
+		(int) count, buf);
+	if ( e2error != 0 )
+	{
+		*error = (wfs_errcode_t) e2error;
+		return WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_e234_write_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive blocks of an ext2/3/4 filesystem. If the write fails,
+ *	the blocks are written one by one and errors on blocks marked
+ *	as bad are ignored.
+ * \param data The filesystem (an 'ext2_filsys').
+ * \param buf The buffer with the data.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_e234_write_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	ext2_filsys e2fs;
+	errcode_t e2error;
+	wfs_blkno_t i;
+	size_t fs_block_size;
+
+	e2fs = (ext2_filsys) data;
+	if ( (e2fs == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	e2error = io_channel_write_blk (e2fs->io, (blk_t) start,
+		(int) count, buf);
+	if ( e2error == 0 )
+	{
+		return WFS_SUCCESS;
+	}
+	fs_block_size = (size_t) EXT2_BLOCK_SIZE (e2fs->super);
+	for ( i = 0; (i < count) && (sig_recvd == 0); i++ )
+	{
+		e2error = io_channel_write_blk (e2fs->io, (blk_t) (start + i),
+			1, &buf[i * fs_block_size]);
+		if ( e2error == 0 )
+		{
+			continue;
+		}
+		*error = (wfs_errcode_t) e2error;
+		/* check if block is marked as bad. If there is no 'badblocks' list
+		or the block is marked OK, then print the error. */
+		if (e2fs->badblocks == NULL)
+		{
+			return WFS_BLKWR;
+		}
+		else if (ext2fs_badblocks_list_test (
+			e2fs->badblocks, (blk_t) (start + i)) == 0)
+		{
+			return WFS_BLKWR;
+		}
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_e234_sync_blocks WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written to a ext2/3/4 filesystem reach the media.
+ * \param data The ext2_filsys of the filesystem.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_e234_sync_blocks (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	ext2_filsys e2fs;
+	errcode_t e2error;
+
+	e2fs = (ext2_filsys) data;
+	if ( (e2fs == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	e2error = io_channel_flush (e2fs->io);
+	if ( e2error != 0 )
+	{
+		*error = (wfs_errcode_t) e2error;
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
 /**
  * Wipes the free space on the given ext2/3/4 filesystem.
  * \param wfs_fs The filesystem.
@@ -965,15 +1219,14 @@ wfs_e234_wipe_fs (
 # endif
 {
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
-	blk_t blno;			/* block number */
-	struct wfs_e234_block_data block_data;
 	unsigned int prev_percent = 0;
-	int block_ret = 0;
 	ext2_filsys e2fs;
 	errcode_t * error_ret;
 	errcode_t e2error = 0;
+	wfs_errcode_t wipe_error = 0;
 	size_t fs_block_size;
-	unsigned long int j;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
 
 	e2fs = (ext2_filsys) wfs_fs.fs_backend;
 	error_ret = (errcode_t *) wfs_fs.fs_error;
@@ -999,33 +1252,10 @@ wfs_e234_wipe_fs (
 		return WFS_BADPARAM;
 	}
 
-	WFS_SET_ERRNO (0);
-	block_data.wd.buf = (unsigned char *) malloc (fs_block_size);
-	if ( block_data.wd.buf == NULL )
-	{
-		e2error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
-		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		if ( error_ret != NULL )
-		{
-			*error_ret = e2error;
-		}
-		return WFS_MALLOC;
-	}
-	block_data.wd.filesys = wfs_fs;
-	block_data.wd.ret_val = WFS_SUCCESS;
-	block_data.wd.total_fs = 0;	/* dummy value, unused */
-	block_data.wd.is_zero_pass = 0;
-	block_data.ino = NULL;
-	block_data.wd.isjournal = 0;
-	block_data.curr_inode = 0;
-	block_data.prev_percent = 0;
-	block_data.number_of_blocks_in_inode = 0;
-
 	/* read the bitmap of blocks */
 	e2error = ext2fs_read_block_bitmap (e2fs);
 	if ( e2error != 0 )
 	{
-		free (block_data.wd.buf);
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 		if ( error_ret != NULL )
 		{
@@ -1034,83 +1264,39 @@ wfs_e234_wipe_fs (
 		return WFS_BLBITMAPREAD;
 	}
 
-	/* wiping free blocks on the whole device */
-	if ( block_data.wd.filesys.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	/* mark bad blocks if needed. Taken from libext2fs->lib/ext2fs/inode.c */
+	if (e2fs->badblocks == NULL)
 	{
-		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0)
-			/*&& (ret == WFS_SUCCESS)*/; j++ )
+		e2error = ext2fs_read_bb_inode (e2fs, &(e2fs->badblocks));
+		if ( (e2error != 0) && (e2fs->badblocks != NULL) )
 		{
-			block_data.wd.passno = j;
-			for ( blno = 1; (blno < e2fs->super->s_blocks_count)
-				&& (sig_recvd == 0); blno++ )
-			{
-				/* if we find an empty block, we shred it */
-				if ( ext2fs_test_block_bitmap (e2fs->block_map, blno) == 0 )
-				{
-					block_ret = e2_do_block (e2fs, &blno, 1, &block_data);
-					wfs_show_progress (WFS_PROGRESS_WFS,
-						(unsigned int)(((e2fs->super->s_blocks_count * j + blno) * 100)
-							/(e2fs->super->s_blocks_count * wfs_fs.npasses)),
-						&prev_percent);
-					if ( (block_ret != 0) || (sig_recvd != 0) )
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-				}
-			}
-			if ( WFS_IS_SYNC_NEEDED_PAT(wfs_fs) )
-			{
-				wfs_e234_flush_fs (wfs_fs);
-			}
-			wfs_show_progress (WFS_PROGRESS_WFS,
-				(unsigned int)((j + 1) * 100 / wfs_fs.npasses),
-				&prev_percent);
-		}
-		if ( (block_data.wd.filesys.zero_pass != 0) && (sig_recvd == 0) )
-		{
-			/* last pass with zeros */
-			wfs_e234_flush_fs (wfs_fs);
-			block_data.wd.is_zero_pass = 1;
-			for ( blno = 1; (blno < e2fs->super->s_blocks_count)
-				&& (sig_recvd == 0); blno++ )
-			{
-				if ( ext2fs_test_block_bitmap (e2fs->block_map, blno) == 0 )
-				{
-					block_ret = e2_do_block (e2fs, &blno, 1, &block_data);
-					if ( (block_ret != 0) || (sig_recvd != 0) )
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-				}
-			}
-			wfs_e234_flush_fs (wfs_fs);
+			ext2fs_badblocks_list_free (e2fs->badblocks);
+			e2fs->badblocks = NULL;
 		}
+		e2error = 0;
+	}
+
+	/* find the free blocks once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_e234_get_free_extents (e2fs, &map);
+	if ( ret_wfs == WFS_SUCCESS )
+	{
+		ops.read_blocks = &wfs_e234_read_blocks;
+		ops.write_blocks = &wfs_e234_write_blocks;
+		ops.write_pattern = NULL;
+		ops.sync_blocks = &wfs_e234_sync_blocks;
+		ops.flush_fs = &wfs_e234_flush_fs;
+		ops.data = e2fs;
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map, fs_block_size,
+			&ops, &wipe_error);
+		e2error = (errcode_t) wipe_error;
 	}
 	else
 	{
-		block_data.wd.passno = 0;
-		for ( blno = 1; (blno < e2fs->super->s_blocks_count)
-			&& (sig_recvd == 0); blno++ )
-		{
-			/* if we find an empty block, we shred it */
-			if ( ext2fs_test_block_bitmap (e2fs->block_map, blno) == 0 )
-			{
-				block_ret = e2_do_block (e2fs, &blno, 1, &block_data);
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(blno * 100)/e2fs->super->s_blocks_count,
-					&prev_percent);
-				if ( (block_ret != 0) || (sig_recvd != 0) )
-				{
-					ret_wfs = WFS_BLKWR;
-					break;
-				}
-			}
-		}
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	}
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-	free (block_data.wd.buf);
+	wfs_extmap_free (&map);
+
 	if ( error_ret != NULL )
 	{
 		*error_ret = e2error;
@@ -1177,6 +1363,7 @@ wfs_e234_wipe_journal (
 	block_data.wd.total_fs = 0;	/* dummy value, unused */
 	block_data.ino = NULL;
 	block_data.wd.isjournal = 1;
+	block_data.first_journ = 1;
 	block_data.curr_inode = 0;
 	block_data.prev_percent = 50;
 
@@ -1375,6 +1562,565 @@ wfs_e234_wipe_unrm (
 
 /* ======================================================================== */
 
+/* The WipeFreeSpace I/O manager for libext2fs. It works like the library's
+   unix_io_manager (which does all the metadata I/O, with its cache), but
+   the multi-block writes, which come only from wiping the free space, go
+   directly to the device through a separate descriptor, optionally opened
+   with O_DIRECT. This way they neither go through nor flush and invalidate
+   the library's cache. The multi-block reads come from the same descriptor,
+   so that they don't get older copies from the cache. Single-block writes
+   are not batched here - the free-extent driver already sends the data
+   in big writes. */
+
+/* The data of a single channel opened by the manager. Each channel gets
+   its own copy of the manager, so the data is found from the channel
+   itself, without any list shared by all the channels. */
+struct wfs_e234_io
+{
+	struct struct_io_manager manager;	/* the channel's manager,
+						   must be the first member */
+	int fd;				/* the descriptor for the data writes, -1 if none */
+	int direct;			/* non-zero if 'fd' uses direct I/O */
+	int dirty;			/* non-zero if 'fd' needs syncing */
+};
+
+/* the manager passed to the library, used only to open the channels */
+static struct struct_io_manager wfs_e234_io_manager_data;
+static int wfs_e234_io_manager_ready = 0;
+
+static const char * const msg_nodirect = N_("Direct I/O not supported or failed, using the system's cache");
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_open WFS_PARAMS ((const char * name, int flags,
+	io_channel * channel));
+#endif
+
+/**
+ * Opens a channel using the library's Unix I/O manager and a separate
+ *	descriptor for the data writes.
+ * \param name The name of the device.
+ * \param flags The flags for opening the device.
+ * \param channel Pointer to the channel to fill.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_open (
+#ifdef WFS_ANSIC
+	const char * name, int flags, io_channel * channel)
+#else
+	name, flags, channel)
+	const char * name;
+	int flags;
+	io_channel * channel;
+#endif
+{
+	errcode_t err;
+	struct wfs_e234_io * io;
+
+	if ( (name == NULL) || (channel == NULL) )
+	{
+		return EXT2_ET_BAD_DEVICE_NAME;
+	}
+	err = (*(unix_io_manager->open)) (name, flags, channel);
+	if ( err != 0 )
+	{
+		return err;
+	}
+	io = (struct wfs_e234_io *) malloc (sizeof (struct wfs_e234_io));
+	if ( io == NULL )
+	{
+		(*(unix_io_manager->close)) (*channel);
+		*channel = NULL;
+		return EXT2_ET_NO_MEMORY;
+	}
+	io->manager = wfs_e234_io_manager_data;
+	io->fd = -1;
+	io->direct = 0;
+	io->dirty = 0;
+#if (defined HAVE_FCNTL_H) && (defined HAVE_PWRITE)
+	if ( (flags & IO_FLAG_RW) != 0 )
+	{
+		/* without the descriptor, the library's functions are used */
+		io->fd = open (name, O_RDWR
+# ifdef O_BINARY
+			| O_BINARY
+# endif
+			);
+		if ( io->fd < 0 )
+		{
+			io->fd = -1;
+		}
+	}
+#endif
+	(*channel)->manager = &(io->manager);
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static struct wfs_e234_io * wfs_e234_io_find WFS_PARAMS ((const io_channel channel));
+#endif
+
+/**
+ * Finds the manager's data of the given channel.
+ * \param channel The channel.
+ * \return the channel's data or NULL if not found.
+ */
+static struct wfs_e234_io *
+wfs_e234_io_find (
+#ifdef WFS_ANSIC
+	const io_channel channel)
+#else
+	channel)
+	const io_channel channel;
+#endif
+{
+	if ( (channel == NULL) || (channel->manager == NULL)
+		|| (channel->manager->open != &wfs_e234_io_open) )
+	{
+		return NULL;
+	}
+	return (struct wfs_e234_io *) channel->manager;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_close WFS_PARAMS ((io_channel channel));
+#endif
+
+/**
+ * Closes the given channel.
+ * \param channel The channel.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_close (
+#ifdef WFS_ANSIC
+	io_channel channel)
+#else
+	channel)
+	io_channel channel;
+#endif
+{
+	struct wfs_e234_io * io;
+	errcode_t err;
+
+	io = wfs_e234_io_find (channel);
+	if ( (io == NULL) || (channel->refcount > 1) )
+	{
+		/* still used elsewhere - the library only drops a reference */
+		return (*(unix_io_manager->close)) (channel);
+	}
+#ifdef HAVE_UNISTD_H
+	if ( io->fd >= 0 )
+	{
+		if ( io->dirty != 0 )
+		{
+			wfs_sync_fd (io->fd);
+		}
+		close (io->fd);
+	}
+#endif
+	/* the library frees the channel, but not its manager */
+	err = (*(unix_io_manager->close)) (channel);
+	free (io);
+	return err;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int wfs_e234_io_write_direct WFS_PARAMS ((io_channel channel,
+	const wfs_blkno_t block, const int count, const void * data));
+#endif
+
+/**
+ * Writes blocks directly to the device, if they're a multi-block write.
+ * \param channel The channel.
+ * \param block The first block to write.
+ * \param count The number of blocks to write (negative: the number of bytes).
+ * \param data The data to write.
+ * \return 1 if the blocks were written, 0 if the library has to write them.
+ */
+static int
+wfs_e234_io_write_direct (
+#ifdef WFS_ANSIC
+	io_channel channel, const wfs_blkno_t block, const int count,
+	const void * data)
+#else
+	channel, block, count, data)
+	io_channel channel;
+	const wfs_blkno_t block;
+	const int count;
+	const void * data;
+#endif
+{
+#if (defined HAVE_FCNTL_H) && (defined HAVE_PWRITE)
+	struct wfs_e234_io * io;
+	size_t size;
+	ssize_t res;
+
+	io = wfs_e234_io_find (channel);
+	if ( (io != NULL) && (io->fd >= 0) && (count > 1) && (data != NULL) )
+	{
+		size = (size_t) count * (size_t) channel->block_size;
+		WFS_SET_ERRNO (0);
+		res = pwrite (io->fd, data, size,
+			(off_t) block * (off_t) channel->block_size);
+		if ( res == (ssize_t) size )
+		{
+			io->dirty = 1;
+			return 1;
+		}
+		/* an error - let the library try and report it, e.g. the buffer
+		   may be unsuitable for direct I/O */
+	}
+#endif
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int wfs_e234_io_read_direct WFS_PARAMS ((io_channel channel,
+	const wfs_blkno_t block, const int count, void * data));
+#endif
+
+/**
+ * Reads blocks directly from the device, if they're a multi-block read,
+ *	like the ones written directly. This way the library's cache,
+ *	which may have older copies of the blocks, isn't used.
+ * \param channel The channel.
+ * \param block The first block to read.
+ * \param count The number of blocks to read (negative: the number of bytes).
+ * \param data The buffer for the data.
+ * \return 1 if the blocks were read, 0 if the library has to read them.
+ */
+static int
+wfs_e234_io_read_direct (
+#ifdef WFS_ANSIC
+	io_channel channel, const wfs_blkno_t block, const int count,
+	void * data)
+#else
+	channel, block, count, data)
+	io_channel channel;
+	const wfs_blkno_t block;
+	const int count;
+	void * data;
+#endif
+{
+#if (defined HAVE_FCNTL_H) && (defined HAVE_PREAD)
+	struct wfs_e234_io * io;
+	size_t size;
+	ssize_t res;
+
+	io = wfs_e234_io_find (channel);
+	if ( (io != NULL) && (io->fd >= 0) && (count > 1) && (data != NULL) )
+	{
+		size = (size_t) count * (size_t) channel->block_size;
+		WFS_SET_ERRNO (0);
+		res = pread (io->fd, data, size,
+			(off_t) block * (off_t) channel->block_size);
+		if ( res == (ssize_t) size )
+		{
+			return 1;
+		}
+		/* an error or the end of the device - let the library
+		   try and report it */
+	}
+#endif
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_write_blk WFS_PARAMS ((io_channel channel,
+	unsigned long block, int count, const void * data));
+#endif
+
+/**
+ * Writes blocks to the given channel. Multi-block writes go directly to the
+ *	device, everything else goes through the library's functions.
+ * \param channel The channel.
+ * \param block The first block to write.
+ * \param count The number of blocks to write (negative: the number of bytes).
+ * \param data The data to write.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_write_blk (
+#ifdef WFS_ANSIC
+	io_channel channel, unsigned long block, int count, const void * data)
+#else
+	channel, block, count, data)
+	io_channel channel;
+	unsigned long block;
+	int count;
+	const void * data;
+#endif
+{
+	if ( wfs_e234_io_write_direct (channel, (wfs_blkno_t) block,
+		count, data) != 0 )
+	{
+		return 0;
+	}
+	return (*(unix_io_manager->write_blk)) (channel, block, count, data);
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_read_blk WFS_PARAMS ((io_channel channel,
+	unsigned long block, int count, void * data));
+#endif
+
+/**
+ * Reads blocks from the given channel. Multi-block reads come directly from
+ *	the device, everything else goes through the library's functions.
+ * \param channel The channel.
+ * \param block The first block to read.
+ * \param count The number of blocks to read (negative: the number of bytes).
+ * \param data The buffer for the data.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_read_blk (
+#ifdef WFS_ANSIC
+	io_channel channel, unsigned long block, int count, void * data)
+#else
+	channel, block, count, data)
+	io_channel channel;
+	unsigned long block;
+	int count;
+	void * data;
+#endif
+{
+	if ( wfs_e234_io_read_direct (channel, (wfs_blkno_t) block,
+		count, data) != 0 )
+	{
+		return 0;
+	}
+	return (*(unix_io_manager->read_blk)) (channel, block, count, data);
+}
+
+/* ======================================================================== */
+
+#ifdef HAVE_IO_CHANNEL_WRITE_BLK64
+# ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_write_blk64 WFS_PARAMS ((io_channel channel,
+	unsigned long long block, int count, const void * data));
+# endif
+
+/**
+ * Writes blocks to the given channel, the 64-bit version of
+ *	wfs_e234_io_write_blk().
+ * \param channel The channel.
+ * \param block The first block to write.
+ * \param count The number of blocks to write (negative: the number of bytes).
+ * \param data The data to write.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_write_blk64 (
+# ifdef WFS_ANSIC
+	io_channel channel, unsigned long long block, int count,
+	const void * data)
+# else
+	channel, block, count, data)
+	io_channel channel;
+	unsigned long long block;
+	int count;
+	const void * data;
+# endif
+{
+	if ( wfs_e234_io_write_direct (channel, (wfs_blkno_t) block,
+		count, data) != 0 )
+	{
+		return 0;
+	}
+	return (*(unix_io_manager->write_blk64)) (channel, block, count, data);
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_read_blk64 WFS_PARAMS ((io_channel channel,
+	unsigned long long block, int count, void * data));
+# endif
+
+/**
+ * Reads blocks from the given channel, the 64-bit version of
+ *	wfs_e234_io_read_blk().
+ * \param channel The channel.
+ * \param block The first block to read.
+ * \param count The number of blocks to read (negative: the number of bytes).
+ * \param data The buffer for the data.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_read_blk64 (
+# ifdef WFS_ANSIC
+	io_channel channel, unsigned long long block, int count, void * data)
+# else
+	channel, block, count, data)
+	io_channel channel;
+	unsigned long long block;
+	int count;
+	void * data;
+# endif
+{
+	if ( wfs_e234_io_read_direct (channel, (wfs_blkno_t) block,
+		count, data) != 0 )
+	{
+		return 0;
+	}
+	return (*(unix_io_manager->read_blk64)) (channel, block, count, data);
+}
+
+/* ======================================================================== */
+#endif /* HAVE_IO_CHANNEL_WRITE_BLK64 */
+
+#ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_flush WFS_PARAMS ((io_channel channel));
+#endif
+
+/**
+ * Flushes the given channel, including the data written directly.
+ * \param channel The channel.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_flush (
+#ifdef WFS_ANSIC
+	io_channel channel)
+#else
+	channel)
+	io_channel channel;
+#endif
+{
+	errcode_t err;
+	struct wfs_e234_io * io;
+	int res;
+
+	err = (*(unix_io_manager->flush)) (channel);
+	io = wfs_e234_io_find (channel);
+	if ( (io != NULL) && (io->fd >= 0) && (io->dirty != 0) )
+	{
+		res = wfs_sync_fd (io->fd);
+		if ( res == 0 )
+		{
+			io->dirty = 0;
+		}
+		else if ( err == 0 )
+		{
+			err = (errcode_t) res;
+		}
+	}
+	return err;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static errcode_t wfs_e234_io_set_option WFS_PARAMS ((io_channel channel,
+	const char * option, const char * arg));
+#endif
+
+/**
+ * Sets an option on the given channel. The "wfs_direct" option makes the
+ *	data writes use direct I/O, other options are passed to the library.
+ * \param channel The channel.
+ * \param option The name of the option.
+ * \param arg The value of the option, if any.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static errcode_t
+wfs_e234_io_set_option (
+#ifdef WFS_ANSIC
+	io_channel channel, const char * option, const char * arg)
+#else
+	channel, option, arg)
+	io_channel channel;
+	const char * option;
+	const char * arg;
+#endif
+{
+#if (defined HAVE_FCNTL_H) && (defined HAVE_PWRITE) && (defined O_DIRECT)
+	struct wfs_e234_io * io;
+	int fd;
+#endif
+
+	if ( (option != NULL) && (strcmp (option, "wfs_direct") == 0) )
+	{
+#if (defined HAVE_FCNTL_H) && (defined HAVE_PWRITE) && (defined O_DIRECT)
+		io = wfs_e234_io_find (channel);
+		if ( (io != NULL) && (io->fd >= 0) && (io->direct == 0)
+			&& (channel->name != NULL) )
+		{
+			fd = open (channel->name, O_RDWR | O_DIRECT);
+			/* if unsupported, just use the normal descriptor */
+			if ( fd >= 0 )
+			{
+				close (io->fd);
+				io->fd = fd;
+				io->direct = 1;
+			}
+		}
+#endif
+		return 0;
+	}
+	if ( unix_io_manager->set_option == NULL )
+	{
+		return EXT2_ET_INVALID_ARGUMENT;
+	}
+	return (*(unix_io_manager->set_option)) (channel, option, arg);
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static io_manager wfs_e234_get_io_manager WFS_PARAMS ((void));
+#endif
+
+/**
+ * Returns the WipeFreeSpace I/O manager for libext2fs.
+ * \return the I/O manager.
+ */
+static io_manager
+wfs_e234_get_io_manager (WFS_VOID)
+{
+	if ( wfs_e234_io_manager_ready == 0 )
+	{
+		/* everything not overridden below is the library's */
+		wfs_e234_io_manager_data = *unix_io_manager;
+		wfs_e234_io_manager_data.name = "WipeFreeSpace I/O Manager";
+		wfs_e234_io_manager_data.open = &wfs_e234_io_open;
+		wfs_e234_io_manager_data.close = &wfs_e234_io_close;
+		wfs_e234_io_manager_data.read_blk = &wfs_e234_io_read_blk;
+		wfs_e234_io_manager_data.write_blk = &wfs_e234_io_write_blk;
+#ifdef HAVE_IO_CHANNEL_WRITE_BLK64
+		/* the library calls these, if set, instead of the ones above */
+		if ( unix_io_manager->read_blk64 != NULL )
+		{
+			wfs_e234_io_manager_data.read_blk64 = &wfs_e234_io_read_blk64;
+		}
+		if ( unix_io_manager->write_blk64 != NULL )
+		{
+			wfs_e234_io_manager_data.write_blk64 = &wfs_e234_io_write_blk64;
+		}
+#endif
+		wfs_e234_io_manager_data.flush = &wfs_e234_io_flush;
+		wfs_e234_io_manager_data.set_option = &wfs_e234_io_set_option;
+		wfs_e234_io_manager_ready = 1;
+	}
+	return &wfs_e234_io_manager_data;
+}
+
 /**
  * Opens an ext2/3/4 filesystem on the given device.
  * \param devname Device name, like /dev/hdXY
@@ -1402,6 +2148,9 @@ wfs_e234_open_fs (
 	wfs_errcode_t ret = WFS_SUCCESS;
 	errcode_t * error_ret;
 	errcode_t e2error = 0;
+	const char * io_options = NULL;
+	int flags = EXT2_FLAG_RW;
+	struct wfs_e234_io * io;
 
 	if ((wfs_fs == NULL) || (data == NULL))
 	{
@@ -1418,26 +2167,67 @@ wfs_e234_open_fs (
 	}
 
 	wfs_fs->whichfs = WFS_CURR_FS_NONE;
-	e2error = ext2fs_open (wfs_fs->fsname, EXT2_FLAG_RW
+	if ( wfs_fs->use_direct != 0 )
+	{
+		/* only the data writes, the metadata keeps being cached */
+		io_options = "wfs_direct";
+	}
+	if ( wfs_fs->plan_only != 0 )
+	{
+		flags = 0;
+	}
+#ifdef HAVE_EXT2FS_OPEN2
+	e2error = ext2fs_open2 (wfs_fs->fsname, io_options, flags
+#else
+	e2error = ext2fs_open (wfs_fs->fsname, flags
+#endif
 #ifdef EXT2_FLAG_EXCLUSIVE
 		| EXT2_FLAG_EXCLUSIVE
 #endif
 		, (int)(data->e2fs.super_off), data->e2fs.blocksize,
-		unix_io_manager, (ext2_filsys *) &(wfs_fs->fs_backend));
+		wfs_e234_get_io_manager (), (ext2_filsys *) &(wfs_fs->fs_backend));
 
 	if ( e2error != 0 )
 	{
 		ret = WFS_OPENFS;
-		e2error = ext2fs_open (wfs_fs->fsname, EXT2_FLAG_RW,
+#ifdef HAVE_EXT2FS_OPEN2
+		e2error = ext2fs_open2 (wfs_fs->fsname, io_options, flags,
+#else
+		e2error = ext2fs_open (wfs_fs->fsname, flags,
+#endif
 			(int)(data->e2fs.super_off),
 			data->e2fs.blocksize,
-			unix_io_manager,
+			wfs_e234_get_io_manager (),
 			(ext2_filsys *) &(wfs_fs->fs_backend));
 	}
+#ifndef HAVE_EXT2FS_OPEN2
+	if ( (e2error == 0) && (io_options != NULL) )
+	{
+		e2error = io_channel_set_options (
+			((ext2_filsys) wfs_fs->fs_backend)->io, io_options);
+		if ( e2error != 0 )
+		{
+			ext2fs_close ((ext2_filsys) wfs_fs->fs_backend);
+			wfs_fs->fs_backend = NULL;
+		}
+	}
+#endif
 	if ( e2error == 0 )
 	{
 		wfs_fs->whichfs = WFS_CURR_FS_EXT234FS;
 		ret = WFS_SUCCESS;
+		wfs_set_uuid (wfs_fs,
+			((ext2_filsys) wfs_fs->fs_backend)->super->s_uuid,
+			sizeof (((ext2_filsys) wfs_fs->fs_backend)->super->s_uuid));
+		if ( (io_options != NULL) && (wfs_fs->plan_only == 0) )
+		{
+			/* tell the user if the data is still going through the cache */
+			io = wfs_e234_io_find (((ext2_filsys) wfs_fs->fs_backend)->io);
+			if ( (io == NULL) || (io->direct == 0) )
+			{
+				wfs_show_msg (0, msg_nodirect, "", *wfs_fs);
+			}
+		}
 	}
 	if ( error_ret != NULL )
 	{
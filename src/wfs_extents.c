@@ -0,0 +1,2358 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- free-extent maps.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_cfg.h"
+
+#define _FILE_OFFSET_BITS 64
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE	1	/* O_DIRECT */
+#endif
+
+#include <stdio.h>
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>	/* malloc(), realloc(), free(), posix_memalign() */
+#endif
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>	/* pread(), pwrite(), close() */
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>	/* for open() */
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>	/* for open() */
+#endif
+
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>	/* open(), O_DIRECT */
+#endif
+
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>	/* pwritev() */
+#endif
+
+#ifdef HAVE_SYS_IOCTL_H
+# include <sys/ioctl.h>	/* ioctl() */
+#endif
+
+#ifdef HAVE_SYS_MOUNT_H
+# include <sys/mount.h>	/* BLKSSZGET */
+#endif
+
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# if ((!defined STDC_HEADERS) || (!STDC_HEADERS)) && (defined HAVE_MEMORY_H)
+#  include <memory.h>
+# endif
+# include <string.h>	/* memset() */
+#endif
+
+#include "wipefreespace.h"
+#include "wfs_extents.h"
+#include "wfs_signal.h"
+#include "wfs_state.h"
+#include "wfs_snapshot.h"
+#include "wfs_progress.h"
+#include "wfs_stats.h"
+#include "wfs_plan.h"
+#include "wfs_util.h"
+#include "wfs_wiping.h"
+
+/* how many ranges to allocate at once */
+#define WFS_EXTMAP_GROW 256
+
+#if (defined O_DIRECT) && (defined HAVE_POSIX_MEMALIGN) && (defined HAVE_PREAD) \
+	&& (defined HAVE_PWRITE) && (defined HAVE_FCNTL_H) && (defined HAVE_UNISTD_H)
+# define WFS_HAVE_DIRECT_IO 1
+#else
+# undef WFS_HAVE_DIRECT_IO
+#endif
+
+#if (defined HAVE_PWRITEV) && (defined HAVE_SYS_UIO_H)
+# define WFS_HAVE_PWRITEV 1
+#else
+# undef WFS_HAVE_PWRITEV
+#endif
+
+/* the largest device alignment hint taken into account */
+#define WFS_IO_ALIGN_MAX (64 * 1024 * 1024)
+
+/* the minimum time (in seconds) and number of writes used to measure
+   the speed of writing with one size */
+#define WFS_PROBE_TIME 0.25
+#define WFS_PROBE_WRITES 4
+
+/* The state of writing to the blocks of a free-extent map */
+struct wfs_extmap_writer
+{
+	const wfs_extent_ops_t *	ops;		/* the backend's operations */
+	size_t				fs_block_size;	/* the size of a single block */
+	wfs_rate_limit_t		limit;		/* the limit of the writing rate */
+	size_t				chunk_blocks;	/* the number of blocks
+							   written at once */
+	size_t				sizes[WFS_IO_SIZES]; /* the numbers of
+							   blocks to try */
+	size_t				nsizes;		/* the number of sizes to try */
+	size_t				probed;		/* the index of the size being
+							   tried, 'nsizes' when done */
+	double				probe_time;	/* the time of writing
+							   with the current size */
+	wfs_blkno_t			probe_blocks;	/* the number of blocks
+							   written with the current size */
+	unsigned int			probe_writes;	/* the number of writes
+							   with the current size */
+	double				best_rate;	/* the best number of blocks
+							   written per second */
+	size_t				best_blocks;	/* the size which gave
+							   the best rate */
+	const wfs_fsid_t *		fs;		/* the filesystem */
+	unsigned long int		key;		/* identifies the free space
+							   in the state file */
+	unsigned long int		pass;		/* the pass being performed */
+	wfs_blkno_t			position;	/* the first block not
+							   written yet in this pass */
+	double				last_save;	/* the time the position
+							   was last saved */
+	unsigned long int		fill_pass;	/* the pass whose pattern
+							   is being written */
+	int				random;		/* non-zero if each block
+							   gets its own pattern */
+};
+
+typedef struct wfs_extmap_writer wfs_extmap_writer_t;
+
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+static const char * const msg_io_size = N_("Write size (bytes), requests at once");
+static const char * const msg_snapshot = N_("Blocks freed since the last wiping, all free blocks");
+#endif
+static const char * const msg_nosnapshot = N_("Cannot save the snapshot of free space, the next wiping will be full");
+static const char * const msg_nodirect = N_("Direct I/O not supported or failed, using the system's cache");
+
+#if (defined TEST_COMPILE) && (defined WFS_ANSIC)
+# undef WFS_ANSIC
+#endif
+
+/* ======================================================================== */
+
+/**
+ * Initializes an empty free-extent map.
+ * \param map The map to initialize.
+ */
+void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_init (
+#ifdef WFS_ANSIC
+	wfs_extent_map_t * const map)
+#else
+	map)
+	wfs_extent_map_t * const map;
+#endif
+{
+	if ( map == NULL )
+	{
+		return;
+	}
+	map->extents = NULL;
+	map->count = 0;
+	map->capacity = 0;
+	map->total_blocks = 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Appends a range of free blocks to the given map. The ranges must be added
+ *	in ascending order. A range directly following the last one is merged
+ *	with it.
+ * \param map The map to add the range to.
+ * \param start The first block of the range.
+ * \param length The number of blocks in the range.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_add (
+#ifdef WFS_ANSIC
+	wfs_extent_map_t * const map,
+	const wfs_blkno_t start,
+	const wfs_blkno_t length)
+#else
+	map, start, length)
+	wfs_extent_map_t * const map;
+	const wfs_blkno_t start;
+	const wfs_blkno_t length;
+#endif
+{
+	wfs_extent_t * last;
+
+	if ( map == NULL )
+	{
+		return WFS_BADPARAM;
+	}
+	if ( length == 0 )
+	{
+		return WFS_SUCCESS;
+	}
+	if ( map->count > 0 )
+	{
+		last = &(map->extents[map->count - 1]);
+		if ( start < last->start + last->length )
+		{
+			/* overlapping or out of order */
+			return WFS_BADPARAM;
+		}
+	}
+	return wfs_extmap_append (map, start, length);
+}
+
+/* ======================================================================== */
+
+/**
+ * Appends a range of free blocks to the given map, in any order. A range
+ *	directly following the last one is merged with it. Call
+ *	wfs_extmap_sort() after adding all the ranges.
+ * \param map The map to add the range to.
+ * \param start The first block of the range.
+ * \param length The number of blocks in the range.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_append (
+#ifdef WFS_ANSIC
+	wfs_extent_map_t * const map,
+	const wfs_blkno_t start,
+	const wfs_blkno_t length)
+#else
+	map, start, length)
+	wfs_extent_map_t * const map;
+	const wfs_blkno_t start;
+	const wfs_blkno_t length;
+#endif
+{
+	wfs_extent_t * last;
+	wfs_extent_t * new_extents;
+
+	if ( map == NULL )
+	{
+		return WFS_BADPARAM;
+	}
+	if ( length == 0 )
+	{
+		return WFS_SUCCESS;
+	}
+	if ( map->count > 0 )
+	{
+		last = &(map->extents[map->count - 1]);
+		if ( start == last->start + last->length )
+		{
+			last->length += length;
+			map->total_blocks += length;
+			return WFS_SUCCESS;
+		}
+	}
+	if ( map->count >= map->capacity )
+	{
+		WFS_SET_ERRNO (0);
+		new_extents = (wfs_extent_t *) realloc (map->extents,
+			(map->capacity + WFS_EXTMAP_GROW) * sizeof (wfs_extent_t));
+		if ( new_extents == NULL )
+		{
+			return WFS_MALLOC;
+		}
+		map->extents = new_extents;
+		map->capacity += WFS_EXTMAP_GROW;
+	}
+	map->extents[map->count].start = start;
+	map->extents[map->count].length = length;
+	map->count++;
+	map->total_blocks += length;
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int wfs_extmap_compare WFS_PARAMS ((const void * e1, const void * e2));
+#endif
+
+/**
+ * Compares two block ranges by their starting blocks (for qsort()).
+ * \param e1 The first range.
+ * \param e2 The second range.
+ * \return -1, 0 or 1, as qsort() requires.
+ */
+static int
+wfs_extmap_compare (
+#ifdef WFS_ANSIC
+	const void * e1, const void * e2)
+#else
+	e1, e2)
+	const void * e1;
+	const void * e2;
+#endif
+{
+	const wfs_extent_t * ext1 = (const wfs_extent_t *) e1;
+	const wfs_extent_t * ext2 = (const wfs_extent_t *) e2;
+
+	if ( ext1->start < ext2->start )
+	{
+		return -1;
+	}
+	if ( ext1->start > ext2->start )
+	{
+		return 1;
+	}
+	return 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Sorts the ranges in the given map and joins the ones which touch or
+ *	overlap, so that the map can be used like one filled with
+ *	wfs_extmap_add().
+ * \param map The map to sort.
+ */
+void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_sort (
+#ifdef WFS_ANSIC
+	wfs_extent_map_t * const map)
+#else
+	map)
+	wfs_extent_map_t * const map;
+#endif
+{
+	size_t i;
+	size_t last = 0;
+
+	if ( (map == NULL) || (map->count == 0) )
+	{
+		return;
+	}
+	qsort (map->extents, map->count, sizeof (wfs_extent_t),
+		&wfs_extmap_compare);
+	for ( i = 1; i < map->count; i++ )
+	{
+		if ( map->extents[i].start
+			<= map->extents[last].start + map->extents[last].length )
+		{
+			if ( map->extents[i].start + map->extents[i].length
+				> map->extents[last].start + map->extents[last].length )
+			{
+				map->extents[last].length = map->extents[i].start
+					+ map->extents[i].length - map->extents[last].start;
+			}
+			continue;
+		}
+		last++;
+		map->extents[last] = map->extents[i];
+	}
+	map->count = last + 1;
+	map->total_blocks = 0;
+	for ( i = 0; i < map->count; i++ )
+	{
+		map->total_blocks += map->extents[i].length;
+	}
+}
+
+/* ======================================================================== */
+
+/**
+ * Removes the blocks present in another map from the given map.
+ * \param map The map to remove the blocks from. It is not changed in
+ *	case of errors.
+ * \param other The map of the blocks to remove.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_subtract (
+#ifdef WFS_ANSIC
+	wfs_extent_map_t * const map,
+	const wfs_extent_map_t * const other)
+#else
+	map, other)
+	wfs_extent_map_t * const map;
+	const wfs_extent_map_t * const other;
+#endif
+{
+	wfs_extent_map_t result;
+	wfs_errcode_t ret_wfs = WFS_SUCCESS;
+	wfs_blkno_t start;
+	wfs_blkno_t end;
+	size_t i;
+	size_t j = 0;
+	size_t k;
+
+	if ( (map == NULL) || (other == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	wfs_extmap_init (&result);
+	for ( i = 0; (i < map->count) && (ret_wfs == WFS_SUCCESS); i++ )
+	{
+		start = map->extents[i].start;
+		end = start + map->extents[i].length;
+		/* the ranges ending before this one won't be needed anymore */
+		while ( (j < other->count) && (other->extents[j].start
+			+ other->extents[j].length <= start) )
+		{
+			j++;
+		}
+		for ( k = j; (k < other->count) && (start < end)
+			&& (ret_wfs == WFS_SUCCESS); k++ )
+		{
+			if ( other->extents[k].start >= end )
+			{
+				break;
+			}
+			if ( other->extents[k].start > start )
+			{
+				ret_wfs = wfs_extmap_add (&result, start,
+					other->extents[k].start - start);
+			}
+			if ( other->extents[k].start + other->extents[k].length
+				> start )
+			{
+				start = other->extents[k].start
+					+ other->extents[k].length;
+			}
+		}
+		if ( (ret_wfs == WFS_SUCCESS) && (start < end) )
+		{
+			ret_wfs = wfs_extmap_add (&result, start, end - start);
+		}
+	}
+	if ( ret_wfs != WFS_SUCCESS )
+	{
+		wfs_extmap_free (&result);
+		return ret_wfs;
+	}
+	wfs_extmap_free (map);
+	*map = result;
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+/**
+ * Frees the memory used by the given free-extent map and makes it empty.
+ * \param map The map to free.
+ */
+void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_free (
+#ifdef WFS_ANSIC
+	wfs_extent_map_t * const map)
+#else
+	map)
+	wfs_extent_map_t * const map;
+#endif
+{
+	if ( map == NULL )
+	{
+		return;
+	}
+	if ( map->extents != NULL )
+	{
+		free (map->extents);
+	}
+	wfs_extmap_init (map);
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells how many blocks of the given size fit in one write.
+ * \param fs_block_size The size of a single block.
+ * \return The number of blocks to write at once (at least 1).
+ */
+size_t GCC_WARN_UNUSED_RESULT
+wfs_extmap_chunk_blocks (
+#ifdef WFS_ANSIC
+	const size_t fs_block_size)
+#else
+	fs_block_size)
+	const size_t fs_block_size;
+#endif
+{
+	if ( (fs_block_size == 0) || (fs_block_size >= WFS_WRITE_CHUNK_SIZE) )
+	{
+		return 1;
+	}
+	return WFS_WRITE_CHUNK_SIZE / fs_block_size;
+}
+
+/* ======================================================================== */
+
+/**
+ * Chooses the write sizes to try on a device: from 256kB to 8MB, each
+ *	a multiple of the device's preferred size and, above the largest
+ *	request size, of the largest request size (so that the kernel can
+ *	split the write into full requests, sent to the device together).
+ *	The largest size is not tried on spinning disks.
+ * \param hints The device's preferred sizes of I/O requests.
+ * \param fs_block_size The size of a single block.
+ * \param sizes The array for the sizes, in blocks, in ascending order.
+ * \return The number of sizes put in the array (at least 1).
+ */
+size_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_io_sizes (
+#ifdef WFS_ANSIC
+	const wfs_io_hints_t * const hints, const size_t fs_block_size,
+	size_t sizes[WFS_IO_SIZES])
+#else
+	hints, fs_block_size, sizes)
+	const wfs_io_hints_t * const hints;
+	const size_t fs_block_size;
+	size_t sizes[WFS_IO_SIZES];
+#endif
+{
+	static const unsigned long int base_sizes[WFS_IO_SIZES] =
+	{
+		256 * 1024, 1024 * 1024, 4 * 1024 * 1024, 8 * 1024 * 1024
+	};
+	unsigned long int block_size = fs_block_size;
+	unsigned long int align;
+	unsigned long int size;
+	size_t count = 0;
+	size_t i;
+
+	if ( (hints == NULL) || (sizes == NULL) )
+	{
+		return 0;
+	}
+	if ( block_size == 0 )
+	{
+		block_size = 1;
+	}
+	align = block_size;
+	if ( (hints->minimum_io_size > align)
+		&& (hints->minimum_io_size <= WFS_IO_ALIGN_MAX) )
+	{
+		align = hints->minimum_io_size;
+	}
+	if ( (hints->optimal_io_size > align)
+		&& (hints->optimal_io_size <= WFS_IO_ALIGN_MAX) )
+	{
+		align = hints->optimal_io_size;
+	}
+	align = ((align + block_size - 1) / block_size) * block_size;
+
+	for ( i = 0; i < WFS_IO_SIZES; i++ )
+	{
+		if ( (i == WFS_IO_SIZES - 1) && (hints->rotational == 1) )
+		{
+			break;
+		}
+		size = ((base_sizes[i] + align - 1) / align) * align;
+		if ( (hints->max_io_size != 0) && (size > hints->max_io_size)
+			&& (hints->max_io_size % align == 0) )
+		{
+			size = ((size + hints->max_io_size - 1)
+				/ hints->max_io_size) * hints->max_io_size;
+		}
+		if ( (count > 0) && (size / block_size <= sizes[count - 1]) )
+		{
+			continue;
+		}
+		sizes[count] = (size_t) (size / block_size);
+		count++;
+	}
+	return count;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_drop_zero_blocks WFS_PARAMS ((
+	wfs_extent_map_t * const map, unsigned char * const buf,
+	const size_t chunk_blocks, const size_t fs_block_size,
+	const wfs_extent_ops_t * const ops, wfs_errcode_t * const error));
+#endif
+
+/**
+ * Removes the blocks which contain only zeros from the given map.
+ * \param map The map to update.
+ * \param buf A buffer for reading.
+ * \param chunk_blocks The number of blocks the buffer can hold.
+ * \param fs_block_size The size of a single block.
+ * \param ops The backend's operations.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_drop_zero_blocks (
+#ifdef WFS_ANSIC
+	wfs_extent_map_t * const map, unsigned char * const buf,
+	const size_t chunk_blocks, const size_t fs_block_size,
+	const wfs_extent_ops_t * const ops, wfs_errcode_t * const error)
+#else
+	map, buf, chunk_blocks, fs_block_size, ops, error)
+	wfs_extent_map_t * const map;
+	unsigned char * const buf;
+	const size_t chunk_blocks;
+	const size_t fs_block_size;
+	const wfs_extent_ops_t * const ops;
+	wfs_errcode_t * const error;
+#endif
+{
+	wfs_errcode_t ret_zero = WFS_SUCCESS;
+	wfs_extent_map_t nonzero;
+	size_t e;
+	size_t i;
+	wfs_blkno_t offset;
+	wfs_blkno_t to_read;
+	double read_start = 0.0;
+
+	if ( (map == NULL) || (buf == NULL) || (ops == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	if ( ops->read_blocks == NULL )
+	{
+		return WFS_SUCCESS;
+	}
+	wfs_extmap_init (&nonzero);
+	for ( e = 0; (e < map->count) && (sig_recvd == 0)
+		&& (ret_zero == WFS_SUCCESS); e++ )
+	{
+		for ( offset = 0; (offset < map->extents[e].length)
+			&& (sig_recvd == 0) && (ret_zero == WFS_SUCCESS);
+			offset += to_read )
+		{
+			to_read = map->extents[e].length - offset;
+			if ( to_read > chunk_blocks )
+			{
+				to_read = chunk_blocks;
+			}
+			if ( wfs_stats_is_enabled () != 0 )
+			{
+				read_start = wfs_get_time ();
+			}
+			ret_zero = (*(ops->read_blocks)) (ops->data, buf,
+				map->extents[e].start + offset, to_read, error);
+			if ( ret_zero != WFS_SUCCESS )
+			{
+				break;
+			}
+			if ( wfs_stats_is_enabled () != 0 )
+			{
+				wfs_stats_add_read (to_read * fs_block_size,
+					wfs_get_time () - read_start);
+			}
+			wfs_progress_add (0, to_read * fs_block_size);
+			for ( i = 0; i < to_read; i++ )
+			{
+				if ( wfs_is_block_zero (&buf[i * fs_block_size],
+					fs_block_size) != 0 )
+				{
+					/* this block is all-zeros - don't wipe, as requested */
+					continue;
+				}
+				ret_zero = wfs_extmap_add (&nonzero,
+					map->extents[e].start + offset + i, 1);
+				if ( ret_zero != WFS_SUCCESS )
+				{
+					break;
+				}
+			}
+		}
+	}
+	wfs_extmap_free (map);
+	*map = nonzero;
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_zero;
+}
+
+/* ======================================================================== */
+
+/**
+ * Writes WFS_PATTERN_UNIT_SIZE bytes of a pattern, repeated, to the given
+ *	area of a device. Many copies of the pattern go to the device in one
+ *	gather write, if possible, so that no big buffer needs to be filled.
+ *	After a partial write, the writing starts again from the end of the
+ *	last whole copy, so that the writes stay aligned for the direct I/O.
+ * \param fd The file descriptor of the device.
+ * \param unit The pattern to write, WFS_PATTERN_UNIT_SIZE bytes long.
+ * \param offset The offset of the area on the device, in bytes.
+ * \param length The length of the area, in bytes.
+ * \return 0 in case of no errors, the error number otherwise.
+ */
+int GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_pwrite_pattern (
+#ifdef WFS_ANSIC
+	const int fd, unsigned char * const unit, const wfs_blkno_t offset,
+	const wfs_blkno_t length)
+#else
+	fd, unit, offset, length)
+	const int fd;
+	unsigned char * const unit;
+	const wfs_blkno_t offset;
+	const wfs_blkno_t length;
+#endif
+{
+#ifdef HAVE_PWRITE
+# ifdef WFS_HAVE_PWRITEV
+	struct iovec iov[WFS_GATHER_UNITS];
+	int n;
+# endif
+	wfs_blkno_t done = 0;
+	size_t size;
+	ssize_t res;
+
+	if ( unit == NULL )
+	{
+		return EINVAL;
+	}
+	while ( (done < length) && (sig_recvd == 0) )
+	{
+# ifdef WFS_HAVE_PWRITEV
+		size = 0;
+		for ( n = 0; (n < WFS_GATHER_UNITS) && (size < length - done); n++ )
+		{
+			iov[n].iov_base = unit;
+			iov[n].iov_len = WFS_PATTERN_UNIT_SIZE;
+			if ( iov[n].iov_len > length - done - size )
+			{
+				iov[n].iov_len = (size_t)(length - done - size);
+			}
+			size += iov[n].iov_len;
+		}
+		WFS_SET_ERRNO (0);
+		res = pwritev (fd, iov, n, (off_t)(offset + done));
+# else
+		size = WFS_PATTERN_UNIT_SIZE;
+		if ( size > length - done )
+		{
+			size = (size_t)(length - done);
+		}
+		WFS_SET_ERRNO (0);
+		res = pwrite (fd, unit, size, (off_t)(offset + done));
+# endif
+		if ( res <= 0 )
+		{
+			return WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		}
+		if ( (size_t) res < size )
+		{
+			/* continuing in the middle of a copy would make
+			   an unaligned write - write the rest of it again */
+			if ( (size_t) res < WFS_PATTERN_UNIT_SIZE )
+			{
+				return EIO;
+			}
+			res -= res % WFS_PATTERN_UNIT_SIZE;
+		}
+		done += (wfs_blkno_t) res;
+	}
+	return 0;
+#else
+	return ENOSYS;
+#endif
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_extmap_fill WFS_PARAMS ((const unsigned long int pass,
+	unsigned char * const buf, const size_t size,
+	const wfs_fsid_t wfs_fs));
+#endif
+
+/**
+ * Fills the buffer with the pattern for the given pass, counting the time
+ *	it takes in the statistics.
+ * \param pass The pass.
+ * \param buf The buffer.
+ * \param size The size of the buffer.
+ * \param wfs_fs The filesystem.
+ */
+static void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_fill (
+#ifdef WFS_ANSIC
+	const unsigned long int pass, unsigned char * const buf,
+	const size_t size, const wfs_fsid_t wfs_fs)
+#else
+	pass, buf, size, wfs_fs)
+	const unsigned long int pass;
+	unsigned char * const buf;
+	const size_t size;
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	double fill_start;
+
+	if ( wfs_stats_is_enabled () == 0 )
+	{
+		wfs_fill_buffer (pass, buf, size, wfs_fs);
+		return;
+	}
+	fill_start = wfs_get_time ();
+	wfs_fill_buffer (pass, buf, size, wfs_fs);
+	wfs_stats_add_fill (wfs_get_time () - fill_start);
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_write WFS_PARAMS ((
+	wfs_extmap_writer_t * const writer, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	wfs_errcode_t * const error));
+#endif
+
+/**
+ * Writes the buffer to consecutive blocks, using the backend's pattern
+ *	writing function, if any, within the user's limit of the writing rate.
+ *	In random passes, the buffer is filled here, with a new pattern for
+ *	each block, and written as a whole.
+ * \param writer The writing state.
+ * \param buf The buffer to write.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_write (
+#ifdef WFS_ANSIC
+	wfs_extmap_writer_t * const writer, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	wfs_errcode_t * const error)
+#else
+	writer, buf, start, count, error)
+	wfs_extmap_writer_t * const writer;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+#endif
+{
+	const wfs_extent_ops_t * const ops = writer->ops;
+	wfs_errcode_t ret_wfs;
+	double write_start = 0.0;
+	double rate;
+	wfs_blkno_t i;
+
+	if ( writer->random != 0 )
+	{
+		/* a random pass - a new pattern for each block */
+		for ( i = 0; (i < count) && (sig_recvd == 0); i++ )
+		{
+			wfs_extmap_fill (writer->fill_pass,
+				&buf[i * writer->fs_block_size],
+				writer->fs_block_size, *(writer->fs));
+		}
+		if ( sig_recvd != 0 )
+		{
+			return WFS_SIGNAL;
+		}
+	}
+	wfs_rate_limit_wait (&(writer->limit),
+		(size_t)(count * writer->fs_block_size));
+	if ( (writer->probed < writer->nsizes) || (wfs_stats_is_enabled () != 0) )
+	{
+		write_start = wfs_get_time ();
+	}
+	if ( (ops->write_pattern != NULL) && (writer->random == 0) )
+	{
+		ret_wfs = (*(ops->write_pattern)) (ops->data, buf, start, count, error);
+	}
+	else
+	{
+		ret_wfs = (*(ops->write_blocks)) (ops->data, buf, start, count, error);
+	}
+	if ( ret_wfs == WFS_SUCCESS )
+	{
+		if ( wfs_stats_is_enabled () != 0 )
+		{
+			wfs_stats_add_write (count * writer->fs_block_size,
+				wfs_get_time () - write_start);
+		}
+		wfs_progress_add (count * writer->fs_block_size, 0);
+	}
+	if ( (writer->probed < writer->nsizes) && (ret_wfs == WFS_SUCCESS) )
+	{
+		writer->probe_time += wfs_get_time () - write_start;
+		writer->probe_blocks += count;
+		writer->probe_writes++;
+		if ( (writer->probe_writes >= WFS_PROBE_WRITES)
+			&& (writer->probe_time >= WFS_PROBE_TIME) )
+		{
+			/* measured long enough - remember the speed, try the next size */
+			rate = (double) writer->probe_blocks / writer->probe_time;
+			if ( rate > writer->best_rate )
+			{
+				writer->best_rate = rate;
+				writer->best_blocks = writer->chunk_blocks;
+			}
+			writer->probed++;
+			writer->probe_time = 0.0;
+			writer->probe_blocks = 0;
+			writer->probe_writes = 0;
+			if ( writer->probed < writer->nsizes )
+			{
+				writer->chunk_blocks = writer->sizes[writer->probed];
+			}
+			else
+			{
+				writer->chunk_blocks = writer->best_blocks;
+			}
+		}
+	}
+	return ret_wfs;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_extmap_barrier WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+	const wfs_extent_ops_t * const ops, wfs_errcode_t * const error));
+#endif
+
+/**
+ * Makes the blocks written so far reach the media. Uses the backend's
+ *	data-only synchronization, if any, and flushes the whole filesystem
+ *	otherwise.
+ * \param wfs_fs The filesystem.
+ * \param ops The backend's operations.
+ * \param error Pointer to the error variable.
+ */
+static void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_barrier (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const wfs_extent_ops_t * const ops,
+	wfs_errcode_t * const error)
+#else
+	wfs_fs, ops, error)
+	const wfs_fsid_t wfs_fs;
+	const wfs_extent_ops_t * const ops;
+	wfs_errcode_t * const error;
+#endif
+{
+	double sync_start = 0.0;
+
+	if ( wfs_stats_is_enabled () != 0 )
+	{
+		sync_start = wfs_get_time ();
+	}
+	if ( (ops->sync_blocks == NULL)
+		|| ((*(ops->sync_blocks)) (ops->data, error) != WFS_SUCCESS) )
+	{
+		if ( ops->flush_fs != NULL )
+		{
+			(*(ops->flush_fs)) (wfs_fs);
+		}
+	}
+	if ( wfs_stats_is_enabled () != 0 )
+	{
+		wfs_stats_add_sync (wfs_get_time () - sync_start);
+	}
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_extmap_checkpoint WFS_PARAMS ((
+	wfs_extmap_writer_t * const writer, const int force,
+	wfs_errcode_t * const error));
+#endif
+
+/**
+ * Saves the position of wiping in the state file, if one is used, no more
+ *	often than every WFS_STATE_INTERVAL seconds, unless forced. The blocks
+ *	written so far are made to reach the media first, so that they don't
+ *	need to be wiped again when resuming.
+ * \param writer The writing state.
+ * \param force Non-zero to save the position regardless of the time.
+ * \param error Pointer to the error variable.
+ */
+static void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_checkpoint (
+#ifdef WFS_ANSIC
+	wfs_extmap_writer_t * const writer, const int force,
+	wfs_errcode_t * const error)
+#else
+	writer, force, error)
+	wfs_extmap_writer_t * const writer;
+	const int force;
+	wfs_errcode_t * const error;
+#endif
+{
+	double now;
+
+	if ( wfs_state_is_enabled () == 0 )
+	{
+		return;
+	}
+	now = wfs_get_time ();
+	if ( (force == 0) && (now - writer->last_save < WFS_STATE_INTERVAL) )
+	{
+		return;
+	}
+	wfs_extmap_barrier (*(writer->fs), writer->ops, error);
+	wfs_state_save_position (*(writer->fs), writer->key, writer->pass,
+		writer->position);
+	writer->last_save = now;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static unsigned long int GCC_WARN_UNUSED_RESULT wfs_extmap_key WFS_PARAMS ((
+	const wfs_extent_map_t * const map));
+#endif
+
+/**
+ * Computes an identifier of the blocks in the given map, to check if the
+ *	free space has changed since the position of wiping was saved.
+ * \param map The map of blocks.
+ * \return The identifier, never zero.
+ */
+static unsigned long int GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_key (
+#ifdef WFS_ANSIC
+	const wfs_extent_map_t * const map)
+#else
+	map)
+	const wfs_extent_map_t * const map;
+#endif
+{
+	/* FNV-1a, limited to 32 bits to be the same everywhere */
+	unsigned long int key = 2166136261UL;
+	size_t i;
+	unsigned int j;
+	wfs_blkno_t values[2];
+	unsigned int v;
+
+	for ( i = 0; i < map->count; i++ )
+	{
+		values[0] = map->extents[i].start;
+		values[1] = map->extents[i].length;
+		for ( v = 0; v < 2; v++ )
+		{
+			for ( j = 0; j < sizeof (wfs_blkno_t); j++ )
+			{
+				key ^= (unsigned long int) (values[v] & 0xFF);
+				key = (key * 16777619UL) & 0xFFFFFFFFUL;
+				values[v] >>= 8;
+			}
+		}
+	}
+	if ( key == 0 )
+	{
+		key = 1;
+	}
+	return key;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_blkno_t GCC_WARN_UNUSED_RESULT wfs_extmap_blocks_before WFS_PARAMS ((
+	const wfs_extent_map_t * const map, const wfs_blkno_t block));
+#endif
+
+/**
+ * Counts the blocks in the given map which are before the given block.
+ * \param map The map of blocks.
+ * \param block The block number.
+ * \return The number of blocks in the map before the given block.
+ */
+static wfs_blkno_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_blocks_before (
+#ifdef WFS_ANSIC
+	const wfs_extent_map_t * const map, const wfs_blkno_t block)
+#else
+	map, block)
+	const wfs_extent_map_t * const map;
+	const wfs_blkno_t block;
+#endif
+{
+	wfs_blkno_t before = 0;
+	size_t e;
+
+	for ( e = 0; (e < map->count) && (map->extents[e].start < block); e++ )
+	{
+		if ( map->extents[e].start + map->extents[e].length <= block )
+		{
+			before += map->extents[e].length;
+		}
+		else
+		{
+			before += block - map->extents[e].start;
+		}
+	}
+	return before;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_write_all WFS_PARAMS ((
+	const wfs_extent_map_t * const map, unsigned char * const buf,
+	wfs_extmap_writer_t * const writer, const wfs_blkno_t first_block,
+	wfs_blkno_t * const done, const wfs_blkno_t total,
+	unsigned int * const prev_percent, wfs_errcode_t * const error));
+#endif
+
+/**
+ * Writes the contents of the buffer to all the blocks in the given map,
+ *	saving the position in the state file from time to time.
+ * \param map The map of blocks to write.
+ * \param buf The buffer to write.
+ * \param writer The writing state.
+ * \param first_block The block to start at (the blocks before it are
+ *	skipped).
+ * \param done The number of blocks already written, updated here.
+ * \param total The number of blocks to write in all, for the progress
+ *	display. Zero means no progress display.
+ * \param prev_percent Pointer to the last displayed progress value.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_write_all (
+#ifdef WFS_ANSIC
+	const wfs_extent_map_t * const map, unsigned char * const buf,
+	wfs_extmap_writer_t * const writer, const wfs_blkno_t first_block,
+	wfs_blkno_t * const done, const wfs_blkno_t total,
+	unsigned int * const prev_percent, wfs_errcode_t * const error)
+#else
+	map, buf, writer, first_block, done, total, prev_percent, error)
+	const wfs_extent_map_t * const map;
+	unsigned char * const buf;
+	wfs_extmap_writer_t * const writer;
+	const wfs_blkno_t first_block;
+	wfs_blkno_t * const done;
+	const wfs_blkno_t total;
+	unsigned int * const prev_percent;
+	wfs_errcode_t * const error;
+#endif
+{
+	wfs_errcode_t ret_wr = WFS_SUCCESS;
+	size_t e;
+	wfs_blkno_t offset;
+	wfs_blkno_t to_write;
+
+	for ( e = 0; (e < map->count) && (sig_recvd == 0)
+		&& (ret_wr == WFS_SUCCESS); e++ )
+	{
+		if ( map->extents[e].start + map->extents[e].length <= first_block )
+		{
+			continue;
+		}
+		offset = 0;
+		if ( map->extents[e].start < first_block )
+		{
+			offset = first_block - map->extents[e].start;
+		}
+		for ( ; (offset < map->extents[e].length)
+			&& (sig_recvd == 0) && (ret_wr == WFS_SUCCESS);
+			offset += to_write )
+		{
+			to_write = map->extents[e].length - offset;
+			if ( to_write > writer->chunk_blocks )
+			{
+				to_write = writer->chunk_blocks;
+			}
+			ret_wr = wfs_extmap_write (writer, buf,
+				map->extents[e].start + offset, to_write, error);
+			if ( ret_wr == WFS_SUCCESS )
+			{
+				writer->position = map->extents[e].start
+					+ offset + to_write;
+				wfs_extmap_checkpoint (writer, 0, error);
+			}
+			*done += to_write;
+			if ( total != 0 )
+			{
+				wfs_show_progress (WFS_PROGRESS_WFS,
+					(unsigned int)((*done * 100) / total),
+					prev_percent);
+			}
+		}
+	}
+	return ret_wr;
+}
+
+/* ======================================================================== */
+
+#ifdef WFS_HAVE_DIRECT_IO
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_direct_rw WFS_PARAMS ((
+	const wfs_direct_io_t * const io, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	const int write_blocks, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads or writes consecutive blocks using direct I/O.
+ * \param io The direct I/O descriptor.
+ * \param buf The buffer for the data, aligned for direct I/O.
+ * \param start The first block to read or write.
+ * \param count The number of blocks to read or write.
+ * \param write_blocks Non-zero to write the blocks, zero to read them.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_extmap_direct_rw (
+# ifdef WFS_ANSIC
+	const wfs_direct_io_t * const io, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	const int write_blocks, wfs_errcode_t * const error)
+# else
+	io, buf, start, count, write_blocks, error)
+	const wfs_direct_io_t * const io;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	const int write_blocks;
+	wfs_errcode_t * const error;
+# endif
+{
+	ssize_t res;
+	size_t size;
+	off_t offset;
+
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	size = (size_t)(count * io->fs_block_size);
+	offset = (off_t)(start * io->fs_block_size);
+	WFS_SET_ERRNO (0);
+	if ( write_blocks != 0 )
+	{
+		res = pwrite (io->fd, buf, size, offset);
+	}
+	else
+	{
+		res = pread (io->fd, buf, size, offset);
+	}
+	if ( res != (ssize_t)size )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return (write_blocks != 0)? WFS_BLKWR : WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_direct_read WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive blocks using direct I/O.
+ * \param data Pointer to a 'wfs_direct_io_t'.
+ * \param buf The buffer for the data.
+ * \param start The first block to read.
+ * \param count The number of blocks to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_extmap_direct_read (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	return wfs_extmap_direct_rw ((wfs_direct_io_t *) data, buf,
+		start, count, 0, error);
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_direct_blocks WFS_PARAMS ((
+	const wfs_direct_io_t * const io, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	const int pattern, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive blocks one at a time, after writing them all at once
+ *	failed (e.g. because of a bad sector). The blocks which can't be written
+ *	directly are given to the backend's function, which knows how to handle
+ *	bad blocks.
+ * \param io The direct I/O descriptor.
+ * \param buf The buffer with the data.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param pattern Non-zero if the buffer holds WFS_PATTERN_UNIT_SIZE bytes
+ *	of a pattern to repeat, zero if it holds all the blocks.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_extmap_direct_blocks (
+# ifdef WFS_ANSIC
+	const wfs_direct_io_t * const io, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	const int pattern, wfs_errcode_t * const error)
+# else
+	io, buf, start, count, pattern, error)
+	const wfs_direct_io_t * const io;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	const int pattern;
+	wfs_errcode_t * const error;
+# endif
+{
+	wfs_errcode_t ret_wr = WFS_SUCCESS;
+	wfs_blkno_t i;
+	unsigned char * data;
+	int res;
+
+	for ( i = 0; (i < count) && (sig_recvd == 0); i++ )
+	{
+		if ( pattern != 0 )
+		{
+			/* each block starts with the beginning of the pattern */
+			data = buf;
+			res = wfs_extmap_pwrite_pattern (io->fd, buf,
+				(start + i) * io->fs_block_size, io->fs_block_size);
+			if ( res == 0 )
+			{
+				continue;
+			}
+			if ( io->fs_block_size > WFS_PATTERN_UNIT_SIZE )
+			{
+				/* no whole block in the buffer for the backend */
+				*error = (wfs_errcode_t) res;
+				return WFS_BLKWR;
+			}
+		}
+		else
+		{
+			data = &buf[i * io->fs_block_size];
+			if ( wfs_extmap_direct_rw (io, data, start + i, 1, 1, error)
+				== WFS_SUCCESS )
+			{
+				continue;
+			}
+		}
+		if ( io->backend.write_blocks == NULL )
+		{
+			return WFS_BLKWR;
+		}
+		ret_wr = (*(io->backend.write_blocks)) (io->backend.data, data,
+			start + i, 1, error);
+		if ( ret_wr != WFS_SUCCESS )
+		{
+			return ret_wr;
+		}
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_direct_write WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive blocks using direct I/O. If that fails, the blocks
+ *	are written one at a time.
+ * \param data Pointer to a 'wfs_direct_io_t'.
+ * \param buf The buffer with the data.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_extmap_direct_write (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	wfs_direct_io_t * io;
+
+	io = (wfs_direct_io_t *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	if ( wfs_extmap_direct_rw (io, buf, start, count, 1, error) == WFS_SUCCESS )
+	{
+		return WFS_SUCCESS;
+	}
+	return wfs_extmap_direct_blocks (io, buf, start, count, 0, error);
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_direct_write_pattern WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes a repeated pattern to consecutive blocks using direct I/O. If that
+ *	fails, the blocks are written one at a time.
+ * \param data Pointer to a 'wfs_direct_io_t'.
+ * \param buf The buffer with WFS_PATTERN_UNIT_SIZE bytes of the pattern.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_extmap_direct_write_pattern (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	wfs_direct_io_t * io;
+
+	io = (wfs_direct_io_t *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	if ( wfs_extmap_pwrite_pattern (io->fd, buf, start * io->fs_block_size,
+		count * io->fs_block_size) == 0 )
+	{
+		return WFS_SUCCESS;
+	}
+	return wfs_extmap_direct_blocks (io, buf, start, count, 1, error);
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_direct_sync WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written using direct I/O reach the media. Direct I/O
+ *	bypasses only the system's cache, not the device's one.
+ * \param data Pointer to a 'wfs_direct_io_t'.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_extmap_direct_sync (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	wfs_direct_io_t * io;
+	int res;
+
+	io = (wfs_direct_io_t *) data;
+	if ( (io == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	res = wfs_sync_fd (io->fd);
+	if ( res != 0 )
+	{
+		*error = (wfs_errcode_t) res;
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+#endif /* WFS_HAVE_DIRECT_IO */
+
+/* ======================================================================== */
+
+/**
+ * Opens the filesystem's device for direct I/O, bypassing the system's
+ *	cache, if the user requested it, and makes the given operations use
+ *	the device directly. The blocks must be numbered from the start of the
+ *	device. If direct I/O is unavailable, the operations are not changed
+ *	and the user is told about it.
+ * \param wfs_fs The filesystem.
+ * \param fs_block_size The size of a single block.
+ * \param io The direct I/O descriptor to fill.
+ * \param ops The backend's operations to update.
+ */
+void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_direct_open (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const size_t fs_block_size,
+	wfs_direct_io_t * const io, wfs_extent_ops_t * const ops)
+#else
+	wfs_fs, fs_block_size, io, ops)
+	const wfs_fsid_t wfs_fs;
+	const size_t fs_block_size;
+	wfs_direct_io_t * const io;
+	wfs_extent_ops_t * const ops;
+#endif
+{
+#ifdef WFS_HAVE_DIRECT_IO
+	int sector_size = 512;
+#endif
+
+	if ( io == NULL )
+	{
+		return;
+	}
+	io->fd = -1;
+	io->fs_block_size = fs_block_size;
+	if ( (ops == NULL) || (wfs_fs.use_direct == 0) )
+	{
+		return;
+	}
+	if ( (wfs_fs.fsname == NULL) || (fs_block_size == 0) )
+	{
+		wfs_show_msg (0, msg_nodirect, "", wfs_fs);
+		return;
+	}
+#ifdef WFS_HAVE_DIRECT_IO
+	io->fd = open (wfs_fs.fsname, O_RDWR | O_DIRECT);
+	if ( io->fd < 0 )
+	{
+		io->fd = -1;
+		wfs_show_msg (0, msg_nodirect, "", wfs_fs);
+		return;
+	}
+# if (defined HAVE_IOCTL) && (defined BLKSSZGET)
+	if ( ioctl (io->fd, BLKSSZGET, &sector_size) != 0 )
+	{
+		sector_size = 512;
+	}
+# endif
+	/* all the transfers must be multiples of the logical block size */
+	if ( (sector_size <= 0) || ((fs_block_size % (size_t) sector_size) != 0)
+		|| (WFS_BUFFER_ALIGN % sector_size != 0) )
+	{
+		close (io->fd);
+		io->fd = -1;
+		wfs_show_msg (0, msg_nodirect, "", wfs_fs);
+		return;
+	}
+	/* the backend's writing is used for the blocks which fail */
+	io->backend = *ops;
+	ops->read_blocks = &wfs_extmap_direct_read;
+	ops->write_blocks = &wfs_extmap_direct_write;
+	ops->write_pattern = &wfs_extmap_direct_write_pattern;
+	ops->sync_blocks = &wfs_extmap_direct_sync;
+	ops->data = io;
+#else
+	wfs_show_msg (0, msg_nodirect, "", wfs_fs);
+#endif
+}
+
+/* ======================================================================== */
+
+/**
+ * Closes the device opened for direct I/O, if any.
+ * \param io The direct I/O descriptor.
+ */
+void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_direct_close (
+#ifdef WFS_ANSIC
+	wfs_direct_io_t * const io)
+#else
+	io)
+	wfs_direct_io_t * const io;
+#endif
+{
+	if ( io == NULL )
+	{
+		return;
+	}
+#ifdef WFS_HAVE_DIRECT_IO
+	if ( io->fd >= 0 )
+	{
+		close (io->fd);
+	}
+#endif
+	io->fd = -1;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_write_range WFS_PARAMS ((
+	const wfs_extent_map_t * const map, unsigned char * const buf,
+	wfs_extmap_writer_t * const writer,
+	size_t first_extent, wfs_blkno_t first_offset, wfs_blkno_t nblocks,
+	wfs_errcode_t * const error));
+#endif
+
+/**
+ * Writes the contents of the buffer to the given number of blocks in the
+ *	given map, starting at the given position.
+ * \param map The map of blocks to write.
+ * \param buf The buffer to write.
+ * \param writer The writing state.
+ * \param first_extent The index of the extent to start in.
+ * \param first_offset The block in the first extent to start at.
+ * \param nblocks The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_write_range (
+#ifdef WFS_ANSIC
+	const wfs_extent_map_t * const map, unsigned char * const buf,
+	wfs_extmap_writer_t * const writer,
+	size_t first_extent, wfs_blkno_t first_offset, wfs_blkno_t nblocks,
+	wfs_errcode_t * const error)
+#else
+	map, buf, writer, first_extent, first_offset, nblocks, error)
+	const wfs_extent_map_t * const map;
+	unsigned char * const buf;
+	wfs_extmap_writer_t * const writer;
+	size_t first_extent;
+	wfs_blkno_t first_offset;
+	wfs_blkno_t nblocks;
+	wfs_errcode_t * const error;
+#endif
+{
+	wfs_errcode_t ret_wr = WFS_SUCCESS;
+	wfs_blkno_t to_write;
+
+	while ( (nblocks > 0) && (first_extent < map->count)
+		&& (sig_recvd == 0) && (ret_wr == WFS_SUCCESS) )
+	{
+		to_write = map->extents[first_extent].length - first_offset;
+		if ( to_write > writer->chunk_blocks )
+		{
+			to_write = writer->chunk_blocks;
+		}
+		if ( to_write > nblocks )
+		{
+			to_write = nblocks;
+		}
+		ret_wr = wfs_extmap_write (writer, buf,
+			map->extents[first_extent].start + first_offset,
+			to_write, error);
+		nblocks -= to_write;
+		first_offset += to_write;
+		if ( first_offset >= map->extents[first_extent].length )
+		{
+			first_extent++;
+			first_offset = 0;
+		}
+	}
+	return ret_wr;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_extmap_wipe_chunks WFS_PARAMS ((
+	const wfs_fsid_t wfs_fs, const wfs_extent_map_t * const map,
+	unsigned char * const buf, const size_t fill_size,
+	const wfs_blkno_t group_blocks, const int extent_groups,
+	const wfs_blkno_t first_block, wfs_extmap_writer_t * const writer,
+	unsigned int * const prev_percent, wfs_errcode_t * const error));
+#endif
+
+/**
+ * Wipes the blocks in the given map in chunk order: all the passes are
+ *	performed on a group of free blocks, then the next group is wiped,
+ *	and so on. The block order is the chunk order with groups which end
+ *	at the end of each free extent.
+ * \param wfs_fs The filesystem.
+ * \param map The map of blocks to wipe.
+ * \param buf The buffer for the data.
+ * \param fill_size The number of bytes of the buffer to fill.
+ * \param group_blocks The maximum number of blocks in a group.
+ * \param extent_groups If non-zero, a group never spans two free extents.
+ * \param first_block The block to start at (the blocks before it are
+ *	skipped). The position is saved in the state file after each group.
+ * \param writer The writing state.
+ * \param prev_percent Pointer to the last displayed progress value.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_wipe_chunks (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const wfs_extent_map_t * const map,
+	unsigned char * const buf, const size_t fill_size,
+	const wfs_blkno_t group_blocks, const int extent_groups,
+	const wfs_blkno_t first_block, wfs_extmap_writer_t * const writer,
+	unsigned int * const prev_percent, wfs_errcode_t * const error)
+#else
+	wfs_fs, map, buf, fill_size, group_blocks, extent_groups, first_block,
+	writer, prev_percent, error)
+	const wfs_fsid_t wfs_fs;
+	const wfs_extent_map_t * const map;
+	unsigned char * const buf;
+	const size_t fill_size;
+	const wfs_blkno_t group_blocks;
+	const int extent_groups;
+	const wfs_blkno_t first_block;
+	wfs_extmap_writer_t * const writer;
+	unsigned int * const prev_percent;
+	wfs_errcode_t * const error;
+#endif
+{
+	wfs_errcode_t ret_wfs = WFS_SUCCESS;
+	unsigned long int j;
+	wfs_blkno_t group_length;
+	wfs_blkno_t left;
+	wfs_blkno_t done;
+	size_t e = 0;
+	wfs_blkno_t offset = 0;
+	size_t next_e;
+	wfs_blkno_t next_offset;
+	size_t group_fill = fill_size;
+
+	/* a group never needs more of the buffer than its own blocks */
+	if ( (writer->fs_block_size != 0)
+		&& (group_blocks < fill_size / writer->fs_block_size) )
+	{
+		group_fill = (size_t) group_blocks * writer->fs_block_size;
+	}
+
+	/* skip the blocks wiped before */
+	while ( (e < map->count)
+		&& (map->extents[e].start + map->extents[e].length <= first_block) )
+	{
+		e++;
+	}
+	if ( (e < map->count) && (map->extents[e].start < first_block) )
+	{
+		offset = first_block - map->extents[e].start;
+	}
+	done = wfs_extmap_blocks_before (map, first_block);
+	writer->pass = 0;
+	writer->position = first_block;
+
+	while ( (e < map->count) && (sig_recvd == 0) && (ret_wfs == WFS_SUCCESS) )
+	{
+		/* find the end of this group of blocks */
+		next_e = e;
+		next_offset = offset;
+		group_length = 0;
+		while ( (next_e < map->count) && (group_length < group_blocks) )
+		{
+			left = map->extents[next_e].length - next_offset;
+			if ( left > group_blocks - group_length )
+			{
+				left = group_blocks - group_length;
+			}
+			group_length += left;
+			next_offset += left;
+			if ( next_offset >= map->extents[next_e].length )
+			{
+				next_e++;
+				next_offset = 0;
+				if ( extent_groups != 0 )
+				{
+					break;
+				}
+			}
+		}
+		/* all the passes over this group before moving on */
+		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0)
+			&& (ret_wfs == WFS_SUCCESS); j++ )
+		{
+			wfs_progress_set_pass (j);
+			writer->fill_pass = j;
+			writer->random = wfs_is_random_pass (j, wfs_fs);
+			if ( writer->random == 0 )
+			{
+				wfs_extmap_fill (j, buf, group_fill, wfs_fs);
+			}
+			if ( sig_recvd != 0 )
+			{
+				ret_wfs = WFS_SIGNAL;
+				break;
+			}
+			ret_wfs = wfs_extmap_write_range (map, buf, writer,
+				e, offset, group_length, error);
+			/* this pass must reach the media before the next one */
+			if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
+			{
+				wfs_extmap_barrier (wfs_fs, writer->ops, error);
+			}
+		}
+		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0)
+			&& (ret_wfs == WFS_SUCCESS) )
+		{
+			/* last pass with zeros: */
+			wfs_progress_set_pass (wfs_fs.npasses);
+			writer->random = 0;
+			WFS_MEMSET (buf, 0, group_fill);
+			ret_wfs = wfs_extmap_write_range (map, buf, writer,
+				e, offset, group_length, error);
+			/* No need to flush the last writing of a given block. */
+		}
+		if ( (sig_recvd != 0) || (ret_wfs != WFS_SUCCESS) )
+		{
+			break;
+		}
+		done += group_length;
+		wfs_show_progress (WFS_PROGRESS_WFS,
+			(unsigned int)((done * 100) / map->total_blocks),
+			prev_percent);
+		e = next_e;
+		offset = next_offset;
+		/* this group is done - resume after it */
+		if ( e < map->count )
+		{
+			writer->position = map->extents[e].start + offset;
+		}
+		else
+		{
+			writer->position = map->extents[map->count - 1].start
+				+ map->extents[map->count - 1].length;
+		}
+		wfs_extmap_checkpoint (writer, 0, error);
+	}
+	return ret_wfs;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void WFS_ATTR ((nonnull)) wfs_extmap_show_blocks WFS_PARAMS ((
+	const wfs_fsid_t wfs_fs, const char * const msg,
+	const wfs_blkno_t count1, const wfs_blkno_t count2));
+#endif
+
+/**
+ * Displays a message with two numbers of blocks.
+ * \param wfs_fs The filesystem.
+ * \param msg The message.
+ * \param count1 The first number.
+ * \param count2 The second number.
+ */
+static void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_show_blocks (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const char * const msg,
+	const wfs_blkno_t count1, const wfs_blkno_t count2)
+#else
+	wfs_fs, msg, count1, count2)
+	const wfs_fsid_t wfs_fs;
+	const char * const msg;
+	const wfs_blkno_t count1;
+	const wfs_blkno_t count2;
+#endif
+{
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+	char tmp[60];
+
+	snprintf (tmp, sizeof (tmp) - 1, "%lu, %lu",
+		(unsigned long int) count1, (unsigned long int) count2);
+	tmp[sizeof (tmp) - 1] = '\0';
+	wfs_show_msg (1, msg, tmp, wfs_fs);
+#endif
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void WFS_ATTR ((nonnull)) wfs_extmap_show_io_size WFS_PARAMS ((
+	const wfs_fsid_t wfs_fs, const wfs_extmap_writer_t * const writer,
+	const wfs_io_hints_t * const hints));
+#endif
+
+/**
+ * Displays the write size chosen for the device and the number of
+ *	requests sent to the device at once with this size.
+ * \param wfs_fs The filesystem.
+ * \param writer The writing state.
+ * \param hints The device's preferred sizes of I/O requests.
+ */
+static void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_extmap_show_io_size (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const wfs_extmap_writer_t * const writer,
+	const wfs_io_hints_t * const hints)
+#else
+	wfs_fs, writer, hints)
+	const wfs_fsid_t wfs_fs;
+	const wfs_extmap_writer_t * const writer;
+	const wfs_io_hints_t * const hints;
+#endif
+{
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+	char tmp[60];
+	unsigned long int size;
+	unsigned long int in_flight = 1;
+
+	size = (unsigned long int) (writer->chunk_blocks * writer->fs_block_size);
+	if ( hints->max_io_size != 0 )
+	{
+		in_flight = (size + hints->max_io_size - 1) / hints->max_io_size;
+	}
+	snprintf (tmp, sizeof (tmp) - 1, "%lu, %lu", size, in_flight);
+	tmp[sizeof (tmp) - 1] = '\0';
+	wfs_show_msg (1, msg_io_size, tmp, wfs_fs);
+#endif
+}
+
+/* ======================================================================== */
+
+/**
+ * Wipes all the blocks in the given free-extent map, with all the passes
+ *	and in the order requested by the user, showing the progress.
+ * \param wfs_fs The filesystem.
+ * \param map The map of the free blocks. The all-zero blocks are removed
+ *	from it, if requested.
+ * \param fs_block_size The size of a single block.
+ * \param ops The backend's operations.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_wipe_extents (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, wfs_extent_map_t * const map,
+	const size_t fs_block_size, const wfs_extent_ops_t * const ops,
+	wfs_errcode_t * const error)
+#else
+	wfs_fs, map, fs_block_size, ops, error)
+	const wfs_fsid_t wfs_fs;
+	wfs_extent_map_t * const map;
+	const size_t fs_block_size;
+	const wfs_extent_ops_t * const ops;
+	wfs_errcode_t * const error;
+#endif
+{
+	wfs_errcode_t ret_wfs = WFS_SUCCESS;
+	unsigned long int j;
+	unsigned int prev_percent = 0;
+	unsigned char * buf;
+	size_t buf_blocks;
+	size_t read_blocks;
+	size_t fill_size;
+	size_t buf_size;
+	wfs_blkno_t group_blocks;
+	wfs_blkno_t done = 0;
+	wfs_extmap_writer_t writer;
+	wfs_io_hints_t hints;
+	unsigned long int first_pass = 0;
+	wfs_blkno_t first_block = 0;
+	wfs_blkno_t free_blocks;
+	wfs_blkno_t resumed;
+	unsigned long int all_passes;
+	int incremental = 0;
+	int random_passes = 0;
+#ifdef HAVE_POSIX_MEMALIGN
+	void * aligned;
+#endif
+
+	if ( (map == NULL) || (ops == NULL) || (error == NULL)
+		|| (fs_block_size == 0) )
+	{
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+		return WFS_BADPARAM;
+	}
+	if ( ops->write_blocks == NULL )
+	{
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+		return WFS_BADPARAM;
+	}
+	if ( wfs_fs.plan_only != 0 )
+	{
+		/* only show what would be wiped - with --incremental, the blocks
+		   freed since the last wiping. The snapshot stays unchanged. */
+		free_blocks = map->total_blocks;
+		if ( wfs_snapshot_begin (wfs_fs, map, fs_block_size,
+			&incremental) != 0 )
+		{
+			wfs_show_msg (0, msg_nosnapshot, "", wfs_fs);
+		}
+		wfs_snapshot_end (wfs_fs, 0);
+		if ( incremental != 0 )
+		{
+			wfs_extmap_show_blocks (wfs_fs, msg_snapshot,
+				map->total_blocks, free_blocks);
+		}
+		ret_wfs = wfs_plan_extents (wfs_fs, map, fs_block_size, ops, error);
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+		return ret_wfs;
+	}
+	read_blocks = wfs_extmap_chunk_blocks (fs_block_size);
+	writer.ops = ops;
+	writer.fs_block_size = fs_block_size;
+	wfs_rate_limit_init (&(writer.limit), wfs_fs.max_rate, wfs_fs.max_iops);
+	wfs_get_io_hints (wfs_fs.fsname, &hints);
+	writer.nsizes = wfs_extmap_io_sizes (&hints, fs_block_size, writer.sizes);
+	if ( (writer.nsizes == 0) || (wfs_fs.max_rate != 0)
+		|| (wfs_fs.max_iops != 0) )
+	{
+		/* the speed is limited anyway - don't measure it */
+		if ( ops->write_pattern != NULL )
+		{
+			writer.sizes[0] = (WFS_PATTERN_UNIT_SIZE * WFS_GATHER_UNITS)
+				/ fs_block_size;
+			if ( writer.sizes[0] == 0 )
+			{
+				writer.sizes[0] = 1;
+			}
+		}
+		else
+		{
+			writer.sizes[0] = read_blocks;
+		}
+		writer.nsizes = 1;
+	}
+	/* the first size is tried first, the rest - during the first seconds */
+	writer.chunk_blocks = writer.sizes[0];
+	writer.probed = (writer.nsizes > 1)? 0 : writer.nsizes;
+	writer.probe_time = 0.0;
+	writer.probe_blocks = 0;
+	writer.probe_writes = 0;
+	writer.best_rate = 0.0;
+	writer.best_blocks = writer.sizes[0];
+	buf_blocks = writer.sizes[writer.nsizes - 1];
+	if ( ops->write_pattern != NULL )
+	{
+		/* only one piece of the pattern is filled, the backend repeats it */
+		fill_size = WFS_PATTERN_UNIT_SIZE;
+	}
+	else
+	{
+		fill_size = buf_blocks * fs_block_size;
+	}
+	buf_size = fill_size;
+	writer.fill_pass = 0;
+	writer.random = 0;
+	for ( j = 0; j < wfs_fs.npasses; j++ )
+	{
+		if ( wfs_is_random_pass (j, wfs_fs) != 0 )
+		{
+			random_passes = 1;
+			break;
+		}
+	}
+	if ( (random_passes != 0) && (buf_size < buf_blocks * fs_block_size) )
+	{
+		/* random passes need a whole buffer of different patterns */
+		buf_size = buf_blocks * fs_block_size;
+	}
+	if ( (wfs_fs.no_wipe_zero_blocks != 0)
+		&& (buf_size < read_blocks * fs_block_size) )
+	{
+		buf_size = read_blocks * fs_block_size;
+	}
+
+	WFS_SET_ERRNO (0);
+#ifdef HAVE_POSIX_MEMALIGN
+	/* aligned, so that it can be used for direct I/O */
+	if ( posix_memalign (&aligned, WFS_BUFFER_ALIGN, buf_size) != 0 )
+	{
+		aligned = NULL;
+	}
+	buf = (unsigned char *) aligned;
+#else
+	buf = (unsigned char *) malloc (buf_size);
+#endif
+	if ( buf == NULL )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+		return WFS_MALLOC;
+	}
+
+	/* wipe only the blocks freed since the last wiping, if known */
+	free_blocks = map->total_blocks;
+	if ( wfs_snapshot_begin (wfs_fs, map, fs_block_size, &incremental) != 0 )
+	{
+		wfs_show_msg (0, msg_nosnapshot, "", wfs_fs);
+	}
+	if ( (incremental != 0) && (wfs_is_verbose () > 0) )
+	{
+		wfs_extmap_show_blocks (wfs_fs, msg_snapshot,
+			map->total_blocks, free_blocks);
+	}
+
+	/* resume from the saved position, if the free space is the same */
+	writer.fs = &wfs_fs;
+	writer.key = wfs_extmap_key (map);
+	if ( wfs_state_get_position (wfs_fs, writer.key, &first_pass,
+		&first_block) == 0 )
+	{
+		first_pass = 0;
+		first_block = 0;
+	}
+	writer.pass = first_pass;
+	writer.position = first_block;
+	writer.last_save = wfs_get_time ();
+
+	all_passes = wfs_fs.npasses + ((wfs_fs.zero_pass != 0)? 1 : 0);
+	wfs_progress_phase (WFS_PROGRESS_WFS, all_passes);
+	if ( wfs_fs.no_wipe_zero_blocks != 0 )
+	{
+		ret_wfs = wfs_extmap_drop_zero_blocks (map, buf, read_blocks,
+			fs_block_size, ops, error);
+	}
+	/* the bytes left to write, for the progress records */
+	if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	{
+		resumed = first_pass * map->total_blocks
+			+ wfs_extmap_blocks_before (map, first_block);
+	}
+	else
+	{
+		resumed = wfs_extmap_blocks_before (map, first_block) * all_passes;
+	}
+	if ( resumed < map->total_blocks * all_passes )
+	{
+		wfs_progress_set_total ((map->total_blocks * all_passes - resumed)
+			* fs_block_size);
+	}
+
+	if ( (ret_wfs != WFS_SUCCESS) || (map->total_blocks == 0) )
+	{
+		/* nothing to do or an error */
+	}
+	else if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	{
+		if ( first_pass < wfs_fs.npasses )
+		{
+			done = first_pass * map->total_blocks
+				+ wfs_extmap_blocks_before (map, first_block);
+		}
+		for ( j = first_pass; (j < wfs_fs.npasses) && (sig_recvd == 0)
+			&& (ret_wfs == WFS_SUCCESS); j++ )
+		{
+			writer.pass = j;
+			writer.position = (j == first_pass)? first_block : 0;
+			wfs_progress_set_pass (j);
+			writer.fill_pass = j;
+			writer.random = wfs_is_random_pass (j, wfs_fs);
+			if ( writer.random == 0 )
+			{
+				/* the same pattern goes to every block in this pass */
+				wfs_extmap_fill (j, buf, fill_size, wfs_fs);
+			}
+			if ( sig_recvd != 0 )
+			{
+				ret_wfs = WFS_SIGNAL;
+				break;
+			}
+			ret_wfs = wfs_extmap_write_all (map, buf, &writer,
+				writer.position, &done,
+				map->total_blocks * wfs_fs.npasses,
+				&prev_percent, error);
+			/* Sync after each pass, if more than 1 overwriting needs to be done.
+			Allow I/O bufferring (efficiency), if just one pass is needed. */
+			if ( WFS_IS_SYNC_NEEDED_PAT(wfs_fs) )
+			{
+				wfs_extmap_barrier (wfs_fs, ops, error);
+			}
+		}
+		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0)
+			&& (ret_wfs == WFS_SUCCESS) )
+		{
+			wfs_extmap_barrier (wfs_fs, ops, error);
+			/* last pass with zeros: */
+			writer.pass = wfs_fs.npasses;
+			writer.position = (first_pass == wfs_fs.npasses)?
+				first_block : 0;
+			wfs_progress_set_pass (wfs_fs.npasses);
+			writer.random = 0;
+			WFS_MEMSET (buf, 0, fill_size);
+			ret_wfs = wfs_extmap_write_all (map, buf, &writer,
+				writer.position, &done, 0, &prev_percent, error);
+			if ( ops->flush_fs != NULL )
+			{
+				(*(ops->flush_fs)) (wfs_fs);
+			}
+		}
+	}
+	else
+	{
+		if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_CHUNK )
+		{
+			group_blocks = wfs_fs.chunk_size / fs_block_size;
+			if ( group_blocks == 0 )
+			{
+				group_blocks = 1;
+			}
+		}
+		else
+		{
+			/* block order: all the passes over one free extent (or
+			   a part of it) at a time, with a barrier after each pass */
+			group_blocks = WFS_BLOCK_GROUP_SIZE / fs_block_size;
+			if ( group_blocks == 0 )
+			{
+				group_blocks = 1;
+			}
+		}
+		ret_wfs = wfs_extmap_wipe_chunks (wfs_fs, map, buf,
+			fill_size, group_blocks,
+			(wfs_fs.wipe_mode == WFS_WIPE_MODE_BLOCK)? 1 : 0,
+			first_block, &writer, &prev_percent, error);
+	}
+	if ( (sig_recvd != 0) && (map->total_blocks != 0) )
+	{
+		/* interrupted - remember where to resume */
+		wfs_extmap_checkpoint (&writer, 1, error);
+	}
+
+	/* the blocks free now are the ones which were wiped (now or before) */
+	wfs_snapshot_end (wfs_fs, ((ret_wfs == WFS_SUCCESS) && (sig_recvd == 0))?
+		1 : 0);
+
+	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+	if ( (writer.nsizes > 1) && (wfs_is_verbose () > 0) )
+	{
+		wfs_extmap_show_io_size (wfs_fs, &writer, &hints);
+	}
+	free (buf);
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_wfs;
+}
@@ -0,0 +1,182 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- free-extent maps, header file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WFS_EXTENTS_H
+# define WFS_EXTENTS_H 1
+
+# include "wipefreespace.h"
+# include "wfs_util.h"
+
+# ifdef WFS_WRITE_CHUNK_SIZE
+#  undef WFS_WRITE_CHUNK_SIZE
+# endif
+
+/* the maximum number of bytes written to the device in one call */
+# define	WFS_WRITE_CHUNK_SIZE (1024 * 1024)
+
+# ifdef WFS_BUFFER_ALIGN
+#  undef WFS_BUFFER_ALIGN
+# endif
+
+/* the alignment of the wiping buffers, enough for direct I/O */
+# define	WFS_BUFFER_ALIGN 4096
+
+# ifdef WFS_PATTERN_UNIT_SIZE
+#  undef WFS_PATTERN_UNIT_SIZE
+# endif
+
+/* the size of a piece of a wiping pattern which can be repeated without
+   breaking the pattern: a multiple of the pattern's length (3 bytes) and
+   of the page size, so that it can be used for direct I/O */
+# define	WFS_PATTERN_UNIT_SIZE (3 * WFS_BUFFER_ALIGN)
+
+# ifdef WFS_GATHER_UNITS
+#  undef WFS_GATHER_UNITS
+# endif
+
+/* the maximum number of pattern pieces written in one call */
+# define	WFS_GATHER_UNITS 256
+
+# ifdef WFS_BLOCK_GROUP_SIZE
+#  undef WFS_BLOCK_GROUP_SIZE
+# endif
+
+/* the maximum number of bytes of a free extent which the block order wipes
+   with all the passes before moving on, with a barrier after each pass */
+# define	WFS_BLOCK_GROUP_SIZE (8UL * 1024 * 1024)
+
+# ifdef WFS_IO_SIZES
+#  undef WFS_IO_SIZES
+# endif
+
+/* the maximum number of write sizes tried at the beginning of wiping */
+# define	WFS_IO_SIZES 4
+
+# if (defined HAVE_LONG_LONG) || (defined HAVE_LONG_LONG_INT)
+typedef unsigned long long int wfs_blkno_t;
+# else
+typedef unsigned long int wfs_blkno_t;
+# endif
+
+/* A range of consecutive free blocks */
+struct wfs_extent
+{
+	wfs_blkno_t start;	/* the first block of the range */
+	wfs_blkno_t length;	/* the number of blocks in the range */
+};
+
+typedef struct wfs_extent wfs_extent_t;
+
+/* A sorted list of non-overlapping free block ranges */
+struct wfs_extent_map
+{
+	wfs_extent_t *	extents;	/* the ranges */
+	size_t		count;		/* the number of ranges used */
+	size_t		capacity;	/* the number of ranges allocated */
+	wfs_blkno_t	total_blocks;	/* the sum of all ranges' lengths */
+};
+
+typedef struct wfs_extent_map wfs_extent_map_t;
+
+/* Reads or writes 'count' consecutive blocks, starting at block 'start' */
+typedef wfs_errcode_t (*wfs_extent_io_t) WFS_PARAMS ((void * const data,
+	unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+
+/* Makes the blocks written so far reach the media, without flushing
+   the filesystem's metadata */
+typedef wfs_errcode_t (*wfs_extent_sync_t) WFS_PARAMS ((void * const data,
+	wfs_errcode_t * const error));
+
+/* The backend's operations used when wiping a free-extent map */
+struct wfs_extent_ops
+{
+	wfs_extent_io_t	read_blocks;	/* reading blocks, NULL if unavailable */
+	wfs_extent_io_t	write_blocks;	/* writing blocks */
+	wfs_extent_io_t	write_pattern;	/* writing blocks with the buffer's
+					   WFS_PATTERN_UNIT_SIZE bytes repeated,
+					   NULL if unavailable */
+	wfs_extent_sync_t sync_blocks;	/* syncing the data, NULL to use flush_fs */
+	wfs_errcode_t (*flush_fs) WFS_PARAMS ((wfs_fsid_t wfs_fs));
+	void *		data;		/* passed to the functions above */
+};
+
+typedef struct wfs_extent_ops wfs_extent_ops_t;
+
+/* A device opened for direct I/O, used instead of the backend's functions */
+struct wfs_direct_io
+{
+	int			fd;		/* the descriptor, -1 if not open */
+	size_t			fs_block_size;	/* the size of a single block */
+	wfs_extent_ops_t	backend;	/* the backend's operations, for
+						   the blocks which can't be
+						   written directly */
+};
+
+typedef struct wfs_direct_io wfs_direct_io_t;
+
+extern void WFS_ATTR ((nonnull))
+	wfs_extmap_init WFS_PARAMS ((wfs_extent_map_t * const map));
+
+extern wfs_errcode_t GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_extmap_add WFS_PARAMS ((wfs_extent_map_t * const map,
+		const wfs_blkno_t start, const wfs_blkno_t length));
+
+extern wfs_errcode_t GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_extmap_append WFS_PARAMS ((wfs_extent_map_t * const map,
+		const wfs_blkno_t start, const wfs_blkno_t length));
+
+extern void WFS_ATTR ((nonnull))
+	wfs_extmap_sort WFS_PARAMS ((wfs_extent_map_t * const map));
+
+extern wfs_errcode_t GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_extmap_subtract WFS_PARAMS ((wfs_extent_map_t * const map,
+		const wfs_extent_map_t * const other));
+
+extern void WFS_ATTR ((nonnull))
+	wfs_extmap_free WFS_PARAMS ((wfs_extent_map_t * const map));
+
+extern size_t GCC_WARN_UNUSED_RESULT
+	wfs_extmap_chunk_blocks WFS_PARAMS ((const size_t fs_block_size));
+
+extern size_t GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_extmap_io_sizes WFS_PARAMS ((const wfs_io_hints_t * const hints,
+		const size_t fs_block_size, size_t sizes[WFS_IO_SIZES]));
+
+extern void WFS_ATTR ((nonnull))
+	wfs_extmap_direct_open WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		const size_t fs_block_size, wfs_direct_io_t * const io,
+		wfs_extent_ops_t * const ops));
+
+extern void WFS_ATTR ((nonnull))
+	wfs_extmap_direct_close WFS_PARAMS ((wfs_direct_io_t * const io));
+
+extern int GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_extmap_pwrite_pattern WFS_PARAMS ((const int fd,
+		unsigned char * const unit, const wfs_blkno_t offset,
+		const wfs_blkno_t length));
+
+extern wfs_errcode_t GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_wipe_extents WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		wfs_extent_map_t * const map, const size_t fs_block_size,
+		const wfs_extent_ops_t * const ops, wfs_errcode_t * const error));
+
+#endif	/* WFS_EXTENTS_H */
@@ -92,6 +92,10 @@ Something wrong. FAT12/16/32 requested, but tffs.h or libtffs missing.
 # undef WFS_ANSIC
 #endif
 
+#ifdef WFS_WANT_WFS
+static const char * const msg_nodirect = N_("Direct I/O not supported or failed, using the system's cache");
+#endif
+
 /*#define WFS_DEBUG 1*/
 /* ============================================================= */
 
@@ -618,7 +622,6 @@ wfs_fat_dirent_find (
 	int ret;
 	dir_entry_t dirent;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	wfs_errcode_t error = 0;
 	tffs_handle_t fat;
 	wfs_errcode_t * error_ret;
@@ -708,7 +711,7 @@ wfs_fat_dirent_find (
 							13 /*dirent.h->long_dir_entry_t*/
 							/* 2 / *sizeof UTF-16 character */
 							-1 /* the first marker byte */,
-							selected, wfs_fs );
+							wfs_fs );
 					}
 					else
 					{
@@ -718,7 +721,7 @@ wfs_fat_dirent_find (
 #endif
 						wfs_fill_buffer ( j, fname,
 							sizeof (dirent.dir_name) - 1 /* the first marker byte */,
-							selected, wfs_fs );
+							wfs_fs );
 					}
 					if ( sig_recvd != 0 )
 					{
@@ -886,7 +889,6 @@ wfs_fat_wipe_file_tail (
 # endif
 {
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	tfile_t * fh = (tfile_t *) file;
 	unsigned int file_len;
 	size_t bufsize;
@@ -946,7 +948,7 @@ wfs_fat_wipe_file_tail (
 #endif
 	for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
 	{
-		wfs_fill_buffer ( j, buf, bufsize, selected, wfs_fs );
+		wfs_fill_buffer ( j, buf, bufsize, wfs_fs );
 		if ( sig_recvd != 0 )
 		{
 			ret_tail = WFS_SIGNAL;
@@ -1401,7 +1403,6 @@ wfs_fat_wipe_fs (
 	unsigned int cluster;
 	unsigned int prev_cluster;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	tfat_t * pfat;
 	tffs_t * ptffs;
 	int sec_per_clus = 1;
@@ -1431,6 +1432,11 @@ wfs_fat_wipe_fs (
 	{
 		return WFS_BADPARAM;
 	}
+	if ( wfs_fs.use_direct != 0 )
+	{
+		/* the sectors are written only through the library */
+		wfs_show_msg (0, msg_nodirect, "", wfs_fs);
+	}
 
 	ptffs = (tffs_t *) fat;
 	pfat = ptffs->pfat;
@@ -1501,7 +1507,7 @@ wfs_fat_wipe_fs (
 					(FAT12 reads/writes two at a time): */
 					_read_fat_sector (pfat, sec_num + sec_per_clus-1);
 				}
-				wfs_fill_buffer ( j, pfat->secbuf, bytes_per_sector, selected, wfs_fs );
+				wfs_fill_buffer ( j, pfat->secbuf, bytes_per_sector, wfs_fs );
 				if ( sig_recvd != 0 )
 				{
 					ret_wfs = WFS_SIGNAL;
@@ -1671,7 +1677,7 @@ wfs_fat_wipe_fs (
 			}
 			for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
 			{
-				wfs_fill_buffer ( j, pfat->secbuf, bytes_per_sector, selected, wfs_fs );
+				wfs_fill_buffer ( j, pfat->secbuf, bytes_per_sector, wfs_fs );
 				if ( sig_recvd != 0 )
 				{
 					ret_wfs = WFS_SIGNAL;
@@ -2125,6 +2131,12 @@ wfs_fat_open_fs (
 
 	wfs_fs->whichfs = WFS_CURR_FS_NONE;
 	wfs_fs->fs_backend = NULL;
+	if ( wfs_fs->plan_only != 0 )
+	{
+		/* the library can only open the filesystem for writing
+		   and there is nothing to plan, so it's not opened */
+		return WFS_OPENFS;
+	}
 
 #ifdef HAVE_FCNTL_H
 	/* first check some basic things, to save resources if different filesystem */
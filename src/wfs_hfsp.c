@@ -82,11 +82,16 @@ extern int volume_writetobuf WFS_PARAMS ((volume * vol, void * buf, long int blo
 #include "wfs_util.h"
 #include "wfs_wiping.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 #if (defined TEST_COMPILE) && (defined WFS_ANSIC)
 # undef WFS_ANSIC
 #endif
 
+#ifdef WFS_WANT_WFS
+static const char * const msg_nodirect = N_("Direct I/O not supported or failed, using the system's cache");
+#endif
+
 /* ============================================================= */
 
 #if (defined WFS_WANT_WFS) || (defined WFS_WANT_PART)
@@ -159,7 +164,6 @@ wfs_hfsp_wipe_part_file (
 {
 	wfs_errcode_t ret_part = WFS_SUCCESS;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	blockiter iter;
 	UInt32 last_block;
 	int res;
@@ -243,7 +247,7 @@ wfs_hfsp_wipe_part_file (
 			}
 		}
 		wfs_fill_buffer ( j, &buf[remainder], (size_t)(fs_block_size - remainder),
-			selected, wfs_fs );
+			wfs_fs );
 		error = volume_writetobuf (hfsp_volume,
 			buf, (long int)last_block);
 		if ( error != 0 )
@@ -528,6 +532,379 @@ wfs_hfsp_wipe_part (
 /* ======================================================================== */
 
 #ifdef WFS_WANT_WFS
+
+# ifndef HFSP_ALLOC_CNID
+#  define HFSP_ALLOC_CNID 6
+# endif
+
+/* the number of bitmap bits checked at once */
+# define WFS_HFSP_WORD_BITS (sizeof (unsigned long int) * 8)
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_hfsp_read_alloc_file WFS_PARAMS ((
+	struct volume * const hfsp_volume, const size_t fs_block_size,
+	unsigned char ** const bitmap));
+# endif
+
+/**
+ * Reads the whole allocation file (the block bitmap) of a HFS+ filesystem.
+ * \param hfsp_volume The filesystem.
+ * \param fs_block_size The size of a filesystem block.
+ * \param bitmap Pointer to the place for the allocated bitmap. Should be
+ *	freed by the caller.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_hfsp_read_alloc_file (
+# ifdef WFS_ANSIC
+	struct volume * const hfsp_volume, const size_t fs_block_size,
+	unsigned char ** const bitmap)
+# else
+	hfsp_volume, fs_block_size, bitmap)
+	struct volume * const hfsp_volume;
+	const size_t fs_block_size;
+	unsigned char ** const bitmap;
+# endif
+{
+	blockiter iter;
+	UInt32 i;
+	UInt32 nblocks;
+	unsigned char * bm;
+
+	if ( (hfsp_volume == NULL) || (bitmap == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	nblocks = hfsp_volume->vol.alloc_file.total_blocks;
+	if ( (nblocks == 0)
+		|| (((size_t)nblocks * fs_block_size * 8) < hfsp_volume->vol.total_blocks) )
+	{
+		/* the bitmap doesn't cover the whole filesystem */
+		return WFS_BLBITMAPREAD;
+	}
+	WFS_SET_ERRNO (0);
+	bm = (unsigned char *) malloc ((size_t)nblocks * fs_block_size);
+	if ( bm == NULL )
+	{
+		return WFS_MALLOC;
+	}
+	blockiter_init (&iter, hfsp_volume, &(hfsp_volume->vol.alloc_file),
+		(UInt8)HFSP_EXTENT_DATA, HFSP_ALLOC_CNID);
+	for ( i = 0; (i < nblocks) && (sig_recvd == 0); i++ )
+	{
+		if ( volume_readinbuf (hfsp_volume, &bm[i * fs_block_size],
+			(long int)blockiter_curr (&iter)) != 0 )
+		{
+			free (bm);
+			return WFS_BLBITMAPREAD;
+		}
+		if ( (i + 1 < nblocks) && (blockiter_next (&iter) != 0) )
+		{
+			free (bm);
+			return WFS_BLKITER;
+		}
+	}
+	if ( sig_recvd != 0 )
+	{
+		free (bm);
+		return WFS_SIGNAL;
+	}
+	*bitmap = bm;
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_hfsp_get_free_extents WFS_PARAMS ((
+	struct volume * const hfsp_volume, const size_t fs_block_size,
+	wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Finds all the free blocks on a HFS+ filesystem. The allocation file is read
+ *	once and checked a word at a time, so that fully used and fully
+ *	free parts are skipped quickly.
+ * \param hfsp_volume The filesystem.
+ * \param fs_block_size The size of a filesystem block.
+ * \param map The map to put the free blocks in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_hfsp_get_free_extents (
+# ifdef WFS_ANSIC
+	struct volume * const hfsp_volume, const size_t fs_block_size,
+	wfs_extent_map_t * const map)
+# else
+	hfsp_volume, fs_block_size, map)
+	struct volume * const hfsp_volume;
+	const size_t fs_block_size;
+	wfs_extent_map_t * const map;
+# endif
+{
+	wfs_errcode_t ret_free;
+	unsigned char * bitmap = NULL;
+	unsigned long int word;
+	wfs_blkno_t nbits;
+	wfs_blkno_t blk_no = 0;
+	wfs_blkno_t run_start = 0;
+	int in_run = 0;
+
+	if ( (hfsp_volume == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	ret_free = wfs_hfsp_read_alloc_file (hfsp_volume, fs_block_size, &bitmap);
+	if ( ret_free != WFS_SUCCESS )
+	{
+		return ret_free;
+	}
+
+	nbits = hfsp_volume->vol.total_blocks;
+	while ( (blk_no < nbits) && (sig_recvd == 0) )
+	{
+		if ( ((blk_no % WFS_HFSP_WORD_BITS) == 0)
+			&& (blk_no + WFS_HFSP_WORD_BITS <= nbits) )
+		{
+			WFS_MEMCOPY (&word, &bitmap[blk_no / 8], sizeof (word));
+			if ( word == ~0UL )
+			{
+				/* all used */
+				if ( in_run != 0 )
+				{
+					ret_free = wfs_extmap_add (map, run_start,
+						blk_no - run_start);
+					if ( ret_free != WFS_SUCCESS )
+					{
+						break;
+					}
+					in_run = 0;
+				}
+				blk_no += WFS_HFSP_WORD_BITS;
+				continue;
+			}
+			if ( word == 0 )
+			{
+				/* all free */
+				if ( in_run == 0 )
+				{
+					run_start = blk_no;
+					in_run = 1;
+				}
+				blk_no += WFS_HFSP_WORD_BITS;
+				continue;
+			}
+		}
+		/* HFS+ numbers the bits starting from the most significant one */
+		if ( (bitmap[blk_no / 8] & (0x80 >> (blk_no % 8))) == 0 )
+		{
+			if ( in_run == 0 )
+			{
+				run_start = blk_no;
+				in_run = 1;
+			}
+		}
+		else if ( in_run != 0 )
+		{
+			ret_free = wfs_extmap_add (map, run_start, blk_no - run_start);
+			if ( ret_free != WFS_SUCCESS )
+			{
+				break;
+			}
+			in_run = 0;
+		}
+		blk_no++;
+	}
+	if ( (in_run != 0) && (ret_free == WFS_SUCCESS) && (sig_recvd == 0) )
+	{
+		ret_free = wfs_extmap_add (map, run_start, nbits - run_start);
+	}
+	free (bitmap);
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+/* A HFS+ filesystem, for reading and writing free blocks */
+struct wfs_hfsp_io
+{
+	struct volume * hfsp_volume;
+	size_t fs_block_size;
+};
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_hfsp_read_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive blocks of a HFS+ filesystem.
+ * \param data Pointer to a 'struct wfs_hfsp_io'.
+ * \param buf The buffer for the data.
+ * \param start The first block to read.
+ * \param count The number of blocks to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_hfsp_read_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_hfsp_io * io;
+	wfs_blkno_t i;
+
+	io = (struct wfs_hfsp_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	/* the library can only read one block at a time */
+	for ( i = 0; (i < count) && (sig_recvd == 0); i++ )
+	{
+		*error = volume_readinbuf (io->hfsp_volume,
+			&buf[i * io->fs_block_size], (long int)(start + i));
+		if ( *error != 0 )
+		{
+			return WFS_BLKRD;
+		}
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_hfsp_write_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes the given buffer to consecutive blocks of a HFS+ filesystem.
+ * \param data Pointer to a 'struct wfs_hfsp_io'.
+ * \param buf The buffer with the data to write.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_hfsp_write_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_hfsp_io * io;
+	wfs_blkno_t i;
+
+	io = (struct wfs_hfsp_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	/* the library can only write one block at a time */
+	for ( i = 0; (i < count) && (sig_recvd == 0); i++ )
+	{
+		*error = volume_writetobuf (io->hfsp_volume,
+			&buf[i * io->fs_block_size], (long int)(start + i));
+		if ( *error != 0 )
+		{
+			return WFS_BLKWR;
+		}
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_hfsp_sync_blocks WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written to a HFS+ filesystem reach the media.
+ * \param data Pointer to a 'struct wfs_hfsp_io'.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_hfsp_sync_blocks (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_hfsp_io * io;
+	int res;
+
+	io = (struct wfs_hfsp_io *) data;
+	if ( (io == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	/* the library writes the blocks directly to its descriptor
+	   of the device, kept as a pointer */
+	res = wfs_sync_fd ((int)(long int)(io->hfsp_volume->fd));
+	if ( res != 0 )
+	{
+		*error = (wfs_errcode_t) res;
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
 /**
  * Wipes the free space on the given HFS+ filesystem.
  * \param wfs_fs The filesystem.
@@ -545,15 +922,14 @@ wfs_hfsp_wipe_fs (
 {
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
 	unsigned int prev_percent = 0;
-	UInt32 curr_block;
-	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
-	unsigned char * buf;
 	wfs_errcode_t error = 0;
 	struct volume * hfsp_volume;
 	wfs_errcode_t * error_ret;
-	int res;
 	size_t fs_block_size;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	struct wfs_hfsp_io io;
+	wfs_direct_io_t direct;
 
 	hfsp_volume = (struct volume *) wfs_fs.fs_backend;
 	error_ret = (wfs_errcode_t *) wfs_fs.fs_error;
@@ -571,176 +947,37 @@ wfs_hfsp_wipe_fs (
 	{
 		return WFS_BADPARAM;
 	}
-	WFS_SET_ERRNO (0);
-	buf = (unsigned char *) malloc ( fs_block_size );
-	if ( buf == NULL )
-	{
-		error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
-		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		if ( error_ret != NULL )
-		{
-			*error_ret = error;
-		}
-		return WFS_MALLOC;
-	}
 
-	if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	/* find the free blocks once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_hfsp_get_free_extents (hfsp_volume, fs_block_size, &map);
+	if ( ret_wfs == WFS_SUCCESS )
 	{
-		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
+		io.hfsp_volume = hfsp_volume;
+		io.fs_block_size = fs_block_size;
+		ops.read_blocks = &wfs_hfsp_read_blocks;
+		ops.write_blocks = &wfs_hfsp_write_blocks;
+		ops.write_pattern = NULL;
+		ops.sync_blocks = &wfs_hfsp_sync_blocks;
+		ops.flush_fs = &wfs_hfsp_flush_fs;
+		ops.data = &io;
+		if ( (hfsp_volume->startblock != 0) && (wfs_fs.use_direct != 0) )
 		{
-			for ( curr_block = 0;
-				(curr_block < hfsp_volume->vol.total_blocks)
-				&& (sig_recvd == 0);
-				curr_block++ )
-			{
-				if ( volume_allocated (hfsp_volume, curr_block) == 0 )
-				{
-					/* block is not allocated - wipe it */
-					if ( wfs_fs.no_wipe_zero_blocks != 0 )
-					{
-						res = volume_readinbuf (hfsp_volume, buf,
-							(long int)curr_block);
-						if ( res != 0 )
-						{
-							if ( error_ret != NULL )
-							{
-								*error_ret = error;
-							}
-							return WFS_BLKRD;
-						}
-						if ( wfs_is_block_zero (buf,
-							fs_block_size) != 0 )
-						{
-							/* this block is all-zeros -
-							 don't wipe, as requested */
-							break;
-						}
-					}
-					wfs_fill_buffer ( j, buf, fs_block_size, selected, wfs_fs );
-					error = volume_writetobuf (hfsp_volume,
-						buf, (long int)curr_block);
-					if ( error != 0 )
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-				} /* if (volume_allocated) */
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int)(((hfsp_volume->vol.total_blocks * j + curr_block) * 100)
-						/ (hfsp_volume->vol.total_blocks * wfs_fs.npasses)),
-					&prev_percent);
-			}
-			/* Flush after each writing, if more than 1 overwriting needs to be done.
-			Allow I/O bufferring (efficiency), if just one pass is needed. */
-			if ( WFS_IS_SYNC_NEEDED_PAT(wfs_fs) )
-			{
-				error = wfs_hfsp_flush_fs (wfs_fs);
-			}
-		}
-		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0)
-			&& (ret_wfs == WFS_SUCCESS) )
-		{
-			wfs_hfsp_flush_fs (wfs_fs);
-			/* perform last wipe with zeros */
-			WFS_MEMSET ( buf, 0, fs_block_size );
-			for ( curr_block = 0;
-				(curr_block < hfsp_volume->vol.total_blocks)
-				&& (sig_recvd == 0);
-				curr_block++ )
-			{
-				if ( volume_allocated (hfsp_volume, curr_block) == 0 )
-				{
-					/* block is not allocated - wipe it */
-					error = volume_writetobuf (hfsp_volume,
-						buf, (long int)curr_block);
-					if ( error != 0 )
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-				} /* if (volume_allocated) */
-			}
-			wfs_hfsp_flush_fs (wfs_fs);
+			/* the direct I/O counts the blocks from the start
+			   of the device, not of the wrapped volume */
+			wfs_show_msg (0, msg_nodirect, "", wfs_fs);
+			wfs_fs.use_direct = 0;
 		}
+		wfs_extmap_direct_open (wfs_fs, fs_block_size, &direct, &ops);
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map, fs_block_size,
+			&ops, &error);
+		wfs_extmap_direct_close (&direct);
 	}
 	else
 	{
-		for ( curr_block = 0;
-			(curr_block < hfsp_volume->vol.total_blocks)
-			&& (sig_recvd == 0);
-			curr_block++ )
-		{
-			if ( volume_allocated (hfsp_volume, curr_block) == 0 )
-			{
-				/* block is not allocated - wipe it */
-				for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
-				{
-					if ( wfs_fs.no_wipe_zero_blocks != 0 )
-					{
-						res = volume_readinbuf (hfsp_volume, buf,
-							(long int)curr_block);
-						if ( res != 0 )
-						{
-							if ( error_ret != NULL )
-							{
-								*error_ret = error;
-							}
-							return WFS_BLKRD;
-						}
-						if ( wfs_is_block_zero (buf,
-							fs_block_size) != 0 )
-						{
-							/* this block is all-zeros - don't wipe, as requested */
-							j = wfs_fs.npasses * 2;
-							break;
-						}
-					}
-					wfs_fill_buffer ( j, buf, fs_block_size, selected, wfs_fs );
-					error = volume_writetobuf (hfsp_volume,
-						buf, (long int)curr_block);
-					if ( error != 0 )
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-					/* Flush after each writing, if more than 1 overwriting needs to be done.
-					Allow I/O bufferring (efficiency), if just one pass is needed. */
-					if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-					{
-						error = wfs_hfsp_flush_fs (wfs_fs);
-					}
-				}
-				if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0)
-					&& (ret_wfs == WFS_SUCCESS) )
-				{
-					/* this block is NOT all-zeros - wipe */
-					if ( j != wfs_fs.npasses * 2 )
-					{
-						/* perform last wipe with zeros */
-						WFS_MEMSET ( buf, 0, fs_block_size );
-						error = volume_writetobuf (hfsp_volume,
-							buf, (long int)curr_block);
-						if ( error != 0 )
-						{
-							ret_wfs = WFS_BLKWR;
-							/* do NOT break here */
-						}
-						/* No need to flush the last writing of a given block. *
-						if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-						{
-							error = wfs_hfsp_flush_fs (wfs_fs);
-						}*/
-					}
-				}
-			} /* if (volume_allocated) */
-			wfs_show_progress (WFS_PROGRESS_WFS,
-				(unsigned int)((curr_block * 100) / hfsp_volume->vol.total_blocks),
-				&prev_percent);
-		} /* for (curr_block) */
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	}
-	free (buf);
-
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+	wfs_extmap_free (&map);
 	if ( error_ret != NULL )
 	{
 		*error_ret = error;
@@ -860,16 +1097,28 @@ wfs_hfsp_open_fs (
 		return WFS_MALLOC;
 	}
 
-	/* volume_open() wants a confirmation from the user when opening in read+write
-	   mode, so put a 'y' in the standard input stream. */
-	ungetc ('y', stdin);
-	res = volume_open (hfsp_volume, dev_name_copy, 0 /*partition*/, HFSP_MODE_RDWR);
-	wfs_flush_pipe_input (STDIN_FILENO);
+	if ( wfs_fs->plan_only != 0 )
+	{
+		res = volume_open (hfsp_volume, dev_name_copy, 0 /*partition*/,
+			HFSP_MODE_RDONLY);
+	}
+	else
+	{
+		/* volume_open() wants a confirmation from the user when opening
+		   in read+write mode, so put a 'y' in the standard input stream. */
+		ungetc ('y', stdin);
+		res = volume_open (hfsp_volume, dev_name_copy, 0 /*partition*/,
+			HFSP_MODE_RDWR);
+		wfs_flush_pipe_input (STDIN_FILENO);
+	}
 	if ( res == 0 )
 	{
 		wfs_fs->whichfs = WFS_CURR_FS_HFSP;
 		ret = WFS_SUCCESS;
 		wfs_fs->fs_backend = hfsp_volume;
+		/* the 64-bit volume identifier, in the last 8 bytes
+		   of the Finder's information */
+		wfs_set_uuid (wfs_fs, &(hfsp_volume->vol.finder_info[24]), 8);
 	}
 	else
 	{
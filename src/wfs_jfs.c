@@ -119,6 +119,7 @@ Something wrong. JFS requested, but jfs_superblock.h or libfs missing.
 #include "wfs_util.h"
 #include "wfs_wiping.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 #if (defined WFS_JFS) && (! defined HAVE_JFS_BREAD) && (defined WFS_REISER) && (! defined HAVE_REISER3_NEW_BREAD)
 # warning Detected unpatched JFS library with Reiser3FS enabled. WipeFreeSpace can crash! Read README.
@@ -305,8 +306,11 @@ wfs_jfs_get_block_size (
 	return (size_t)(jfs->super.s_bsize);
 }
 
+#endif /* (defined WFS_WANT_WFS) || (defined WFS_WANT_UNRM) */
+
 /* ======================================================================== */
 
+#ifdef WFS_WANT_UNRM
 # ifndef WFS_ANSIC
 static wfs_errcode_t wfs_jfs_wipe_block WFS_PARAMS ((const wfs_wipedata_t wd,
 	const int64_t blocknum, FILE * fp));
@@ -331,7 +335,6 @@ wfs_jfs_wipe_block (
 	unsigned long int j;
 	unsigned long int max_passes;
 	unsigned long int pat_no;
-	int selected[WFS_NPAT] = {0};
 	int res;
 	wfs_errcode_t error = 0;
 	wfs_errcode_t * error_ret;
@@ -400,7 +403,7 @@ wfs_jfs_wipe_block (
 		{
 			pat_no = j;
 		}
-		wfs_fill_buffer ( pat_no, wd.buf, fs_block_size, selected, wd.filesys );
+		wfs_fill_buffer ( pat_no, wd.buf, fs_block_size, wd.filesys );
 		if ( sig_recvd != 0 )
 		{
 			break;
@@ -469,7 +472,7 @@ wfs_jfs_wipe_block (
 	}
 	return WFS_SUCCESS;
 }
-#endif /* (defined WFS_WANT_WFS) || (defined WFS_WANT_UNRM) */
+#endif /* WFS_WANT_UNRM */
 
 /* ======================================================================== */
 
@@ -525,6 +528,251 @@ wfs_jfs_wipe_part (
 /* ======================================================================== */
 
 #ifdef WFS_WANT_WFS
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_jfs_get_free_extents WFS_PARAMS ((
+	struct dmap * * const block_map, const int64_t ndmaps,
+	wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Finds the free blocks described by the given allocation maps.
+ * \param block_map The allocation maps (dmaps) of the filesystem.
+ * \param ndmaps The number of the allocation maps.
+ * \param map The map to put the free blocks in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_jfs_get_free_extents (
+# ifdef WFS_ANSIC
+	struct dmap * * const block_map, const int64_t ndmaps,
+	wfs_extent_map_t * const map)
+# else
+	block_map, ndmaps, map)
+	struct dmap * * const block_map;
+	const int64_t ndmaps;
+	wfs_extent_map_t * const map;
+# endif
+{
+	int64_t i;
+	int64_t j;
+	wfs_blkno_t run_start = 0;
+	wfs_blkno_t run_length = 0;
+	wfs_errcode_t ret_free = WFS_SUCCESS;
+
+	if ( (block_map == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	for ( i = 0; (i < ndmaps) && (sig_recvd == 0)
+		&& (ret_free == WFS_SUCCESS); i++ )
+	{
+		if ( block_map[i] == NULL )
+		{
+			continue;
+		}
+		/* skip this dmap if no free blocks */
+		if ( block_map[i]->nfree == 0 )
+		{
+			continue;
+		}
+		for ( j = 0; j < block_map[i]->nblocks; j++ )
+		{
+			if ( is_block_free (block_map[i]->start + j,
+				block_map, ndmaps) == 1 )
+			{
+				if ( (run_length != 0) && (run_start + run_length
+					== (wfs_blkno_t)(block_map[i]->start + j)) )
+				{
+					run_length++;
+					continue;
+				}
+				if ( run_length != 0 )
+				{
+					ret_free = wfs_extmap_add (map,
+						run_start, run_length);
+					if ( ret_free != WFS_SUCCESS )
+					{
+						break;
+					}
+				}
+				run_start = (wfs_blkno_t)(block_map[i]->start + j);
+				run_length = 1;
+			}
+		}
+	}
+	if ( (run_length != 0) && (ret_free == WFS_SUCCESS) )
+	{
+		ret_free = wfs_extmap_add (map, run_start, run_length);
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+/* A JFS device, for reading and writing free blocks */
+struct wfs_jfs_io
+{
+	FILE * fp;
+	size_t fs_block_size;
+};
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_jfs_read_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive blocks of a JFS filesystem.
+ * \param data Pointer to a 'struct wfs_jfs_io'.
+ * \param buf The buffer for the data.
+ * \param start The first block to read.
+ * \param count The number of blocks to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_jfs_read_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_jfs_io * io;
+	int res;
+
+	io = (struct wfs_jfs_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	WFS_SET_ERRNO (0);
+	res = ujfs_rw_diskblocks (io->fp,
+		(int64_t)(start * io->fs_block_size),
+		(int32_t)(count * io->fs_block_size), buf, GET);
+	if ( res != 0 )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_jfs_write_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive blocks of a JFS filesystem.
+ * \param data Pointer to a 'struct wfs_jfs_io'.
+ * \param buf The buffer with the data.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_jfs_write_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_jfs_io * io;
+	int res;
+
+	io = (struct wfs_jfs_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	WFS_SET_ERRNO (0);
+	res = ujfs_rw_diskblocks (io->fp,
+		(int64_t)(start * io->fs_block_size),
+		(int32_t)(count * io->fs_block_size), buf, PUT);
+	if ( res != 0 )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return WFS_BLKWR;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_jfs_sync_blocks WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written to a JFS filesystem reach the media.
+ * \param data Pointer to a 'struct wfs_jfs_io'.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_jfs_sync_blocks (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_jfs_io * io;
+
+	io = (struct wfs_jfs_io *) data;
+	if ( (io == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	WFS_SET_ERRNO (0);
+	if ( ujfs_flush_dev (io->fp) != 0 )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
 /**
  * Wipes the free space on the given JFS filesystem.
  * \param wfs_fs The filesystem.
@@ -541,24 +789,24 @@ wfs_jfs_wipe_fs (
 # endif
 {
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
-	wfs_wipedata_t wd;
 	unsigned int prev_percent = 0;
 	int res = 0;
 	int64_t total_size = 0;
 	int64_t nblocks = 0;
 	int64_t i;
-	int64_t j = 0;
 	struct dmap **block_map = NULL;
 	int64_t start = 0;
 	int level;
 	int blocks;
 	int64_t ndmaps;
-	size_t bufsize;
-	unsigned char * buf;
+	size_t fs_block_size;
 	wfs_errcode_t error = 0;
 	struct wfs_jfs * jfs;
 	wfs_errcode_t * error_ret;
-	unsigned long int pass_no;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_direct_io_t direct;
+	struct wfs_jfs_io io;
 
 	jfs = (struct wfs_jfs *) wfs_fs.fs_backend;
 	error_ret = (wfs_errcode_t *) wfs_fs.fs_error;
@@ -581,18 +829,10 @@ wfs_jfs_wipe_fs (
 		return WFS_BADPARAM;
 	}
 
-	bufsize = wfs_jfs_get_block_size (wfs_fs);
-	WFS_SET_ERRNO (0);
-	buf = (unsigned char *) malloc ( bufsize );
-	if ( buf == NULL )
+	fs_block_size = wfs_jfs_get_block_size (wfs_fs);
+	if ( fs_block_size == 0 )
 	{
-		error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
-		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		if ( error_ret != NULL )
-		{
-			*error_ret = error;
-		}
-		return WFS_MALLOC;
+		return WFS_BADPARAM;
 	}
 
 	res = ujfs_get_dev_size (jfs->fs, &total_size);
@@ -600,7 +840,6 @@ wfs_jfs_wipe_fs (
 	{
 		error = WFS_BLBITMAPREAD;
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		free (buf);
 		if ( error_ret != NULL )
 		{
 			*error_ret = error;
@@ -620,7 +859,6 @@ wfs_jfs_wipe_fs (
 	{
 		error = WFS_BLBITMAPREAD;
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		free (buf);
 		if ( error_ret != NULL )
 		{
 			*error_ret = error;
@@ -633,7 +871,6 @@ wfs_jfs_wipe_fs (
 	{
 		error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		free (buf);
 		if ( error_ret != NULL )
 		{
 			*error_ret = error;
@@ -667,148 +904,11 @@ wfs_jfs_wipe_fs (
 # endif
 		start += PSIZE;
 	}
-	wd.filesys = wfs_fs;
-	wd.total_fs = 0;	/* dummy value, unused */
-	wd.ret_val = WFS_SUCCESS;
-	wd.buf = buf;
-	wd.isjournal = 0;
-	wd.is_zero_pass = 0;
 
-	if ( wd.filesys.wipe_mode == WFS_WIPE_MODE_PATTERN )
-	{
-		for ( pass_no = 0; (pass_no < wfs_fs.npasses) && (sig_recvd == 0)
-			/*&& (ret == WFS_SUCCESS)*/; pass_no++ )
-		{
-			wd.passno = pass_no;
-			for ( i = 0; (i < ndmaps) && (sig_recvd == 0); i++ )
-			{
-				if ( block_map[i] == NULL )
-				{
-					continue;
-				}
-				/* skip this dmap if no free blocks */
-				if ( block_map[i]->nfree == 0 )
-				{
-					/* update the progress: */
-					wfs_show_progress (WFS_PROGRESS_WFS,
-						(unsigned int)(((ndmaps * (int64_t)pass_no + i)*100)/(ndmaps * (int64_t)wfs_fs.npasses)),
-						&prev_percent);
-					continue;
-				}
-				for ( j = 0; (j < block_map[i]->nblocks)
-					&& (sig_recvd == 0); j++ )
-				{
-					if ( is_block_free (block_map[i]->start + j,
-						block_map, ndmaps) == 1 )
-					{
-						/* wipe the block here */
-						if ( ret_wfs == WFS_SUCCESS )
-						{
-							ret_wfs = wfs_jfs_wipe_block (wd,
-								block_map[i]->start + j,
-								jfs->fs);
-						}
-						else
-						{
-							wfs_jfs_wipe_block (wd,
-								block_map[i]->start + j,
-								jfs->fs);
-						}
-						/* update the progress: */
-						wfs_show_progress (WFS_PROGRESS_WFS,
-							(unsigned int)(((ndmaps * (int64_t)pass_no + i)*100)/(ndmaps * (int64_t)wfs_fs.npasses)
-							+ (j*100)/block_map[i]->nblocks/(ndmaps * (int64_t)wfs_fs.npasses)),
-							&prev_percent);
-					}
-				}
-			}
-		}
-		if ( (wd.filesys.zero_pass != 0) && (sig_recvd == 0) )
-		{
-			/* last pass with zeros */
-			ujfs_flush_dev (jfs->fs);
-			wd.is_zero_pass = 1;
-			for ( i = 0; (i < ndmaps) && (sig_recvd == 0); i++ )
-			{
-				if ( block_map[i] == NULL )
-				{
-					continue;
-				}
-				/* skip this dmap if no free blocks */
-				if ( block_map[i]->nfree == 0 )
-				{
-					continue;
-				}
-				for ( j = 0; (j < block_map[i]->nblocks)
-					&& (sig_recvd == 0); j++ )
-				{
-					if ( is_block_free (block_map[i]->start + j,
-						block_map, ndmaps) == 1 )
-					{
-						/* wipe the block here */
-						if ( ret_wfs == WFS_SUCCESS )
-						{
-							ret_wfs = wfs_jfs_wipe_block (wd,
-								block_map[i]->start + j,
-								jfs->fs);
-						}
-						else
-						{
-							wfs_jfs_wipe_block (wd,
-								block_map[i]->start + j,
-								jfs->fs);
-						}
-					}
-				}
-			}
-			ujfs_flush_dev (jfs->fs);
-		}
-	}
-	else
-	{
-		wd.passno = 0;
-		for ( i = 0; (i < ndmaps) && (sig_recvd == 0); i++ )
-		{
-			if ( block_map[i] == NULL )
-			{
-				continue;
-			}
-			/* skip this dmap if no free blocks */
-			if ( block_map[i]->nfree == 0 )
-			{
-				/* update the progress: */
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int)((i*100)/ndmaps),
-					&prev_percent);
-				continue;
-			}
-			for ( j = 0; (j < block_map[i]->nblocks)
-				&& (sig_recvd == 0); j++ )
-			{
-				if ( is_block_free (block_map[i]->start + j,
-					block_map, ndmaps) == 1 )
-				{
-					/* wipe the block here */
-					if ( ret_wfs == WFS_SUCCESS )
-					{
-						ret_wfs = wfs_jfs_wipe_block (wd,
-							block_map[i]->start + j,
-							jfs->fs);
-					}
-					else
-					{
-						wfs_jfs_wipe_block (wd,
-							block_map[i]->start + j,
-							jfs->fs);
-					}
-					/* update the progress: */
-					wfs_show_progress (WFS_PROGRESS_WFS, (unsigned int)((i*100)/ndmaps
-						+ (j*100)/block_map[i]->nblocks/ndmaps), &prev_percent);
-				}
-			}
-		}
-	}
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+	/* find the free blocks once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_jfs_get_free_extents (block_map, ndmaps, &map);
+	/* the allocation maps aren't needed anymore */
 	for ( i = 0; i < ndmaps; i++ )
 	{
 		if ( block_map[i] != NULL )
@@ -817,7 +917,26 @@ wfs_jfs_wipe_fs (
 		}
 	}
 	free (block_map);
-	free (buf);
+	if ( ret_wfs == WFS_SUCCESS )
+	{
+		io.fp = jfs->fs;
+		io.fs_block_size = fs_block_size;
+		ops.read_blocks = &wfs_jfs_read_blocks;
+		ops.write_blocks = &wfs_jfs_write_blocks;
+		ops.write_pattern = NULL;
+		ops.sync_blocks = &wfs_jfs_sync_blocks;
+		ops.flush_fs = &wfs_jfs_flush_fs;
+		ops.data = &io;
+		wfs_extmap_direct_open (wfs_fs, fs_block_size, &direct, &ops);
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map, fs_block_size,
+			&ops, &error);
+		wfs_extmap_direct_close (&direct);
+	}
+	else
+	{
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+	}
+	wfs_extmap_free (&map);
 	if ( error_ret != NULL )
 	{
 		*error_ret = error;
@@ -1277,7 +1396,7 @@ wfs_jfs_open_fs (
 		return WFS_MALLOC;
 	}
 	WFS_SET_ERRNO (0);
-	jfs->fs = fopen ( wfs_fs->fsname, "r+b" );
+	jfs->fs = fopen ( wfs_fs->fsname, (wfs_fs->plan_only != 0)? "rb" : "r+b" );
 	if ( jfs->fs == NULL )
 	{
 		error = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
@@ -1316,6 +1435,8 @@ wfs_jfs_open_fs (
 		wfs_fs->whichfs = WFS_CURR_FS_JFS;
 		ret = WFS_SUCCESS;
 		wfs_fs->fs_backend = jfs;
+		wfs_set_uuid (wfs_fs, (const unsigned char *) jfs->super.s_uuid,
+			sizeof (jfs->super.s_uuid));
 	}
 	if ( error_ret != NULL )
 	{
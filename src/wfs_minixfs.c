@@ -38,8 +38,12 @@ Something wrong. MinixFS requested, but minix_fs.h or libminixfs missing.
 # include <errno.h>
 #endif
 
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>	/* off_t */
+#endif
+
 #ifdef HAVE_UNISTD_H
-# include <unistd.h>	/* sync() */
+# include <unistd.h>	/* sync(), pread(), pwrite() */
 #endif
 
 #ifdef HAVE_MALLOC_H
@@ -62,6 +66,7 @@ Something wrong. MinixFS requested, but minix_fs.h or libminixfs missing.
 #include "wfs_util.h"
 #include "wfs_wiping.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 #if (defined TEST_COMPILE) && (defined WFS_ANSIC)
 # undef WFS_ANSIC
@@ -71,50 +76,6 @@ Something wrong. MinixFS requested, but minix_fs.h or libminixfs missing.
 
 int opt_squash = 0;	/* global symbol used by the libminixfs library, has to be present */
 
-#ifdef WFS_WANT_WFS
-# ifndef WFS_ANSIC
-static long int GCC_WARN_UNUSED_RESULT wfs_minixfs_get_free_bit WFS_PARAMS ((
-	const u8 * const bmap, const int bitmap_size_in_blocks, const long int start_position));
-# endif
-
-static long int GCC_WARN_UNUSED_RESULT
-# ifdef WFS_ANSIC
-WFS_ATTR ((nonnull))
-# endif
-wfs_minixfs_get_free_bit (
-# ifdef WFS_ANSIC
-	const u8 * const bmap, const int bitmap_size_in_blocks, const long int start_position)
-# else
-	bmap, bitmap_size_in_blocks, start_position)
-	const u8 * const bmap;
-	const int bitmap_size_in_blocks;
-	const long int start_position;
-# endif
-{
-	long int i, j;
-	if ( (bmap == NULL) || (bitmap_size_in_blocks == 0) )
-	{
-		return -1L;
-	}
-
-	for (i = 0; (i < bitmap_size_in_blocks * BLOCK_SIZE)
-		&& (sig_recvd == 0); i++)
-	{
-		if (bmap[i] != 0xff)
-		{
-			for (j = 0; j < 8; j++)
-			{
-				if ( ((bmap[i] & (1<<j)) == 0)
-					&& ((i<<3) + j >= start_position) )
-				{
-					return (i<<3) + j;
-				}
-			}
-		}
-	}
-	return -1L;
-}
-#endif /* WFS_WANT_WFS */
 
 /* ======================================================================== */
 
@@ -180,7 +141,6 @@ wfs_minixfs_wipe_dir (
 {
 	wfs_errcode_t ret_part = WFS_SUCCESS;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	struct minix_inode *ino;
 	struct minix2_inode *ino2;
 	unsigned int inode_size;
@@ -329,7 +289,7 @@ wfs_minixfs_wipe_dir (
 					{
 						wfs_fill_buffer ( k, &blk[j+2],
 							direntsize-2,
-							selected, wfs_fs );
+							wfs_fs );
 						if ( sig_recvd != 0 )
 						{
 							ret_part = WFS_SIGNAL;
@@ -404,7 +364,7 @@ wfs_minixfs_wipe_dir (
 			}
 			wfs_fill_buffer ( j, &buf[was_read],
 				(unsigned int)(fs_block_size - (size_t)was_read),
-				selected, wfs_fs );
+				wfs_fs );
 			if ( sig_recvd != 0 )
 			{
 				ret_part = WFS_SIGNAL;
@@ -515,6 +475,389 @@ wfs_minixfs_wipe_part (
 
 /* ======================================================================== */
 
+#ifdef WFS_WANT_WFS
+
+/* the number of bitmap bits checked at once */
+# define WFS_MINIXFS_WORD_BITS (sizeof (unsigned long int) * 8)
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_minixfs_get_free_extents WFS_PARAMS ((
+	const struct minix_fs_dat * const minix, wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Finds all the free zones on a Minix filesystem. The zone bitmap is
+ *	checked a word at a time, so that fully used and fully free parts
+ *	are skipped quickly.
+ * \param minix The filesystem.
+ * \param map The map to put the free blocks in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_minixfs_get_free_extents (
+# ifdef WFS_ANSIC
+	const struct minix_fs_dat * const minix, wfs_extent_map_t * const map)
+# else
+	minix, map)
+	const struct minix_fs_dat * const minix;
+	wfs_extent_map_t * const map;
+# endif
+{
+	wfs_errcode_t ret_free = WFS_SUCCESS;
+	unsigned long int word;
+	wfs_blkno_t nbits;
+	wfs_blkno_t bit = 0;
+	wfs_blkno_t run_start = 0;
+	wfs_blkno_t first_zone;
+	int in_run = 0;
+	const u8 * bmap;
+
+	if ( (minix == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	bmap = minix->zone_bmap;
+	if ( bmap == NULL )
+	{
+		return WFS_BLBITMAPREAD;
+	}
+	/* bit number 'n' describes the zone number 'n + FIRSTZONE - 1' */
+	first_zone = (wfs_blkno_t)(FIRSTZONE (minix) - 1);
+	nbits = (wfs_blkno_t)ZMAPS (minix) * BLOCK_SIZE * 8;
+	if ( nbits + first_zone > (wfs_blkno_t)BLOCKS (minix) )
+	{
+		nbits = (wfs_blkno_t)BLOCKS (minix) - first_zone;
+	}
+	while ( (bit < nbits) && (sig_recvd == 0) )
+	{
+		if ( ((bit % WFS_MINIXFS_WORD_BITS) == 0)
+			&& (bit + WFS_MINIXFS_WORD_BITS <= nbits) )
+		{
+			WFS_MEMCOPY (&word, &bmap[bit / 8], sizeof (word));
+			if ( word == ~0UL )
+			{
+				/* all used */
+				if ( in_run != 0 )
+				{
+					ret_free = wfs_extmap_add (map,
+						first_zone + run_start, bit - run_start);
+					if ( ret_free != WFS_SUCCESS )
+					{
+						break;
+					}
+					in_run = 0;
+				}
+				bit += WFS_MINIXFS_WORD_BITS;
+				continue;
+			}
+			if ( word == 0 )
+			{
+				/* all free */
+				if ( in_run == 0 )
+				{
+					run_start = bit;
+					in_run = 1;
+				}
+				bit += WFS_MINIXFS_WORD_BITS;
+				continue;
+			}
+		}
+		if ( (bmap[bit / 8] & (1 << (bit % 8))) == 0 )
+		{
+			if ( in_run == 0 )
+			{
+				run_start = bit;
+				in_run = 1;
+			}
+		}
+		else if ( in_run != 0 )
+		{
+			ret_free = wfs_extmap_add (map, first_zone + run_start,
+				bit - run_start);
+			if ( ret_free != WFS_SUCCESS )
+			{
+				break;
+			}
+			in_run = 0;
+		}
+		bit++;
+	}
+	if ( (in_run != 0) && (ret_free == WFS_SUCCESS) && (sig_recvd == 0) )
+	{
+		ret_free = wfs_extmap_add (map, first_zone + run_start,
+			nbits - run_start);
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_minixfs_rw_blocks WFS_PARAMS ((
+	const int fd, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, const int write_blocks,
+	wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads or writes consecutive blocks of a Minix filesystem, directly
+ *	on the device, at once.
+ * \param fd The file descriptor of the device.
+ * \param buf The buffer for the data.
+ * \param start The first block to read or write.
+ * \param count The number of blocks to read or write.
+ * \param write_blocks Non-zero to write the blocks, zero to read them.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_minixfs_rw_blocks (
+# ifdef WFS_ANSIC
+	const int fd, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, const int write_blocks,
+	wfs_errcode_t * const error)
+# else
+	fd, buf, start, count, write_blocks, error)
+	const int fd;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	const int write_blocks;
+	wfs_errcode_t * const error;
+# endif
+{
+	ssize_t res;
+	size_t size;
+	off_t offset;
+
+	if ( (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	size = (size_t)(count * BLOCK_SIZE);
+	offset = (off_t)(start * BLOCK_SIZE);
+	WFS_SET_ERRNO (0);
+# if (defined HAVE_PREAD) && (defined HAVE_PWRITE)
+	if ( write_blocks != 0 )
+	{
+		res = pwrite (fd, buf, size, offset);
+	}
+	else
+	{
+		res = pread (fd, buf, size, offset);
+	}
+# else
+	if ( lseek (fd, offset, SEEK_SET) != offset )
+	{
+		res = -1;
+	}
+	else if ( write_blocks != 0 )
+	{
+		res = write (fd, buf, size);
+	}
+	else
+	{
+		res = read (fd, buf, size);
+	}
+# endif
+	if ( res != (ssize_t)size )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return (write_blocks != 0)? WFS_BLKWR : WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_minixfs_read_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive blocks of a Minix filesystem.
+ * \param data Pointer to the file descriptor of the device.
+ * \param buf The buffer for the data.
+ * \param start The first block to read.
+ * \param count The number of blocks to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_minixfs_read_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	if ( data == NULL )
+	{
+		return WFS_BADPARAM;
+	}
+	return wfs_minixfs_rw_blocks (*((int *) data), buf, start, count,
+		0, error);
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_minixfs_write_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive blocks of a Minix filesystem.
+ * \param data Pointer to the file descriptor of the device.
+ * \param buf The buffer with the data.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_minixfs_write_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	if ( data == NULL )
+	{
+		return WFS_BADPARAM;
+	}
+	return wfs_minixfs_rw_blocks (*((int *) data), buf, start, count,
+		1, error);
+}
+
+/* ======================================================================== */
+
+# ifdef HAVE_PWRITE
+#  ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_minixfs_write_pattern WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+#  endif
+
+/**
+ * Writes a repeated pattern to consecutive blocks of a Minix filesystem.
+ * \param data Pointer to the file descriptor of the device.
+ * \param buf The buffer with WFS_PATTERN_UNIT_SIZE bytes of the pattern.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#  ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#  endif
+wfs_minixfs_write_pattern (
+#  ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+#  else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+#  endif
+{
+	int res;
+
+	if ( (data == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	res = wfs_extmap_pwrite_pattern (*((int *) data), buf,
+		start * BLOCK_SIZE, count * BLOCK_SIZE);
+	if ( res != 0 )
+	{
+		*error = (wfs_errcode_t) res;
+		return WFS_BLKWR;
+	}
+	return WFS_SUCCESS;
+}
+# endif /* HAVE_PWRITE */
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_minixfs_sync_blocks WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written to a Minix filesystem reach the media.
+ * \param data Pointer to the file descriptor of the device.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_minixfs_sync_blocks (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	int res;
+
+	if ( (data == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	res = wfs_sync_fd (*((int *) data));
+	if ( res != 0 )
+	{
+		*error = (wfs_errcode_t) res;
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+#endif /* WFS_WANT_WFS */
+
+/* ======================================================================== */
+
 #ifdef WFS_WANT_WFS
 /**
  * Wipes the free space on the given Minix filesystem.
@@ -532,18 +875,14 @@ wfs_minixfs_wipe_fs (
 # endif
 {
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
-	long int start_pos = 0;
-	long int current_block = 0;
-	size_t written;
-	size_t was_read;
-	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	unsigned int prev_percent = 0;
-	unsigned char * buf;
 	wfs_errcode_t error = 0;
 	struct minix_fs_dat * minix;
 	wfs_errcode_t * error_ret;
-	size_t fs_block_size;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_direct_io_t direct;
+	int fd;
 
 	minix = (struct minix_fs_dat *) wfs_fs.fs_backend;
 	error_ret = (wfs_errcode_t *) wfs_fs.fs_error;
@@ -556,230 +895,47 @@ wfs_minixfs_wipe_fs (
 		}
 		return WFS_BADPARAM;
 	}
-	fs_block_size = wfs_minixfs_get_block_size (wfs_fs);
-
-	WFS_SET_ERRNO (0);
-	buf = (unsigned char *) malloc ( fs_block_size );
-	if ( buf == NULL )
+	if ( minix->fp == NULL )
 	{
-		error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 		if ( error_ret != NULL )
 		{
 			*error_ret = error;
 		}
-		return WFS_MALLOC;
+		return WFS_BADPARAM;
 	}
 
-	if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	/* The library keeps using the stream, but wiping goes directly
+	 to the descriptor, without the stdio buffering. */
+	wfs_minixfs_flush_fs (wfs_fs);
+	fd = fileno (minix->fp);
+
+	/* find the free blocks once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_minixfs_get_free_extents (minix, &map);
+	if ( ret_wfs == WFS_SUCCESS )
 	{
-		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
-		{
-			start_pos = 0;
-			do
-			{
-				current_block = wfs_minixfs_get_free_bit (minix->zone_bmap,
-					ZMAPS (minix), start_pos);
-				if ( current_block == -1L )
-				{
-					break;
-				}
-				start_pos = current_block + 1;
-				current_block += FIRSTZONE (minix)-1;
-				if ( (unsigned long int)current_block > BLOCKS (minix) )
-				{
-					break;
-				}
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					was_read = fread (buf, 1,
-						fs_block_size,
-						goto_blk (minix->fp,
-						(int)(current_block & 0x0FFFFFFFF)));
-					if ( (was_read == fs_block_size)
-						&& (wfs_is_block_zero (buf,
-						fs_block_size) != 0) )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						continue;
-					}
-				}
-				wfs_fill_buffer ( j, buf, fs_block_size, selected, wfs_fs );
-				if ( sig_recvd != 0 )
-				{
-					ret_wfs = WFS_SIGNAL;
-					break;
-				}
-				error = 0;
-				WFS_SET_ERRNO (0);
-				written = fwrite (buf, 1, fs_block_size,
-					goto_blk (minix->fp,
-					(int)(current_block & 0x0FFFFFFFF)));
-				if ( written != fs_block_size )
-				{
-# ifdef HAVE_ERRNO_H
-					error = errno;
-# endif
-					ret_wfs = WFS_BLKWR;
-					break;
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_minixfs_flush_fs (wfs_fs);
-				}
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int)((((BLOCKS (minix)) * j + (unsigned long int)current_block) * 100)
-						/((BLOCKS (minix)) * wfs_fs.npasses)),
-					&prev_percent);
-			}
-			while ( (current_block != -1L) && (sig_recvd == 0) );
-			wfs_minixfs_flush_fs (wfs_fs);
-		}
-		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-		{
-			wfs_minixfs_flush_fs (wfs_fs);
-			/* last pass with zeros: */
-			WFS_MEMSET ( buf, 0, fs_block_size );
-			if ( sig_recvd == 0 )
-			{
-				do
-				{
-					current_block = wfs_minixfs_get_free_bit (minix->zone_bmap,
-						ZMAPS (minix), start_pos);
-					if ( current_block == -1L )
-					{
-						break;
-					}
-					start_pos = current_block + 1;
-					current_block += FIRSTZONE (minix)-1;
-					if ( (unsigned long int)current_block > BLOCKS (minix) )
-					{
-						break;
-					}
-					error = 0;
-					WFS_SET_ERRNO (0);
-					written = fwrite (buf, 1, fs_block_size,
-						goto_blk (minix->fp, (int)(current_block & 0x0FFFFFFFF)));
-					if ( written != fs_block_size )
-					{
-# ifdef HAVE_ERRNO_H
-						error = errno;
+		ops.read_blocks = &wfs_minixfs_read_blocks;
+		ops.write_blocks = &wfs_minixfs_write_blocks;
+# ifdef HAVE_PWRITE
+		ops.write_pattern = &wfs_minixfs_write_pattern;
+# else
+		ops.write_pattern = NULL;
 # endif
-						ret_wfs = WFS_BLKWR;
-					}
-					if ( sig_recvd != 0 )
-					{
-						ret_wfs = WFS_SIGNAL;
-						break;
-					}
-				}
-				while ( (current_block != -1L) && (sig_recvd == 0) );
-				wfs_minixfs_flush_fs (wfs_fs);
-			}
-			else
-			{
-				ret_wfs = WFS_SIGNAL;
-			}
-		}
+		ops.sync_blocks = &wfs_minixfs_sync_blocks;
+		ops.flush_fs = &wfs_minixfs_flush_fs;
+		ops.data = &fd;
+		wfs_extmap_direct_open (wfs_fs,
+			wfs_minixfs_get_block_size (wfs_fs), &direct, &ops);
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map,
+			wfs_minixfs_get_block_size (wfs_fs), &ops, &error);
+		wfs_extmap_direct_close (&direct);
 	}
 	else
 	{
-		do
-		{
-			current_block = wfs_minixfs_get_free_bit (minix->zone_bmap,
-				ZMAPS (minix), start_pos);
-			if ( current_block == -1L )
-			{
-				break;
-			}
-			start_pos = current_block + 1;
-			current_block += FIRSTZONE (minix)-1;
-			if ( (unsigned long int)current_block > BLOCKS (minix) )
-			{
-				break;
-			}
-			for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
-			{
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					was_read = fread (buf, 1,
-						fs_block_size,
-						goto_blk (minix->fp, (int)(current_block & 0x0FFFFFFFF)));
-					if ( (was_read == fs_block_size)
-						&& (wfs_is_block_zero (buf,
-						fs_block_size) != 0) )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						j = wfs_fs.npasses * 2;
-						break;
-					}
-				}
-				wfs_fill_buffer ( j, buf, fs_block_size, selected, wfs_fs );
-				if ( sig_recvd != 0 )
-				{
-					ret_wfs = WFS_SIGNAL;
-					break;
-				}
-				error = 0;
-				WFS_SET_ERRNO (0);
-				written = fwrite (buf, 1, fs_block_size,
-					goto_blk (minix->fp, (int)(current_block & 0x0FFFFFFFF)));
-				if ( written != fs_block_size )
-				{
-# ifdef HAVE_ERRNO_H
-					error = errno;
-# endif
-					ret_wfs = WFS_BLKWR;
-					break;
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_minixfs_flush_fs (wfs_fs);
-				}
-			}
-			if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-			{
-				/* last pass with zeros: */
-				if ( j != wfs_fs.npasses * 2 )
-				{
-					WFS_MEMSET ( buf, 0, fs_block_size );
-					if ( sig_recvd != 0 )
-					{
-						ret_wfs = WFS_SIGNAL;
-						break;
-					}
-					error = 0;
-					WFS_SET_ERRNO (0);
-					written = fwrite (buf, 1, fs_block_size,
-						goto_blk (minix->fp, (int)(current_block & 0x0FFFFFFFF)));
-					if ( written != fs_block_size )
-					{
-# ifdef HAVE_ERRNO_H
-						error = errno;
-# endif
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-					/* No need to flush the last writing of a given block. *
-					if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-					{
-						error = wfs_minixfs_flush_fs (wfs_fs);
-					}*/
-				}
-			}
-			wfs_show_progress (WFS_PROGRESS_WFS,
-				(unsigned int)((current_block * 100)/(BLOCKS (minix))),
-				&prev_percent);
-		}
-		while ( (current_block != -1L) && (sig_recvd == 0) );
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	}
-
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-	free (buf);
+	wfs_extmap_free (&map);
 	if ( error_ret != NULL )
 	{
 		*error_ret = error;
@@ -923,7 +1079,7 @@ wfs_minixfs_open_fs (
 		return WFS_OPENFS;
 	}
 	WFS_SET_ERRNO (0);
-	minix->fp = fopen (wfs_fs->fsname, "r+b");
+	minix->fp = fopen (wfs_fs->fsname, (wfs_fs->plan_only != 0)? "rb" : "r+b");
 	if ( minix->fp == NULL )
 	{
 		ret = WFS_GET_ERRNO_OR_DEFAULT (EBADF);
@@ -1176,8 +1332,14 @@ wfs_minixfs_flush_fs (
 #endif
 		return WFS_FLUSHFS;
 	}
-#if (!defined __STRICT_ANSI__) && (defined HAVE_UNISTD_H) && (defined HAVE_SYNC)
+#if (!defined __STRICT_ANSI__) && (defined HAVE_UNISTD_H)
+# if (defined HAVE_FSYNC)
+	/* the wiping is done directly on the descriptor */
+	fsync (fileno (minix->fp));
+# endif
+# if (defined HAVE_SYNC)
 	sync ();
+# endif
 #endif
 	return WFS_SUCCESS;
 }
@@ -111,6 +111,7 @@ Something wrong. NTFS requested, but headers or library missing.
 #include "wfs_wiping.h"
 #include "wfs_subprocess.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 #if (defined TEST_COMPILE) && (defined WFS_ANSIC)
 # undef WFS_ANSIC
@@ -136,6 +137,9 @@ struct wfs_ntfs_list_head
 	for (pos = (head)->next, n = pos->next; pos != (head); \
 		pos = n, n = pos->next)
 
+/* NTFS_MNT_RDONLY in ntfs-3g and MS_RDONLY in libntfs - both are 1 */
+#define WFS_NTFS_MNT_RDONLY 1
+
 /* ======================================================================== */
 
 struct filename
@@ -290,7 +294,6 @@ wipe_compressed_attribute (
 # endif
 	/*wfs_fsid_t wfs_fs;*/
 	int go_back;
-	int selected[WFS_NPAT] = {0};
 	ntfs_volume * ntfs;
 	wfs_errcode_t gerror = 0;
 	wfs_errcode_t * error_ret;
@@ -452,11 +455,11 @@ wipe_compressed_attribute (
 			}
 			if ( mybuf != NULL )
 			{
-				wfs_fill_buffer (j, mybuf, bufsize, selected, wfs_fs);	/* buf OK */
+				wfs_fill_buffer (j, mybuf, bufsize, wfs_fs);	/* buf OK */
 			}
 			else
 			{
-				wfs_fill_buffer (j, buf, (size_t) size, selected, wfs_fs);	/* buf OK */
+				wfs_fill_buffer (j, buf, (size_t) size, wfs_fs);	/* buf OK */
 			}
 			if ( sig_recvd != 0 )
 			{
@@ -605,7 +608,6 @@ wipe_attribute (
 	unsigned long int j;
 	s64 offset;
 	/*wfs_fsid_t wfs_fs;*/
-	int selected[WFS_NPAT] = {0};
 # ifdef HAVE_LIBNTFS_3G
 	s64 s64zero = 0;
 # endif
@@ -652,7 +654,7 @@ wipe_attribute (
 				break;
 			}
 		}
-		wfs_fill_buffer (j, buf, (size_t) size, selected, wfs_fs);	/* buf OK */
+		wfs_fill_buffer (j, buf, (size_t) size, wfs_fs);	/* buf OK */
 		if ( sig_recvd != 0 )
 		{
 	       		break;
@@ -728,24 +730,39 @@ wipe_attribute (
 /* ======================================================================== */
 
 #if (defined WFS_WANT_WFS) || (defined WFS_WANT_UNRM)
+# undef	BUFSIZE
+# define	BUFSIZE	512
+
+/* The section of $Bitmap last read by utils_cluster_in_use(), kept by
+   the caller, so that each wiping has its own. */
+struct wfs_ntfs_bitmap_cache
+{
+	unsigned char buf[BUFSIZE];
+	s64 bmplcn;	/* Which bit of $Bitmap is in the buffer, -1 if none */
+};
+
 # ifndef WFS_ANSIC
 static int GCC_WARN_UNUSED_RESULT utils_cluster_in_use WFS_PARAMS ((
-	const ntfs_volume * const vol, const s64 lcn));
+	const ntfs_volume * const vol, const s64 lcn,
+	struct wfs_ntfs_bitmap_cache * const cache));
 # endif
 
 /**
  * Part of ntfsprogs.
- * Modified: removed logging, signal handling, check for memset, added "(ntfs_bmplcn < 0) ||".
+ * Modified: removed logging, signal handling, check for memset, added "(cache->bmplcn < 0) ||",
+ *	the cache passed as a parameter.
  *
  * utils_cluster_in_use - Determine if a cluster is in use
  * \param vol  An ntfs volume obtained from ntfs_mount
  * \param lcn  The Logical Cluster Number to test
+ * \param cache The cached section of $Bitmap, with "bmplcn" set to -1 before
+ *	the first call for the given volume
  *
  * The metadata file $Bitmap has one binary bit representing each cluster on
  * disk.  The bit will be set for each cluster that is in use.  The function
  * reads the relevant part of $Bitmap into a buffer and tests the bit.
  *
- * This function has a static buffer in which it caches a section of $Bitmap.
+ * The buffer caches a section of $Bitmap.
  * If the lcn, being tested, lies outside the range, the buffer will be
  * refreshed.
  *
@@ -759,32 +776,29 @@ WFS_ATTR ((nonnull))
 # endif
 utils_cluster_in_use (
 # ifdef WFS_ANSIC
-	const ntfs_volume * const vol, const s64 lcn)
+	const ntfs_volume * const vol, const s64 lcn,
+	struct wfs_ntfs_bitmap_cache * const cache)
 # else
-	vol, lcn)
+	vol, lcn, cache)
 	const ntfs_volume * const vol;
 	const s64 lcn;
+	struct wfs_ntfs_bitmap_cache * const cache;
 # endif
 {
-
-# undef	BUFSIZE
-# define	BUFSIZE	512
-	static unsigned char ntfs_buffer[BUFSIZE];
-	static s64 ntfs_bmplcn = -BUFSIZE - 1;	/* Which bit of $Bitmap is in the buffer */
 	int cbyte, bit;
 	ntfs_attr *attr = NULL;
 
 	s64 sizeof_ntfs_buffer = BUFSIZE;
 
-	if ( vol == NULL )
+	if ( (vol == NULL) || (cache == NULL) )
 	{
 		return 1 /* always used */;
 	}
 
 	/* Does lcn lie in the section of $Bitmap we already have cached? */
-	if (	(ntfs_bmplcn < 0) ||
-		(lcn < ntfs_bmplcn) ||
-		(lcn >= (ntfs_bmplcn + (BUFSIZE << 3)) )
+	if (	(cache->bmplcn < 0) ||
+		(lcn < cache->bmplcn) ||
+		(lcn >= (cache->bmplcn + (BUFSIZE << 3)) )
 	   )
 	{
 
@@ -795,14 +809,14 @@ utils_cluster_in_use (
 		}
 
 		/* Mark the buffer as in use, in case the read is shorter. */
-		WFS_MEMSET (ntfs_buffer, 0xFF, BUFSIZE);
+		WFS_MEMSET (cache->buf, 0xFF, BUFSIZE);
 		if ( sig_recvd != 0 )
 		{
 			return -1;
 		}
-		ntfs_bmplcn = lcn & (~((BUFSIZE << 3) - 1));
+		cache->bmplcn = lcn & (~((BUFSIZE << 3) - 1));
 
-		if (ntfs_attr_pread (attr, (ntfs_bmplcn>>3), sizeof_ntfs_buffer, ntfs_buffer) < 0)
+		if (ntfs_attr_pread (attr, (cache->bmplcn>>3), sizeof_ntfs_buffer, cache->buf) < 0)
 		{
 			ntfs_attr_close (attr);
 			return -1;
@@ -817,7 +831,7 @@ utils_cluster_in_use (
 	{
 		return -1;
 	}
-	return (ntfs_buffer[cbyte] & bit);
+	return (cache->buf[cbyte] & bit);
 }
 #endif /* (defined WFS_WANT_WFS) || (defined WFS_WANT_UNRM) */
 
@@ -956,7 +970,8 @@ free_file (
 
 # ifndef WFS_ANSIC
 static wfs_errcode_t GCC_WARN_UNUSED_RESULT destroy_record WFS_PARAMS ((
-	const wfs_fsid_t wfs_fs, const s64 record, unsigned char * const buf));
+	const wfs_fsid_t wfs_fs, const s64 record, unsigned char * const buf,
+	struct wfs_ntfs_bitmap_cache * const bmp_cache));
 # endif
 
 /**
@@ -965,7 +980,7 @@ static wfs_errcode_t GCC_WARN_UNUSED_RESULT destroy_record WFS_PARAMS ((
  * \param wfs_fs The filesystem.
  * \param record The record (i-node number), which filenames & data to destroy.
  * \param buf Buffer for wipe data.
- * \param error Pointer to error variable.
+ * \param bmp_cache The cached section of $Bitmap of the filesystem.
  * \return 0 in case of no errors, other values otherwise.
  */
 static wfs_errcode_t GCC_WARN_UNUSED_RESULT
@@ -974,12 +989,14 @@ WFS_ATTR ((nonnull))
 # endif
 destroy_record (
 # ifdef WFS_ANSIC
-	const wfs_fsid_t wfs_fs, const s64 record_no, unsigned char * const buf)
+	const wfs_fsid_t wfs_fs, const s64 record_no, unsigned char * const buf,
+	struct wfs_ntfs_bitmap_cache * const bmp_cache)
 # else
-	wfs_fs, record_no, buf)
+	wfs_fs, record_no, buf, bmp_cache)
 	const wfs_fsid_t wfs_fs;
 	const s64 record_no;
 	unsigned char * const buf;
+	struct wfs_ntfs_bitmap_cache * const bmp_cache;
 # endif
 {
 	struct ufile *file = NULL;
@@ -990,7 +1007,6 @@ destroy_record (
 	unsigned long int pass, i;
 	s64 j;
 	unsigned char * a_offset;
-	int selected[WFS_NPAT] = {0};
 	ntfs_volume * ntfs;
 	wfs_errcode_t * error_ret;
 	wfs_errcode_t error = 0;
@@ -1098,7 +1114,7 @@ destroy_record (
 		for ( pass = 0; (pass < wfs_fs.npasses) && (sig_recvd == 0); pass++ )
 		{
 			wfs_fill_buffer (pass, a_offset, le32_to_cpu(ctx->attr->value_length),
-				selected, wfs_fs);
+				wfs_fs);
 			if ( sig_recvd != 0 )
 			{
 		       		break;
@@ -1143,7 +1159,7 @@ destroy_record (
 		{
 
 			wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->value_length),
-				sizeof(u32), selected, wfs_fs);
+				sizeof(u32), wfs_fs);
 			if ( sig_recvd != 0 )
 			{
 		       		break;
@@ -1196,7 +1212,7 @@ destroy_record (
 			for ( pass = 0; (pass < wfs_fs.npasses) && (sig_recvd == 0); pass++ )
 			{
 				wfs_fill_buffer (pass, a_offset, le32_to_cpu(ctx->attr->value_length),
-					selected, wfs_fs);
+					wfs_fs);
 				if ( sig_recvd != 0 )
 				{
 			       		break;
@@ -1240,7 +1256,7 @@ destroy_record (
 			for ( pass = 0; (pass < wfs_fs.npasses) && (sig_recvd == 0); pass++ )
 			{
 				wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->value_length),
-					sizeof(u32), selected, wfs_fs);
+					sizeof(u32), wfs_fs);
 				if ( sig_recvd != 0 )
 				{
 			       		break;
@@ -1296,7 +1312,7 @@ destroy_record (
 				for (j = rl[i].lcn; (j < rl[i].lcn + rl[i].length) &&
 					(sig_recvd == 0) && (ret_wfs == WFS_SUCCESS); j++)
 				{
-					if ( utils_cluster_in_use (ntfs, j) == 0 )
+					if ( utils_cluster_in_use (ntfs, j, bmp_cache) == 0 )
 					{
 						for ( pass = 0; (pass < wfs_fs.npasses)
 							&& (sig_recvd == 0); pass++ )
@@ -1319,7 +1335,7 @@ destroy_record (
 							}
 							wfs_fill_buffer (pass, buf /* buf OK */,
 								fs_block_size,
-								selected, wfs_fs);
+								wfs_fs);
 							if ( sig_recvd != 0 )
 							{
 			       					break;
@@ -1364,17 +1380,17 @@ destroy_record (
 			for ( pass = 0; (pass < wfs_fs.npasses) && (sig_recvd == 0); pass++ )
 			{
 				wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->lowest_vcn),
-					sizeof(VCN), selected, wfs_fs);
+					sizeof(VCN), wfs_fs);
 				wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->highest_vcn),
-					sizeof(VCN), selected, wfs_fs);
+					sizeof(VCN), wfs_fs);
 				wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->allocated_size),
-					sizeof(VCN), selected, wfs_fs);
+					sizeof(VCN), wfs_fs);
 				wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->data_size),
-					sizeof(VCN), selected, wfs_fs);
+					sizeof(VCN), wfs_fs);
 				wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->initialized_size),
-					sizeof(VCN), selected, wfs_fs);
+					sizeof(VCN), wfs_fs);
 				wfs_fill_buffer (pass, (unsigned char *) &(ctx->attr->compressed_size),
-					sizeof(VCN), selected, wfs_fs);
+					sizeof(VCN), wfs_fs);
 				if ( sig_recvd != 0 )
 				{
 			       		break;
@@ -1454,7 +1470,6 @@ wfs_ntfs_wipe_journal (
 	ntfs_attr *na = NULL;
 	s64 len, pos, count;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	unsigned char * buf = NULL;
 	MFT_REF log_ino;
 	s64 blocksize;
@@ -1590,7 +1605,7 @@ wfs_ntfs_wipe_journal (
 		if ( j < wfs_fs.npasses )
 		{
 			wfs_fill_buffer (j, buf, (size_t) blocksize,
-				selected, wfs_fs);/* buf OK */
+				wfs_fs);/* buf OK */
 		}
 		else
 		{
@@ -1915,6 +1930,224 @@ wfs_ntfs_wipe_part (
 /* ======================================================================== */
 
 #ifdef WFS_WANT_WFS
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ntfs_get_free_extents WFS_PARAMS ((
+	const ntfs_volume * const ntfs, wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Finds the free clusters on the given NTFS filesystem.
+ * \param ntfs The filesystem.
+ * \param map The map to put the free clusters in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ntfs_get_free_extents (
+# ifdef WFS_ANSIC
+	const ntfs_volume * const ntfs, wfs_extent_map_t * const map)
+# else
+	ntfs, map)
+	const ntfs_volume * const ntfs;
+	wfs_extent_map_t * const map;
+# endif
+{
+	s64 i;
+	wfs_blkno_t run_start = 0;
+	wfs_blkno_t run_length = 0;
+	wfs_errcode_t ret_free = WFS_SUCCESS;
+	struct wfs_ntfs_bitmap_cache bmp_cache;
+
+	if ( (ntfs == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	bmp_cache.bmplcn = -1;
+	for ( i = 0; (i < ntfs->nr_clusters) && (sig_recvd == 0); i++ )
+	{
+		/* check if cluster in use */
+		if ( utils_cluster_in_use (ntfs, i, &bmp_cache) == 0 )
+		{
+			if ( run_length == 0 )
+			{
+				run_start = (wfs_blkno_t) i;
+			}
+			run_length++;
+			continue;
+		}
+		if ( run_length != 0 )
+		{
+			ret_free = wfs_extmap_add (map, run_start, run_length);
+			run_length = 0;
+			if ( ret_free != WFS_SUCCESS )
+			{
+				return ret_free;
+			}
+		}
+	}
+	if ( run_length != 0 )
+	{
+		ret_free = wfs_extmap_add (map, run_start, run_length);
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ntfs_read_clusters WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive clusters of an NTFS filesystem.
+ * \param data The filesystem (an 'ntfs_volume').
+ * \param buf The buffer for the data.
+ * \param start The first cluster to read.
+ * \param count The number of clusters to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ntfs_read_clusters (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	ntfs_volume * ntfs;
+	s64 size;
+
+	ntfs = (ntfs_volume *) data;
+	if ( (ntfs == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	size = (s64) count * ntfs->cluster_size;
+	WFS_SET_ERRNO (0);
+	if ( ntfs_pread (ntfs->dev, (s64) start * ntfs->cluster_size,
+		size, buf) != size )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ntfs_write_clusters WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive clusters of an NTFS filesystem.
+ * \param data The filesystem (an 'ntfs_volume').
+ * \param buf The buffer with the data.
+ * \param start The first cluster to write.
+ * \param count The number of clusters to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ntfs_write_clusters (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	ntfs_volume * ntfs;
+	s64 size;
+
+	ntfs = (ntfs_volume *) data;
+	if ( (ntfs == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	size = (s64) count * ntfs->cluster_size;
+	WFS_SET_ERRNO (0);
+	if ( ntfs_pwrite (ntfs->dev, (s64) start * ntfs->cluster_size,
+		size, buf) != size )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return WFS_BLKWR;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ntfs_sync_clusters WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written to a NTFS filesystem reach the media.
+ * \param data The ntfs_volume of the filesystem.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ntfs_sync_clusters (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	ntfs_volume * ntfs;
+
+	ntfs = (ntfs_volume *) data;
+	if ( (ntfs == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	WFS_SET_ERRNO (0);
+	if ( ntfs->dev->d_ops->sync (ntfs->dev) != 0 )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
 /**
  * Wipes the free space on the given NTFS filesystem.
  * \param wfs_fs The filesystem.
@@ -1941,13 +2174,12 @@ wfs_ntfs_wipe_fs (
 	char ** args_ntfswipe_copy = NULL;
 	child_id_t child_ntfswipe;
 	wfs_errcode_t error = 0;
-	s64 i, size, result;
-	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
-	unsigned char * buf;
 	ntfs_volume * ntfs;
 	wfs_errcode_t * error_ret;
 	size_t fs_block_size;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_direct_io_t direct;
 
 	error_ret = (wfs_errcode_t *) wfs_fs.fs_error;
 	if ( wfs_fs.use_dedicated != 0 )
@@ -2032,208 +2264,27 @@ wfs_ntfs_wipe_fs (
 		return WFS_BADPARAM;
 	}
 
-	WFS_SET_ERRNO (0);
-	buf = (unsigned char *) malloc (fs_block_size);
-	if ( buf == NULL )
-	{
-		error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
-		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		if ( error_ret != NULL )
-		{
-			*error_ret = error;
-		}
-		return WFS_MALLOC;
-	}
-	if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	/* find the free clusters once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_ntfs_get_free_extents (ntfs, &map);
+	if ( ret_wfs == WFS_SUCCESS )
 	{
-		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
-		{
-			for (i = 0; (i < ntfs->nr_clusters) && (sig_recvd==0); i++)
-			{
-				/* check if cluster in use */
-				if (utils_cluster_in_use (ntfs, i) != 0)
-				{
-					wfs_show_progress (WFS_PROGRESS_WFS,
-						(unsigned int) (((ntfs->nr_clusters * (s64)j + i) * 100)/(ntfs->nr_clusters * (s64)wfs_fs.npasses)),
-						&prev_percent);
-					continue;
-				}
-
-				/* cluster is unused - wipe it */
-				size = ntfs->cluster_size;
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					result = ntfs_pread (ntfs->dev, ntfs->cluster_size * i, size, buf);
-					if (result != size)
-					{
-						ret_wfs = WFS_BLKRD;
-						break;
-					}
-					if ( wfs_is_block_zero (buf, (size_t)size) != 0 )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						break;
-					}
-				}
-				wfs_fill_buffer (j, buf, fs_block_size, selected, wfs_fs);/* buf OK */
-				if ( sig_recvd != 0 )
-				{
-					break;
-				}
-
-				/* writing modified cluster here: */
-				result = ntfs_pwrite (ntfs->dev, ntfs->cluster_size * i, size, buf);
-				if (result != size)
-				{
-					free (buf);
-					wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-					if ( error_ret != NULL )
-					{
-						*error_ret = error;
-					}
-					return WFS_BLKWR;
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_ntfs_flush_fs (wfs_fs);
-				}
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int) (((ntfs->nr_clusters * (s64)j + i) * 100)/(ntfs->nr_clusters * (s64)wfs_fs.npasses)),
-					&prev_percent);
-			}
-		}
-		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-		{
-			/* last pass with zeros: */
-			if ( j != wfs_fs.npasses * 2 )
-			{
-				if ( sig_recvd == 0 )
-				{
-					wfs_ntfs_flush_fs (wfs_fs);
-					WFS_MEMSET (buf, 0, fs_block_size);
-					size = ntfs->cluster_size;
-					for (i = 0; (i < ntfs->nr_clusters) && (sig_recvd==0); i++)
-					{
-						/* writing modified cluster here: */
-						result = ntfs_pwrite (ntfs->dev,
-							ntfs->cluster_size * i, size, buf);
-						if (result != size)
-						{
-							free (buf);
-							wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-							if ( error_ret != NULL )
-							{
-								*error_ret = error;
-							}
-							return WFS_BLKWR;
-						}
-						/* No need to flush the last writing of a given block. *
-						if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-						{
-							error = wfs_ntfs_flush_fs (wfs_fs);
-						}*/
-					}
-					wfs_ntfs_flush_fs (wfs_fs);
-				}
-			}
-		}
+		ops.read_blocks = &wfs_ntfs_read_clusters;
+		ops.write_blocks = &wfs_ntfs_write_clusters;
+		ops.write_pattern = NULL;
+		ops.sync_blocks = &wfs_ntfs_sync_clusters;
+		ops.flush_fs = &wfs_ntfs_flush_fs;
+		ops.data = ntfs;
+		wfs_extmap_direct_open (wfs_fs, fs_block_size, &direct, &ops);
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map, fs_block_size,
+			&ops, &error);
+		wfs_extmap_direct_close (&direct);
 	}
 	else
 	{
-		for (i = 0; (i < ntfs->nr_clusters) && (sig_recvd==0); i++)
-		{
-			/* check if cluster in use */
-			if (utils_cluster_in_use (ntfs, i) != 0)
-			{
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int) ((i * 100)/ntfs->nr_clusters),
-					&prev_percent);
-				continue;
-			}
-
-			/* cluster is unused - wipe it */
-			for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
-			{
-				size = ntfs->cluster_size;
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					result = ntfs_pread (ntfs->dev, ntfs->cluster_size * i, size, buf);
-					if (result != size)
-					{
-						ret_wfs = WFS_BLKRD;
-						break;
-					}
-					if ( wfs_is_block_zero (buf, (size_t)size) != 0 )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						j = wfs_fs.npasses * 2;
-						break;
-					}
-				}
-				wfs_fill_buffer (j, buf, fs_block_size, selected, wfs_fs);/* buf OK */
-				if ( sig_recvd != 0 )
-				{
-					break;
-				}
-
-				/* writing modified cluster here: */
-				result = ntfs_pwrite (ntfs->dev, ntfs->cluster_size * i, size, buf);
-				if (result != size)
-				{
-					free (buf);
-					wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-					if ( error_ret != NULL )
-					{
-						*error_ret = error;
-					}
-					return WFS_BLKWR;
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_ntfs_flush_fs (wfs_fs);
-				}
-			}
-			if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-			{
-				/* last pass with zeros: */
-				if ( j != wfs_fs.npasses * 2 )
-				{
-					/* this block is NOT all-zeros - wipe */
-					WFS_MEMSET (buf, 0, fs_block_size);
-					if ( sig_recvd == 0 )
-					{
-						size = ntfs->cluster_size;
-						/* writing modified cluster here: */
-						result = ntfs_pwrite (ntfs->dev,
-							ntfs->cluster_size * i, size, buf);
-						if (result != size)
-						{
-							free (buf);
-							wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-							if ( error_ret != NULL )
-							{
-								*error_ret = error;
-							}
-							return WFS_BLKWR;
-						}
-						/* No need to flush the last writing of a given block. *
-						if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-						{
-							error = wfs_ntfs_flush_fs (wfs_fs);
-						}*/
-					}
-				}
-			}
-			wfs_show_progress (WFS_PROGRESS_WFS,
-				(unsigned int) ((i * 100)/ntfs->nr_clusters), &prev_percent);
-		}
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	}
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-	free (buf);
+	wfs_extmap_free (&map);
 	if ( error_ret != NULL )
 	{
 		*error_ret = error;
@@ -2287,7 +2338,9 @@ wfs_ntfs_wipe_unrm (
 	wfs_errcode_t error = 0;
 	wfs_errcode_t * error_ret;
 	size_t fs_block_size;
+	struct wfs_ntfs_bitmap_cache bmp_cache;
 
+	bmp_cache.bmplcn = -1;
 	error_ret = (wfs_errcode_t *) wfs_fs.fs_error;
 	if ( wfs_fs.use_dedicated != 0 )
 	{
@@ -2461,7 +2514,8 @@ wfs_ntfs_wipe_unrm (
 					break;
 				}
 				/* wiping the i-node here: */
-				ret = destroy_record (wfs_fs, (i+j)*CHAR_BIT+k, buf);
+				ret = destroy_record (wfs_fs, (i+j)*CHAR_BIT+k, buf,
+					&bmp_cache);
 				if ( ret != WFS_SUCCESS )
 				{
 					ret_wfs = ret;
@@ -2504,6 +2558,46 @@ done:
 
 /* ======================================================================== */
 
+#ifndef WFS_ANSIC
+static void wfs_ntfs_set_uuid WFS_PARAMS ((wfs_fsid_t * const wfs_fs,
+	ntfs_volume * const nv));
+#endif
+
+/**
+ * Puts the volume's serial number from the boot sector into the filesystem's
+ *	UUID, left empty when the boot sector can't be read.
+ * \param wfs_fs The filesystem.
+ * \param nv The opened volume.
+ */
+static void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_ntfs_set_uuid (
+#ifdef WFS_ANSIC
+	wfs_fsid_t * const wfs_fs, ntfs_volume * const nv)
+#else
+	wfs_fs, nv)
+	wfs_fsid_t * const wfs_fs;
+	ntfs_volume * const nv;
+#endif
+{
+	NTFS_BOOT_SECTOR bs;
+
+	if ( (wfs_fs == NULL) || (nv == NULL) )
+	{
+		return;
+	}
+	if ( ntfs_pread (nv->dev, 0, sizeof (bs), &bs) != (s64) sizeof (bs) )
+	{
+		return;
+	}
+	wfs_set_uuid (wfs_fs, (const unsigned char *) &(bs.volume_serial_number),
+		sizeof (bs.volume_serial_number));
+}
+
+/* ======================================================================== */
+
 /**
  * Opens an NTFS filesystem on the given device.
  * \param devname Device name, like /dev/hdXY
@@ -2551,7 +2645,8 @@ wfs_ntfs_open_fs (
 	wfs_fs->whichfs = WFS_CURR_FS_NONE;
 
 	WFS_SET_ERRNO (0);
-	nv = ntfs_mount (wfs_fs->fsname, 0);
+	nv = ntfs_mount (wfs_fs->fsname,
+		(wfs_fs->plan_only != 0)? WFS_NTFS_MNT_RDONLY : 0);
 	if ( (nv == NULL) && (sig_recvd == 0) )
 	{
 		error = WFS_OPENFS;
@@ -2563,7 +2658,8 @@ wfs_ntfs_open_fs (
 #endif
 		ret = WFS_OPENFS;
 #if (defined HAVE_SYS_MOUNT_H) && (defined HAVE_UMOUNT)
-		res = umount (wfs_fs->fsname);
+		/* planning must not change anything */
+		res = (wfs_fs->plan_only != 0)? -1 : umount (wfs_fs->fsname);
 		if ( (res == 0) && (sig_recvd == 0) )
 		{
 			nv = ntfs_mount (wfs_fs->fsname, 0);
@@ -2573,6 +2669,7 @@ wfs_ntfs_open_fs (
 				wfs_fs->whichfs = WFS_CURR_FS_NTFS;
 				wfs_fs->fs_backend = nv;
 /*				WFS_MEMCOPY (&(wfs_fs->ntfs), nv, sizeof(ntfs_volume));*/
+				wfs_ntfs_set_uuid (wfs_fs, nv);
 				if ( wfs_fs->use_dedicated != 0 )
 				{
 					/* allow the dedicated tool to mount */
@@ -2589,6 +2686,7 @@ wfs_ntfs_open_fs (
 		wfs_fs->whichfs = WFS_CURR_FS_NTFS;
 		wfs_fs->fs_backend = nv;
 /*		WFS_MEMCOPY (&(wfs_fs->ntfs), nv, sizeof(ntfs_volume));*/
+		wfs_ntfs_set_uuid (wfs_fs, nv);
 		if ( wfs_fs->use_dedicated != 0 )
 		{
 			/* allow the dedicated tool to mount */
@@ -87,6 +87,7 @@ Something wrong. OCFS requested, but ocfsp2.h or libocfs2 missing.
 #include "wfs_util.h"
 #include "wfs_wiping.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 struct wfs_ocfs_block_data
 {
@@ -157,7 +158,6 @@ static int wfs_ocfs_wipe_part_blocks (
 	struct wfs_ocfs_block_data * bd = (struct wfs_ocfs_block_data *)priv_data;
 	errcode_t error = 0;
 	int changed = 0;
-	int selected[WFS_NPAT] = {0};
 	size_t to_wipe;
 	unsigned int offset;
 	unsigned long int j;
@@ -204,7 +204,7 @@ static int wfs_ocfs_wipe_part_blocks (
 						}
 					}
 					wfs_fill_buffer ( j, &(bd->wd.buf[offset]), to_wipe,
-						selected, bd->wd.filesys );/* buf OK */
+						bd->wd.filesys );/* buf OK */
 					if ( sig_recvd != 0 )
 					{
 						break;
@@ -306,7 +306,6 @@ wfs_ocfs_wipe_part (
 	size_t cluster_size;
 	const size_t sig_len = strlen (OCFS2_INODE_SIGNATURE);
 	unsigned int j;
-	int selected[WFS_NPAT] = {0};
 	size_t to_wipe;
 	unsigned int offset;
 	errcode_t error = 0;
@@ -431,7 +430,7 @@ wfs_ocfs_wipe_part (
 					&& (sig_recvd == 0); j++ )
 				{
 					wfs_fill_buffer ( j, &(dinode->id2.i_data.id_data[offset]),
-						to_wipe, selected, wfs_fs );/* buf OK */
+						to_wipe, wfs_fs );/* buf OK */
 					if ( sig_recvd != 0 )
 					{
 						break;
@@ -521,6 +520,360 @@ wfs_ocfs_wipe_part (
 /* ============================================================= */
 
 #ifdef WFS_WANT_WFS
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ocfs_add_group WFS_PARAMS ((
+	ocfs2_filesys * const ocfs2, const struct ocfs2_group_desc * const gd,
+	wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Adds the free clusters of one group of the global bitmap to the map.
+ * \param ocfs2 The filesystem.
+ * \param gd The group descriptor.
+ * \param map The map to add the free clusters to.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ocfs_add_group (
+# ifdef WFS_ANSIC
+	ocfs2_filesys * const ocfs2, const struct ocfs2_group_desc * const gd,
+	wfs_extent_map_t * const map)
+# else
+	ocfs2, gd, map)
+	ocfs2_filesys * const ocfs2;
+	const struct ocfs2_group_desc * const gd;
+	wfs_extent_map_t * const map;
+# endif
+{
+	wfs_errcode_t ret_grp = WFS_SUCCESS;
+	wfs_blkno_t first_cluster = 0;
+	unsigned int bit;
+	unsigned int run_start = 0;
+	int in_run = 0;
+
+	if ( (ocfs2 == NULL) || (gd == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	/* the first group starts at cluster 0, though it's not located there */
+	if ( gd->bg_blkno != OCFS2_RAW_SB(ocfs2->fs_super)->s_first_cluster_group )
+	{
+		first_cluster = ocfs2_blocks_to_clusters (ocfs2, gd->bg_blkno);
+	}
+	for ( bit = 0; (bit < gd->bg_bits) && (ret_grp == WFS_SUCCESS); bit++ )
+	{
+		if ( (bit % 8 == 0) && (bit + 8 <= gd->bg_bits)
+			&& (gd->bg_bitmap[bit / 8] == 0xFF) )
+		{
+			/* all used */
+			if ( in_run != 0 )
+			{
+				ret_grp = wfs_extmap_append (map,
+					first_cluster + run_start, bit - run_start);
+				in_run = 0;
+			}
+			bit += 7;
+			continue;
+		}
+		if ( (gd->bg_bitmap[bit / 8] & (1 << (bit % 8))) == 0 )
+		{
+			if ( in_run == 0 )
+			{
+				run_start = bit;
+				in_run = 1;
+			}
+		}
+		else if ( in_run != 0 )
+		{
+			ret_grp = wfs_extmap_append (map,
+				first_cluster + run_start, bit - run_start);
+			in_run = 0;
+		}
+	}
+	if ( (in_run != 0) && (ret_grp == WFS_SUCCESS) )
+	{
+		ret_grp = wfs_extmap_append (map,
+			first_cluster + run_start, gd->bg_bits - run_start);
+	}
+	return ret_grp;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ocfs_get_free_extents WFS_PARAMS ((
+	ocfs2_filesys * const ocfs2, wfs_extent_map_t * const map,
+	errcode_t * const error));
+# endif
+
+/**
+ * Finds all the free clusters on an OCFS2 filesystem, by walking the chains
+ *	of group descriptors of the global bitmap. Groups with no free
+ *	clusters are skipped without checking their bitmaps.
+ * \param ocfs2 The filesystem.
+ * \param map The map to put the free clusters in.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ocfs_get_free_extents (
+# ifdef WFS_ANSIC
+	ocfs2_filesys * const ocfs2, wfs_extent_map_t * const map,
+	errcode_t * const error)
+# else
+	ocfs2, map, error)
+	ocfs2_filesys * const ocfs2;
+	wfs_extent_map_t * const map;
+	errcode_t * const error;
+# endif
+{
+	wfs_errcode_t ret_free = WFS_SUCCESS;
+	uint64_t bitmap_blkno;
+	uint64_t gd_blkno;
+	ocfs2_cached_inode * ci = NULL;
+	struct ocfs2_chain_list * cl;
+	struct ocfs2_group_desc * gd;
+	char * gd_buf;
+	unsigned int chain;
+
+	if ( (ocfs2 == NULL) || (map == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+
+	*error = ocfs2_lookup_system_inode (ocfs2, GLOBAL_BITMAP_SYSTEM_INODE,
+		0, &bitmap_blkno);
+	if ( *error != 0 )
+	{
+		return WFS_BLBITMAPREAD;
+	}
+	*error = ocfs2_read_cached_inode (ocfs2, bitmap_blkno, &ci);
+	if ( *error != 0 )
+	{
+		return WFS_BLBITMAPREAD;
+	}
+	WFS_SET_ERRNO (0);
+	gd_buf = (char *) malloc ( (size_t)ocfs2->fs_blocksize );
+	if ( gd_buf == NULL )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
+		ocfs2_free_cached_inode (ocfs2, ci);
+		return WFS_MALLOC;
+	}
+
+	cl = &(ci->ci_inode->id2.i_chain);
+	for ( chain = 0; (chain < cl->cl_next_free_rec) && (sig_recvd == 0)
+		&& (ret_free == WFS_SUCCESS); chain++ )
+	{
+		if ( cl->cl_recs[chain].c_free == 0 )
+		{
+			/* no free clusters in the whole chain */
+			continue;
+		}
+		for ( gd_blkno = cl->cl_recs[chain].c_blkno;
+			(gd_blkno != 0) && (sig_recvd == 0); gd_blkno = gd->bg_next_group )
+		{
+			*error = ocfs2_read_group_desc (ocfs2, gd_blkno, gd_buf);
+			if ( *error != 0 )
+			{
+				ret_free = WFS_BLBITMAPREAD;
+				break;
+			}
+			gd = (struct ocfs2_group_desc *) gd_buf;
+			if ( gd->bg_free_bits_count == 0 )
+			{
+				/* a full group */
+				continue;
+			}
+			ret_free = wfs_ocfs_add_group (ocfs2, gd, map);
+			if ( ret_free != WFS_SUCCESS )
+			{
+				break;
+			}
+		}
+	}
+	free (gd_buf);
+	ocfs2_free_cached_inode (ocfs2, ci);
+	/* the chains aren't ordered by the cluster numbers */
+	wfs_extmap_sort (map);
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+/* An OCFS2 filesystem, for reading and writing free clusters */
+struct wfs_ocfs_io
+{
+	ocfs2_filesys * ocfs2;
+	unsigned int blocks_per_cluster;
+};
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ocfs_read_clusters WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive clusters of an OCFS2 filesystem.
+ * \param data Pointer to a 'struct wfs_ocfs_io'.
+ * \param buf The buffer for the data.
+ * \param start The first cluster to read.
+ * \param count The number of clusters to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ocfs_read_clusters (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_ocfs_io * io;
+	errcode_t err;
+
+	io = (struct wfs_ocfs_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	err = io_read_block_nocache (io->ocfs2->fs_io,
+		/* blkno */ (int64_t)(start * io->blocks_per_cluster),
+		/* count */ (int)(count * io->blocks_per_cluster),
+		(char *)buf);
+	if ( err != 0 )
+	{
+		*error = (wfs_errcode_t) err;
+		return WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ocfs_write_clusters WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive clusters of an OCFS2 filesystem.
+ * \param data Pointer to a 'struct wfs_ocfs_io'.
+ * \param buf The buffer with the data.
+ * \param start The first cluster to write.
+ * \param count The number of clusters to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_ocfs_write_clusters (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_ocfs_io * io;
+	errcode_t err;
+
+	io = (struct wfs_ocfs_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	err = io_write_block_nocache (io->ocfs2->fs_io,
+		/* blkno */ (int64_t)(start * io->blocks_per_cluster),
+		/* count */ (int)(count * io->blocks_per_cluster),
+		(char *)buf);
+	if ( err != 0 )
+	{
+		*error = (wfs_errcode_t) err;
+		return WFS_BLKWR;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifdef HAVE_IO_GET_FD
+#  ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_ocfs_sync_clusters WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+#  endif
+
+/**
+ * Makes the clusters written to an OCFS2 filesystem reach the media.
+ * \param data Pointer to a 'struct wfs_ocfs_io'.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#  ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#  endif
+wfs_ocfs_sync_clusters (
+#  ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+#  else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+#  endif
+{
+	struct wfs_ocfs_io * io;
+	int res;
+
+	io = (struct wfs_ocfs_io *) data;
+	if ( (io == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	/* the clusters are written without the library's cache,
+	   so only the device's data has to be synced */
+	res = wfs_sync_fd (io_get_fd (io->ocfs2->fs_io));
+	if ( res != 0 )
+	{
+		*error = (wfs_errcode_t) res;
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+# endif /* HAVE_IO_GET_FD */
+
+/* ======================================================================== */
+
 /**
  * Wipes the free space on the given OCFS filesystem.
  * \param wfs_fs The filesystem.
@@ -538,17 +891,15 @@ wfs_ocfs_wipe_fs (
 {
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
 	unsigned int prev_percent = 0;
-	uint32_t curr_cluster;
-	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
-	unsigned char * buf;
-	errcode_t err;
-	int is_alloc;
 	size_t cluster_size;
-	unsigned int blocks_per_cluster;
 	errcode_t error = 0;
+	wfs_errcode_t wipe_error = 0;
 	ocfs2_filesys * ocfs2;
 	errcode_t * error_ret;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_direct_io_t direct;
+	struct wfs_ocfs_io io;
 
 	ocfs2 = (ocfs2_filesys *) wfs_fs.fs_backend;
 	error_ret = (errcode_t *) wfs_fs.fs_error;
@@ -568,255 +919,36 @@ wfs_ocfs_wipe_fs (
 		return WFS_BADPARAM;
 	}
 
-	blocks_per_cluster = (unsigned int)(ocfs2_clusters_to_blocks (
-		ocfs2, 1) & 0x0FFFFFFFF);
-
-	WFS_SET_ERRNO (0);
-	buf = (unsigned char *) malloc ( cluster_size );
-	if ( buf == NULL )
-	{
-		error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
-		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		if ( error_ret != NULL )
-		{
-			*error_ret = error;
-		}
-		return WFS_MALLOC;
-	}
-
-	if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	/* find the free clusters once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_ocfs_get_free_extents (ocfs2, &map, &error);
+	if ( ret_wfs == WFS_SUCCESS )
 	{
-		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
-		{
-			for ( curr_cluster = 0;
-				(curr_cluster < ocfs2->fs_clusters) && (sig_recvd == 0);
-				curr_cluster++ )
-			{
-				is_alloc = 1;
-				err = ocfs2_test_cluster_allocated (ocfs2, curr_cluster,
-					&is_alloc);
-				if ( err != 0 )
-				{
-					ret_wfs = WFS_BLBITMAPREAD;
-					wfs_show_progress (WFS_PROGRESS_WFS,
-						(unsigned int) (((ocfs2->fs_clusters * j + curr_cluster) * 100)/(ocfs2->fs_clusters * wfs_fs.npasses)),
-						&prev_percent);
-					continue;
-				}
-				if ( is_alloc != 0 )
-				{
-					wfs_show_progress (WFS_PROGRESS_WFS,
-						(unsigned int) (((ocfs2->fs_clusters * j + curr_cluster) * 100)/(ocfs2->fs_clusters * wfs_fs.npasses)),
-						&prev_percent);
-					continue;
-				}
-
-				/* cluster is unused - wipe it */
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					err = io_read_block_nocache (ocfs2->fs_io,
-						/* blkno */ curr_cluster * blocks_per_cluster,
-						/* count */ (int)blocks_per_cluster,
-						(char *)buf);
-					if ( err != 0 )
-					{
-						ret_wfs = WFS_BLKRD;
-						break;
-					}
-					if ( wfs_is_block_zero (buf, cluster_size) != 0 )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						j = wfs_fs.npasses * 2;
-						break;
-					}
-				}
-				wfs_fill_buffer ( j, buf, cluster_size,
-					selected, wfs_fs );/* buf OK */
-				if ( sig_recvd != 0 )
-				{
-					break;
-				}
-				/* writing modified cluster here: */
-				err = io_write_block_nocache (ocfs2->fs_io,
-					/* blkno */ curr_cluster * blocks_per_cluster,
-					/* count */ (int)blocks_per_cluster,
-					(char *)buf);
-				if ( err != 0 )
-				{
-					free (buf);
-					wfs_show_progress (WFS_PROGRESS_WFS, 100,
-						&prev_percent);
-					if ( error_ret != NULL )
-					{
-						*error_ret = error;
-					}
-					return WFS_BLKWR;
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_ocfs_flush_fs (wfs_fs);
-				}
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int) (((ocfs2->fs_clusters * j + curr_cluster) * 100)/(ocfs2->fs_clusters * wfs_fs.npasses)),
-					&prev_percent);
-			}
-		}
-		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-		{
-			if ( j != wfs_fs.npasses * 2 )
-			{
-				/* last pass with zeros: */
-				WFS_MEMSET ( buf, 0, cluster_size );
-				if ( sig_recvd == 0 )
-				{
-					wfs_ocfs_flush_fs (wfs_fs);
-					for ( curr_cluster = 0;
-						(curr_cluster < ocfs2->fs_clusters) && (sig_recvd == 0);
-						curr_cluster++ )
-					{
-						/* writing modified cluster here: */
-						err = io_write_block_nocache (ocfs2->fs_io,
-							curr_cluster * blocks_per_cluster,
-							(int)blocks_per_cluster, (char *)buf);
-						if ( err != 0 )
-						{
-							free (buf);
-							wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-							if ( error_ret != NULL )
-							{
-								*error_ret = error;
-							}
-							return WFS_BLKWR;
-						}
-						/* No need to flush the last writing of a given block. *
-						if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-						{
-							error = wfs_ocfs_flush_fs (
-								wfs_fs);
-						}*/
-					}
-					wfs_ocfs_flush_fs (wfs_fs);
-				}
-			}
-		}
+		io.ocfs2 = ocfs2;
+		io.blocks_per_cluster = (unsigned int)(ocfs2_clusters_to_blocks (
+			ocfs2, 1) & 0x0FFFFFFFF);
+		ops.read_blocks = &wfs_ocfs_read_clusters;
+		ops.write_blocks = &wfs_ocfs_write_clusters;
+		ops.write_pattern = NULL;
+# ifdef HAVE_IO_GET_FD
+		ops.sync_blocks = &wfs_ocfs_sync_clusters;
+# else
+		ops.sync_blocks = NULL;
+# endif
+		ops.flush_fs = &wfs_ocfs_flush_fs;
+		ops.data = &io;
+		wfs_extmap_direct_open (wfs_fs, cluster_size, &direct, &ops);
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map, cluster_size,
+			&ops, &wipe_error);
+		wfs_extmap_direct_close (&direct);
+		error = (errcode_t) wipe_error;
 	}
 	else
 	{
-		for ( curr_cluster = 0;
-			(curr_cluster < ocfs2->fs_clusters) && (sig_recvd == 0);
-			curr_cluster++ )
-		{
-			is_alloc = 1;
-			err = ocfs2_test_cluster_allocated (ocfs2, curr_cluster,
-				&is_alloc);
-			if ( err != 0 )
-			{
-				ret_wfs = WFS_BLBITMAPREAD;
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int) ((curr_cluster * 100)/ocfs2->fs_clusters),
-					&prev_percent);
-				continue;
-			}
-			if ( is_alloc != 0 )
-			{
-				wfs_show_progress (WFS_PROGRESS_WFS,
-					(unsigned int) ((curr_cluster * 100)/ocfs2->fs_clusters),
-					&prev_percent);
-				continue;
-			}
-
-			/* cluster is unused - wipe it */
-			for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0); j++ )
-			{
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					err = io_read_block_nocache (ocfs2->fs_io,
-						/* blkno */ curr_cluster * blocks_per_cluster,
-						/* count */ (int)blocks_per_cluster,
-						(char *)buf);
-					if ( err != 0 )
-					{
-						ret_wfs = WFS_BLKRD;
-						break;
-					}
-					if ( wfs_is_block_zero (buf, cluster_size) != 0 )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						j = wfs_fs.npasses * 2;
-						break;
-					}
-				}
-				wfs_fill_buffer ( j, buf, cluster_size,
-					selected, wfs_fs );/* buf OK */
-				if ( sig_recvd != 0 )
-				{
-					break;
-				}
-				/* writing modified cluster here: */
-				err = io_write_block_nocache (ocfs2->fs_io,
-					/* blkno */ curr_cluster * blocks_per_cluster,
-					/* count */ (int)blocks_per_cluster,
-					(char *)buf);
-				if ( err != 0 )
-				{
-					free (buf);
-					wfs_show_progress (WFS_PROGRESS_WFS, 100,
-						&prev_percent);
-					if ( error_ret != NULL )
-					{
-						*error_ret = error;
-					}
-					return WFS_BLKWR;
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_ocfs_flush_fs (wfs_fs);
-				}
-			}
-			if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-			{
-				if ( j != wfs_fs.npasses * 2 )
-				{
-					/* last pass with zeros: */
-					WFS_MEMSET ( buf, 0, cluster_size );
-					if ( sig_recvd == 0 )
-					{
-						/* writing modified cluster here: */
-						err = io_write_block_nocache (ocfs2->fs_io,
-							curr_cluster * blocks_per_cluster,
-							(int)blocks_per_cluster, (char *)buf);
-						if ( err != 0 )
-						{
-							free (buf);
-							wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-							if ( error_ret != NULL )
-							{
-								*error_ret = error;
-							}
-							return WFS_BLKWR;
-						}
-						/* No need to flush the last writing of a given block. *
-						if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-						{
-							error = wfs_ocfs_flush_fs (
-								wfs_fs);
-						}*/
-					}
-				}
-			}
-			wfs_show_progress (WFS_PROGRESS_WFS,
-				(unsigned int) ((100*curr_cluster)/ocfs2->fs_clusters),
-				&prev_percent);
-		}
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	}
+	wfs_extmap_free (&map);
 
-	free (buf);
-
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	if ( error_ret != NULL )
 	{
 		*error_ret = error;
@@ -861,7 +993,6 @@ static int wfs_ocfs_wipe_unrm_dir (
 	errcode_t err;
 	wfs_wipedata_t * wd = (wfs_wipedata_t *)priv_data;
 	int changed = 0;
-	int selected[WFS_NPAT] = {0};
 	ocfs2_filesys * ocfs2;
 
 	if ( (dirent == NULL) || (wd == NULL) )
@@ -903,7 +1034,7 @@ static int wfs_ocfs_wipe_unrm_dir (
 			wfs_fill_buffer ( wd->passno,
 				(unsigned char *)dirent->name,
 				OCFS2_MAX_FILENAME_LEN,
-				selected, wd->filesys );
+				wd->filesys );
 		}
 
 		changed = 1;
@@ -949,7 +1080,6 @@ wfs_ocfs_wipe_unrm (
 	wfs_wipedata_t wd;
 	uint64_t curr_block;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	unsigned char * buf;
 	unsigned char * jbuf;
 	size_t cluster_size;
@@ -1107,8 +1237,7 @@ wfs_ocfs_wipe_unrm (
 				&& (sig_recvd == 0); j++ )
 			{
 				wfs_fill_buffer ( j, jbuf,
-					(size_t)jsb->s_blocksize, selected,
-					wfs_fs );/* buf OK */
+					(size_t)jsb->s_blocksize, wfs_fs );/* buf OK */
 				if ( sig_recvd != 0 )
 				{
 					break;
@@ -1277,7 +1406,8 @@ wfs_ocfs_open_fs (
 
 	wfs_fs->whichfs = WFS_CURR_FS_NONE;
 	ocfs2 = NULL;
-	err = ocfs2_open (wfs_fs->fsname, OCFS2_FLAG_RW | OCFS2_FLAG_BUFFERED,
+	err = ocfs2_open (wfs_fs->fsname, ((wfs_fs->plan_only != 0)?
+		OCFS2_FLAG_RO : OCFS2_FLAG_RW) | OCFS2_FLAG_BUFFERED,
 		0, 0, &ocfs2);
 	if ( (err != 0) || (ocfs2 == NULL) )
 	{
@@ -1292,6 +1422,8 @@ wfs_ocfs_open_fs (
 		wfs_fs->whichfs = WFS_CURR_FS_OCFS;
 		ret = WFS_SUCCESS;
 		wfs_fs->fs_backend = ocfs2;
+		wfs_set_uuid (wfs_fs, OCFS2_RAW_SB (ocfs2->fs_super)->s_uuid,
+			sizeof (OCFS2_RAW_SB (ocfs2->fs_super)->s_uuid));
 	}
 
 	return ret;
@@ -0,0 +1,316 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- planning the wiping without writing.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_cfg.h"
+
+#include <stdio.h>	/* printf() */
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>	/* malloc(), free() */
+#endif
+
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# if ((!defined STDC_HEADERS) || (!STDC_HEADERS)) && (defined HAVE_MEMORY_H)
+#  include <memory.h>
+# endif
+# include <string.h>	/* memset() */
+#endif
+
+#ifdef HAVE_LIBINTL_H
+# include <libintl.h>	/* translation stuff */
+#endif
+
+#include "wipefreespace.h"
+#include "wfs_plan.h"
+#include "wfs_stats.h"
+#include "wfs_signal.h"
+#include "wfs_util.h"
+
+#if (defined HAVE_LONG_LONG) || (defined HAVE_LONG_LONG_INT)
+# define WFS_BLKNO_FORMAT "%llu"
+#else
+# define WFS_BLKNO_FORMAT "%lu"
+#endif
+
+static const char * const msg_plan = N_("Plan of wiping the free space (nothing is written)");
+static const char * const msg_extents = N_("Free extents");
+static const char * const msg_free = N_("Free bytes");
+static const char * const msg_passes = N_("Passes, including the zero pass");
+static const char * const msg_to_write = N_("Bytes to write");
+static const char * const msg_speed = N_("Read speed (MB/s)");
+static const char * const msg_limit = N_("Write speed limit (MB/s)");
+static const char * const msg_eta = N_("Estimated time (s)");
+static const char * const msg_unknown = N_("unknown");
+static const char * const msg_sizes = N_("Free extent sizes (bytes: extents, bytes)");
+static const char * const msg_zeros = N_("The all-zero blocks, which would be skipped, are included");
+
+#if (defined TEST_COMPILE) && (defined WFS_ANSIC)
+# undef WFS_ANSIC
+#endif
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static double GCC_WARN_UNUSED_RESULT wfs_plan_probe WFS_PARAMS ((
+	const wfs_extent_map_t * const map, const size_t fs_block_size,
+	const wfs_extent_ops_t * const ops, wfs_errcode_t * const error));
+#endif
+
+/**
+ * Measures how fast the free space can be read, by reading the beginning
+ *	of the largest free extent, for at most WFS_PLAN_PROBE_TIME seconds or
+ *	WFS_PLAN_PROBE_BYTES bytes. Nothing is written.
+ * \param map The free extents.
+ * \param fs_block_size The size of a single block.
+ * \param ops The backend's operations.
+ * \param error Pointer to the error variable.
+ * \return the number of bytes read per second, 0 if not known.
+ */
+static double GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_plan_probe (
+#ifdef WFS_ANSIC
+	const wfs_extent_map_t * const map, const size_t fs_block_size,
+	const wfs_extent_ops_t * const ops, wfs_errcode_t * const error)
+#else
+	map, fs_block_size, ops, error)
+	const wfs_extent_map_t * const map;
+	const size_t fs_block_size;
+	const wfs_extent_ops_t * const ops;
+	wfs_errcode_t * const error;
+#endif
+{
+	const wfs_extent_t * largest;
+	unsigned char * buf;
+	size_t chunk_blocks;
+	size_t e;
+	wfs_blkno_t offset;
+	wfs_blkno_t to_read;
+	wfs_blkno_t bytes = 0;
+	double start;
+	double now;
+	double read_start;
+
+	if ( (ops->read_blocks == NULL) || (map->count == 0) )
+	{
+		return 0.0;
+	}
+	largest = &(map->extents[0]);
+	for ( e = 1; e < map->count; e++ )
+	{
+		if ( map->extents[e].length > largest->length )
+		{
+			largest = &(map->extents[e]);
+		}
+	}
+	chunk_blocks = wfs_extmap_chunk_blocks (fs_block_size);
+	WFS_SET_ERRNO (0);
+	buf = (unsigned char *) malloc (chunk_blocks * fs_block_size);
+	if ( buf == NULL )
+	{
+		return 0.0;
+	}
+	start = wfs_get_time ();
+	now = start;
+	for ( offset = 0; (offset < largest->length) && (sig_recvd == 0)
+		&& (bytes < WFS_PLAN_PROBE_BYTES)
+		&& (now - start < WFS_PLAN_PROBE_TIME); offset += to_read )
+	{
+		to_read = largest->length - offset;
+		if ( to_read > chunk_blocks )
+		{
+			to_read = chunk_blocks;
+		}
+		read_start = now;
+		if ( (*(ops->read_blocks)) (ops->data, buf, largest->start + offset,
+			to_read, error) != WFS_SUCCESS )
+		{
+			/* the plan is still useful without the speed */
+			bytes = 0;
+			break;
+		}
+		now = wfs_get_time ();
+		bytes += to_read * fs_block_size;
+		wfs_stats_add_read (to_read * fs_block_size, now - read_start);
+	}
+	free (buf);
+	if ( (bytes == 0) || (now <= start) )
+	{
+		return 0.0;
+	}
+	return (double) bytes / (now - start);
+}
+
+/* ======================================================================== */
+
+/**
+ * Shows how much wiping the free space would take, without writing
+ *	anything: the number and the sizes of the free extents, the number
+ *	of bytes to write with all the passes and the estimated time, based
+ *	on the speed of reading the free space.
+ * \param wfs_fs The filesystem.
+ * \param map The free extents.
+ * \param fs_block_size The size of a single block.
+ * \param ops The backend's operations.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS or an error code.
+ */
+wfs_errcode_t GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_plan_extents (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const wfs_extent_map_t * const map,
+	const size_t fs_block_size, const wfs_extent_ops_t * const ops,
+	wfs_errcode_t * const error)
+#else
+	wfs_fs, map, fs_block_size, ops, error)
+	const wfs_fsid_t wfs_fs;
+	const wfs_extent_map_t * const map;
+	const size_t fs_block_size;
+	const wfs_extent_ops_t * const ops;
+	wfs_errcode_t * const error;
+#endif
+{
+	unsigned long int counts[WFS_PLAN_BUCKETS];
+	wfs_blkno_t sizes[WFS_PLAN_BUCKETS];
+	wfs_blkno_t to_write;
+	wfs_blkno_t length;
+	unsigned long int all_passes;
+	unsigned int b;
+	size_t e;
+	double rate;
+	double limit = 0.0;
+	double iops_limit;
+
+	if ( fs_block_size == 0 )
+	{
+		return WFS_BADPARAM;
+	}
+	WFS_MEMSET (counts, 0, sizeof (counts));
+	WFS_MEMSET (sizes, 0, sizeof (sizes));
+	for ( e = 0; e < map->count; e++ )
+	{
+		b = 0;
+		for ( length = map->extents[e].length;
+			(length > 1) && (b < WFS_PLAN_BUCKETS - 1); length >>= 1 )
+		{
+			b++;
+		}
+		counts[b]++;
+		sizes[b] += map->extents[e].length * fs_block_size;
+	}
+	all_passes = wfs_fs.npasses + ((wfs_fs.zero_pass != 0)? 1 : 0);
+	to_write = map->total_blocks * fs_block_size * all_passes;
+
+	rate = wfs_plan_probe (map, fs_block_size, ops, error);
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	if ( wfs_fs.max_rate != 0 )
+	{
+		limit = (double) wfs_fs.max_rate;
+	}
+	if ( wfs_fs.max_iops != 0 )
+	{
+		/* each write is at most one buffer */
+		iops_limit = (double) wfs_fs.max_iops
+			* (double) (wfs_extmap_chunk_blocks (fs_block_size)
+			* fs_block_size);
+		if ( (limit <= 0.0) || (iops_limit < limit) )
+		{
+			limit = iops_limit;
+		}
+	}
+
+	if ( wfs_is_stdout_open () == 0 )
+	{
+		return WFS_SUCCESS;
+	}
+	printf ("%s:%s: %s:\n", wfs_get_program_name (),
+		(wfs_fs.fsname != NULL)? wfs_fs.fsname : "", _(msg_plan));
+	printf ("  %s: %lu\n", _(msg_extents), (unsigned long int) map->count);
+	printf ("  %s: " WFS_BLKNO_FORMAT "\n", _(msg_free),
+		map->total_blocks * fs_block_size);
+	printf ("  %s: %lu\n", _(msg_passes), all_passes);
+	printf ("  %s: " WFS_BLKNO_FORMAT "\n", _(msg_to_write), to_write);
+	if ( wfs_fs.no_wipe_zero_blocks != 0 )
+	{
+		/* finding them would mean reading all the free space */
+		printf ("  %s\n", _(msg_zeros));
+	}
+	if ( rate > 0.0 )
+	{
+		printf ("  %s: %.2f\n", _(msg_speed), rate / (1024.0 * 1024.0));
+	}
+	else
+	{
+		printf ("  %s: %s\n", _(msg_speed), _(msg_unknown));
+	}
+	if ( limit > 0.0 )
+	{
+		printf ("  %s: %.2f\n", _(msg_limit), limit / (1024.0 * 1024.0));
+		if ( (rate <= 0.0) || (limit < rate) )
+		{
+			rate = limit;
+		}
+	}
+	if ( rate > 0.0 )
+	{
+		printf ("  %s: %.0f\n", _(msg_eta), (double) to_write / rate);
+	}
+	else
+	{
+		printf ("  %s: %s\n", _(msg_eta), _(msg_unknown));
+	}
+	printf ("  %s:\n", _(msg_sizes));
+	for ( b = 0; b < WFS_PLAN_BUCKETS; b++ )
+	{
+		if ( counts[b] == 0 )
+		{
+			continue;
+		}
+		if ( b == WFS_PLAN_BUCKETS - 1 )
+		{
+			printf ("    [" WFS_BLKNO_FORMAT ", -): %lu, " WFS_BLKNO_FORMAT
+				"\n", ((wfs_blkno_t) 1 << b) * fs_block_size,
+				counts[b], sizes[b]);
+		}
+		else
+		{
+			printf ("    [" WFS_BLKNO_FORMAT ", " WFS_BLKNO_FORMAT "): %lu, "
+				WFS_BLKNO_FORMAT "\n",
+				((wfs_blkno_t) 1 << b) * fs_block_size,
+				((wfs_blkno_t) 1 << (b + 1)) * fs_block_size,
+				counts[b], sizes[b]);
+		}
+	}
+	fflush (stdout);
+	return WFS_SUCCESS;
+}
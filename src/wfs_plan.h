@@ -0,0 +1,55 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- planning the wiping without writing, header file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WFS_PLAN_H
+# define WFS_PLAN_H 1
+
+# include "wipefreespace.h"
+# include "wfs_extents.h"
+
+# ifdef WFS_PLAN_PROBE_BYTES
+#  undef WFS_PLAN_PROBE_BYTES
+# endif
+
+/* the maximum number of bytes read to measure the device's speed */
+# define	WFS_PLAN_PROBE_BYTES (64UL * 1024 * 1024)
+
+# ifdef WFS_PLAN_PROBE_TIME
+#  undef WFS_PLAN_PROBE_TIME
+# endif
+
+/* the maximum number of seconds spent measuring the device's speed */
+# define	WFS_PLAN_PROBE_TIME 2.0
+
+# ifdef WFS_PLAN_BUCKETS
+#  undef WFS_PLAN_BUCKETS
+# endif
+
+/* the number of buckets in the histogram of free extent sizes,
+   one per power of 2 of blocks, the last one is open-ended */
+# define	WFS_PLAN_BUCKETS 40
+
+extern wfs_errcode_t GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_plan_extents WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		const wfs_extent_map_t * const map, const size_t fs_block_size,
+		const wfs_extent_ops_t * const ops, wfs_errcode_t * const error));
+
+#endif	/* WFS_PLAN_H */
@@ -0,0 +1,310 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- recognizing filesystems by their magic numbers.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_cfg.h"
+
+#include <stdio.h>	/* NULL */
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>	/* malloc(), free() */
+#endif
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>	/* read(), close() */
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>	/* for open() */
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>	/* for open() */
+#endif
+
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>	/* open() */
+#endif
+
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# if ((!defined STDC_HEADERS) || (!STDC_HEADERS)) && (defined HAVE_MEMORY_H)
+#  include <memory.h>
+# endif
+# include <string.h>	/* memcmp() */
+#endif
+
+#include "wipefreespace.h"
+#include "wfs_probe.h"
+
+#ifndef O_RDONLY
+# define O_RDONLY	0
+#endif
+
+#ifndef EINTR
+# define EINTR 4
+#endif
+
+/* A magic number of a filesystem and where it is on the device */
+struct wfs_probe_magic
+{
+	wfs_curr_fs_t	fs;
+	size_t		offset;
+	const char *	magic;
+	size_t		len;
+};
+
+/* The magic numbers which are unlikely to appear by accident, checked first.
+   The offsets are from the start of the device, the multi-byte numbers
+   are stored little-endian, except for HFS+. */
+static const struct wfs_probe_magic wfs_probe_magics[] =
+{
+	{ WFS_CURR_FS_XFS,	0,		"XFSB",		4 },
+	{ WFS_CURR_FS_NTFS,	3,		"NTFS    ",	8 },
+	/* the superblock at 1024, s_magic at 56 */
+	{ WFS_CURR_FS_EXT234FS,	1024 + 56,	"\x53\xEF",	2 },
+	/* the volume header at 1024, the signature first */
+	{ WFS_CURR_FS_HFSP,	1024,		"H+",		2 },
+	{ WFS_CURR_FS_HFSP,	1024,		"HX",		2 },
+	/* the superblock at 32 KiB */
+	{ WFS_CURR_FS_JFS,	32768,		"JFS1",		4 },
+	/* the master superblock at 64 KiB */
+	{ WFS_CURR_FS_REISER4,	65536,		"ReIsEr4",	7 },
+	/* the superblock at 64 KiB (or 8 KiB in the old format), magic at 52 */
+	{ WFS_CURR_FS_REISERFS,	65536 + 52,	"ReIsEr",	6 },
+	{ WFS_CURR_FS_REISERFS,	8192 + 52,	"ReIsEr",	6 },
+	/* the superblock in block 2, for each possible block size */
+	{ WFS_CURR_FS_OCFS,	1024,		"OCFSV2",	6 },
+	{ WFS_CURR_FS_OCFS,	2048,		"OCFSV2",	6 },
+	{ WFS_CURR_FS_OCFS,	4096,		"OCFSV2",	6 },
+	{ WFS_CURR_FS_OCFS,	8192,		"OCFSV2",	6 }
+};
+
+/* The short MinixFS magic numbers in the superblock at 1024, in both byte
+   orders, checked last, because they can easily appear by accident */
+static const struct wfs_probe_magic wfs_probe_minix_magics[] =
+{
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x7F\x13",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x8F\x13",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x68\x24",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x78\x24",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x13\x7F",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x13\x8F",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x24\x68",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 16,	"\x24\x78",	2 },
+	/* version 3 has it at 24 */
+	{ WFS_CURR_FS_MINIXFS,	1024 + 24,	"\x5A\x4D",	2 },
+	{ WFS_CURR_FS_MINIXFS,	1024 + 24,	"\x4D\x5A",	2 }
+};
+
+#if (defined TEST_COMPILE) && (defined WFS_ANSIC)
+# undef WFS_ANSIC
+#endif
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_curr_fs_t GCC_WARN_UNUSED_RESULT wfs_probe_table WFS_PARAMS ((
+	const unsigned char * const buf, const size_t len,
+	const struct wfs_probe_magic * const magics, const size_t nmagics));
+#endif
+
+/**
+ * Checks the given buffer for the given magic numbers.
+ * \param buf The beginning of the device.
+ * \param len The number of bytes in the buffer.
+ * \param magics The magic numbers to look for.
+ * \param nmagics The number of elements of "magics".
+ * \return The filesystem with the first matching magic number,
+ *	WFS_CURR_FS_NONE if none matches.
+ */
+static wfs_curr_fs_t GCC_WARN_UNUSED_RESULT
+wfs_probe_table (
+#ifdef WFS_ANSIC
+	const unsigned char * const buf, const size_t len,
+	const struct wfs_probe_magic * const magics, const size_t nmagics)
+#else
+	buf, len, magics, nmagics)
+	const unsigned char * const buf;
+	const size_t len;
+	const struct wfs_probe_magic * const magics;
+	const size_t nmagics;
+#endif
+{
+	size_t i;
+
+	for ( i = 0; i < nmagics; i++ )
+	{
+		if ( (magics[i].offset + magics[i].len <= len)
+			&& (memcmp (&buf[magics[i].offset], magics[i].magic,
+				magics[i].len) == 0) )
+		{
+			return magics[i].fs;
+		}
+	}
+	return WFS_CURR_FS_NONE;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_probe_is_fat WFS_PARAMS ((
+	const unsigned char * const buf, const size_t len));
+#endif
+
+/**
+ * Checks if the given buffer starts with a FAT boot sector.
+ * \param buf The beginning of the device.
+ * \param len The number of bytes in the buffer.
+ * \return 1 if it's a FAT boot sector, 0 otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_probe_is_fat (
+#ifdef WFS_ANSIC
+	const unsigned char * const buf, const size_t len)
+#else
+	buf, len)
+	const unsigned char * const buf;
+	const size_t len;
+#endif
+{
+	if ( len < 512 )
+	{
+		return 0;
+	}
+	/* the boot sector signature */
+	if ( (buf[510] != 0x55) || (buf[511] != 0xAA) )
+	{
+		return 0;
+	}
+	/* the type in the FAT12/16 or in the FAT32 extended boot record */
+	if ( (memcmp (&buf[54], "FAT", 3) == 0)
+		|| (memcmp (&buf[82], "FAT", 3) == 0) )
+	{
+		return 1;
+	}
+	return 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Recognizes the filesystem by the magic numbers in the given data.
+ * \param buf The beginning of the device.
+ * \param len The number of bytes in the buffer.
+ * \return The filesystem found, WFS_CURR_FS_NONE if unknown.
+ */
+wfs_curr_fs_t GCC_WARN_UNUSED_RESULT
+wfs_probe_buffer (
+#ifdef WFS_ANSIC
+	const unsigned char * const buf, const size_t len)
+#else
+	buf, len)
+	const unsigned char * const buf;
+	const size_t len;
+#endif
+{
+	wfs_curr_fs_t fs;
+
+	if ( buf == NULL )
+	{
+		return WFS_CURR_FS_NONE;
+	}
+	fs = wfs_probe_table (buf, len, wfs_probe_magics,
+		sizeof (wfs_probe_magics) / sizeof (wfs_probe_magics[0]));
+	if ( fs != WFS_CURR_FS_NONE )
+	{
+		return fs;
+	}
+	if ( wfs_probe_is_fat (buf, len) != 0 )
+	{
+		return WFS_CURR_FS_FATFS;
+	}
+	return wfs_probe_table (buf, len, wfs_probe_minix_magics,
+		sizeof (wfs_probe_minix_magics) / sizeof (wfs_probe_minix_magics[0]));
+}
+
+/* ======================================================================== */
+
+/**
+ * Recognizes the filesystem on the given device by its magic numbers,
+ *	reading the beginning of the device once.
+ * \param dev_name The name of the device.
+ * \return The filesystem found, WFS_CURR_FS_NONE if unknown or if the device
+ *	can't be read.
+ */
+wfs_curr_fs_t GCC_WARN_UNUSED_RESULT
+wfs_probe_fs (
+#ifdef WFS_ANSIC
+	const char * const dev_name)
+#else
+	dev_name)
+	const char * const dev_name;
+#endif
+{
+	unsigned char * buf;
+	size_t len = 0;
+	ssize_t res;
+	int fd;
+	wfs_curr_fs_t fs;
+
+	if ( dev_name == NULL )
+	{
+		return WFS_CURR_FS_NONE;
+	}
+	buf = (unsigned char *) malloc (WFS_PROBE_SIZE);
+	if ( buf == NULL )
+	{
+		return WFS_CURR_FS_NONE;
+	}
+	fd = open (dev_name, O_RDONLY);
+	if ( fd < 0 )
+	{
+		free (buf);
+		return WFS_CURR_FS_NONE;
+	}
+	while ( len < WFS_PROBE_SIZE )
+	{
+		res = read (fd, &buf[len], WFS_PROBE_SIZE - len);
+		if ( res < 0 )
+		{
+#ifdef HAVE_ERRNO_H
+			if ( errno == EINTR )
+			{
+				continue;
+			}
+#endif
+			break;
+		}
+		if ( res == 0 )
+		{
+			/* a device smaller than the buffer */
+			break;
+		}
+		len += (size_t) res;
+	}
+	close (fd);
+	fs = wfs_probe_buffer (buf, len);
+	free (buf);
+	return fs;
+}
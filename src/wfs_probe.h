@@ -0,0 +1,42 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- recognizing filesystems by their magic numbers, header file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WFS_PROBE_H
+# define WFS_PROBE_H 1
+
+# include "wipefreespace.h"
+
+# ifdef WFS_PROBE_SIZE
+#  undef WFS_PROBE_SIZE
+# endif
+
+/* the number of bytes read from the start of the device to find
+   the magic numbers - the farthest are ReiserFS's, at 64 KiB */
+# define	WFS_PROBE_SIZE (128UL * 1024)
+
+extern wfs_curr_fs_t GCC_WARN_UNUSED_RESULT
+	wfs_probe_fs WFS_PARAMS ((const char * const dev_name));
+
+extern wfs_curr_fs_t GCC_WARN_UNUSED_RESULT
+	wfs_probe_buffer WFS_PARAMS ((const unsigned char * const buf,
+		const size_t len));
+
+#endif	/* WFS_PROBE_H */
@@ -0,0 +1,615 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- machine-readable progress records.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_cfg.h"
+
+#include <stdio.h>	/* sprintf() */
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>	/* write() */
+#endif
+
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# if ((!defined STDC_HEADERS) || (!STDC_HEADERS)) && (defined HAVE_MEMORY_H)
+#  include <memory.h>
+# endif
+# include <string.h>
+#endif
+
+#ifdef HAVE_SIGNAL_H
+# include <signal.h>
+#endif
+
+#include "wipefreespace.h"
+#include "wfs_progress.h"
+#include "wfs_util.h"
+
+/* the maximum length of the device's name in a record, after escaping */
+#define WFS_PROGRESS_DEVICE 512
+
+/* the maximum length of a record */
+#define WFS_PROGRESS_RECORD (WFS_PROGRESS_DEVICE + 512)
+
+/* the additional space for the fields of the other records */
+#define WFS_PROGRESS_EXTRA 1024
+
+#if (defined HAVE_LONG_LONG) || (defined HAVE_LONG_LONG_INT)
+# define WFS_BLKNO_FORMAT "%llu"
+#else
+# define WFS_BLKNO_FORMAT "%lu"
+#endif
+
+/* The progress of the current stage of wiping */
+struct wfs_progress_state
+{
+	int			fd;		/* where the records go, -1 if
+						   the records are disabled */
+	wfs_progress_format_t	format;		/* the format of the records */
+	const char *		device;		/* the filesystem's device */
+	int			type;		/* the stage, -1 if none yet */
+	unsigned long int	passes;		/* the number of passes, 0 if
+						   not known */
+	unsigned long int	pass;		/* the current pass, from 0 */
+	wfs_blkno_t		written;	/* the bytes written so far */
+	wfs_blkno_t		scanned;	/* the bytes read so far */
+	wfs_blkno_t		total;		/* the bytes to write, 0 if
+						   not known */
+	unsigned int		percent;	/* the backend's percentage */
+	int			finished;	/* whether the stage has ended */
+	double			start;		/* the stage's starting time */
+	double			last;		/* the time of the last record */
+	wfs_blkno_t		last_written;	/* the bytes written at the
+						   time of the last record */
+	double			rate;		/* the bytes per second since
+						   the last record */
+	double			avg_rate;	/* the moving average of rate,
+						   negative if not known yet */
+};
+
+typedef struct wfs_progress_state wfs_progress_state_t;
+
+static const char * const wfs_progress_type_names[] =
+{
+	"wfs", "part", "unrm"
+};
+
+static wfs_progress_state_t progress =
+{
+	-1, WFS_PROGRESS_FORMAT_TEXT, "", -1, 0, 0, 0, 0, 0, 0, 0,
+	0.0, 0.0, 0, 0.0, -1.0
+};
+
+#if (defined TEST_COMPILE) && (defined WFS_ANSIC)
+# undef WFS_ANSIC
+#endif
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_progress_escape WFS_PARAMS ((const char * const src,
+	char * const dest, const size_t size));
+#endif
+
+/**
+ * Copies a string, escaping the characters which can't appear in JSON
+ *	strings, as much as fits in the destination.
+ * \param src The string to copy.
+ * \param dest The place for the copy.
+ * \param size The size of the place for the copy.
+ */
+static void
+wfs_progress_escape (
+#ifdef WFS_ANSIC
+	const char * const src, char * const dest, const size_t size)
+#else
+	src, dest, size)
+	const char * const src;
+	char * const dest;
+	const size_t size;
+#endif
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t i;
+	size_t j = 0;
+
+	for ( i = 0; (src[i] != '\0') && (j + 7 < size); i++ )
+	{
+		if ( (src[i] == '"') || (src[i] == '\\') )
+		{
+			dest[j++] = '\\';
+			dest[j++] = src[i];
+		}
+		else if ( ((unsigned char) src[i]) < 0x20 )
+		{
+			dest[j++] = '\\';
+			dest[j++] = 'u';
+			dest[j++] = '0';
+			dest[j++] = '0';
+			dest[j++] = hex[(((unsigned char) src[i]) >> 4) & 0x0F];
+			dest[j++] = hex[((unsigned char) src[i]) & 0x0F];
+		}
+		else
+		{
+			dest[j++] = src[i];
+		}
+	}
+	dest[j] = '\0';
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_progress_write WFS_PARAMS ((const char * const record,
+	const int len));
+#endif
+
+/**
+ * Writes a complete record to the descriptor, disabling the records if
+ *	that fails. SIGPIPE is ignored during the writing, so that a reader
+ *	which went away stops only the records and not the wiping.
+ * \param record The record.
+ * \param len The length of the record.
+ */
+static void
+wfs_progress_write (
+#ifdef WFS_ANSIC
+	const char * const record, const int len)
+#else
+	record, len)
+	const char * const record;
+	const int len;
+#endif
+{
+	int pos = 0;
+#ifdef HAVE_UNISTD_H
+	ssize_t res;
+# if (defined HAVE_SIGNAL_H) && (defined SIGPIPE)
+#  if (defined HAVE_SIGACTION) && (!defined __STRICT_ANSI__)
+	struct sigaction ign_pipe;
+	struct sigaction old_pipe;
+	int pipe_res;
+#  else
+	typedef void (*wfs_pipe_handler_t) (int);
+	wfs_pipe_handler_t old_pipe;
+#  endif
+
+	/* the handler of SIGPIPE would stop the program */
+#  if (defined HAVE_SIGACTION) && (!defined __STRICT_ANSI__)
+	WFS_MEMSET (&ign_pipe, 0, sizeof (struct sigaction));
+	ign_pipe.sa_handler = SIG_IGN;
+	pipe_res = sigaction (SIGPIPE, &ign_pipe, &old_pipe);
+#  else
+	old_pipe = signal (SIGPIPE, SIG_IGN);
+#  endif
+# endif
+
+	while ( pos < len )
+	{
+		WFS_SET_ERRNO (0);
+		res = write (progress.fd, &record[pos], (size_t) (len - pos));
+		if ( res <= 0 )
+		{
+# ifdef EINTR
+			if ( (res < 0) && (errno == EINTR) )
+			{
+				continue;
+			}
+# endif
+			/* nobody reads the records anymore */
+			progress.fd = -1;
+			break;
+		}
+		pos += (int) res;
+	}
+# if (defined HAVE_SIGNAL_H) && (defined SIGPIPE)
+#  if (defined HAVE_SIGACTION) && (!defined __STRICT_ANSI__)
+	if ( pipe_res == 0 )
+	{
+		sigaction (SIGPIPE, &old_pipe, NULL);
+	}
+#  else
+	if ( old_pipe != SIG_ERR )
+	{
+		signal (SIGPIPE, old_pipe);
+	}
+#  endif
+# endif
+#endif
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_progress_emit WFS_PARAMS ((const double now));
+#endif
+
+/**
+ * Updates the speeds and writes a progress record.
+ * \param now The current time.
+ */
+static void
+wfs_progress_emit (
+#ifdef WFS_ANSIC
+	const double now)
+#else
+	now)
+	const double now;
+#endif
+{
+	char record[WFS_PROGRESS_RECORD];
+	char device[WFS_PROGRESS_DEVICE];
+	double interval;
+	double weight;
+	double eta = -1.0;
+	unsigned int percent;
+	int len;
+
+	interval = now - progress.last;
+	if ( interval > 0.0 )
+	{
+		progress.rate = (double) (progress.written - progress.last_written)
+			/ interval;
+		if ( progress.avg_rate < 0.0 )
+		{
+			progress.avg_rate = progress.rate;
+		}
+		else
+		{
+			weight = interval / WFS_PROGRESS_AVERAGE;
+			if ( weight > 1.0 )
+			{
+				weight = 1.0;
+			}
+			progress.avg_rate += (progress.rate - progress.avg_rate) * weight;
+		}
+	}
+	progress.last = now;
+	progress.last_written = progress.written;
+
+	percent = progress.percent;
+	if ( progress.total != 0 )
+	{
+		percent = (unsigned int) ((progress.written * 100) / progress.total);
+	}
+	if ( (progress.finished != 0) || (percent > 100) )
+	{
+		percent = 100;
+	}
+	if ( percent == 100 )
+	{
+		eta = 0.0;
+	}
+	else if ( (progress.total != 0) && (progress.avg_rate > 0.0) )
+	{
+		eta = (double) (progress.total - progress.written)
+			/ progress.avg_rate;
+	}
+	else if ( (percent > 0) && (now > progress.start) )
+	{
+		/* no byte counts - assume a constant speed */
+		eta = (now - progress.start) * (100 - percent) / percent;
+	}
+
+	if ( progress.format == WFS_PROGRESS_FORMAT_JSON )
+	{
+		wfs_progress_escape (progress.device, device, sizeof (device));
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+		len = snprintf (record, sizeof (record),
+#else
+		len = sprintf (record,
+#endif
+			"{\"device\":\"%s\",\"phase\":\"%s\",\"pass\":%lu,"
+			"\"passes\":%lu,\"bytes_written\":" WFS_BLKNO_FORMAT ","
+			"\"bytes_scanned\":" WFS_BLKNO_FORMAT ",\"bytes_total\":"
+			WFS_BLKNO_FORMAT ",\"percent\":%u,\"mb_per_s\":%.2f,"
+			"\"avg_mb_per_s\":%.2f,\"eta_s\":%.0f}\n",
+			device, wfs_progress_type_names[progress.type],
+			progress.pass + 1, progress.passes, progress.written,
+			progress.scanned, progress.total, percent,
+			progress.rate / (1024.0 * 1024.0),
+			((progress.avg_rate > 0.0)? progress.avg_rate : 0.0)
+				/ (1024.0 * 1024.0), eta);
+	}
+	else
+	{
+		/* the name of the device goes last, it may have spaces */
+		wfs_progress_escape (progress.device, device, sizeof (device));
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+		len = snprintf (record, sizeof (record),
+#else
+		len = sprintf (record,
+#endif
+			"phase=%s pass=%lu/%lu written=" WFS_BLKNO_FORMAT
+			" scanned=" WFS_BLKNO_FORMAT " total=" WFS_BLKNO_FORMAT
+			" percent=%u mb_per_s=%.2f avg_mb_per_s=%.2f eta_s=%.0f"
+			" device=%s\n",
+			wfs_progress_type_names[progress.type],
+			progress.pass + 1, progress.passes, progress.written,
+			progress.scanned, progress.total, percent,
+			progress.rate / (1024.0 * 1024.0),
+			((progress.avg_rate > 0.0)? progress.avg_rate : 0.0)
+				/ (1024.0 * 1024.0), eta, device);
+	}
+	if ( (len <= 0) || (len >= (int) sizeof (record)) )
+	{
+		return;
+	}
+	wfs_progress_write (record, len);
+}
+
+/* ======================================================================== */
+
+/**
+ * Starts writing the progress records to the given descriptor.
+ * \param fd The descriptor, -1 to disable the records.
+ * \param format The format of the records.
+ */
+void
+wfs_progress_init (
+#ifdef WFS_ANSIC
+	const int fd, const wfs_progress_format_t format)
+#else
+	fd, format)
+	const int fd;
+	const wfs_progress_format_t format;
+#endif
+{
+	progress.fd = fd;
+	progress.format = format;
+	progress.type = -1;
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells if the progress records are written.
+ * \return non-zero if a descriptor for the records was given.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_progress_is_enabled (WFS_VOID)
+{
+	return (progress.fd >= 0)? 1 : 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Sets the filesystem the next records are about.
+ * \param wfs_fs The filesystem.
+ */
+void
+wfs_progress_set_fs (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs)
+#else
+	wfs_fs)
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	progress.device = (wfs_fs.fsname != NULL)? wfs_fs.fsname : "";
+	progress.type = -1;
+}
+
+/* ======================================================================== */
+
+/**
+ * Starts a new stage of wiping, with the counters set to zero.
+ * \param type The stage.
+ * \param passes The number of passes, 0 if not known.
+ */
+void
+wfs_progress_phase (
+#ifdef WFS_ANSIC
+	const wfs_progress_type_t type, const unsigned long int passes)
+#else
+	type, passes)
+	const wfs_progress_type_t type;
+	const unsigned long int passes;
+#endif
+{
+	progress.type = (int) type;
+	progress.passes = passes;
+	progress.pass = 0;
+	progress.written = 0;
+	progress.scanned = 0;
+	progress.total = 0;
+	progress.percent = 0;
+	progress.finished = 0;
+	progress.start = wfs_get_time ();
+	progress.last = progress.start;
+	progress.last_written = 0;
+	progress.rate = 0.0;
+	progress.avg_rate = -1.0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Sets the number of bytes to be written in the current stage.
+ * \param bytes The number of bytes, 0 if not known.
+ */
+void
+wfs_progress_set_total (
+#ifdef WFS_ANSIC
+	const wfs_blkno_t bytes)
+#else
+	bytes)
+	const wfs_blkno_t bytes;
+#endif
+{
+	progress.total = bytes;
+}
+
+/* ======================================================================== */
+
+/**
+ * Sets the pass being performed.
+ * \param pass The pass, from 0.
+ */
+void
+wfs_progress_set_pass (
+#ifdef WFS_ANSIC
+	const unsigned long int pass)
+#else
+	pass)
+	const unsigned long int pass;
+#endif
+{
+	progress.pass = pass;
+}
+
+/* ======================================================================== */
+
+/**
+ * Counts the bytes written and read in the current stage and writes a
+ *	progress record, if it's time for one.
+ * \param written The number of bytes just written.
+ * \param scanned The number of bytes just read.
+ */
+void
+wfs_progress_add (
+#ifdef WFS_ANSIC
+	const wfs_blkno_t written, const wfs_blkno_t scanned)
+#else
+	written, scanned)
+	const wfs_blkno_t written;
+	const wfs_blkno_t scanned;
+#endif
+{
+	double now;
+
+	progress.written += written;
+	progress.scanned += scanned;
+	if ( (progress.fd < 0) || (progress.type < 0) )
+	{
+		return;
+	}
+	now = wfs_get_time ();
+	if ( now - progress.last >= WFS_PROGRESS_INTERVAL )
+	{
+		wfs_progress_emit (now);
+	}
+}
+
+/* ======================================================================== */
+
+/**
+ * Sets the percentage of the stage done, as computed by the backend, and
+ *	writes a progress record, if it's time for one or if the stage has
+ *	just ended.
+ * \param type The stage.
+ * \param percent The percentage.
+ */
+void
+wfs_progress_percent (
+#ifdef WFS_ANSIC
+	const wfs_progress_type_t type, const unsigned int percent)
+#else
+	type, percent)
+	const wfs_progress_type_t type;
+	const unsigned int percent;
+#endif
+{
+	double now;
+
+	if ( progress.fd < 0 )
+	{
+		return;
+	}
+	if ( progress.type != (int) type )
+	{
+		wfs_progress_phase (type, 0);
+	}
+	if ( progress.finished != 0 )
+	{
+		return;
+	}
+	progress.percent = percent;
+	now = wfs_get_time ();
+	if ( percent >= 100 )
+	{
+		progress.finished = 1;
+		wfs_progress_emit (now);
+	}
+	else if ( now - progress.last >= WFS_PROGRESS_INTERVAL )
+	{
+		wfs_progress_emit (now);
+	}
+}
+
+/* ======================================================================== */
+
+/**
+ * Writes a record other than the progress of a stage, like the statistics
+ *	of a stage. The name of the device is added to the given fields.
+ * \param json The fields of the record in the JSON format, without braces.
+ * \param text The fields of the record in the text format.
+ */
+void
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_progress_record (
+#ifdef WFS_ANSIC
+	const char * const json, const char * const text)
+#else
+	json, text)
+	const char * const json;
+	const char * const text;
+#endif
+{
+	char record[WFS_PROGRESS_RECORD + WFS_PROGRESS_EXTRA];
+	char device[WFS_PROGRESS_DEVICE];
+	int len;
+
+	if ( progress.fd < 0 )
+	{
+		return;
+	}
+	wfs_progress_escape (progress.device, device, sizeof (device));
+	if ( progress.format == WFS_PROGRESS_FORMAT_JSON )
+	{
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+		len = snprintf (record, sizeof (record),
+#else
+		len = sprintf (record,
+#endif
+			"{\"device\":\"%s\",%s}\n", device, json);
+	}
+	else
+	{
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+		len = snprintf (record, sizeof (record),
+#else
+		len = sprintf (record,
+#endif
+			"%s device=%s\n", text, device);
+	}
+	if ( (len <= 0) || (len >= (int) sizeof (record)) )
+	{
+		return;
+	}
+	wfs_progress_write (record, len);
+}
@@ -0,0 +1,83 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- machine-readable progress records, header file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WFS_PROGRESS_H
+# define WFS_PROGRESS_H 1
+
+# include "wipefreespace.h"
+# include "wfs_extents.h"
+
+# ifdef WFS_PROGRESS_INTERVAL
+#  undef WFS_PROGRESS_INTERVAL
+# endif
+
+/* the number of seconds between the progress records */
+# define	WFS_PROGRESS_INTERVAL 1.0
+
+# ifdef WFS_PROGRESS_AVERAGE
+#  undef WFS_PROGRESS_AVERAGE
+# endif
+
+/* the number of seconds the average speed is mostly made of */
+# define	WFS_PROGRESS_AVERAGE 10.0
+
+/* The formats of the progress records */
+enum wfs_progress_format
+{
+	WFS_PROGRESS_FORMAT_TEXT,
+	WFS_PROGRESS_FORMAT_JSON
+};
+
+typedef enum wfs_progress_format wfs_progress_format_t;
+
+extern void
+	wfs_progress_init WFS_PARAMS ((const int fd,
+		const wfs_progress_format_t format));
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_progress_is_enabled WFS_PARAMS ((void));
+
+extern void
+	wfs_progress_set_fs WFS_PARAMS ((const wfs_fsid_t wfs_fs));
+
+extern void
+	wfs_progress_phase WFS_PARAMS ((const wfs_progress_type_t type,
+		const unsigned long int passes));
+
+extern void
+	wfs_progress_set_total WFS_PARAMS ((const wfs_blkno_t bytes));
+
+extern void
+	wfs_progress_set_pass WFS_PARAMS ((const unsigned long int pass));
+
+extern void
+	wfs_progress_add WFS_PARAMS ((const wfs_blkno_t written,
+		const wfs_blkno_t scanned));
+
+extern void
+	wfs_progress_percent WFS_PARAMS ((const wfs_progress_type_t type,
+		const unsigned int percent));
+
+extern void WFS_ATTR ((nonnull))
+	wfs_progress_record WFS_PARAMS ((const char * const json,
+		const char * const text));
+
+#endif	/* WFS_PROGRESS_H */
@@ -21,8 +21,19 @@
 
 #include "wfs_cfg.h"
 
+#define _LARGEFILE64_SOURCE 1
+
 #include <stdio.h>
 
+#if (!defined __USE_FILE_OFFSET64) && (!defined __USE_LARGEFILE64)
+# ifndef lseek64
+#  define lseek64	lseek
+# endif
+# ifndef off64_t
+#  define off64_t	off_t
+# endif
+#endif
+
 #ifdef HAVE_SYS_TYPES_H
 # include <sys/types.h>
 #endif
@@ -117,7 +128,7 @@ Something wrong. ReiserFS requested, but headers or library missing.
 #endif
 
 #ifdef HAVE_FCNTL_H
-# include <fcntl.h>	/* O_EXCL, O_RDWR */
+# include <fcntl.h>	/* O_EXCL, O_RDWR, O_RDONLY */
 #endif
 
 #ifndef O_EXCL
@@ -126,6 +137,9 @@ Something wrong. ReiserFS requested, but headers or library missing.
 #ifndef O_RDWR
 # define O_RDWR		02
 #endif
+#ifndef O_RDONLY
+# define O_RDONLY	0
+#endif
 
 #include "wipefreespace.h"
 #include "wfs_reiser.h"
@@ -133,6 +147,7 @@ Something wrong. ReiserFS requested, but headers or library missing.
 #include "wfs_util.h"
 #include "wfs_wiping.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 #ifdef HAVE_REISER3_NEW_BREAD
 # define bread reiser3_new_bread
@@ -211,7 +226,6 @@ wfs_reiser_wipe_part (
 	int i;
 	unsigned char * buf;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	char * offset;
 	unsigned long int length;
 	unsigned int prev_percent = 0;
@@ -356,7 +370,7 @@ wfs_reiser_wipe_part (
 				/*&& (ret_part == WFS_SUCCESS)*/; j++ )
 			{
 				wfs_fill_buffer ( j, (unsigned char *) offset,
-					(size_t) length, selected, wfs_fs );
+					(size_t) length, wfs_fs );
 
 				if ( sig_recvd != 0 )
 				{
@@ -482,6 +496,507 @@ wfs_reiser_wipe_part (
 /* ======================================================================== */
 
 #ifdef WFS_WANT_WFS
+
+/* the number of bitmap bits checked at once */
+# define WFS_REISER_WORD_BITS (sizeof (unsigned long int) * 8)
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_reiser_get_excluded WFS_PARAMS ((
+	reiserfs_filsys_t * const rfs, const size_t fs_block_size,
+	wfs_extent_map_t * const excluded));
+# endif
+
+/**
+ * Finds the blocks of a ReiserFS filesystem which must never be wiped,
+ *	even if marked as free: the skipped area at the beginning, the
+ *	superblock, the bitmaps and the journal.
+ * \param rfs The filesystem.
+ * \param fs_block_size The size of a filesystem block.
+ * \param excluded The map to put the excluded block ranges in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_reiser_get_excluded (
+# ifdef WFS_ANSIC
+	reiserfs_filsys_t * const rfs, const size_t fs_block_size,
+	wfs_extent_map_t * const excluded)
+# else
+	rfs, fs_block_size, excluded)
+	reiserfs_filsys_t * const rfs;
+	const size_t fs_block_size;
+	wfs_extent_map_t * const excluded;
+# endif
+{
+	wfs_errcode_t ret_excl;
+	size_t nbitmaps;
+	size_t i;
+	unsigned long int blk_no;
+	unsigned long int block_count;
+	unsigned long int bits_per_block;
+
+	if ( (rfs == NULL) || (excluded == NULL) || (fs_block_size == 0) )
+	{
+		return WFS_BADPARAM;
+	}
+	if ( (rfs->fs_ondisk_sb == NULL) || (rfs->fs_super_bh == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	block_count = get_sb_block_count (rfs->fs_ondisk_sb);
+	bits_per_block = (unsigned long int)(fs_block_size * 8);
+	nbitmaps = (size_t)((block_count + bits_per_block - 1) / bits_per_block);
+
+	/* the skipped area and the superblock */
+	ret_excl = wfs_extmap_append (excluded, 0,
+		rfs->fs_super_bh->b_blocknr + 1);
+	if ( ret_excl != WFS_SUCCESS )
+	{
+		return ret_excl;
+	}
+
+	/* the journal, if it's on this device */
+	blk_no = get_jp_journal_1st_block (sb_jp (rfs->fs_ondisk_sb));
+	if ( block_of_journal (rfs, blk_no) != 0 )
+	{
+		/* the journal's blocks and its header */
+		ret_excl = wfs_extmap_append (excluded, blk_no,
+			get_jp_journal_size (&(rfs->fs_ondisk_sb->s_v1.sb_journal)) + 1);
+		if ( ret_excl != WFS_SUCCESS )
+		{
+			return ret_excl;
+		}
+	}
+
+	/* the bitmaps - the same walk as the library does when reading them */
+	blk_no = rfs->fs_super_bh->b_blocknr + 1;
+	for ( i = 0; (i < nbitmaps) && (blk_no < block_count); i++ )
+	{
+		if ( block_of_bitmap (rfs, blk_no) != 0 )
+		{
+			ret_excl = wfs_extmap_append (excluded, blk_no, 1);
+			if ( ret_excl != WFS_SUCCESS )
+			{
+				return ret_excl;
+			}
+		}
+		if ( rfs->fs_super_bh->b_blocknr != 2 )
+		{
+			/* new format - bitmaps spread over the filesystem */
+			blk_no = (blk_no / bits_per_block + 1) * bits_per_block;
+		}
+		else
+		{
+			/* old format - bitmaps right after the superblock */
+			blk_no++;
+		}
+	}
+
+	/* the journal may be anywhere, so put the ranges in order */
+	wfs_extmap_sort (excluded);
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_reiser_add_free_run WFS_PARAMS ((
+	wfs_extent_map_t * const map, const wfs_extent_map_t * const excluded,
+	size_t * const next_excluded, wfs_blkno_t start, const wfs_blkno_t end));
+# endif
+
+/**
+ * Adds a run of free blocks to the free-extent map, leaving out the
+ *	excluded blocks.
+ * \param map The map to add the blocks to.
+ * \param excluded The blocks which should not be added.
+ * \param next_excluded The index of the first excluded range which may
+ *	still overlap the free runs (updated).
+ * \param start The first free block.
+ * \param end The block after the last free block.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_reiser_add_free_run (
+# ifdef WFS_ANSIC
+	wfs_extent_map_t * const map, const wfs_extent_map_t * const excluded,
+	size_t * const next_excluded, wfs_blkno_t start, const wfs_blkno_t end)
+# else
+	map, excluded, next_excluded, start, end)
+	wfs_extent_map_t * const map;
+	const wfs_extent_map_t * const excluded;
+	size_t * const next_excluded;
+	wfs_blkno_t start;
+	const wfs_blkno_t end;
+# endif
+{
+	wfs_errcode_t ret_run;
+	const wfs_extent_t * ex;
+
+	if ( (map == NULL) || (excluded == NULL) || (next_excluded == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	while ( start < end )
+	{
+		while ( (*next_excluded < excluded->count)
+			&& (excluded->extents[*next_excluded].start
+				+ excluded->extents[*next_excluded].length <= start) )
+		{
+			(*next_excluded)++;
+		}
+		if ( (*next_excluded >= excluded->count)
+			|| (excluded->extents[*next_excluded].start >= end) )
+		{
+			return wfs_extmap_add (map, start, end - start);
+		}
+		ex = &(excluded->extents[*next_excluded]);
+		if ( ex->start > start )
+		{
+			ret_run = wfs_extmap_add (map, start, ex->start - start);
+			if ( ret_run != WFS_SUCCESS )
+			{
+				return ret_run;
+			}
+		}
+		start = ex->start + ex->length;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_reiser_get_free_extents WFS_PARAMS ((
+	reiserfs_filsys_t * const rfs, const size_t fs_block_size,
+	wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Finds all the free blocks on a ReiserFS filesystem. The block bitmap is
+ *	checked a word at a time, so that fully used and fully free parts
+ *	are skipped quickly.
+ * \param rfs The filesystem.
+ * \param fs_block_size The size of a filesystem block.
+ * \param map The map to put the free blocks in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_reiser_get_free_extents (
+# ifdef WFS_ANSIC
+	reiserfs_filsys_t * const rfs, const size_t fs_block_size,
+	wfs_extent_map_t * const map)
+# else
+	rfs, fs_block_size, map)
+	reiserfs_filsys_t * const rfs;
+	const size_t fs_block_size;
+	wfs_extent_map_t * const map;
+# endif
+{
+	wfs_errcode_t ret_free = WFS_SUCCESS;
+	wfs_extent_map_t excluded;
+	size_t next_excluded = 0;
+	unsigned long int word;
+	wfs_blkno_t nbits;
+	wfs_blkno_t blk_no = 0;
+	wfs_blkno_t run_start = 0;
+	int in_run = 0;
+	reiserfs_bitmap_t * bm;
+
+	if ( (rfs == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	bm = rfs->fs_bitmap2;
+	if ( (bm == NULL) || (bm->bm_map == NULL) )
+	{
+		return WFS_BLBITMAPREAD;
+	}
+
+	wfs_extmap_init (&excluded);
+	ret_free = wfs_reiser_get_excluded (rfs, fs_block_size, &excluded);
+	if ( ret_free != WFS_SUCCESS )
+	{
+		wfs_extmap_free (&excluded);
+		return ret_free;
+	}
+
+	nbits = bm->bm_bit_size;
+	if ( nbits > get_sb_block_count (rfs->fs_ondisk_sb) )
+	{
+		nbits = get_sb_block_count (rfs->fs_ondisk_sb);
+	}
+	while ( (blk_no < nbits) && (sig_recvd == 0) )
+	{
+		if ( ((blk_no % WFS_REISER_WORD_BITS) == 0)
+			&& (blk_no + WFS_REISER_WORD_BITS <= nbits) )
+		{
+			WFS_MEMCOPY (&word, &(bm->bm_map[blk_no / 8]), sizeof (word));
+			if ( word == ~0UL )
+			{
+				/* all used */
+				if ( in_run != 0 )
+				{
+					ret_free = wfs_reiser_add_free_run (map,
+						&excluded, &next_excluded, run_start, blk_no);
+					if ( ret_free != WFS_SUCCESS )
+					{
+						break;
+					}
+					in_run = 0;
+				}
+				blk_no += WFS_REISER_WORD_BITS;
+				continue;
+			}
+			if ( word == 0 )
+			{
+				/* all free */
+				if ( in_run == 0 )
+				{
+					run_start = blk_no;
+					in_run = 1;
+				}
+				blk_no += WFS_REISER_WORD_BITS;
+				continue;
+			}
+		}
+		if ( (bm->bm_map[blk_no / 8] & (1 << (blk_no % 8))) == 0 )
+		{
+			if ( in_run == 0 )
+			{
+				run_start = blk_no;
+				in_run = 1;
+			}
+		}
+		else if ( in_run != 0 )
+		{
+			ret_free = wfs_reiser_add_free_run (map,
+				&excluded, &next_excluded, run_start, blk_no);
+			if ( ret_free != WFS_SUCCESS )
+			{
+				break;
+			}
+			in_run = 0;
+		}
+		blk_no++;
+	}
+	if ( (in_run != 0) && (ret_free == WFS_SUCCESS) && (sig_recvd == 0) )
+	{
+		ret_free = wfs_reiser_add_free_run (map,
+			&excluded, &next_excluded, run_start, nbits);
+	}
+	wfs_extmap_free (&excluded);
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+/* The device of a ReiserFS filesystem, for reading and writing free blocks */
+struct wfs_reiser_io
+{
+	reiserfs_filsys_t * rfs;
+	size_t fs_block_size;
+};
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_reiser_read_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive blocks of a ReiserFS filesystem.
+ * \param data Pointer to a 'struct wfs_reiser_io'.
+ * \param buf The buffer for the data.
+ * \param start The first block to read.
+ * \param count The number of blocks to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_reiser_read_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	off64_t file_offset;
+	struct wfs_reiser_io * io;
+
+	io = (struct wfs_reiser_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	file_offset = (off64_t) (start * io->fs_block_size);
+	WFS_SET_ERRNO (0);
+	if ( (lseek64 (io->rfs->fs_dev, file_offset, SEEK_SET) != file_offset)
+		|| (read (io->rfs->fs_dev, buf, (size_t)(count * io->fs_block_size))
+			!= (ssize_t)(count * io->fs_block_size)) )
+	{
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		return WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_reiser_write_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes the given buffer to consecutive blocks of a ReiserFS filesystem.
+ *	If writing all the blocks at once fails, the blocks are written
+ *	one by one and errors on known bad blocks are ignored.
+ * \param data Pointer to a 'struct wfs_reiser_io'.
+ * \param buf The buffer with the data to write.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_reiser_write_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	off64_t file_offset;
+	wfs_blkno_t i;
+	struct wfs_reiser_io * io;
+	reiserfs_filsys_t * rfs;
+	size_t fs_block_size;
+
+	io = (struct wfs_reiser_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	rfs = io->rfs;
+	fs_block_size = io->fs_block_size;
+	file_offset = (off64_t) (start * fs_block_size);
+	WFS_SET_ERRNO (0);
+	if ( lseek64 (rfs->fs_dev, file_offset, SEEK_SET) == file_offset )
+	{
+		if ( write (rfs->fs_dev, buf, (size_t)(count * fs_block_size))
+			== (ssize_t)(count * fs_block_size) )
+		{
+			return WFS_SUCCESS;
+		}
+	}
+	for ( i = 0; (i < count) && (sig_recvd == 0); i++ )
+	{
+		file_offset = (off64_t) ((start + i) * fs_block_size);
+		WFS_SET_ERRNO (0);
+		if ( (lseek64 (rfs->fs_dev, file_offset, SEEK_SET) == file_offset)
+			&& (write (rfs->fs_dev, &buf[i * fs_block_size], fs_block_size)
+				== (ssize_t) fs_block_size) )
+		{
+			continue;
+		}
+		*error = WFS_GET_ERRNO_OR_DEFAULT (EIO);
+		/* check if block is marked as bad. If there is no 'badblocks' list
+		or the block is marked OK, then print the error. */
+		if (rfs->fs_badblocks_bm == NULL)
+		{
+			return WFS_BLKWR;
+		}
+		else if (reiserfs_bitmap_test_bit (
+			rfs->fs_badblocks_bm,
+			(unsigned int)((start + i) & 0x0FFFFFFFF)) == 0)
+		{
+			return WFS_BLKWR;
+		}
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_reiser_sync_blocks WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written to a ReiserFS filesystem reach the media.
+ * \param data Pointer to a 'struct wfs_reiser_io'.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_reiser_sync_blocks (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_reiser_io * io;
+	int res;
+
+	io = (struct wfs_reiser_io *) data;
+	if ( (io == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	res = wfs_sync_fd (io->rfs->fs_dev);
+	if ( res != 0 )
+	{
+		*error = (wfs_errcode_t) res;
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
 /**
  * Wipes the free space on the given ReiserFS filesystem.
  * \param wfs_fs The filesystem.
@@ -498,17 +1013,15 @@ wfs_reiser_wipe_fs (
 # endif
 {
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
-	unsigned long int blk_no;
-	struct buffer_head * bh;
-	int selected[WFS_NPAT] = {0};
-	unsigned char *buf;
-	unsigned long int j;
 	unsigned int prev_percent = 0;
-	unsigned long int curr_sector = 0;
 	wfs_errcode_t error = 0;
 	reiserfs_filsys_t * rfs;
 	wfs_errcode_t * error_ret;
 	size_t fs_block_size;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_direct_io_t direct;
+	struct wfs_reiser_io io;
 
 	rfs = (reiserfs_filsys_t *) wfs_fs.fs_backend;
 	error_ret = (wfs_errcode_t *) wfs_fs.fs_error;
@@ -548,293 +1061,40 @@ wfs_reiser_wipe_fs (
 	{
 		return WFS_BADPARAM;
 	}
-	WFS_SET_ERRNO (0);
-	buf = (unsigned char *) malloc ( fs_block_size );
-	if ( buf == NULL )
-	{
-		error = WFS_GET_ERRNO_OR_DEFAULT (ENOMEM);
-		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-		if ( error_ret != NULL )
-		{
-			*error_ret = error;
-		}
-		return WFS_MALLOC;
-	}
 
-	if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
+	/* get the library's buffers onto the disk before writing directly */
+	reiserfs_flush (rfs);
+	/* find the free blocks once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_reiser_get_free_extents (rfs, fs_block_size, &map);
+	if ( ret_wfs == WFS_SUCCESS )
 	{
-		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0)
-			/*&& (ret_wfs == WFS_SUCCESS)*/; j++ )
-		{
-			curr_sector = 0;
-			/*blk_no < wfs_fs.rfs.fs_ondisk_sb->s_v1.sb_block_count*/
-			for ( blk_no = 0; (blk_no < get_sb_block_count (rfs->fs_ondisk_sb))
-				&& (sig_recvd == 0) /*&& (ret_wfs == WFS_SUCCESS)*/; blk_no++ )
-			{
-				if (       (not_data_block   ( rfs, blk_no ) != 0)
-					|| (block_of_bitmap  ( rfs, blk_no ) != 0)
-					|| (block_of_journal ( rfs, blk_no ) != 0)
-					|| (reiserfs_bitmap_test_bit (rfs->fs_bitmap2, (unsigned int)(blk_no & 0x0FFFFFFFF)) != 0)
-				)
-				{
-					curr_sector++;
-					wfs_show_progress (WFS_PROGRESS_WFS, (unsigned int)(((get_sb_block_count (rfs->fs_ondisk_sb) * j + curr_sector) * 100)
-						/ (get_sb_block_count (rfs->fs_ondisk_sb) * wfs_fs.npasses)), &prev_percent);
-					continue;
-				}
-				/* read the block just to fill the structure */
-				bh = bread (rfs->fs_dev, blk_no, fs_block_size);
-				if ( bh == NULL )
-				{
-					curr_sector++;
-					wfs_show_progress (WFS_PROGRESS_WFS, (unsigned int)(((get_sb_block_count (rfs->fs_ondisk_sb) * j + curr_sector) * 100)
-						/ (get_sb_block_count (rfs->fs_ondisk_sb) * wfs_fs.npasses)), &prev_percent);
-					continue;
-				}
-
-				/* write the block here. */
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					if ( wfs_is_block_zero ((unsigned char *)bh->b_data, fs_block_size) != 0 )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						break;
-					}
-				}
-
-				wfs_fill_buffer ( j, (unsigned char *) bh->b_data,
-					fs_block_size, selected, wfs_fs );
-				if ( sig_recvd != 0 )
-				{
-					ret_wfs = WFS_SIGNAL;
-					break;
-				}
-				mark_buffer_dirty2 (bh);
-				mark_buffer_uptodate2 (bh);
-				error = bwrite (bh);
-				if ( error != 0 )
-				{
-					/* check if block is marked as bad. If there is no 'badblocks' list
-					or the block is marked OK, then print the error. */
-					if (rfs->fs_badblocks_bm == NULL)
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-					else if (reiserfs_bitmap_test_bit (
-						rfs->fs_badblocks_bm,
-						(unsigned int)(blk_no & 0x0FFFFFFFF)) == 0)
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_reiser_flush_fs (wfs_fs);
-				}
-				curr_sector++;
-				wfs_show_progress (WFS_PROGRESS_WFS, (unsigned int)(((get_sb_block_count (rfs->fs_ondisk_sb) * j + curr_sector) * 100)
-					/ (get_sb_block_count (rfs->fs_ondisk_sb) * wfs_fs.npasses)), &prev_percent);
-				if (bh->b_count != 0)
-				{
-					brelse (bh);
-				}
-			}	/* for block */
-		}
-		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-		{
-			if ( j != wfs_fs.npasses * 2 )
-			{
-				/* last pass with zeros: */
-				if ( sig_recvd == 0 )
-				{
-					wfs_reiser_flush_fs (wfs_fs);
-					/*blk_no < wfs_fs.rfs.fs_ondisk_sb->s_v1.sb_block_count*/
-					for ( blk_no = 0; (blk_no < get_sb_block_count (rfs->fs_ondisk_sb))
-						&& (sig_recvd == 0) /*&& (ret_wfs == WFS_SUCCESS)*/; blk_no++ )
-					{
-						if (       (not_data_block   ( rfs, blk_no ) != 0)
-							|| (block_of_bitmap  ( rfs, blk_no ) != 0)
-							|| (block_of_journal ( rfs, blk_no ) != 0)
-							|| (reiserfs_bitmap_test_bit (rfs->fs_bitmap2, (unsigned int)(blk_no & 0x0FFFFFFFF)) != 0)
-						)
-						{
-							continue;
-						}
-						/* read the block just to fill the structure */
-						bh = bread (rfs->fs_dev, blk_no, fs_block_size);
-						if ( bh == NULL )
-						{
-							continue;
-						}
-						WFS_MEMSET ( (unsigned char *) bh->b_data, 0,
-							fs_block_size );
-
-						mark_buffer_dirty2 (bh);
-						mark_buffer_uptodate2 (bh);
-						error = bwrite (bh);
-						if ( error != 0 )
-						{
-							/* check if block is marked as bad. If there is no 'badblocks'
-							list or the block is marked OK, then print the error. */
-							if (rfs->fs_badblocks_bm == NULL)
-							{
-								ret_wfs = WFS_BLKWR;
-								break;
-							}
-							else if (reiserfs_bitmap_test_bit (
-								rfs->fs_badblocks_bm,
-								(unsigned int)(blk_no & 0x0FFFFFFFF)) == 0)
-							{
-								ret_wfs = WFS_BLKWR;
-								break;
-							}
-						}
-						/* No need to flush the last writing of a given block. *
-						if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-						{
-							error = wfs_reiser_flush_fs (wfs_fs);
-						}*/
-						if (bh->b_count != 0)
-						{
-							brelse (bh);
-						}
-					}
-					wfs_reiser_flush_fs (wfs_fs);
-				}
-			}
-		}
+		io.rfs = rfs;
+		io.fs_block_size = fs_block_size;
+		ops.read_blocks = &wfs_reiser_read_blocks;
+		ops.write_blocks = &wfs_reiser_write_blocks;
+		ops.write_pattern = NULL;
+		ops.sync_blocks = &wfs_reiser_sync_blocks;
+		ops.flush_fs = &wfs_reiser_flush_fs;
+		ops.data = &io;
+		wfs_extmap_direct_open (wfs_fs, fs_block_size, &direct, &ops);
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map, fs_block_size,
+			&ops, &error);
+		wfs_extmap_direct_close (&direct);
 	}
 	else
 	{
-		/*blk_no < wfs_fs.rfs.fs_ondisk_sb->s_v1.sb_block_count*/
-		for ( blk_no = 0; (blk_no < get_sb_block_count (rfs->fs_ondisk_sb))
-			&& (sig_recvd == 0) /*&& (ret_wfs == WFS_SUCCESS)*/; blk_no++ )
-		{
-			if (       (not_data_block   ( rfs, blk_no ) != 0)
-				|| (block_of_bitmap  ( rfs, blk_no ) != 0)
-				|| (block_of_journal ( rfs, blk_no ) != 0)
-				|| (reiserfs_bitmap_test_bit (rfs->fs_bitmap2, (unsigned int)(blk_no & 0x0FFFFFFFF)) != 0)
-			)
-			{
-				curr_sector++;
-				wfs_show_progress (WFS_PROGRESS_WFS, (unsigned int)((curr_sector * 100)
-					/ get_sb_block_count (rfs->fs_ondisk_sb)), &prev_percent);
-				continue;
-			}
-			/* read the block just to fill the structure */
-			bh = bread (rfs->fs_dev, blk_no, fs_block_size);
-			if ( bh == NULL )
-			{
-				curr_sector++;
-				wfs_show_progress (WFS_PROGRESS_WFS, (unsigned int)((curr_sector * 100)
-					/ get_sb_block_count (rfs->fs_ondisk_sb)), &prev_percent);
-				continue;
-			}
-
-			/* write the block here. */
-			for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0)
-				/*&& (ret_wfs == WFS_SUCCESS)*/; j++ )
-			{
-				if ( wfs_fs.no_wipe_zero_blocks != 0 )
-				{
-					if ( wfs_is_block_zero ((unsigned char *)bh->b_data, fs_block_size) != 0 )
-					{
-						/* this block is all-zeros - don't wipe, as requested */
-						j = wfs_fs.npasses * 2;
-						break;
-					}
-				}
-
-				wfs_fill_buffer ( j, (unsigned char *) bh->b_data,
-					fs_block_size, selected, wfs_fs );
-				if ( sig_recvd != 0 )
-				{
-					ret_wfs = WFS_SIGNAL;
-					break;
-				}
-				mark_buffer_dirty2 (bh);
-				mark_buffer_uptodate2 (bh);
-				error = bwrite (bh);
-				if ( error != 0 )
-				{
-					/* check if block is marked as bad. If there is no 'badblocks' list
-					or the block is marked OK, then print the error. */
-					if (rfs->fs_badblocks_bm == NULL)
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-					else if (reiserfs_bitmap_test_bit (
-						rfs->fs_badblocks_bm,
-						(unsigned int)(blk_no & 0x0FFFFFFFF)) == 0)
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-				}
-				/* Flush after each writing, if more than 1 overwriting needs to be done.
-				Allow I/O bufferring (efficiency), if just one pass is needed. */
-				if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-				{
-					error = wfs_reiser_flush_fs (wfs_fs);
-				}
-			}
-			if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-			{
-				if ( j != wfs_fs.npasses * 2 )
-				{
-					/* last pass with zeros: */
-					WFS_MEMSET ( (unsigned char *) bh->b_data, 0,
-						fs_block_size );
-					if ( sig_recvd == 0 )
-					{
-						mark_buffer_dirty2 (bh);
-						mark_buffer_uptodate2 (bh);
-						error = bwrite (bh);
-						if ( error != 0 )
-						{
-							/* check if block is marked as bad. If there is no 'badblocks'
-							list or the block is marked OK, then print the error. */
-							if (rfs->fs_badblocks_bm == NULL)
-							{
-								ret_wfs = WFS_BLKWR;
-								break;
-							}
-							else if (reiserfs_bitmap_test_bit (
-								rfs->fs_badblocks_bm,
-								(unsigned int)(blk_no & 0x0FFFFFFFF)) == 0)
-							{
-								ret_wfs = WFS_BLKWR;
-								break;
-							}
-						}
-						/* No need to flush the last writing of a given block. *
-						if ( (wfs_fs.npasses > 1) && (sig_recvd == 0) )
-						{
-							error = wfs_reiser_flush_fs (wfs_fs);
-						}*/
-					}
-				}
-			}
-			if (bh->b_count != 0)
-			{
-				brelse (bh);
-			}
-			curr_sector++;
-			wfs_show_progress (WFS_PROGRESS_WFS, (unsigned int)((curr_sector * 100)
-				/ get_sb_block_count (rfs->fs_ondisk_sb)), &prev_percent);
-		}	/* for block */
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	}
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
-	free (buf);
+	wfs_extmap_free (&map);
 	if ( error_ret != NULL )
 	{
 		*error_ret = error;
 	}
+	if ( (sig_recvd != 0) && (ret_wfs == WFS_SUCCESS) )
+	{
+		return WFS_SIGNAL;
+	}
 	return ret_wfs;
 }
 #endif /* WFS_WANT_WFS */
@@ -867,7 +1127,6 @@ wfs_reiser_wipe_unrm (
 	unsigned int count;
 	unsigned char * buf;
 	unsigned long int j;
-	int selected[WFS_NPAT] = {0};
 	struct reiserfs_de_head * deh;
 	unsigned long int blk_no;
 	unsigned int prev_percent = 0;
@@ -978,7 +1237,7 @@ wfs_reiser_wipe_unrm (
 					}
 
 					wfs_fill_buffer ( j, (unsigned char *) bh->b_data,
-						fs_block_size, selected, wfs_fs );
+						fs_block_size, wfs_fs );
 				}
 				if ( sig_recvd != 0 )
 				{
@@ -1156,7 +1415,7 @@ wfs_reiser_wipe_unrm (
 									 name_in_entry (deh, (int)count),
 									(size_t) name_in_entry_length
 										(head, deh, (int)count),
-									selected, wfs_fs );
+									wfs_fs );
 							}
 						}
 						if ( sig_recvd != 0 )
@@ -1361,7 +1620,8 @@ wfs_reiser_open_fs (
 		return WFS_MALLOC;
 	}
 
-	res = reiserfs_open (dev_name_copy, O_RDWR | O_EXCL
+	res = reiserfs_open (dev_name_copy,
+		((wfs_fs->plan_only != 0)? O_RDONLY : O_RDWR) | O_EXCL
 #ifdef O_BINARY
 		| O_BINARY
 #endif
@@ -1416,6 +1676,9 @@ wfs_reiser_open_fs (
 	wfs_fs->fs_backend = res;
 
 	wfs_fs->whichfs = WFS_CURR_FS_REISERFS;
+	/* empty in the old-format superblocks, leaving the UUID unknown */
+	wfs_set_uuid (wfs_fs, res->fs_ondisk_sb->s_uuid,
+		sizeof (res->fs_ondisk_sb->s_uuid));
 	free (dev_name_copy);
 
 	if ( error_ret != NULL )
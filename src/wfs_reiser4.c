@@ -49,7 +49,7 @@
 #endif
 
 #ifdef HAVE_FCNTL_H
-# include <fcntl.h>	/* O_EXCL, O_RDWR */
+# include <fcntl.h>	/* O_EXCL, O_RDWR, O_RDONLY */
 #endif
 
 /* this must be here, as it defines blk_t: */
@@ -89,12 +89,16 @@ Something wrong. Reiser4 requested, but headers or libraries missing.
 #ifndef O_RDWR
 # define O_RDWR		02
 #endif
+#ifndef O_RDONLY
+# define O_RDONLY	0
+#endif
 
 #include "wfs_reiser4.h"
 #include "wfs_util.h"
 #include "wfs_signal.h"
 #include "wfs_wiping.h"
 #include "wfs_mount_check.h"
+#include "wfs_extents.h"
 
 struct wfs_r4_block_data
 {
@@ -171,7 +175,6 @@ wfs_r4_wipe_last_block (
 {
 	struct wfs_r4_block_data * const bd = (struct wfs_r4_block_data *) data;
 	errno_t ret_part = WFS_SUCCESS;
-	int selected[WFS_NPAT] = {0};
 	unsigned long int j;
 	aal_block_t * block;
 	unsigned int to_wipe, to_skip;
@@ -247,7 +250,7 @@ wfs_r4_wipe_last_block (
 			}
 		}
 		wfs_fill_buffer ( j, (unsigned char *) &(((char *)(block->data))[to_skip]),
-			to_wipe, selected, bd->wfs_fs );
+			to_wipe, bd->wfs_fs );
 		if ( sig_recvd != 0 )
 		{
 			ret_part = WFS_SIGNAL;
@@ -334,7 +337,6 @@ wfs_r4_wipe_part_work (
 	wfs_errcode_t ret_temp;
 	uint64_t obj_size;
 	uint64_t to_wipe;
-	int selected[WFS_NPAT] = {0};
 	unsigned char *buf;
 	unsigned long int j;
 	uint64_t written;
@@ -479,7 +481,7 @@ wfs_r4_wipe_part_work (
 			/*&& (ret_part == WFS_SUCCESS)*/; j++ )
 		{
 			wfs_fill_buffer ( j, buf, fs_block_size,
-				selected, wfs_fs );
+				wfs_fs );
 			if ( sig_recvd != 0 )
 			{
 				ret_part = WFS_SIGNAL;
@@ -648,6 +650,329 @@ wfs_r4_wipe_part (
 /* ======================================================================== */
 
 #ifdef WFS_WANT_WFS
+
+/* the number of blocks checked at once when looking for free space */
+# define WFS_R4_SCAN_WINDOW	64
+/* the maximum number of blocks checked at once in long uniform regions */
+# define WFS_R4_SCAN_WINDOW_MAX	(WFS_R4_SCAN_WINDOW * 1024)
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_r4_add_free_region WFS_PARAMS ((
+	reiser4_alloc_t * const alloc, const blk_t start, const count_t len,
+	const int mixed, wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Adds the free blocks from the given region of a Reiser4 filesystem to the
+ *	free-extent map. Regions which are neither wholly free nor wholly
+ *	used are split in halves.
+ * \param alloc The block allocator of the filesystem.
+ * \param start The first block of the region.
+ * \param len The number of blocks in the region.
+ * \param mixed Non-zero if the region is already known to be neither
+ *	wholly free nor wholly used, so it can be split without checking.
+ * \param map The map to add the free blocks to.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_r4_add_free_region (
+# ifdef WFS_ANSIC
+	reiser4_alloc_t * const alloc, const blk_t start, const count_t len,
+	const int mixed, wfs_extent_map_t * const map)
+# else
+	alloc, start, len, mixed, map)
+	reiser4_alloc_t * const alloc;
+	const blk_t start;
+	const count_t len;
+	const int mixed;
+	wfs_extent_map_t * const map;
+# endif
+{
+	wfs_errcode_t ret_free;
+	count_t half;
+
+	if ( (alloc == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	if ( mixed == 0 )
+	{
+		if ( reiser4_alloc_available (alloc, start, len) != 0 )
+		{
+			return wfs_extmap_add (map, start, len);
+		}
+		if ( (len == 1) || (reiser4_alloc_occupied (alloc, start, len) != 0) )
+		{
+			return WFS_SUCCESS;
+		}
+	}
+	half = len / 2;
+	ret_free = wfs_r4_add_free_region (alloc, start, half, 0, map);
+	if ( ret_free != WFS_SUCCESS )
+	{
+		return ret_free;
+	}
+	return wfs_r4_add_free_region (alloc, start + half, len - half, 0, map);
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_r4_get_free_extents WFS_PARAMS ((
+	reiser4_alloc_t * const alloc, const count_t first_block,
+	const count_t number_of_blocks, wfs_extent_map_t * const map));
+# endif
+
+/**
+ * Finds all the free blocks on a Reiser4 filesystem. The allocator bitmap is
+ *	checked a region at a time, with the region growing while the
+ *	blocks stay all free or all used.
+ * \param alloc The block allocator of the filesystem.
+ * \param first_block The first block which can be free.
+ * \param number_of_blocks The number of blocks on the filesystem.
+ * \param map The map to put the free blocks in.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_r4_get_free_extents (
+# ifdef WFS_ANSIC
+	reiser4_alloc_t * const alloc, const count_t first_block,
+	const count_t number_of_blocks, wfs_extent_map_t * const map)
+# else
+	alloc, first_block, number_of_blocks, map)
+	reiser4_alloc_t * const alloc;
+	const count_t first_block;
+	const count_t number_of_blocks;
+	wfs_extent_map_t * const map;
+# endif
+{
+	wfs_errcode_t ret_free = WFS_SUCCESS;
+	blk_t blk_no;
+	count_t window = WFS_R4_SCAN_WINDOW;
+	count_t to_check;
+	int available;
+	int occupied;
+
+	if ( (alloc == NULL) || (map == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+
+	blk_no = first_block;
+	while ( (blk_no < number_of_blocks) && (sig_recvd == 0) )
+	{
+		to_check = number_of_blocks - blk_no;
+		if ( to_check > window )
+		{
+			to_check = window;
+		}
+		available = reiser4_alloc_available (alloc, blk_no, to_check);
+		occupied = 0;
+		if ( available == 0 )
+		{
+			occupied = reiser4_alloc_occupied (alloc, blk_no, to_check);
+		}
+		if ( (available != 0) || (occupied != 0) )
+		{
+			/* a uniform region - check more blocks next time */
+			if ( window < WFS_R4_SCAN_WINDOW_MAX )
+			{
+				window *= 2;
+			}
+		}
+		else
+		{
+			window = WFS_R4_SCAN_WINDOW;
+		}
+		/* the bitmap was checked already - don't check it again */
+		if ( available != 0 )
+		{
+			ret_free = wfs_extmap_add (map, blk_no, to_check);
+		}
+		else if ( occupied == 0 )
+		{
+			ret_free = wfs_r4_add_free_region (alloc, blk_no,
+				to_check, 1, map);
+		}
+		if ( ret_free != WFS_SUCCESS )
+		{
+			break;
+		}
+		blk_no += to_check;
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
+	}
+	return ret_free;
+}
+
+/* ======================================================================== */
+
+/* The device of a Reiser4 filesystem, for reading and writing free blocks */
+struct wfs_r4_io
+{
+	aal_device_t * device;
+	count_t dev_blocks;	/* the number of device blocks in a filesystem block */
+};
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_r4_read_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Reads consecutive blocks of a Reiser4 filesystem.
+ * \param data Pointer to a 'struct wfs_r4_io'.
+ * \param buf The buffer for the data.
+ * \param start The first block to read.
+ * \param count The number of blocks to read.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_r4_read_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_r4_io * io;
+	errno_t err;
+
+	io = (struct wfs_r4_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	err = aal_device_read (io->device, buf, start * io->dev_blocks,
+		count * io->dev_blocks);
+	if ( err != 0 )
+	{
+		*error = (wfs_errcode_t) err;
+		return WFS_BLKRD;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_r4_write_blocks WFS_PARAMS ((
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Writes consecutive blocks of a Reiser4 filesystem.
+ * \param data Pointer to a 'struct wfs_r4_io'.
+ * \param buf The buffer with the data.
+ * \param start The first block to write.
+ * \param count The number of blocks to write.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_r4_write_blocks (
+# ifdef WFS_ANSIC
+	void * const data, unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error)
+# else
+	data, buf, start, count, error)
+	void * const data;
+	unsigned char * const buf;
+	const wfs_blkno_t start;
+	const wfs_blkno_t count;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_r4_io * io;
+	errno_t err;
+
+	io = (struct wfs_r4_io *) data;
+	if ( (io == NULL) || (buf == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	err = aal_device_write (io->device, buf, start * io->dev_blocks,
+		count * io->dev_blocks);
+	if ( err != 0 )
+	{
+		*error = (wfs_errcode_t) err;
+		return WFS_BLKWR;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_r4_sync_blocks WFS_PARAMS ((
+	void * const data, wfs_errcode_t * const error));
+# endif
+
+/**
+ * Makes the blocks written to a Reiser4 filesystem reach the media.
+ * \param data Pointer to a 'struct wfs_r4_io'.
+ * \param error Pointer to the error variable.
+ * \return WFS_SUCCESS in case of no errors, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+# ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+# endif
+wfs_r4_sync_blocks (
+# ifdef WFS_ANSIC
+	void * const data, wfs_errcode_t * const error)
+# else
+	data, error)
+	void * const data;
+	wfs_errcode_t * const error;
+# endif
+{
+	struct wfs_r4_io * io;
+	errno_t err;
+
+	io = (struct wfs_r4_io *) data;
+	if ( (io == NULL) || (error == NULL) )
+	{
+		return WFS_BADPARAM;
+	}
+	err = aal_device_sync (io->device);
+	if ( err != 0 )
+	{
+		*error = (wfs_errcode_t) err;
+		return WFS_FLUSHFS;
+	}
+	return WFS_SUCCESS;
+}
+
+/* ======================================================================== */
+
 /**
  * Wipes the free space on the given Reiser4 filesystem.
  * \param wfs_fs The filesystem.
@@ -665,15 +990,13 @@ wfs_r4_wipe_fs (
 {
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
 	count_t number_of_blocks;
-	blk_t blk_no;
-	const count_t one = 1;
-	int selected[WFS_NPAT] = {0};
-	unsigned long int j;
-	aal_block_t * block;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_direct_io_t direct;
+	struct wfs_r4_io io;
 	int had_to_open_alloc = 0;
 	unsigned int prev_percent = 0;
-	count_t curr_sector = 0;
-	errno_t error = 0;
+	wfs_errcode_t error = 0;
 	reiser4_fs_t * r4;
 	errno_t * error_ret;
 	size_t fs_block_size;
@@ -685,7 +1008,7 @@ wfs_r4_wipe_fs (
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 		if ( error_ret != NULL )
 		{
-			*error_ret = error;
+			*error_ret = (errno_t) error;
 		}
 		return WFS_BADPARAM;
 	}
@@ -694,13 +1017,19 @@ wfs_r4_wipe_fs (
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 		if ( error_ret != NULL )
 		{
-			*error_ret = error;
+			*error_ret = (errno_t) error;
 		}
 		return WFS_BADPARAM;
 	}
 	fs_block_size = wfs_r4_get_block_size (wfs_fs);
-	if ( fs_block_size == 0 )
+	if ( (fs_block_size == 0) || (r4->device->blksize == 0)
+		|| ((fs_block_size % r4->device->blksize) != 0) )
 	{
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+		if ( error_ret != NULL )
+		{
+			*error_ret = (errno_t) error;
+		}
 		return WFS_BADPARAM;
 	}
 
@@ -712,7 +1041,7 @@ wfs_r4_wipe_fs (
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 		if ( error_ret != NULL )
 		{
-			*error_ret = error;
+			*error_ret = (errno_t) error;
 		}
 		return WFS_BLBITMAPREAD;
 	}
@@ -727,223 +1056,48 @@ wfs_r4_wipe_fs (
 		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 		if ( error_ret != NULL )
 		{
-			*error_ret = error;
+			*error_ret = (errno_t) error;
 		}
 		return WFS_BLBITMAPREAD;
 	}
-	if ( wfs_fs.wipe_mode == WFS_WIPE_MODE_PATTERN )
-	{
-		for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0)
-			/*&& (ret_wfs == WFS_SUCCESS)*/; j++ )
-		{
-			curr_sector = 0;
-			for ( blk_no = REISER4_FS_MIN_SIZE (fs_block_size);
-				(blk_no < number_of_blocks) && (sig_recvd == 0)
-				/*&& (ret_wfs == WFS_SUCCESS)*/; blk_no++ )
-			{
-				if ( reiser4_alloc_available (r4->alloc, blk_no, one) != 0 )
-				{
-					/* block is unallocated, wipe it */
-					block = aal_block_load (r4->device,
-						(uint32_t)(fs_block_size & 0x0FFFFFFFF),
-						blk_no);
-					if ( block == NULL )
-					{
-						ret_wfs = WFS_BLKITER;
-						curr_sector++;
-						wfs_show_progress (WFS_PROGRESS_WFS,
-							(unsigned int)(((number_of_blocks * j + curr_sector) * 100)/(number_of_blocks * wfs_fs.npasses)),
-							&prev_percent);
-						continue;
-					}
-					if ( wfs_fs.no_wipe_zero_blocks != 0 )
-					{
-						if ( wfs_is_block_zero (block->data, fs_block_size) != 0 )
-						{
-							/* this block is all-zeros - don't wipe, as requested */
-							j = wfs_fs.npasses * 2;
-							break;
-						}
-					}
-					wfs_fill_buffer ( j, (unsigned char *) block->data,
-						fs_block_size, selected, wfs_fs );
-					if ( sig_recvd != 0 )
-					{
-						ret_wfs = WFS_SIGNAL;
-						break;
-					}
-					error = aal_block_write (block);
-					if ( error != 0 )
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-					/* Flush after each writing, if more than 1
-					overwriting needs to be done. Allow I/O bufferring
-					(efficiency), if just one pass is needed. */
-					if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-					{
-						error = wfs_r4_flush_fs (wfs_fs);
-					}
-					aal_block_free (block);
-				}
-			}
-			curr_sector++;
-			wfs_show_progress (WFS_PROGRESS_WFS,
-				(unsigned int)(((number_of_blocks * j + curr_sector) * 100)/(number_of_blocks * wfs_fs.npasses)),
-				&prev_percent);
-		}
-		if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-		{
-			if ( j != wfs_fs.npasses * 2 )
-			{
-				wfs_r4_flush_fs (wfs_fs);
-				/* last pass with zeros: */
-				if ( sig_recvd == 0 )
-				{
-					for ( blk_no = REISER4_FS_MIN_SIZE (fs_block_size);
-						(blk_no < number_of_blocks) && (sig_recvd == 0)
-						/*&& (ret_wfs == WFS_SUCCESS)*/; blk_no++ )
-					{
-						if ( reiser4_alloc_available (r4->alloc, blk_no, one) != 0 )
-						{
-							/* block is unallocated, wipe it */
-							block = aal_block_load (r4->device,
-								(uint32_t)(fs_block_size & 0x0FFFFFFFF),
-								blk_no);
-							if ( block == NULL )
-							{
-								ret_wfs = WFS_BLKITER;
-								continue;
-							}
-							if ( sig_recvd != 0 )
-							{
-								ret_wfs = WFS_SIGNAL;
-								break;
-							}
-							WFS_MEMSET ( (unsigned char *) block->data, 0,
-								fs_block_size );
-							error = aal_block_write (block);
-							if ( error != 0 )
-							{
-								ret_wfs = WFS_BLKWR;
-								break;
-							}
-							aal_block_free (block);
-						}
-						/* No need to flush the last
-						* writing of a given block. *
-						if ( (wfs_fs.npasses > 1)
-							&& (sig_recvd == 0) )
-						{
-							error = wfs_r4_flush_fs (
-								wfs_fs);
-						} */
-					}
-					wfs_r4_flush_fs (wfs_fs);
-				}
-			}
-		}
+
+	/* find the free blocks once, for all the passes */
+	wfs_extmap_init (&map);
+	ret_wfs = wfs_r4_get_free_extents (r4->alloc,
+		REISER4_FS_MIN_SIZE (fs_block_size), number_of_blocks, &map);
+	if ( ret_wfs == WFS_SUCCESS )
+	{
+		io.device = r4->device;
+		io.dev_blocks = fs_block_size / r4->device->blksize;
+		ops.read_blocks = &wfs_r4_read_blocks;
+		ops.write_blocks = &wfs_r4_write_blocks;
+		ops.write_pattern = NULL;
+		ops.sync_blocks = &wfs_r4_sync_blocks;
+		ops.flush_fs = &wfs_r4_flush_fs;
+		ops.data = &io;
+		wfs_extmap_direct_open (wfs_fs, fs_block_size, &direct, &ops);
+		ret_wfs = wfs_wipe_extents (wfs_fs, &map, fs_block_size,
+			&ops, &error);
+		wfs_extmap_direct_close (&direct);
 	}
 	else
 	{
-		curr_sector = 0;
-		for ( blk_no = REISER4_FS_MIN_SIZE (fs_block_size);
-			(blk_no < number_of_blocks) && (sig_recvd == 0)
-			/*&& (ret_wfs == WFS_SUCCESS)*/; blk_no++ )
-		{
-			if ( reiser4_alloc_available (r4->alloc, blk_no, one) != 0 )
-			{
-				/* block is unallocated, wipe it */
-				block = aal_block_load (r4->device,
-					(uint32_t)(fs_block_size & 0x0FFFFFFFF),
-					blk_no);
-				if ( block == NULL )
-				{
-					ret_wfs = WFS_BLKITER;
-					curr_sector++;
-					wfs_show_progress (WFS_PROGRESS_WFS,
-						(unsigned int)((curr_sector * 100)/number_of_blocks),
-						&prev_percent);
-					continue;
-				}
-				for ( j = 0; (j < wfs_fs.npasses) && (sig_recvd == 0)
-					/*&& (ret_wfs == WFS_SUCCESS)*/; j++ )
-				{
-					if ( wfs_fs.no_wipe_zero_blocks != 0 )
-					{
-						if ( wfs_is_block_zero (block->data, fs_block_size) != 0 )
-						{
-							/* this block is all-zeros - don't wipe, as requested */
-							j = wfs_fs.npasses * 2;
-							break;
-						}
-					}
-					wfs_fill_buffer ( j, (unsigned char *) block->data,
-						fs_block_size, selected, wfs_fs );
-					if ( sig_recvd != 0 )
-					{
-						ret_wfs = WFS_SIGNAL;
-						break;
-					}
-					error = aal_block_write (block);
-					if ( error != 0 )
-					{
-						ret_wfs = WFS_BLKWR;
-						break;
-					}
-					/* Flush after each writing, if more than 1
-					overwriting needs to be done. Allow I/O bufferring
-					(efficiency), if just one pass is needed. */
-					if ( WFS_IS_SYNC_NEEDED(wfs_fs) )
-					{
-						error = wfs_r4_flush_fs (wfs_fs);
-					}
-				}
-				if ( (wfs_fs.zero_pass != 0) && (sig_recvd == 0) )
-				{
-					if ( j != wfs_fs.npasses * 2 )
-					{
-						/* last pass with zeros: */
-						WFS_MEMSET ( (unsigned char *) block->data, 0,
-							fs_block_size );
-						if ( sig_recvd == 0 )
-						{
-							error = aal_block_write (block);
-							if ( error != 0 )
-							{
-								ret_wfs = WFS_BLKWR;
-								/*break; free the block first */
-							}
-							/* No need to flush the last
-							* writing of a given block. *
-							if ( (wfs_fs.npasses > 1)
-								&& (sig_recvd == 0) )
-							{
-								error = wfs_r4_flush_fs (
-									wfs_fs);
-							} */
-						}
-					}
-				}
-				aal_block_free (block);
-			}
-			curr_sector++;
-			wfs_show_progress (WFS_PROGRESS_WFS,
-				(unsigned int)((curr_sector * 100)/number_of_blocks),
-				&prev_percent);
-		}
+		wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
 	}
-	wfs_show_progress (WFS_PROGRESS_WFS, 100, &prev_percent);
+	wfs_extmap_free (&map);
 	if ( had_to_open_alloc != 0 )
 	{
 		reiser4_alloc_close (r4->alloc);
+		r4->alloc = NULL;
 	}
 	if ( error_ret != NULL )
 	{
-		*error_ret = error;
+		*error_ret = (errno_t) error;
+	}
+	if ( sig_recvd != 0 )
+	{
+		return WFS_SIGNAL;
 	}
-
 	return ret_wfs;
 }
 #endif /* WFS_WANT_WFS */
@@ -973,7 +1127,6 @@ wfs_r4_wipe_journal (
 	struct wfs_r4_block_data * const bd = (struct wfs_r4_block_data *) data;
 	errno_t ret_journ = WFS_SUCCESS;
         uint64_t blk_no;
-	int selected[WFS_NPAT] = {0};
 	unsigned long int j;
 	aal_block_t * block;
 	unsigned int prev_percent = 0;
@@ -1032,7 +1185,7 @@ wfs_r4_wipe_journal (
 				}
 			}
 			wfs_fill_buffer ( j, (unsigned char *) block->data,
-				fs_block_size, selected, bd->wfs_fs );
+				fs_block_size, bd->wfs_fs );
 			if ( sig_recvd != 0 )
 			{
 				ret_journ = WFS_SIGNAL;
@@ -1133,7 +1286,6 @@ wfs_r4_wipe_object (
 	errno_t ret_obj = WFS_SUCCESS;
 	struct wfs_r4_block_data * const bd = (struct wfs_r4_block_data *) data;
         uint64_t blk_no;
-	int selected[WFS_NPAT] = {0};
 	unsigned long int j;
 	aal_block_t * block;
 	reiser4_fs_t * r4;
@@ -1191,13 +1343,13 @@ wfs_r4_wipe_object (
 					(size_t)((fs_block_size
 						- (reiser4_object_size (bd->obj)
 						% fs_block_size)) & 0xFFFFFFFF),
-					selected, bd->wfs_fs );
+					bd->wfs_fs );
 			}
 			else
 			{
 				wfs_fill_buffer ( j, (unsigned char *) block->data,
 					fs_block_size,
-					selected, bd->wfs_fs );
+					bd->wfs_fs );
 			}
 			if ( sig_recvd != 0 )
 			{
@@ -1575,7 +1727,8 @@ wfs_r4_open_fs (
 
 	/* 512 is the default, just for opening. Later on we use the status
 	   field to get the block size */
-	dev = aal_device_open (&file_ops, dev_name_copy, 512, O_RDWR | O_EXCL
+	dev = aal_device_open (&file_ops, dev_name_copy, 512,
+		((wfs_fs->plan_only != 0)? O_RDONLY : O_RDWR) | O_EXCL
 #ifdef O_BINARY
 		| O_BINARY
 #endif
@@ -1608,6 +1761,11 @@ wfs_r4_open_fs (
 
 	wfs_fs->whichfs = WFS_CURR_FS_REISER4;
 	wfs_fs->fs_backend = r4;
+	if ( r4->master != NULL )
+	{
+		wfs_set_uuid (wfs_fs, (const unsigned char *) r4->master->ent.ms_uuid,
+			sizeof (r4->master->ent.ms_uuid));
+	}
 
 	/*  dev_name_copy free()d upon close() */
 	if ( error_ret != NULL )
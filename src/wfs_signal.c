@@ -212,7 +212,7 @@ child_signal_received (
 # undef void
 }
 
-static wfs_fsid_t wf_gen = {"", 0, 0, NULL, NULL, WFS_CURR_FS_NONE, 0, 0, WFS_WIPE_MODE_BLOCK};
+static wfs_fsid_t wf_gen = {"", 0, 0, NULL, NULL, WFS_CURR_FS_NONE, 0, 0, WFS_WIPE_MODE_BLOCK, WFS_DEFAULT_CHUNK_SIZE, 0, 0, 0, 0, NULL, ""};
 
 /* =============================================================== */
 
@@ -0,0 +1,817 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- snapshots of the free space for incremental wiping.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_cfg.h"
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>	/* FILE, fopen(), rename(), remove() */
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>	/* malloc(), free() */
+#endif
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>	/* fsync(), lseek(), close() */
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>	/* for open() */
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>	/* stat() */
+#endif
+
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>	/* open() */
+#endif
+
+#ifdef HAVE_DIRENT_H
+# include <dirent.h>	/* opendir(), readdir() */
+#endif
+
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# if ((!defined STDC_HEADERS) || (!STDC_HEADERS)) && (defined HAVE_MEMORY_H)
+#  include <memory.h>
+# endif
+# include <string.h>	/* strcmp(), strlen(), strcpy() */
+#endif
+
+#include "wipefreespace.h"
+#include "wfs_snapshot.h"
+
+/* the first line of a snapshot file */
+#define WFS_SNAPSHOT_HEADER "# WipeFreeSpace snapshot 1"
+
+/* the maximum length of the line identifying the filesystem */
+#define WFS_SNAPSHOT_LINE 512
+
+/* the directory with the symbolic links to the devices, named by UUIDs */
+#define WFS_SNAPSHOT_UUID_DIR "/dev/disk/by-uuid"
+
+#if (defined HAVE_LONG_LONG) || (defined HAVE_LONG_LONG_INT)
+# define WFS_BLKNO_FORMAT "%llu"
+#else
+# define WFS_BLKNO_FORMAT "%lu"
+#endif
+
+#ifndef ENOENT
+# define ENOENT 2
+#endif
+
+#ifndef ENOTDIR
+# define ENOTDIR 20
+#endif
+
+#ifndef EINVAL
+# define EINVAL 22
+#endif
+
+static const char * snapshot_dir = NULL;
+
+#if (defined TEST_COMPILE) && (defined WFS_ANSIC)
+# undef WFS_ANSIC
+#endif
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static char * GCC_WARN_UNUSED_RESULT wfs_snapshot_path WFS_PARAMS ((
+	const char * const device, const char * const suffix));
+#endif
+
+/**
+ * Makes the name of the snapshot file of the given device: the device's
+ *	name with the characters other than letters, digits, dots and dashes
+ *	changed to underscores, in the snapshot directory.
+ * \param device The name of the device.
+ * \param suffix The ending of the file name.
+ * \return The allocated name, NULL in case of errors.
+ */
+static char * GCC_WARN_UNUSED_RESULT
+wfs_snapshot_path (
+#ifdef WFS_ANSIC
+	const char * const device, const char * const suffix)
+#else
+	device, suffix)
+	const char * const device;
+	const char * const suffix;
+#endif
+{
+	char * path;
+	size_t dir_len;
+	size_t i;
+
+	dir_len = strlen (snapshot_dir);
+	path = (char *) malloc (dir_len + 1 + strlen (device)
+		+ strlen (suffix) + 1);
+	if ( path == NULL )
+	{
+		return NULL;
+	}
+	strcpy (path, snapshot_dir);
+	path[dir_len] = '/';
+	for ( i = 0; device[i] != '\0'; i++ )
+	{
+		if ( ((device[i] >= 'a') && (device[i] <= 'z'))
+			|| ((device[i] >= 'A') && (device[i] <= 'Z'))
+			|| ((device[i] >= '0') && (device[i] <= '9'))
+			|| (device[i] == '.') || (device[i] == '-') )
+		{
+			path[dir_len + 1 + i] = device[i];
+		}
+		else
+		{
+			path[dir_len + 1 + i] = '_';
+		}
+	}
+	strcpy (&path[dir_len + 1 + i], suffix);
+	return path;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static wfs_blkno_t GCC_WARN_UNUSED_RESULT wfs_snapshot_dev_size WFS_PARAMS ((
+	const char * const device));
+#endif
+
+/**
+ * Checks the size of the given device or filesystem image.
+ * \param device The name of the device.
+ * \return The size in bytes, 0 if unknown.
+ */
+static wfs_blkno_t GCC_WARN_UNUSED_RESULT
+wfs_snapshot_dev_size (
+#ifdef WFS_ANSIC
+	const char * const device)
+#else
+	device)
+	const char * const device;
+#endif
+{
+	wfs_blkno_t size = 0;
+#if (defined HAVE_OPEN) && (defined HAVE_FCNTL_H) && (defined HAVE_UNISTD_H)
+	int fd;
+	off_t end;
+
+	fd = open (device, O_RDONLY);
+	if ( fd < 0 )
+	{
+		return 0;
+	}
+	/* works for block devices, too */
+	end = lseek (fd, (off_t) 0, SEEK_END);
+	if ( end > 0 )
+	{
+		size = (wfs_blkno_t) end;
+	}
+	close (fd);
+#endif
+	return size;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_snapshot_uuid WFS_PARAMS ((
+	const wfs_fsid_t wfs_fs, char * const uuid, const size_t size));
+#endif
+
+/**
+ * Finds the UUID of the given filesystem: the one read from its superblock
+ *	or, if its library doesn't give one, the one of the link to its device
+ *	named by the UUID of its filesystem.
+ * \param wfs_fs The filesystem.
+ * \param uuid The place for the UUID, "-" if unknown.
+ * \param size The size of the place for the UUID.
+ * \return 1 if the UUID is known, 0 otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_uuid (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, char * const uuid, const size_t size)
+#else
+	wfs_fs, uuid, size)
+	const wfs_fsid_t wfs_fs;
+	char * const uuid;
+	const size_t size;
+#endif
+{
+#if (defined HAVE_DIRENT_H) && (defined HAVE_OPENDIR) \
+	&& (defined HAVE_SYS_STAT_H) && (defined HAVE_STAT)
+	DIR * dir;
+	struct dirent * entry;
+	struct stat dev_stat;
+	struct stat link_stat;
+	char path[WFS_SNAPSHOT_LINE];
+#endif
+
+	strcpy (uuid, "-");
+	if ( (wfs_fs.fs_uuid[0] != '\0') && (strlen (wfs_fs.fs_uuid) < size) )
+	{
+		strcpy (uuid, wfs_fs.fs_uuid);
+		return 1;
+	}
+#if (defined HAVE_DIRENT_H) && (defined HAVE_OPENDIR) \
+	&& (defined HAVE_SYS_STAT_H) && (defined HAVE_STAT)
+	if ( (wfs_fs.fsname == NULL) || (stat (wfs_fs.fsname, &dev_stat) != 0) )
+	{
+		return 0;
+	}
+	if ( ! S_ISBLK (dev_stat.st_mode) )
+	{
+		/* images don't have the links */
+		return 0;
+	}
+	dir = opendir (WFS_SNAPSHOT_UUID_DIR);
+	if ( dir == NULL )
+	{
+		return 0;
+	}
+	while ( (entry = readdir (dir)) != NULL )
+	{
+		if ( (entry->d_name[0] == '.')
+			|| (strlen (entry->d_name) >= size)
+			|| (strlen (WFS_SNAPSHOT_UUID_DIR) + 1
+				+ strlen (entry->d_name) >= sizeof (path)) )
+		{
+			continue;
+		}
+		strcpy (path, WFS_SNAPSHOT_UUID_DIR "/");
+		strcat (path, entry->d_name);
+		if ( stat (path, &link_stat) != 0 )
+		{
+			continue;
+		}
+		if ( (S_ISBLK (link_stat.st_mode))
+			&& (link_stat.st_rdev == dev_stat.st_rdev) )
+		{
+			strcpy (uuid, entry->d_name);
+			break;
+		}
+	}
+	closedir (dir);
+#endif
+	return (strcmp (uuid, "-") != 0)? 1 : 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_snapshot_identify WFS_PARAMS ((
+	const wfs_fsid_t wfs_fs, const size_t fs_block_size, char * const line));
+#endif
+
+/**
+ * Makes the line identifying the filesystem: its type, the block size,
+ *	the size of its device and its UUID.
+ * \param wfs_fs The filesystem.
+ * \param fs_block_size The size of a single block.
+ * \param line The place for the line, WFS_SNAPSHOT_LINE characters.
+ * \return 1 if the filesystem's UUID is known, 0 otherwise - the other
+ *	values don't tell filesystems apart.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_identify (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const size_t fs_block_size, char * const line)
+#else
+	wfs_fs, fs_block_size, line)
+	const wfs_fsid_t wfs_fs;
+	const size_t fs_block_size;
+	char * const line;
+#endif
+{
+	/* leave space for the numbers */
+	char uuid[WFS_SNAPSHOT_LINE - 80];
+	int known;
+
+	known = wfs_snapshot_uuid (wfs_fs, uuid, sizeof (uuid));
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+	snprintf (line, WFS_SNAPSHOT_LINE - 1, "%d %lu " WFS_BLKNO_FORMAT " %s",
+		(int) wfs_fs.whichfs, (unsigned long int) fs_block_size,
+		wfs_snapshot_dev_size (wfs_fs.fsname), uuid);
+#else
+	sprintf (line, "%d %lu " WFS_BLKNO_FORMAT " %s",
+		(int) wfs_fs.whichfs, (unsigned long int) fs_block_size,
+		wfs_snapshot_dev_size (wfs_fs.fsname), uuid);
+#endif
+	line[WFS_SNAPSHOT_LINE - 1] = '\0';
+	return known;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_snapshot_put_number WFS_PARAMS ((
+	FILE * const f, wfs_blkno_t value));
+#endif
+
+/**
+ * Writes a number to a snapshot file, 7 bits per byte, the lowest bits
+ *	first, with the highest bit set in all the bytes except the last.
+ * \param f The file.
+ * \param value The number to write.
+ * \return 0 on success, an errno value otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_put_number (
+#ifdef WFS_ANSIC
+	FILE * const f, wfs_blkno_t value)
+#else
+	f, value)
+	FILE * const f;
+	wfs_blkno_t value;
+#endif
+{
+	int byte;
+
+	do
+	{
+		byte = (int) (value & 0x7F);
+		value >>= 7;
+		if ( value != 0 )
+		{
+			byte |= 0x80;
+		}
+		if ( putc (byte, f) == EOF )
+		{
+			return WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+		}
+	} while ( value != 0 );
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_snapshot_get_number WFS_PARAMS ((
+	FILE * const f, wfs_blkno_t * const value));
+#endif
+
+/**
+ * Reads a number written by wfs_snapshot_put_number().
+ * \param f The file.
+ * \param value Pointer to the place for the number.
+ * \return 0 on success, -1 if the file is truncated or invalid.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_get_number (
+#ifdef WFS_ANSIC
+	FILE * const f, wfs_blkno_t * const value)
+#else
+	f, value)
+	FILE * const f;
+	wfs_blkno_t * const value;
+#endif
+{
+	int byte;
+	unsigned int shift = 0;
+
+	*value = 0;
+	do
+	{
+		if ( shift >= sizeof (wfs_blkno_t) * 8 )
+		{
+			return -1;
+		}
+		byte = getc (f);
+		if ( byte == EOF )
+		{
+			return -1;
+		}
+		*value |= ((wfs_blkno_t) (byte & 0x7F)) << shift;
+		shift += 7;
+	} while ( (byte & 0x80) != 0 );
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_snapshot_write WFS_PARAMS ((
+	const char * const path, const char * const ident,
+	const wfs_extent_map_t * const map));
+#endif
+
+/**
+ * Writes the given free-extent map to a snapshot file. The ranges are
+ *	stored as the distances from the previous ones and their lengths, so
+ *	that a map of a whole filesystem takes little space.
+ * \param path The name of the file.
+ * \param ident The line identifying the filesystem.
+ * \param map The map to write.
+ * \return 0 on success, an errno value otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_write (
+#ifdef WFS_ANSIC
+	const char * const path, const char * const ident,
+	const wfs_extent_map_t * const map)
+#else
+	path, ident, map)
+	const char * const path;
+	const char * const ident;
+	const wfs_extent_map_t * const map;
+#endif
+{
+	FILE * f;
+	size_t i;
+	wfs_blkno_t prev_end = 0;
+	int res = 0;
+
+	WFS_SET_ERRNO (0);
+	f = fopen (path, "wb");
+	if ( f == NULL )
+	{
+		return WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+	if ( fprintf (f, "%s\n%s\n", WFS_SNAPSHOT_HEADER, ident) < 0 )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+	if ( res == 0 )
+	{
+		res = wfs_snapshot_put_number (f, (wfs_blkno_t) map->count);
+	}
+	for ( i = 0; (i < map->count) && (res == 0); i++ )
+	{
+		res = wfs_snapshot_put_number (f,
+			map->extents[i].start - prev_end);
+		if ( res == 0 )
+		{
+			res = wfs_snapshot_put_number (f,
+				map->extents[i].length);
+		}
+		prev_end = map->extents[i].start + map->extents[i].length;
+	}
+	if ( res == 0 )
+	{
+		/* the total lets a truncated file be detected */
+		res = wfs_snapshot_put_number (f, map->total_blocks);
+	}
+	if ( (res == 0) && (fflush (f) != 0) )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+#if (defined HAVE_FSYNC) && (defined HAVE_UNISTD_H)
+	/* the new contents must be on the disk before the rename */
+	if ( (res == 0) && (fsync (fileno (f)) != 0) )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+#endif
+	if ( (fclose (f) != 0) && (res == 0) )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+	if ( res != 0 )
+	{
+		remove (path);
+	}
+	return res;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_snapshot_read WFS_PARAMS ((
+	const char * const path, const char * const ident,
+	wfs_extent_map_t * const map));
+#endif
+
+/**
+ * Reads a free-extent map from a snapshot file.
+ * \param path The name of the file.
+ * \param ident The line identifying the filesystem, which must be the
+ *	same as saved in the file.
+ * \param map The empty map to fill.
+ * \return 0 on success, -1 if the file is missing, invalid or made for
+ *	a different filesystem.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_read (
+#ifdef WFS_ANSIC
+	const char * const path, const char * const ident,
+	wfs_extent_map_t * const map)
+#else
+	path, ident, map)
+	const char * const path;
+	const char * const ident;
+	wfs_extent_map_t * const map;
+#endif
+{
+	FILE * f;
+	char line[WFS_SNAPSHOT_LINE];
+	size_t len;
+	wfs_blkno_t count;
+	wfs_blkno_t i;
+	wfs_blkno_t start;
+	wfs_blkno_t length;
+	wfs_blkno_t total;
+	wfs_blkno_t prev_end = 0;
+	int res = 0;
+
+	f = fopen (path, "rb");
+	if ( f == NULL )
+	{
+		return -1;
+	}
+	if ( fgets (line, sizeof (line), f) == NULL )
+	{
+		fclose (f);
+		return -1;
+	}
+	len = strlen (line);
+	if ( (len == 0) || (line[len - 1] != '\n') )
+	{
+		fclose (f);
+		return -1;
+	}
+	line[len - 1] = '\0';
+	if ( strcmp (line, WFS_SNAPSHOT_HEADER) != 0 )
+	{
+		fclose (f);
+		return -1;
+	}
+	if ( fgets (line, sizeof (line), f) == NULL )
+	{
+		fclose (f);
+		return -1;
+	}
+	len = strlen (line);
+	if ( (len == 0) || (line[len - 1] != '\n') )
+	{
+		fclose (f);
+		return -1;
+	}
+	line[len - 1] = '\0';
+	if ( strcmp (line, ident) != 0 )
+	{
+		/* a different or re-created filesystem */
+		fclose (f);
+		return -1;
+	}
+	res = wfs_snapshot_get_number (f, &count);
+	for ( i = 0; (i < count) && (res == 0); i++ )
+	{
+		res = wfs_snapshot_get_number (f, &start);
+		if ( res == 0 )
+		{
+			res = wfs_snapshot_get_number (f, &length);
+		}
+		if ( res == 0 )
+		{
+			start += prev_end;
+			if ( (start < prev_end) || (length == 0)
+				|| (start + length < start) )
+			{
+				res = -1;
+			}
+		}
+		if ( res == 0 )
+		{
+			if ( wfs_extmap_add (map, start, length) != WFS_SUCCESS )
+			{
+				res = -1;
+			}
+			prev_end = start + length;
+		}
+	}
+	if ( res == 0 )
+	{
+		res = wfs_snapshot_get_number (f, &total);
+	}
+	if ( (res == 0) && ((total != map->total_blocks)
+		|| (getc (f) != EOF)) )
+	{
+		res = -1;
+	}
+	fclose (f);
+	if ( res != 0 )
+	{
+		wfs_extmap_free (map);
+	}
+	return res;
+}
+
+/* ======================================================================== */
+
+/**
+ * Starts using the snapshots of the free space in the given directory.
+ * \param dir The name of the directory, NULL to disable the snapshots.
+ * \return 0 on success, an errno value otherwise.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_init (
+#ifdef WFS_ANSIC
+	const char * const dir)
+#else
+	dir)
+	const char * const dir;
+#endif
+{
+#if (defined HAVE_SYS_STAT_H) && (defined HAVE_STAT)
+	struct stat s;
+#endif
+
+	snapshot_dir = NULL;
+	if ( dir == NULL )
+	{
+		return 0;
+	}
+#if (defined HAVE_SYS_STAT_H) && (defined HAVE_STAT)
+	WFS_SET_ERRNO (0);
+	if ( stat (dir, &s) != 0 )
+	{
+		return WFS_GET_ERRNO_OR_DEFAULT (ENOENT);
+	}
+	if ( ! S_ISDIR (s.st_mode) )
+	{
+		return ENOTDIR;
+	}
+#endif
+	snapshot_dir = dir;
+	return 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells if the snapshots of the free space are used.
+ * \return non-zero if a snapshot directory was given.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_snapshot_is_enabled (WFS_VOID)
+{
+	return (snapshot_dir != NULL)? 1 : 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Prepares the snapshot of the current free space of the given filesystem
+ *	and removes the blocks which were free at the time of the previous
+ *	snapshot from the map, if that snapshot was made for the same
+ *	filesystem. The new snapshot replaces the previous one after the
+ *	wiping succeeds, see wfs_snapshot_end(). Nothing is done for the
+ *	filesystems without a known UUID.
+ * \param wfs_fs The filesystem.
+ * \param map The map of all the free blocks, changed to the blocks which
+ *	need wiping.
+ * \param fs_block_size The size of a single block.
+ * \param applied Pointer to a variable set to 1 if the map was changed,
+ *	to 0 otherwise.
+ * \return 0 on success, an errno value if the new snapshot could not
+ *	be written.
+ */
+int GCC_WARN_UNUSED_RESULT
+#ifdef WFS_ANSIC
+WFS_ATTR ((nonnull))
+#endif
+wfs_snapshot_begin (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, wfs_extent_map_t * const map,
+	const size_t fs_block_size, int * const applied)
+#else
+	wfs_fs, map, fs_block_size, applied)
+	const wfs_fsid_t wfs_fs;
+	wfs_extent_map_t * const map;
+	const size_t fs_block_size;
+	int * const applied;
+#endif
+{
+	char ident[WFS_SNAPSHOT_LINE];
+	char * path;
+	char * new_path;
+	wfs_extent_map_t old;
+	int res;
+
+	if ( applied == NULL )
+	{
+		return EINVAL;
+	}
+	*applied = 0;
+	if ( (snapshot_dir == NULL) || (wfs_fs.fsname == NULL) || (map == NULL) )
+	{
+		return 0;
+	}
+	if ( wfs_snapshot_identify (wfs_fs, fs_block_size, ident) == 0 )
+	{
+		/* another filesystem on the same device could take the
+		   snapshot - wipe all the free space, don't save any */
+		return 0;
+	}
+	path = wfs_snapshot_path (wfs_fs.fsname, ".snap");
+	if ( path == NULL )
+	{
+		return ENOMEM;
+	}
+	new_path = wfs_snapshot_path (wfs_fs.fsname, ".snap.new");
+	if ( new_path == NULL )
+	{
+		free (path);
+		return ENOMEM;
+	}
+	/* all the blocks free now will have been wiped when this is used */
+	res = wfs_snapshot_write (new_path, ident, map);
+
+	wfs_extmap_init (&old);
+	if ( wfs_snapshot_read (path, ident, &old) == 0 )
+	{
+		if ( wfs_extmap_subtract (map, &old) == WFS_SUCCESS )
+		{
+			*applied = 1;
+		}
+	}
+	wfs_extmap_free (&old);
+	free (new_path);
+	free (path);
+	return res;
+}
+
+/* ======================================================================== */
+
+/**
+ * Replaces the previous snapshot of the given filesystem with the one made
+ *	by wfs_snapshot_begin(), if the wiping succeeded, or discards the new
+ *	one otherwise.
+ * \param wfs_fs The filesystem.
+ * \param success Non-zero if all the free blocks were wiped.
+ * \return 0 on success, an errno value otherwise.
+ */
+int
+wfs_snapshot_end (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const int success)
+#else
+	wfs_fs, success)
+	const wfs_fsid_t wfs_fs;
+	const int success;
+#endif
+{
+	char uuid[WFS_SNAPSHOT_LINE - 80];
+	char * path;
+	char * new_path;
+	int res = 0;
+
+	if ( (snapshot_dir == NULL) || (wfs_fs.fsname == NULL) )
+	{
+		return 0;
+	}
+	if ( wfs_snapshot_uuid (wfs_fs, uuid, sizeof (uuid)) == 0 )
+	{
+		/* no snapshot was made */
+		return 0;
+	}
+	path = wfs_snapshot_path (wfs_fs.fsname, ".snap");
+	if ( path == NULL )
+	{
+		return ENOMEM;
+	}
+	new_path = wfs_snapshot_path (wfs_fs.fsname, ".snap.new");
+	if ( new_path == NULL )
+	{
+		free (path);
+		return ENOMEM;
+	}
+	WFS_SET_ERRNO (0);
+	if ( success != 0 )
+	{
+		if ( rename (new_path, path) != 0 )
+		{
+			res = WFS_GET_ERRNO_OR_DEFAULT (ENOENT);
+		}
+	}
+	else
+	{
+		remove (new_path);
+	}
+	free (new_path);
+	free (path);
+	return res;
+}
@@ -0,0 +1,43 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- snapshots of the free space for incremental wiping, header file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WFS_SNAPSHOT_H
+# define WFS_SNAPSHOT_H 1
+
+# include "wipefreespace.h"
+# include "wfs_extents.h"
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_snapshot_init WFS_PARAMS ((const char * const dir));
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_snapshot_is_enabled WFS_PARAMS ((void));
+
+extern int GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_snapshot_begin WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		wfs_extent_map_t * const map, const size_t fs_block_size,
+		int * const applied));
+
+extern int
+	wfs_snapshot_end WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		const int success));
+
+#endif	/* WFS_SNAPSHOT_H */
@@ -0,0 +1,826 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- saving and restoring the progress of wiping.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_cfg.h"
+
+#include <stdio.h>	/* FILE, fopen(), rename(), remove() */
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>	/* malloc(), realloc(), free() */
+#endif
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>	/* fsync() */
+#endif
+
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# if ((!defined STDC_HEADERS) || (!STDC_HEADERS)) && (defined HAVE_MEMORY_H)
+#  include <memory.h>
+# endif
+# include <string.h>	/* strcmp(), strlen(), strcpy() */
+#endif
+
+#include "wipefreespace.h"
+#include "wfs_state.h"
+#include "wfs_wiping.h"
+
+/* the first line of the state file */
+#define WFS_STATE_HEADER "# WipeFreeSpace state 2"
+
+/* the maximum length of a line of the state file */
+#define WFS_STATE_LINE 4352
+
+#if (defined HAVE_LONG_LONG) || (defined HAVE_LONG_LONG_INT)
+# define WFS_BLKNO_FORMAT "%llu"
+#else
+# define WFS_BLKNO_FORMAT "%lu"
+#endif
+
+#ifndef ENOENT
+# define ENOENT 2
+#endif
+
+/* The saved progress of wiping one filesystem, one line of the state file */
+struct wfs_state_rec
+{
+	char *			device;		/* the filesystem's device */
+	wfs_state_phase_t	phase;		/* the stage being performed */
+	int			whichfs;	/* the type of the filesystem */
+	unsigned long int	npasses;	/* the number of wiping passes */
+	int			zero_pass;	/* whether the zero pass is done */
+	int			wipe_mode;	/* the wiping order */
+	int			method;		/* the wiping method */
+	unsigned long int	seed;		/* decides the order of the patterns */
+	unsigned long int	key;		/* identifies the free space,
+						   0 if not known yet */
+	unsigned long int	pass;		/* the pass being performed */
+	wfs_blkno_t		cursor;		/* the block to start the pass at */
+};
+
+typedef struct wfs_state_rec wfs_state_rec_t;
+
+static const char * const wfs_state_phase_names[] =
+{
+	"none", "unrm", "part", "wfs", "done"
+};
+
+static const char * state_path = NULL;
+/* the first failure of saving the position since it was last checked */
+static int save_error = 0;
+
+#if (defined TEST_COMPILE) && (defined WFS_ANSIC)
+# undef WFS_ANSIC
+#endif
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_state_free WFS_PARAMS ((wfs_state_rec_t * const recs,
+	const size_t count));
+#endif
+
+/**
+ * Frees the records read from the state file.
+ * \param recs The records.
+ * \param count The number of the records.
+ */
+static void
+wfs_state_free (
+#ifdef WFS_ANSIC
+	wfs_state_rec_t * const recs, const size_t count)
+#else
+	recs, count)
+	wfs_state_rec_t * const recs;
+	const size_t count;
+#endif
+{
+	size_t i;
+
+	if ( recs == NULL )
+	{
+		return;
+	}
+	for ( i = 0; i < count; i++ )
+	{
+		if ( recs[i].device != NULL )
+		{
+			free (recs[i].device);
+		}
+	}
+	free (recs);
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_state_parse WFS_PARAMS ((
+	char * const line, wfs_state_rec_t * const rec));
+#endif
+
+/**
+ * Reads one record from a line of the state file.
+ * \param line The line, without the end-of-line character.
+ * \param rec The record to fill. The device name is allocated.
+ * \return 0 on success, -1 if the line is not a valid record, or an
+ *	errno value.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_state_parse (
+#ifdef WFS_ANSIC
+	char * const line, wfs_state_rec_t * const rec)
+#else
+	line, rec)
+	char * const line;
+	wfs_state_rec_t * const rec;
+#endif
+{
+	char phase[8];
+	int device_pos = 0;
+	size_t i;
+
+	if ( sscanf (line, "%7s %d %lu %d %d %d %lu %lu %lu " WFS_BLKNO_FORMAT " %n",
+		phase, &(rec->whichfs), &(rec->npasses), &(rec->zero_pass),
+		&(rec->wipe_mode), &(rec->method), &(rec->seed), &(rec->key),
+		&(rec->pass), &(rec->cursor), &device_pos) < 10 )
+	{
+		return -1;
+	}
+	if ( (device_pos <= 0) || (line[device_pos] == '\0') )
+	{
+		return -1;
+	}
+	rec->phase = WFS_STATE_NONE;
+	for ( i = 0; i < sizeof (wfs_state_phase_names)
+		/ sizeof (wfs_state_phase_names[0]); i++ )
+	{
+		if ( strcmp (phase, wfs_state_phase_names[i]) == 0 )
+		{
+			rec->phase = (wfs_state_phase_t) i;
+			break;
+		}
+	}
+	if ( i == sizeof (wfs_state_phase_names) / sizeof (wfs_state_phase_names[0]) )
+	{
+		return -1;
+	}
+	rec->device = (char *) malloc (strlen (&line[device_pos]) + 1);
+	if ( rec->device == NULL )
+	{
+		return ENOMEM;
+	}
+	strcpy (rec->device, &line[device_pos]);
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_state_load WFS_PARAMS ((
+	wfs_state_rec_t ** const recs, size_t * const count));
+#endif
+
+/**
+ * Reads all the records from the state file. A missing file has no
+ *	records, invalid lines are skipped.
+ * \param recs Pointer to the array of records, allocated here.
+ * \param count Pointer to the number of records, filled here.
+ * \return 0 on success, an errno value otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_state_load (
+#ifdef WFS_ANSIC
+	wfs_state_rec_t ** const recs, size_t * const count)
+#else
+	recs, count)
+	wfs_state_rec_t ** const recs;
+	size_t * const count;
+#endif
+{
+	FILE * f;
+	char line[WFS_STATE_LINE];
+	size_t len;
+	wfs_state_rec_t * new_recs;
+	wfs_state_rec_t rec;
+	int res;
+
+	*recs = NULL;
+	*count = 0;
+	WFS_SET_ERRNO (0);
+	f = fopen (state_path, "r");
+	if ( f == NULL )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (ENOENT);
+		if ( res == ENOENT )
+		{
+			return 0;
+		}
+		return res;
+	}
+	while ( fgets (line, sizeof (line), f) != NULL )
+	{
+		len = strlen (line);
+		if ( (len == 0) || (line[len - 1] != '\n') )
+		{
+			/* too long or not finished - not written by us */
+			continue;
+		}
+		line[len - 1] = '\0';
+		if ( line[0] == '#' )
+		{
+			continue;
+		}
+		res = wfs_state_parse (line, &rec);
+		if ( res == -1 )
+		{
+			continue;
+		}
+		if ( res == 0 )
+		{
+			new_recs = (wfs_state_rec_t *) realloc (*recs,
+				(*count + 1) * sizeof (wfs_state_rec_t));
+			if ( new_recs == NULL )
+			{
+				free (rec.device);
+				res = ENOMEM;
+			}
+			else
+			{
+				*recs = new_recs;
+				(*recs)[*count] = rec;
+				(*count)++;
+			}
+		}
+		if ( res != 0 )
+		{
+			fclose (f);
+			wfs_state_free (*recs, *count);
+			*recs = NULL;
+			*count = 0;
+			return res;
+		}
+	}
+	fclose (f);
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_state_store WFS_PARAMS ((
+	const wfs_state_rec_t * const recs, const size_t count));
+#endif
+
+/**
+ * Writes all the records to the state file, atomically: a new file is
+ *	written and synced first and then replaces the old one.
+ * \param recs The records.
+ * \param count The number of the records.
+ * \return 0 on success, an errno value otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_state_store (
+#ifdef WFS_ANSIC
+	const wfs_state_rec_t * const recs, const size_t count)
+#else
+	recs, count)
+	const wfs_state_rec_t * const recs;
+	const size_t count;
+#endif
+{
+	FILE * f;
+	char * tmp_path;
+	size_t i;
+	int res = 0;
+
+	tmp_path = (char *) malloc (strlen (state_path) + 5);
+	if ( tmp_path == NULL )
+	{
+		return ENOMEM;
+	}
+	strcpy (tmp_path, state_path);
+	strcat (tmp_path, ".tmp");
+
+	WFS_SET_ERRNO (0);
+	f = fopen (tmp_path, "w");
+	if ( f == NULL )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+		free (tmp_path);
+		return res;
+	}
+	if ( fprintf (f, "%s\n", WFS_STATE_HEADER) < 0 )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+	for ( i = 0; (i < count) && (res == 0); i++ )
+	{
+		if ( fprintf (f, "%s %d %lu %d %d %d %lu %lu %lu " WFS_BLKNO_FORMAT " %s\n",
+			wfs_state_phase_names[recs[i].phase], recs[i].whichfs,
+			recs[i].npasses, recs[i].zero_pass, recs[i].wipe_mode,
+			recs[i].method, recs[i].seed, recs[i].key, recs[i].pass,
+			recs[i].cursor, recs[i].device) < 0 )
+		{
+			res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+		}
+	}
+	if ( (res == 0) && (fflush (f) != 0) )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+#if (defined HAVE_FSYNC) && (defined HAVE_UNISTD_H)
+	/* the new contents must be on the disk before the rename */
+	if ( (res == 0) && (fsync (fileno (f)) != 0) )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+#endif
+	if ( (fclose (f) != 0) && (res == 0) )
+	{
+		res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+	if ( res == 0 )
+	{
+		if ( rename (tmp_path, state_path) != 0 )
+		{
+			res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+		}
+	}
+	if ( res != 0 )
+	{
+		remove (tmp_path);
+	}
+	free (tmp_path);
+	return res;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_state_matches WFS_PARAMS ((
+	const wfs_state_rec_t * const rec, const wfs_fsid_t wfs_fs));
+#endif
+
+/**
+ * Checks if the given record was saved for the given filesystem, wiped
+ *	in the same way, with the same patterns in the same order.
+ * \param rec The record.
+ * \param wfs_fs The filesystem.
+ * \return 1 if the record can be used for the filesystem, 0 otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_state_matches (
+#ifdef WFS_ANSIC
+	const wfs_state_rec_t * const rec, const wfs_fsid_t wfs_fs)
+#else
+	rec, wfs_fs)
+	const wfs_state_rec_t * const rec;
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	enum wfs_method method;
+
+	method = wfs_get_method (wfs_fs);
+	if ( (rec->whichfs == (int) wfs_fs.whichfs)
+		&& (rec->npasses == wfs_fs.npasses)
+		&& (rec->zero_pass == wfs_fs.zero_pass)
+		&& (rec->wipe_mode == (int) wfs_fs.wipe_mode)
+		&& (rec->method == (int) method)
+		&& (rec->seed == wfs_get_seed (wfs_fs)) )
+	{
+		return 1;
+	}
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static size_t GCC_WARN_UNUSED_RESULT wfs_state_find WFS_PARAMS ((
+	const wfs_state_rec_t * const recs, const size_t count,
+	const wfs_fsid_t wfs_fs));
+#endif
+
+/**
+ * Finds the record of the given filesystem.
+ * \param recs The records.
+ * \param count The number of the records.
+ * \param wfs_fs The filesystem.
+ * \return The index of the record, 'count' if not found.
+ */
+static size_t GCC_WARN_UNUSED_RESULT
+wfs_state_find (
+#ifdef WFS_ANSIC
+	const wfs_state_rec_t * const recs, const size_t count,
+	const wfs_fsid_t wfs_fs)
+#else
+	recs, count, wfs_fs)
+	const wfs_state_rec_t * const recs;
+	const size_t count;
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	size_t i;
+
+	if ( (recs == NULL) || (wfs_fs.fsname == NULL) )
+	{
+		return count;
+	}
+	for ( i = 0; i < count; i++ )
+	{
+		if ( strcmp (recs[i].device, wfs_fs.fsname) == 0 )
+		{
+			return i;
+		}
+	}
+	return count;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_state_update WFS_PARAMS ((
+	const wfs_fsid_t wfs_fs, const wfs_state_phase_t phase,
+	const int keep_position, const unsigned long int key,
+	const unsigned long int pass, const wfs_blkno_t cursor));
+#endif
+
+/**
+ * Replaces (or adds) the record of the given filesystem in the state file.
+ * \param wfs_fs The filesystem.
+ * \param phase The stage being performed.
+ * \param keep_position If non-zero, the saved position is not changed
+ *	if the filesystem is already in the given stage.
+ * \param key The identifier of the free space.
+ * \param pass The pass being performed.
+ * \param cursor The block to start the pass at.
+ * \return 0 on success, an errno value otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_state_update (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const wfs_state_phase_t phase,
+	const int keep_position, const unsigned long int key,
+	const unsigned long int pass, const wfs_blkno_t cursor)
+#else
+	wfs_fs, phase, keep_position, key, pass, cursor)
+	const wfs_fsid_t wfs_fs;
+	const wfs_state_phase_t phase;
+	const int keep_position;
+	const unsigned long int key;
+	const unsigned long int pass;
+	const wfs_blkno_t cursor;
+#endif
+{
+	wfs_state_rec_t * recs;
+	wfs_state_rec_t * new_recs;
+	char * device;
+	size_t count;
+	size_t i;
+	int res;
+	enum wfs_method method;
+
+	if ( (state_path == NULL) || (wfs_fs.fsname == NULL) )
+	{
+		return 0;
+	}
+	/* read again - another process could have updated the file */
+	res = wfs_state_load (&recs, &count);
+	if ( res != 0 )
+	{
+		return res;
+	}
+	i = wfs_state_find (recs, count, wfs_fs);
+	if ( i == count )
+	{
+		device = (char *) malloc (strlen (wfs_fs.fsname) + 1);
+		if ( device == NULL )
+		{
+			wfs_state_free (recs, count);
+			return ENOMEM;
+		}
+		strcpy (device, wfs_fs.fsname);
+		new_recs = (wfs_state_rec_t *) realloc (recs,
+			(count + 1) * sizeof (wfs_state_rec_t));
+		if ( new_recs == NULL )
+		{
+			free (device);
+			wfs_state_free (recs, count);
+			return ENOMEM;
+		}
+		recs = new_recs;
+		recs[count].device = device;
+		recs[count].phase = WFS_STATE_NONE;
+		count++;
+	}
+	else if ( (keep_position != 0) && (recs[i].phase == phase)
+		&& (wfs_state_matches (&recs[i], wfs_fs) != 0) )
+	{
+		/* resuming this stage - nothing changes */
+		wfs_state_free (recs, count);
+		return 0;
+	}
+	recs[i].phase = phase;
+	recs[i].whichfs = (int) wfs_fs.whichfs;
+	recs[i].npasses = wfs_fs.npasses;
+	recs[i].zero_pass = wfs_fs.zero_pass;
+	recs[i].wipe_mode = (int) wfs_fs.wipe_mode;
+	method = wfs_get_method (wfs_fs);
+	recs[i].method = (int) method;
+	recs[i].seed = wfs_get_seed (wfs_fs);
+	recs[i].key = key;
+	recs[i].pass = pass;
+	recs[i].cursor = cursor;
+	res = wfs_state_store (recs, count);
+	wfs_state_free (recs, count);
+	return res;
+}
+
+/* ======================================================================== */
+
+/**
+ * Starts saving the progress of wiping to the given file. The file is
+ *	created, if needed, to check that it can be written.
+ * \param path The name of the state file, NULL to disable saving.
+ * \return 0 on success, an errno value otherwise.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_state_init (
+#ifdef WFS_ANSIC
+	const char * const path)
+#else
+	path)
+	const char * const path;
+#endif
+{
+	wfs_state_rec_t * recs;
+	size_t count;
+	int res;
+
+	state_path = path;
+	save_error = 0;
+	if ( path == NULL )
+	{
+		return 0;
+	}
+	res = wfs_state_load (&recs, &count);
+	if ( res == 0 )
+	{
+		res = wfs_state_store (recs, count);
+		wfs_state_free (recs, count);
+	}
+	if ( res != 0 )
+	{
+		state_path = NULL;
+	}
+	return res;
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells if the progress of wiping is being saved.
+ * \return non-zero if a state file is in use.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_state_is_enabled (WFS_VOID)
+{
+	return (state_path != NULL)? 1 : 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells at which stage the wiping of the given filesystem should start.
+ *	When resuming, the filesystem's wiping is given the saved seed, to
+ *	use the same patterns in the same order as before.
+ * \param wfs_fs The filesystem, already opened.
+ * \return The saved stage, if the filesystem's type and the wiping
+ *	parameters are the same as saved, WFS_STATE_NONE otherwise.
+ */
+wfs_state_phase_t GCC_WARN_UNUSED_RESULT
+wfs_state_start (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs)
+#else
+	wfs_fs)
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	wfs_state_rec_t * recs;
+	size_t count;
+	size_t i;
+	unsigned long int seed;
+	wfs_state_phase_t phase = WFS_STATE_NONE;
+
+	if ( state_path == NULL )
+	{
+		return WFS_STATE_NONE;
+	}
+	if ( wfs_state_load (&recs, &count) != 0 )
+	{
+		return WFS_STATE_NONE;
+	}
+	i = wfs_state_find (recs, count, wfs_fs);
+	if ( i < count )
+	{
+		seed = wfs_get_seed (wfs_fs);
+		wfs_set_seed (wfs_fs, recs[i].seed);
+		if ( wfs_state_matches (&recs[i], wfs_fs) != 0 )
+		{
+			phase = recs[i].phase;
+		}
+		else
+		{
+			/* not resuming - back to this run's own patterns */
+			wfs_set_seed (wfs_fs, seed);
+		}
+	}
+	wfs_state_free (recs, count);
+	return phase;
+}
+
+/* ======================================================================== */
+
+/**
+ * Saves the stage being started on the given filesystem. If the saved
+ *	stage is the same, the saved position within it is kept.
+ * \param wfs_fs The filesystem.
+ * \param phase The stage being started.
+ * \return 0 on success, an errno value otherwise.
+ */
+int
+wfs_state_set_phase (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const wfs_state_phase_t phase)
+#else
+	wfs_fs, phase)
+	const wfs_fsid_t wfs_fs;
+	const wfs_state_phase_t phase;
+#endif
+{
+	return wfs_state_update (wfs_fs, phase, 1, 0, 0, 0);
+}
+
+/* ======================================================================== */
+
+/**
+ * Gets the saved position in the free space of the given filesystem.
+ * \param wfs_fs The filesystem.
+ * \param key The identifier of the filesystem's current free space.
+ * \param pass Pointer to the pass to start with, filled here.
+ * \param cursor Pointer to the block to start the pass at, filled here.
+ * \return 1 if a position was saved for the same free space, 0 otherwise.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_state_get_position (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const unsigned long int key,
+	unsigned long int * const pass, wfs_blkno_t * const cursor)
+#else
+	wfs_fs, key, pass, cursor)
+	const wfs_fsid_t wfs_fs;
+	const unsigned long int key;
+	unsigned long int * const pass;
+	wfs_blkno_t * const cursor;
+#endif
+{
+	wfs_state_rec_t * recs;
+	size_t count;
+	size_t i;
+	int found = 0;
+
+	if ( (state_path == NULL) || (pass == NULL) || (cursor == NULL) )
+	{
+		return 0;
+	}
+	if ( wfs_state_load (&recs, &count) != 0 )
+	{
+		return 0;
+	}
+	i = wfs_state_find (recs, count, wfs_fs);
+	if ( (i < count) && (wfs_state_matches (&recs[i], wfs_fs) != 0)
+		&& (recs[i].phase == WFS_STATE_WFS) && (recs[i].key == key)
+		&& (key != 0) )
+	{
+		*pass = recs[i].pass;
+		*cursor = recs[i].cursor;
+		found = 1;
+	}
+	wfs_state_free (recs, count);
+	return found;
+}
+
+/* ======================================================================== */
+
+/**
+ * Saves the position in the free space of the given filesystem.
+ * \param wfs_fs The filesystem.
+ * \param key The identifier of the filesystem's free space.
+ * \param pass The pass being performed.
+ * \param cursor The block to start the pass at, when resuming.
+ * \return 0 on success, an errno value otherwise.
+ */
+int
+wfs_state_save_position (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const unsigned long int key,
+	const unsigned long int pass, const wfs_blkno_t cursor)
+#else
+	wfs_fs, key, pass, cursor)
+	const wfs_fsid_t wfs_fs;
+	const unsigned long int key;
+	const unsigned long int pass;
+	const wfs_blkno_t cursor;
+#endif
+{
+	int res;
+
+	res = wfs_state_update (wfs_fs, WFS_STATE_WFS, 0, key, pass, cursor);
+	if ( (res != 0) && (save_error == 0) )
+	{
+		save_error = res;
+	}
+	return res;
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells if saving the position in the free space has failed since the last
+ *	call. The position is saved while wiping, where it can't be shown.
+ * \return The errno value of the first failure, 0 if there were none.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_state_get_save_error (WFS_VOID)
+{
+	int res;
+
+	res = save_error;
+	save_error = 0;
+	return res;
+}
+
+/* ======================================================================== */
+
+/**
+ * Stops saving the progress of wiping. The state file is removed if all
+ *	the filesystems in it have been wiped completely.
+ * \return 0 on success, an errno value otherwise.
+ */
+int
+wfs_state_finish (WFS_VOID)
+{
+	wfs_state_rec_t * recs;
+	size_t count;
+	size_t i;
+	int res;
+
+	if ( state_path == NULL )
+	{
+		return 0;
+	}
+	res = wfs_state_load (&recs, &count);
+	if ( res == 0 )
+	{
+		for ( i = 0; i < count; i++ )
+		{
+			if ( recs[i].phase != WFS_STATE_DONE )
+			{
+				break;
+			}
+		}
+		if ( i == count )
+		{
+			WFS_SET_ERRNO (0);
+			if ( remove (state_path) != 0 )
+			{
+				res = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+			}
+		}
+		wfs_state_free (recs, count);
+	}
+	state_path = NULL;
+	return res;
+}
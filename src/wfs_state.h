@@ -0,0 +1,76 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- saving and restoring the progress of wiping, header file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WFS_STATE_H
+# define WFS_STATE_H 1
+
+# include "wipefreespace.h"
+# include "wfs_extents.h"
+
+# ifdef WFS_STATE_INTERVAL
+#  undef WFS_STATE_INTERVAL
+# endif
+
+/* the number of seconds between saving the position in the free space */
+# define	WFS_STATE_INTERVAL 30
+
+/* The stages of wiping a filesystem, in the order they are performed */
+enum wfs_state_phase
+{
+	WFS_STATE_NONE = 0,
+	WFS_STATE_UNRM,
+	WFS_STATE_PART,
+	WFS_STATE_WFS,
+	WFS_STATE_DONE
+};
+
+typedef enum wfs_state_phase wfs_state_phase_t;
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_state_init WFS_PARAMS ((const char * const path));
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_state_is_enabled WFS_PARAMS ((void));
+
+extern wfs_state_phase_t GCC_WARN_UNUSED_RESULT
+	wfs_state_start WFS_PARAMS ((const wfs_fsid_t wfs_fs));
+
+extern int
+	wfs_state_set_phase WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		const wfs_state_phase_t phase));
+
+extern int GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
+	wfs_state_get_position WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		const unsigned long int key, unsigned long int * const pass,
+		wfs_blkno_t * const cursor));
+
+extern int
+	wfs_state_save_position WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		const unsigned long int key, const unsigned long int pass,
+		const wfs_blkno_t cursor));
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_state_get_save_error WFS_PARAMS ((void));
+
+extern int
+	wfs_state_finish WFS_PARAMS ((void));
+
+#endif	/* WFS_STATE_H */
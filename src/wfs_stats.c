@@ -0,0 +1,492 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- timing and I/O statistics of the stages of wiping.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_cfg.h"
+
+#include <stdio.h>	/* printf(), sprintf() */
+
+#ifdef HAVE_STRING_H
+# if ((!defined STDC_HEADERS) || (!STDC_HEADERS)) && (defined HAVE_MEMORY_H)
+#  include <memory.h>
+# endif
+# include <string.h>	/* memset() */
+#endif
+
+#ifdef HAVE_LIBINTL_H
+# include <libintl.h>	/* translation stuff */
+#endif
+
+#include "wipefreespace.h"
+#include "wfs_stats.h"
+#include "wfs_progress.h"
+#include "wfs_util.h"
+
+/* the maximum length of the fields of a statistics record */
+#define WFS_STATS_RECORD 1024
+
+#if (defined HAVE_LONG_LONG) || (defined HAVE_LONG_LONG_INT)
+# define WFS_BLKNO_FORMAT "%llu"
+# define WFS_BLKNO_COLUMN " %14llu"
+#else
+# define WFS_BLKNO_FORMAT "%lu"
+# define WFS_BLKNO_COLUMN " %14lu"
+#endif
+
+/* The statistics of one stage */
+struct wfs_stats_data
+{
+	unsigned long int	runs;		/* how many times the stage
+						   was entered */
+	double			time;		/* the wall time of the stage */
+	double			read_time;	/* the time spent reading */
+	double			write_time;	/* the time spent writing */
+	double			sync_time;	/* the time spent synchronizing */
+	double			fill_time;	/* the time spent generating
+						   the patterns */
+	wfs_blkno_t		bytes_read;
+	wfs_blkno_t		bytes_written;
+	unsigned long int	reads;		/* the number of read requests */
+	unsigned long int	writes;		/* the number of write requests */
+	unsigned long int	syncs;		/* the number of synchronizations */
+	unsigned long int	latency[WFS_STATS_BUCKETS];
+						/* the write latency histogram */
+};
+
+typedef struct wfs_stats_data wfs_stats_data_t;
+
+/* The statistics of the current filesystem */
+struct wfs_stats_state
+{
+	int			enabled;	/* whether the statistics
+						   are collected */
+	const char *		device;		/* the filesystem's device */
+	int			current;	/* the current stage, -1 if
+						   none */
+	double			start;		/* the current stage's
+						   starting time */
+	wfs_stats_data_t	phases[WFS_STATS_PHASES];
+};
+
+typedef struct wfs_stats_state wfs_stats_state_t;
+
+static const char * const wfs_stats_phase_names[] =
+{
+	"open", "check", "flush", "unrm", "part", "wfs", "close"
+};
+
+static const char * const msg_stats = N_("Statistics of the stages");
+static const char * const msg_stats_header = N_("stage       time (s)    I/O (s)   fill (s)  other (s)       read (B)    written (B)    reads   writes  syncs");
+static const char * const msg_latency = N_("Write latency (microseconds: requests) of stage");
+
+static wfs_stats_state_t stats;
+
+#if (defined TEST_COMPILE) && (defined WFS_ANSIC)
+# undef WFS_ANSIC
+#endif
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static unsigned int GCC_WARN_UNUSED_RESULT wfs_stats_bucket
+	WFS_PARAMS ((const double seconds));
+#endif
+
+/**
+ * Finds the latency histogram bucket for the given time: bucket 0 is for
+ *	times below 1 microsecond, bucket N (N > 0) is for times from 2^(N-1)
+ *	up to 2^N microseconds, the last one also for all longer times.
+ * \param seconds The time.
+ * \return the number of the bucket.
+ */
+static unsigned int GCC_WARN_UNUSED_RESULT
+wfs_stats_bucket (
+#ifdef WFS_ANSIC
+	const double seconds)
+#else
+	seconds)
+	const double seconds;
+#endif
+{
+	double usecs = seconds * 1000000.0;
+	unsigned int bucket = 0;
+
+	while ( (usecs >= 1.0) && (bucket < WFS_STATS_BUCKETS - 1) )
+	{
+		usecs /= 2.0;
+		bucket++;
+	}
+	return bucket;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_stats_emit WFS_PARAMS ((const int phase));
+#endif
+
+/**
+ * Writes the statistics of a stage to the progress records, if enabled.
+ * \param phase The stage.
+ */
+static void
+wfs_stats_emit (
+#ifdef WFS_ANSIC
+	const int phase)
+#else
+	phase)
+	const int phase;
+#endif
+{
+	const wfs_stats_data_t * const data = &(stats.phases[phase]);
+	char hist[WFS_STATS_RECORD / 2];
+	char json[WFS_STATS_RECORD];
+	char text[WFS_STATS_RECORD];
+	unsigned int i;
+	int len;
+	int pos = 0;
+
+	if ( wfs_progress_is_enabled () == 0 )
+	{
+		return;
+	}
+	hist[0] = '\0';
+	for ( i = 0; i < WFS_STATS_BUCKETS; i++ )
+	{
+		len = sprintf (&hist[pos], (i == 0)? "%lu" : ",%lu",
+			data->latency[i]);
+		if ( len <= 0 )
+		{
+			return;
+		}
+		pos += len;
+	}
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+	len = snprintf (json, sizeof (json),
+#else
+	len = sprintf (json,
+#endif
+		"\"stats\":\"%s\",\"time_s\":%.6f,\"read_s\":%.6f,"
+		"\"write_s\":%.6f,\"sync_s\":%.6f,\"fill_s\":%.6f,"
+		"\"bytes_read\":" WFS_BLKNO_FORMAT ",\"bytes_written\":"
+		WFS_BLKNO_FORMAT ",\"reads\":%lu,\"writes\":%lu,\"syncs\":%lu,"
+		"\"write_latency_us_log2\":[%s]",
+		wfs_stats_phase_names[phase], data->time, data->read_time,
+		data->write_time, data->sync_time, data->fill_time,
+		data->bytes_read, data->bytes_written, data->reads,
+		data->writes, data->syncs, hist);
+	if ( (len <= 0) || (len >= (int) sizeof (json)) )
+	{
+		return;
+	}
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+	len = snprintf (text, sizeof (text),
+#else
+	len = sprintf (text,
+#endif
+		"stats=%s time_s=%.6f read_s=%.6f write_s=%.6f sync_s=%.6f"
+		" fill_s=%.6f read=" WFS_BLKNO_FORMAT " written="
+		WFS_BLKNO_FORMAT " reads=%lu writes=%lu syncs=%lu"
+		" latency_us_log2=%s",
+		wfs_stats_phase_names[phase], data->time, data->read_time,
+		data->write_time, data->sync_time, data->fill_time,
+		data->bytes_read, data->bytes_written, data->reads,
+		data->writes, data->syncs, hist);
+	if ( (len <= 0) || (len >= (int) sizeof (text)) )
+	{
+		return;
+	}
+	wfs_progress_record (json, text);
+}
+
+/* ======================================================================== */
+
+/**
+ * Starts collecting the statistics.
+ */
+void
+wfs_stats_init (WFS_VOID)
+{
+	stats.enabled = 1;
+	stats.current = -1;
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells if the statistics are collected.
+ * \return non-zero if the statistics are collected.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_stats_is_enabled (WFS_VOID)
+{
+	return stats.enabled;
+}
+
+/* ======================================================================== */
+
+/**
+ * Sets the filesystem the next statistics are about and clears the
+ *	statistics.
+ * \param wfs_fs The filesystem.
+ */
+void
+wfs_stats_set_fs (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs)
+#else
+	wfs_fs)
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	if ( stats.enabled == 0 )
+	{
+		return;
+	}
+	WFS_MEMSET (stats.phases, 0, sizeof (stats.phases));
+	stats.device = (wfs_fs.fsname != NULL)? wfs_fs.fsname : "";
+	stats.current = -1;
+}
+
+/* ======================================================================== */
+
+/**
+ * Starts measuring a stage. A stage can be entered many times, the
+ *	statistics of all the times are added.
+ * \param phase The stage.
+ */
+void
+wfs_stats_begin (
+#ifdef WFS_ANSIC
+	const wfs_stats_phase_t phase)
+#else
+	phase)
+	const wfs_stats_phase_t phase;
+#endif
+{
+	if ( stats.enabled == 0 )
+	{
+		return;
+	}
+	if ( stats.current >= 0 )
+	{
+		wfs_stats_end ();
+	}
+	stats.current = (int) phase;
+	stats.start = wfs_get_time ();
+}
+
+/* ======================================================================== */
+
+/**
+ * Stops measuring the current stage and writes its statistics to
+ *	the progress records, if enabled.
+ */
+void
+wfs_stats_end (WFS_VOID)
+{
+	wfs_stats_data_t * data;
+
+	if ( (stats.enabled == 0) || (stats.current < 0) )
+	{
+		return;
+	}
+	data = &(stats.phases[stats.current]);
+	data->time += wfs_get_time () - stats.start;
+	data->runs++;
+	wfs_stats_emit (stats.current);
+	stats.current = -1;
+}
+
+/* ======================================================================== */
+
+/**
+ * Counts a read request in the current stage.
+ * \param bytes The number of bytes read.
+ * \param seconds The time the request took.
+ */
+void
+wfs_stats_add_read (
+#ifdef WFS_ANSIC
+	const wfs_blkno_t bytes, const double seconds)
+#else
+	bytes, seconds)
+	const wfs_blkno_t bytes;
+	const double seconds;
+#endif
+{
+	if ( (stats.enabled == 0) || (stats.current < 0) )
+	{
+		return;
+	}
+	stats.phases[stats.current].bytes_read += bytes;
+	stats.phases[stats.current].read_time += seconds;
+	stats.phases[stats.current].reads++;
+}
+
+/* ======================================================================== */
+
+/**
+ * Counts a write request in the current stage.
+ * \param bytes The number of bytes written.
+ * \param seconds The time the request took.
+ */
+void
+wfs_stats_add_write (
+#ifdef WFS_ANSIC
+	const wfs_blkno_t bytes, const double seconds)
+#else
+	bytes, seconds)
+	const wfs_blkno_t bytes;
+	const double seconds;
+#endif
+{
+	if ( (stats.enabled == 0) || (stats.current < 0) )
+	{
+		return;
+	}
+	stats.phases[stats.current].bytes_written += bytes;
+	stats.phases[stats.current].write_time += seconds;
+	stats.phases[stats.current].writes++;
+	stats.phases[stats.current].latency[wfs_stats_bucket (seconds)]++;
+}
+
+/* ======================================================================== */
+
+/**
+ * Counts a synchronization of the written data in the current stage.
+ * \param seconds The time the synchronization took.
+ */
+void
+wfs_stats_add_sync (
+#ifdef WFS_ANSIC
+	const double seconds)
+#else
+	seconds)
+	const double seconds;
+#endif
+{
+	if ( (stats.enabled == 0) || (stats.current < 0) )
+	{
+		return;
+	}
+	stats.phases[stats.current].sync_time += seconds;
+	stats.phases[stats.current].syncs++;
+}
+
+/* ======================================================================== */
+
+/**
+ * Counts the time spent generating a wiping pattern in the current stage.
+ * \param seconds The time.
+ */
+void
+wfs_stats_add_fill (
+#ifdef WFS_ANSIC
+	const double seconds)
+#else
+	seconds)
+	const double seconds;
+#endif
+{
+	if ( (stats.enabled == 0) || (stats.current < 0) )
+	{
+		return;
+	}
+	stats.phases[stats.current].fill_time += seconds;
+}
+
+/* ======================================================================== */
+
+/**
+ * Displays the statistics of the stages performed on the current
+ *	filesystem: a table of times and counters, followed by the write
+ *	latency histograms.
+ */
+void
+wfs_stats_report (WFS_VOID)
+{
+	const wfs_stats_data_t * data;
+	double io_time;
+	double other_time;
+	unsigned int i;
+	unsigned int b;
+
+	if ( (stats.enabled == 0) || (wfs_is_stdout_open () == 0) )
+	{
+		return;
+	}
+	wfs_stats_end ();
+	printf ("%s:%s: %s:\n  %s\n", wfs_get_program_name (),
+		stats.device, _(msg_stats), _(msg_stats_header));
+	for ( i = 0; i < WFS_STATS_PHASES; i++ )
+	{
+		data = &(stats.phases[i]);
+		if ( data->runs == 0 )
+		{
+			continue;
+		}
+		io_time = data->read_time + data->write_time + data->sync_time;
+		/* the rest is the backend's work, like reading the metadata */
+		other_time = data->time - io_time - data->fill_time;
+		if ( other_time < 0.0 )
+		{
+			other_time = 0.0;
+		}
+		printf ("  %-6s %13.3f %10.3f %10.3f %10.3f" WFS_BLKNO_COLUMN
+			WFS_BLKNO_COLUMN " %8lu %8lu %6lu\n",
+			wfs_stats_phase_names[i], data->time, io_time,
+			data->fill_time, other_time, data->bytes_read,
+			data->bytes_written, data->reads, data->writes,
+			data->syncs);
+	}
+	for ( i = 0; i < WFS_STATS_PHASES; i++ )
+	{
+		data = &(stats.phases[i]);
+		if ( data->writes == 0 )
+		{
+			continue;
+		}
+		printf ("%s:%s: %s '%s':\n", wfs_get_program_name (),
+			stats.device, _(msg_latency), wfs_stats_phase_names[i]);
+		for ( b = 0; b < WFS_STATS_BUCKETS; b++ )
+		{
+			if ( data->latency[b] == 0 )
+			{
+				continue;
+			}
+			if ( b == 0 )
+			{
+				printf ("  [0, 1): %lu\n", data->latency[b]);
+			}
+			else if ( b == WFS_STATS_BUCKETS - 1 )
+			{
+				printf ("  [%lu, -): %lu\n", 1UL << (b - 1),
+					data->latency[b]);
+			}
+			else
+			{
+				printf ("  [%lu, %lu): %lu\n", 1UL << (b - 1),
+					1UL << b, data->latency[b]);
+			}
+		}
+	}
+	fflush (stdout);
+}
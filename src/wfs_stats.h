@@ -0,0 +1,83 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- timing and I/O statistics of the stages of wiping, header file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users.sourceforge.net
+ * License: GNU General Public License, v2+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WFS_STATS_H
+# define WFS_STATS_H 1
+
+# include "wipefreespace.h"
+# include "wfs_extents.h"
+
+# ifdef WFS_STATS_BUCKETS
+#  undef WFS_STATS_BUCKETS
+# endif
+
+/* the number of buckets in the write latency histograms: below 1us,
+   then one per power of 2 of microseconds, the last one is open-ended */
+# define	WFS_STATS_BUCKETS 26
+
+/* The stages of working on a filesystem the statistics are kept for */
+enum wfs_stats_phase
+{
+	WFS_STATS_OPEN,
+	WFS_STATS_CHECK,
+	WFS_STATS_FLUSH,
+	WFS_STATS_UNRM,
+	WFS_STATS_PART,
+	WFS_STATS_WFS,
+	WFS_STATS_CLOSE,
+	WFS_STATS_PHASES
+};
+
+typedef enum wfs_stats_phase wfs_stats_phase_t;
+
+extern void
+	wfs_stats_init WFS_PARAMS ((void));
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_stats_is_enabled WFS_PARAMS ((void));
+
+extern void
+	wfs_stats_set_fs WFS_PARAMS ((const wfs_fsid_t wfs_fs));
+
+extern void
+	wfs_stats_begin WFS_PARAMS ((const wfs_stats_phase_t phase));
+
+extern void
+	wfs_stats_end WFS_PARAMS ((void));
+
+extern void
+	wfs_stats_add_read WFS_PARAMS ((const wfs_blkno_t bytes,
+		const double seconds));
+
+extern void
+	wfs_stats_add_write WFS_PARAMS ((const wfs_blkno_t bytes,
+		const double seconds));
+
+extern void
+	wfs_stats_add_sync WFS_PARAMS ((const double seconds));
+
+extern void
+	wfs_stats_add_fill WFS_PARAMS ((const double seconds));
+
+extern void
+	wfs_stats_report WFS_PARAMS ((void));
+
+#endif	/* WFS_STATS_H */
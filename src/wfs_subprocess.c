@@ -58,6 +58,15 @@
 # include <sched.h>
 #endif
 
+/* posix_spawnp() takes the same environment as execvpe(), so use it only
+   where the child would get the same environment. The child is waited for
+   like a forked one, so use it only where fork() would be used. */
+#if (defined HAVE_SPAWN_H) && (defined HAVE_POSIX_SPAWNP) && (defined HAVE_EXECVPE) \
+	&& (defined HAVE_WORKING_FORK)
+# include <spawn.h>
+# define WFS_USE_SPAWN 1
+#endif
+
 #include "wipefreespace.h"
 #include "wfs_subprocess.h"
 
@@ -83,9 +92,10 @@
 
 /* ======================================================================== */
 
-#ifndef WFS_ANSIC
+#ifndef WFS_USE_SPAWN
+# ifndef WFS_ANSIC
 static void * child_function WFS_PARAMS ((void * p));
-#endif
+# endif
 
 /*
  * The child function called after successful creating a child process.
@@ -252,8 +262,101 @@ child_function (
 	}
 	*return WFS_EXECERR;*/
 }
+#endif /* ! WFS_USE_SPAWN */
+
+/* ======================================================================== */
+
+#ifdef WFS_USE_SPAWN
+# ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_spawn_redirect WFS_PARAMS ((
+	posix_spawn_file_actions_t * const actions, const int fd,
+	const int target));
+# endif
+
+/**
+ * Adds redirecting one of the standard descriptors of the child to the
+ *	actions performed when starting it.
+ * \param actions The actions to add to.
+ * \param fd The descriptor to redirect to, -1 means closing the standard one.
+ * \param target The standard descriptor to redirect.
+ * \return 0 on success, an error code otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT
+wfs_spawn_redirect (
+# ifdef WFS_ANSIC
+	posix_spawn_file_actions_t * const actions, const int fd,
+	const int target)
+# else
+	actions, fd, target)
+	posix_spawn_file_actions_t * const actions;
+	const int fd;
+	const int target;
+# endif
+{
+	if ( fd != -1 )
+	{
+		return posix_spawn_file_actions_adddup2 (actions, fd, target);
+	}
+	return posix_spawn_file_actions_addclose (actions, target);
+}
+
+/* ======================================================================== */
+
+# ifndef WFS_ANSIC
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_spawn_child WFS_PARAMS ((
+	child_id_t * const id));
+# endif
+
+/**
+ * Launches a child process with posix_spawnp(), which doesn't copy
+ *	the memory of this process, like fork() does, before running the program.
+ * \param id A structure describing the child process to create.
+ * \return WFS_SUCCESS on success, other values otherwise.
+ */
+static wfs_errcode_t GCC_WARN_UNUSED_RESULT
+wfs_spawn_child (
+# ifdef WFS_ANSIC
+	child_id_t * const id)
+# else
+	id )
+	child_id_t * const id;
+# endif
+{
+	posix_spawn_file_actions_t actions;
+	char * null_env[] = { NULL };
+	int res;
+
+	if ( posix_spawn_file_actions_init (&actions) != 0 )
+	{
+		return WFS_FORKERR;
+	}
+	res = wfs_spawn_redirect (&actions, id->stdin_fd, STDIN_FILENO);
+	if ( res == 0 )
+	{
+		res = wfs_spawn_redirect (&actions, id->stdout_fd, STDOUT_FILENO);
+	}
+	if ( res == 0 )
+	{
+		res = wfs_spawn_redirect (&actions, id->stderr_fd, STDERR_FILENO);
+	}
+	if ( res == 0 )
+	{
+		res = posix_spawnp (&(id->chld_id.chld_pid), id->program_name,
+			&actions, NULL, id->args,
+			(id->child_env != NULL)? id->child_env : null_env);
+	}
+	posix_spawn_file_actions_destroy (&actions);
+	if ( res != 0 )
+	{
+		return WFS_FORKERR;
+	}
+	/* a child process, waited for just like a forked one */
+	id->type = CHILD_FORK;
+	return WFS_SUCCESS;
+}
 
 /* ======================================================================== */
+#endif /* WFS_USE_SPAWN */
 
 /**
  * Launches a child process that runs the given program with the given arguments,
@@ -279,6 +382,9 @@ wfs_create_child (
 	}
 
 #ifdef HAVE_WORKING_FORK /* HAVE_FORK */
+# ifdef WFS_USE_SPAWN
+	return wfs_spawn_child (id);
+# else
 	id->chld_id.chld_pid = fork ();
 	if ( id->chld_id.chld_pid < 0 )
 	{
@@ -298,6 +404,7 @@ wfs_create_child (
 		id->type = CHILD_FORK;
 		return WFS_SUCCESS;
 	}
+# endif /* WFS_USE_SPAWN */
 #else
 	/* PThreads shouldn't be used, because an exit() in a thread causes the whole
 	   program to be closed. Besides, there is no portable way to check if a thread
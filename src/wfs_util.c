@@ -56,6 +56,21 @@
 # include <sys/stat.h>
 #endif
 
+#ifdef MAJOR_IN_MKDEV
+# include <sys/mkdev.h>
+#else
+# if defined MAJOR_IN_SYSMACROS
+#  include <sys/sysmacros.h>
+# else /* ! MAJOR_IN_SYSMACROS */
+#  ifdef HAVE_SYS_SYSMACROS_H
+#   include <sys/sysmacros.h>
+#  endif
+#  ifdef HAVE_SYS_MKDEV_H
+#   include <sys/mkdev.h>
+#  endif
+# endif /* MAJOR_IN_SYSMACROS */
+#endif
+
 #if (defined HAVE_FCNTL_H) && (defined HAVE_SYS_IOCTL_H)
 # include <fcntl.h>     /* O_RDWR, open() for ioctl() */
 # include <sys/ioctl.h>
@@ -75,6 +90,22 @@
 # endif
 #endif
 
+#ifdef HAVE_SYS_TIME_H
+# include <sys/time.h>	/* gettimeofday() */
+#endif
+
+#ifdef HAVE_TIME_H
+# include <time.h>	/* nanosleep() */
+#endif
+
+#ifdef HAVE_SYS_RESOURCE_H
+# include <sys/resource.h>	/* setpriority() */
+#endif
+
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>	/* SYS_ioprio_set */
+#endif
+
 #ifdef HAVE_LIBINTL_H
 # include <libintl.h>	/* translation stuff */
 #endif
@@ -92,6 +123,14 @@
 # define WFS_USED_ONLY_WITH_IOCTL
 #endif
 
+/* the values from the kernel's ioprio.h, not always installed */
+#define WFS_IOPRIO_WHO_PROCESS		1
+#define WFS_IOPRIO_CLASS_IDLE		3
+#define WFS_IOPRIO_CLASS_SHIFT		13
+
+/* the lowest CPU scheduling priority */
+#define WFS_NICE_IDLE			19
+
 #if (defined TEST_COMPILE) && (defined WFS_ANSIC)
 # undef WFS_ANSIC
 #endif
@@ -537,6 +576,408 @@ wfs_flush_pipe_input (
 
 /* ======================================================================== */
 
+/**
+ * Makes the data written to the given file descriptor reach the media,
+ *	without writing out the file's metadata, if possible.
+ * @param fd The file descriptor to synchronize.
+ * @return 0 in case of no errors, an errno value otherwise.
+ */
+int
+wfs_sync_fd (
+#ifdef WFS_ANSIC
+	const int fd)
+#else
+	fd )
+	const int fd;
+#endif
+{
+	int res = 0;
+
+	WFS_SET_ERRNO (0);
+#ifdef HAVE_FDATASYNC
+	res = fdatasync (fd);
+#else
+# ifdef HAVE_FSYNC
+	res = fsync (fd);
+# else
+#  ifdef HAVE_SYNC
+	sync ();
+#  endif
+	if ( fd < 0 )
+	{
+		res = -1;
+	}
+# endif
+#endif
+	if ( res != 0 )
+	{
+		return WFS_GET_ERRNO_OR_DEFAULT (EIO);
+	}
+	return 0;
+}
+
+/* ======================================================================== */
+
+/**
+ * Sets the UUID of the given filesystem, read from its superblock, as text.
+ *	A 16-byte UUID gets the dashes of the usual form, shorter serial
+ *	numbers are just the hexadecimal digits.
+ * @param wfs_fs The filesystem.
+ * @param uuid The bytes of the UUID, in the order they are shown.
+ * @param len The number of the bytes, at most 16. A UUID with all the
+ *	bytes zero is not set, as it doesn't identify anything.
+ */
+void
+wfs_set_uuid (
+#ifdef WFS_ANSIC
+	wfs_fsid_t * const wfs_fs, const unsigned char * const uuid,
+	const size_t len)
+#else
+	wfs_fs, uuid, len)
+	wfs_fsid_t * const wfs_fs;
+	const unsigned char * const uuid;
+	const size_t len;
+#endif
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t i;
+	size_t pos = 0;
+
+	if ( wfs_fs == NULL )
+	{
+		return;
+	}
+	wfs_fs->fs_uuid[0] = '\0';
+	if ( (uuid == NULL) || (len == 0) || (len > 16)
+		|| (wfs_is_block_zero (uuid, len) != 0) )
+	{
+		return;
+	}
+	for ( i = 0; i < len; i++ )
+	{
+		if ( (len == 16) && ((i == 4) || (i == 6) || (i == 8) || (i == 10)) )
+		{
+			wfs_fs->fs_uuid[pos++] = '-';
+		}
+		wfs_fs->fs_uuid[pos++] = hex[(uuid[i] >> 4) & 0x0F];
+		wfs_fs->fs_uuid[pos++] = hex[uuid[i] & 0x0F];
+	}
+	wfs_fs->fs_uuid[pos] = '\0';
+}
+
+/* ======================================================================== */
+
+/**
+ * Makes the current process (and its future children) use the disks and the
+ *	processor only when no-one else wants to, so that the wiping does not
+ *	slow down other programs.
+ * @return 0 in case of no errors, an errno value otherwise.
+ */
+int
+wfs_set_idle_priority (WFS_VOID)
+{
+	int ret = 0;
+
+#if (defined HAVE_SYSCALL) && (defined SYS_ioprio_set)
+	WFS_SET_ERRNO (0);
+	if ( syscall (SYS_ioprio_set, WFS_IOPRIO_WHO_PROCESS, 0,
+		WFS_IOPRIO_CLASS_IDLE << WFS_IOPRIO_CLASS_SHIFT) != 0 )
+	{
+		ret = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+#else
+	ret = ENOSYS;
+#endif
+#if (defined HAVE_SETPRIORITY) && (defined HAVE_SYS_RESOURCE_H)
+	WFS_SET_ERRNO (0);
+	if ( (setpriority (PRIO_PROCESS, 0, WFS_NICE_IDLE) != 0) && (ret == 0) )
+	{
+		ret = WFS_GET_ERRNO_OR_DEFAULT (EPERM);
+	}
+#endif
+	return ret;
+}
+
+/* ======================================================================== */
+
+/**
+ * Gets the current time.
+ * @return the current time, in seconds.
+ */
+double
+wfs_get_time (WFS_VOID)
+{
+#if (defined HAVE_GETTIMEOFDAY) && (defined HAVE_SYS_TIME_H)
+	struct timeval tv;
+#endif
+	time_t now;
+
+#if (defined HAVE_GETTIMEOFDAY) && (defined HAVE_SYS_TIME_H)
+	if ( gettimeofday (&tv, NULL) == 0 )
+	{
+		return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+	}
+#endif
+	now = time (NULL);
+	return (double) now;
+}
+
+/* ======================================================================== */
+
+/**
+ * Initializes a token bucket which limits the rate of writing.
+ * @param limit The bucket to initialize.
+ * @param max_rate The maximum number of bytes per second, 0 means no limit.
+ * @param max_iops The maximum number of writes per second, 0 means no limit.
+ */
+void
+wfs_rate_limit_init (
+#ifdef WFS_ANSIC
+	wfs_rate_limit_t * const limit, const unsigned long int max_rate,
+	const unsigned long int max_iops)
+#else
+	limit, max_rate, max_iops)
+	wfs_rate_limit_t * const limit;
+	const unsigned long int max_rate;
+	const unsigned long int max_iops;
+#endif
+{
+	if ( limit == NULL )
+	{
+		return;
+	}
+	limit->max_rate = max_rate;
+	limit->max_iops = max_iops;
+	/* the bucket starts full: one second's worth */
+	limit->byte_tokens = (double) max_rate;
+	limit->io_tokens = (double) max_iops;
+	limit->last = 0.0;
+	if ( (max_rate != 0) || (max_iops != 0) )
+	{
+		limit->last = wfs_get_time ();
+	}
+}
+
+/* ======================================================================== */
+
+/**
+ * Takes one write of the given size from the token bucket, waiting until
+ *	the write fits in the rate limits. The unused limit accumulates for
+ *	at most one second.
+ * @param limit The bucket to use.
+ * @param bytes The number of bytes about to be written.
+ */
+void
+wfs_rate_limit_wait (
+#ifdef WFS_ANSIC
+	wfs_rate_limit_t * const limit, const size_t bytes)
+#else
+	limit, bytes)
+	wfs_rate_limit_t * const limit;
+	const size_t bytes;
+#endif
+{
+	double now;
+	double elapsed;
+	double wait = 0.0;
+#if (defined HAVE_NANOSLEEP) && (defined HAVE_TIME_H)
+	struct timespec ts;
+#endif
+
+	if ( limit == NULL )
+	{
+		return;
+	}
+	if ( (limit->max_rate == 0) && (limit->max_iops == 0) )
+	{
+		return;
+	}
+	now = wfs_get_time ();
+	elapsed = now - limit->last;
+	if ( elapsed < 0.0 )
+	{
+		elapsed = 0.0;
+	}
+	limit->last = now;
+	if ( limit->max_rate != 0 )
+	{
+		limit->byte_tokens += elapsed * (double) limit->max_rate;
+		if ( limit->byte_tokens > (double) limit->max_rate )
+		{
+			limit->byte_tokens = (double) limit->max_rate;
+		}
+		limit->byte_tokens -= (double) bytes;
+		if ( limit->byte_tokens < 0.0 )
+		{
+			wait = -limit->byte_tokens / (double) limit->max_rate;
+		}
+	}
+	if ( limit->max_iops != 0 )
+	{
+		limit->io_tokens += elapsed * (double) limit->max_iops;
+		if ( limit->io_tokens > (double) limit->max_iops )
+		{
+			limit->io_tokens = (double) limit->max_iops;
+		}
+		limit->io_tokens -= 1.0;
+		if ( (limit->io_tokens < 0.0)
+			&& (-limit->io_tokens / (double) limit->max_iops > wait) )
+		{
+			wait = -limit->io_tokens / (double) limit->max_iops;
+		}
+	}
+	if ( wait <= 0.0 )
+	{
+		return;
+	}
+	/* the tokens used while sleeping are added back on the next call */
+#if (defined HAVE_NANOSLEEP) && (defined HAVE_TIME_H)
+	ts.tv_sec = (time_t) wait;
+	ts.tv_nsec = (long int) ((wait - (double) ts.tv_sec) * 1000000000.0);
+	nanosleep (&ts, NULL);
+#else
+# ifdef HAVE_SLEEP
+	sleep ((unsigned int) wait + 1);
+# endif
+#endif
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int wfs_read_queue_value WFS_PARAMS ((const unsigned int dev_major,
+	const unsigned int dev_minor, const char * const name,
+	unsigned long int * const value));
+#endif
+
+/**
+ * Reads one of the values describing a block device's request queue
+ *	from sysfs. Partitions use the values of the whole device.
+ * @param dev_major The major number of the device.
+ * @param dev_minor The minor number of the device.
+ * @param name The name of the value in the "queue" directory.
+ * @param value Pointer to the place for the value.
+ * @return 0 in case of no errors, other values otherwise.
+ */
+static int
+wfs_read_queue_value (
+#ifdef WFS_ANSIC
+	const unsigned int dev_major, const unsigned int dev_minor,
+	const char * const name, unsigned long int * const value)
+#else
+	dev_major, dev_minor, name, value)
+	const unsigned int dev_major;
+	const unsigned int dev_minor;
+	const char * const name;
+	unsigned long int * const value;
+#endif
+{
+	char path[WFS_MNTBUFLEN];
+	FILE * f;
+	int res;
+	int i;
+
+	for ( i = 0; i < 2; i++ )
+	{
+#if (!defined __STRICT_ANSI__) && (defined HAVE_SNPRINTF)
+		res = snprintf (path, sizeof (path) - 1,
+			"/sys/dev/block/%u:%u/%squeue/%s", dev_major, dev_minor,
+			(i == 0)? "" : "../", name);
+#else
+		res = sprintf (path, "/sys/dev/block/%u:%u/%squeue/%s",
+			dev_major, dev_minor, (i == 0)? "" : "../", name);
+#endif
+		if ( res <= 0 )
+		{
+			return -1;
+		}
+		path[sizeof (path) - 1] = '\0';
+		f = fopen (path, "r");
+		if ( f == NULL )
+		{
+			continue;
+		}
+		res = fscanf (f, "%lu", value);
+		fclose (f);
+		if ( res == 1 )
+		{
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/* ======================================================================== */
+
+/**
+ * Reads the preferred sizes of I/O requests of the given device from sysfs.
+ *	The values which are unknown are zero (or -1 for the rotational flag).
+ * @param dev_name The name of the device.
+ * @param hints Pointer to the place for the values.
+ */
+void
+wfs_get_io_hints (
+#ifdef WFS_ANSIC
+	const char * const dev_name, wfs_io_hints_t * const hints)
+#else
+	dev_name, hints)
+	const char * const dev_name;
+	wfs_io_hints_t * const hints;
+#endif
+{
+#if (defined HAVE_SYS_STAT_H) && (defined HAVE_STAT) \
+	&& (defined major) && (defined minor)
+	struct stat s;
+	unsigned long int value;
+#endif
+
+	if ( hints == NULL )
+	{
+		return;
+	}
+	hints->optimal_io_size = 0;
+	hints->minimum_io_size = 0;
+	hints->max_io_size = 0;
+	hints->rotational = -1;
+	if ( dev_name == NULL )
+	{
+		return;
+	}
+#if (defined HAVE_SYS_STAT_H) && (defined HAVE_STAT) \
+	&& (defined major) && (defined minor)
+	if ( stat (dev_name, &s) != 0 )
+	{
+		return;
+	}
+	if ( ! S_ISBLK (s.st_mode) )
+	{
+		return;
+	}
+	if ( wfs_read_queue_value ((unsigned int) major (s.st_rdev),
+		(unsigned int) minor (s.st_rdev), "optimal_io_size", &value) == 0 )
+	{
+		hints->optimal_io_size = value;
+	}
+	if ( wfs_read_queue_value ((unsigned int) major (s.st_rdev),
+		(unsigned int) minor (s.st_rdev), "minimum_io_size", &value) == 0 )
+	{
+		hints->minimum_io_size = value;
+	}
+	if ( wfs_read_queue_value ((unsigned int) major (s.st_rdev),
+		(unsigned int) minor (s.st_rdev), "max_sectors_kb", &value) == 0 )
+	{
+		hints->max_io_size = value * 1024;
+	}
+	if ( wfs_read_queue_value ((unsigned int) major (s.st_rdev),
+		(unsigned int) minor (s.st_rdev), "rotational", &value) == 0 )
+	{
+		hints->rotational = (value != 0)? 1 : 0;
+	}
+#endif
+}
+
+/* ======================================================================== */
+
 /**
  * Makes a deep copy of the given array.
  * @param array The array to copy.
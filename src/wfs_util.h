@@ -36,6 +36,30 @@ struct fs_ioctl
 
 typedef struct fs_ioctl fs_ioctl_t;
 
+/* A token bucket which limits the rate of writing */
+struct wfs_rate_limit
+{
+	unsigned long int	max_rate;	/* bytes per second, 0 - no limit */
+	unsigned long int	max_iops;	/* writes per second, 0 - no limit */
+	double			byte_tokens;	/* the bytes which can be written now */
+	double			io_tokens;	/* the writes which can be done now */
+	double			last;		/* the time of the last update */
+};
+
+typedef struct wfs_rate_limit wfs_rate_limit_t;
+
+/* The preferred sizes of I/O requests of a device */
+struct wfs_io_hints
+{
+	unsigned long int	optimal_io_size;	/* e.g. a RAID stripe, 0 if unknown */
+	unsigned long int	minimum_io_size;	/* the smallest efficient size */
+	unsigned long int	max_io_size;		/* the largest request size */
+	int			rotational;		/* 1 - a spinning disk,
+							   0 - not, -1 - unknown */
+};
+
+typedef struct wfs_io_hints wfs_io_hints_t;
+
 extern const char *
 	wfs_convert_fs_to_name WFS_PARAMS ((const wfs_curr_fs_t fs));
 
@@ -61,6 +85,32 @@ extern int GCC_WARN_UNUSED_RESULT WFS_ATTR ((nonnull))
 extern void
 	wfs_flush_pipe_input WFS_PARAMS ((const int fd));
 
+extern int
+	wfs_sync_fd WFS_PARAMS ((const int fd));
+
+extern void
+	wfs_set_uuid WFS_PARAMS ((wfs_fsid_t * const wfs_fs,
+		const unsigned char * const uuid, const size_t len));
+
+extern int
+	wfs_set_idle_priority WFS_PARAMS ((void));
+
+extern double
+	wfs_get_time WFS_PARAMS ((void));
+
+extern void
+	wfs_get_io_hints WFS_PARAMS ((const char * const dev_name,
+		wfs_io_hints_t * const hints));
+
+extern void
+	wfs_rate_limit_init WFS_PARAMS ((wfs_rate_limit_t * const limit,
+		const unsigned long int max_rate,
+		const unsigned long int max_iops));
+
+extern void
+	wfs_rate_limit_wait WFS_PARAMS ((wfs_rate_limit_t * const limit,
+		const size_t bytes));
+
 extern char **
 	wfs_deep_copy_array WFS_PARAMS ((const char * const * const array,
 		const unsigned int len));
@@ -55,21 +55,14 @@
 #include "wfs_signal.h"
 #include "wfs_util.h"
 
-enum wfs_method
-{
-	WFS_METHOD_GUTMANN,
-	WFS_METHOD_RANDOM,
-	WFS_METHOD_SCHNEIER,
-	WFS_METHOD_DOD
-};
-
 static const char * const msg_pattern     = N_("Using pattern");
 static const char * const msg_random      = N_("random");
 
-static int opt_verbose = 0;
-static int opt_allzero = 0;
-static enum wfs_method opt_method = WFS_METHOD_GUTMANN;
-static unsigned long int wfs_npasses = WFS_PASSES;		/* Number of passes (patterns used) */
+/* The wiping used for the filesystems which don't have their own */
+static wfs_wipe_ctx_t wfs_default_ctx =
+{
+	WFS_METHOD_GUTMANN, WFS_PASSES, 0, 0, { 0xFFF, 0x000 }, 1, 1, NULL
+};
 
 /* Taken from `shred' source */
 static const unsigned int patterns_random[] =
@@ -97,38 +90,62 @@ static const unsigned int patterns_schneier[] =
 	0xFFF, 0x000
 };
 
-static unsigned int patterns_dod[] =
-{
-	0xFFF, 0x000	/* will be filled in later */
-};
-
 #if (defined TEST_COMPILE) && (defined WFS_ANSIC)
 # undef WFS_ANSIC
 #endif
 
 /* ======================================================================== */
 
+#ifndef WFS_ANSIC
+static unsigned int wfs_wipe_rand WFS_PARAMS ((wfs_wipe_ctx_t * const ctx));
+#endif
+
+/**
+ * Gets the next random number of the given wiping, without using the
+ *	random number generator shared by the whole program.
+ * \param ctx The wiping.
+ * \return A random number between 0 and 32767.
+ */
+static unsigned int
+wfs_wipe_rand (
+#ifdef WFS_ANSIC
+	wfs_wipe_ctx_t * const ctx)
+#else
+	ctx)
+	wfs_wipe_ctx_t * const ctx;
+#endif
+{
+	/* the generator from the example of rand() in the C standard */
+	ctx->rand_state = (ctx->rand_state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+	return (unsigned int) ((ctx->rand_state >> 16) & 0x7FFF);
+}
+
+/* ======================================================================== */
+
 #ifndef WFS_ANSIC
 static int wfs_is_pass_random WFS_PARAMS ((const unsigned long int pat_no,
-	const enum wfs_method method));
+	const wfs_wipe_ctx_t * const ctx));
 #endif
 
 /**
  * Tells if the given wiping pass for the given method should be using a random pattern.
  * \param pat_no Pass number.
- * \param method The wiping method.
+ * \param ctx The wiping, with the method and the number of passes.
  * \return 1 if the should be random, 0 otherwise.
  */
 static int
 wfs_is_pass_random (
 #ifdef WFS_ANSIC
-	const unsigned long int pat_no, const enum wfs_method method)
+	const unsigned long int pat_no, const wfs_wipe_ctx_t * const ctx)
 #else
-	pat_no, method)
+	pat_no, ctx)
 	const unsigned long int pat_no;
-	const enum wfs_method method;
+	const wfs_wipe_ctx_t * const ctx;
 #endif
 {
+	const enum wfs_method method = ctx->method;
+	const unsigned long int wfs_npasses = ctx->npasses;
+
 	if ( method == WFS_METHOD_GUTMANN )
 	{
 		/* Gutmann method: first 4, 1 middle and last 4 passes are random */
@@ -169,36 +186,209 @@ wfs_is_pass_random (
 
 /* ======================================================================== */
 
+#ifndef WFS_ANSIC
+static const unsigned int * wfs_get_patterns WFS_PARAMS ((
+	const wfs_wipe_ctx_t * const ctx, size_t * const npat));
+#endif
+
+/**
+ * Gets the fixed patterns of the method of the given wiping.
+ * \param ctx The wiping.
+ * \param npat Will get the number of the patterns.
+ * \return The patterns, NULL for an unknown method.
+ */
+static const unsigned int *
+wfs_get_patterns (
+#ifdef WFS_ANSIC
+	const wfs_wipe_ctx_t * const ctx, size_t * const npat)
+#else
+	ctx, npat)
+	const wfs_wipe_ctx_t * const ctx;
+	size_t * const npat;
+#endif
+{
+	if ( ctx->method == WFS_METHOD_GUTMANN )
+	{
+		*npat = sizeof (patterns_gutmann)/sizeof (patterns_gutmann[0]);
+		return patterns_gutmann;
+	}
+	else if ( ctx->method == WFS_METHOD_RANDOM )
+	{
+		*npat = sizeof (patterns_random)/sizeof (patterns_random[0]);
+		return patterns_random;
+	}
+	else if ( ctx->method == WFS_METHOD_SCHNEIER )
+	{
+		*npat = sizeof (patterns_schneier)/sizeof (patterns_schneier[0]);
+		return patterns_schneier;
+	}
+	else if ( ctx->method == WFS_METHOD_DOD )
+	{
+		*npat = sizeof (ctx->patterns_dod)/sizeof (ctx->patterns_dod[0]);
+		return ctx->patterns_dod;
+	}
+	*npat = 0;
+	return NULL;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_wipe_ctx_schedule WFS_PARAMS ((wfs_wipe_ctx_t * const ctx));
+#endif
+
 /**
- * Inintializes the wiping module.
+ * Computes the pattern of each pass of the given wiping. The Gutmann and
+ *	random methods use their fixed patterns in a random order, each of
+ *	them once before any is used again, the other methods - in sequence.
+ * \param ctx The wiping, with the method and the number of passes set.
+ *	The schedule is left NULL if it can't be allocated.
+ */
+static void
+wfs_wipe_ctx_schedule (
+#ifdef WFS_ANSIC
+	wfs_wipe_ctx_t * const ctx)
+#else
+	ctx)
+	wfs_wipe_ctx_t * const ctx;
+#endif
+{
+	const unsigned int * patterns;
+	size_t order[WFS_NPAT];
+	size_t npat;
+	size_t next;
+	size_t i, j, tmp;
+	unsigned long int pass;
+
+	ctx->schedule = NULL;
+	patterns = wfs_get_patterns (ctx, &npat);
+	if ( (patterns == NULL) || (npat == 0) || (npat > WFS_NPAT)
+		|| (ctx->npasses == 0)
+		|| (ctx->npasses > ((size_t)(-1)) / sizeof (unsigned int)) )
+	{
+		return;
+	}
+	ctx->schedule = (unsigned int *) malloc ((size_t) ctx->npasses
+		* sizeof (unsigned int));
+	if ( ctx->schedule == NULL )
+	{
+		return;
+	}
+	next = npat;
+	for ( pass = 0; pass < ctx->npasses; pass++ )
+	{
+		if ( wfs_is_pass_random (pass, ctx) == 1 )
+		{
+			ctx->schedule[pass] = WFS_PATTERN_RANDOM;
+			continue;
+		}
+		if ( (ctx->method != WFS_METHOD_GUTMANN)
+			&& (ctx->method != WFS_METHOD_RANDOM) )
+		{
+			/* other methods use their patterns in sequence */
+			ctx->schedule[pass] = patterns[pass % npat] & 0xFFF;
+			continue;
+		}
+		if ( next >= npat )
+		{
+			/* all the patterns used - shuffle them again (Fisher-Yates) */
+			for ( i = 0; i < npat; i++ )
+			{
+				order[i] = i;
+			}
+			for ( i = npat - 1; i > 0; i-- )
+			{
+				j = (size_t) wfs_wipe_rand (ctx) % (i + 1);
+				tmp = order[i];
+				order[i] = order[j];
+				order[j] = tmp;
+			}
+			next = 0;
+		}
+		ctx->schedule[pass] = patterns[order[next]];
+		next++;
+	}
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static void wfs_wipe_ctx_seed WFS_PARAMS ((wfs_wipe_ctx_t * const ctx,
+	const unsigned long int seed));
+#endif
+
+/**
+ * Starts the random numbers of the given wiping from the given seed and
+ *	computes the patterns which depend on them. The same seed gives
+ *	the same patterns in the same order.
+ * \param ctx The wiping, with the method and the number of passes set
+ *	and without a schedule.
+ * \param seed The first state of the random numbers.
+ */
+static void
+wfs_wipe_ctx_seed (
+#ifdef WFS_ANSIC
+	wfs_wipe_ctx_t * const ctx, const unsigned long int seed)
+#else
+	ctx, seed)
+	wfs_wipe_ctx_t * const ctx;
+	const unsigned long int seed;
+#endif
+{
+	ctx->seed = seed;
+	ctx->rand_state = seed;
+	if ( ctx->method == WFS_METHOD_DOD )
+	{
+		/* fill the patterns with a random byte and its complement */
+		ctx->patterns_dod[0] = wfs_wipe_rand (ctx);
+		ctx->patterns_dod[1] = ~(ctx->patterns_dod[0]);
+	}
+	wfs_wipe_ctx_schedule (ctx);
+}
+
+/* ======================================================================== */
+
+/**
+ * Inintializes the given wiping.
+ * \param ctx The wiping to initialize.
  * \param npasses The number of wiping passes to use.
  * \param verbose Non-zero if verbose mode should be enabled.
  * \param allzero Non-zero if all patterns should be zero.
  * \param method The wiping method to use.
  * \return The number of wiping passes that would be used by default.
+ *	The wiping has to be freed with wfs_wipe_ctx_free().
  */
 unsigned long int
-wfs_init_wiping (
+wfs_wipe_ctx_init (
 #ifdef WFS_ANSIC
+	wfs_wipe_ctx_t * const ctx,
 	unsigned long int number_of_passes, const int verbose,
 	const int allzero, const char * const method)
 #else
-	number_of_passes, verbose, allzero, method)
+	ctx, number_of_passes, verbose, allzero, method)
+	wfs_wipe_ctx_t * const ctx;
 	unsigned long int number_of_passes;
 	const int verbose;
 	const int allzero;
 	const char * const method;
 #endif
 {
-	opt_verbose = verbose;
-	opt_allzero = allzero;
-	wfs_npasses = number_of_passes;
+	if ( ctx == NULL )
+	{
+		return number_of_passes;
+	}
+	ctx->method = WFS_METHOD_GUTMANN;
+	ctx->verbose = verbose;
+	ctx->allzero = allzero;
+	ctx->npasses = number_of_passes;
+	ctx->patterns_dod[0] = 0xFFF;
+	ctx->patterns_dod[1] = 0x000;
 
 	if ( method != NULL )
 	{
 		if ( WFS_STRCASECMP (method, "gutmann") == 0 )
 		{
-			opt_method = WFS_METHOD_GUTMANN;
+			ctx->method = WFS_METHOD_GUTMANN;
 			/* the number of passes is the number of predefined patterns
 				+ the number of random patterns. */
 			number_of_passes = sizeof (patterns_gutmann)/sizeof (patterns_gutmann[0])
@@ -206,7 +396,7 @@ wfs_init_wiping (
 		}
 		else if ( WFS_STRCASECMP (method, "random") == 0 )
 		{
-			opt_method = WFS_METHOD_RANDOM;
+			ctx->method = WFS_METHOD_RANDOM;
 			/* the number of passes is the number of predefined patterns
 				+ the number of random patterns. */
 			number_of_passes = sizeof (patterns_random)/sizeof (patterns_random[0])
@@ -214,7 +404,7 @@ wfs_init_wiping (
 		}
 		else if ( WFS_STRCASECMP (method, "schneier") == 0 )
 		{
-			opt_method = WFS_METHOD_SCHNEIER;
+			ctx->method = WFS_METHOD_SCHNEIER;
 			/* the number of passes is the number of predefined patterns
 				+ the number of random patterns. */
 			number_of_passes = sizeof (patterns_schneier)/sizeof (patterns_schneier[0])
@@ -222,51 +412,216 @@ wfs_init_wiping (
 		}
 		else if ( WFS_STRCASECMP (method, "dod") == 0 )
 		{
-			opt_method = WFS_METHOD_DOD;
-			/* fill the patterns with a random byte and its complement */
-#if (!defined __STRICT_ANSI__) && (defined HAVE_RANDOM)
-			patterns_dod[0] = (unsigned int)random ();
-#else
-			patterns_dod[0] = (unsigned int)rand ();
-#endif
-			patterns_dod[1] = ~patterns_dod[0];
+			ctx->method = WFS_METHOD_DOD;
 			/* the number of passes is the number of predefined patterns
 				+ the number of random patterns. */
-			number_of_passes = sizeof (patterns_dod)/sizeof (patterns_dod[0])
+			number_of_passes = sizeof (ctx->patterns_dod)/sizeof (ctx->patterns_dod[0])
 				+ 1;
 		}
 	}
 	else
 	{
-		opt_method = WFS_METHOD_GUTMANN;
+		ctx->method = WFS_METHOD_GUTMANN;
 		/* the number of passes is the number of predefined patterns
 			+ the number of random patterns. */
 		number_of_passes = sizeof (patterns_gutmann)/sizeof (patterns_gutmann[0])
 			+ 4 + 1 + 4;
 	}
-	if ( wfs_npasses == 0 )
+	if ( ctx->npasses == 0 )
 	{
 		/* use the default or the parameter */
-		wfs_npasses = number_of_passes;
+		ctx->npasses = number_of_passes;
 	}
-	if ( wfs_npasses == 0 )
+	if ( ctx->npasses == 0 )
 	{
 		/* use the default */
-		wfs_npasses = WFS_PASSES;
+		ctx->npasses = WFS_PASSES;
 		number_of_passes = WFS_PASSES;
 	}
+	/* each wiping gets its own sequence of random numbers */
+#if (!defined __STRICT_ANSI__) && (defined HAVE_RANDOM)
+	wfs_wipe_ctx_seed (ctx, (unsigned long int)random ());
+#else
+	wfs_wipe_ctx_seed (ctx, (unsigned long int)rand ());
+#endif
 	return number_of_passes;
 }
 
 /* ======================================================================== */
 
+/**
+ * Frees the resources of the given wiping.
+ * \param ctx The wiping to free.
+ */
+void
+wfs_wipe_ctx_free (
+#ifdef WFS_ANSIC
+	wfs_wipe_ctx_t * const ctx)
+#else
+	ctx)
+	wfs_wipe_ctx_t * const ctx;
+#endif
+{
+	if ( ctx == NULL )
+	{
+		return;
+	}
+	if ( ctx->schedule != NULL )
+	{
+		free (ctx->schedule);
+		ctx->schedule = NULL;
+	}
+}
+
+/* ======================================================================== */
+
+/**
+ * Inintializes the wiping used for the filesystems which don't have their own.
+ * \param npasses The number of wiping passes to use.
+ * \param verbose Non-zero if verbose mode should be enabled.
+ * \param allzero Non-zero if all patterns should be zero.
+ * \param method The wiping method to use.
+ * \return The number of wiping passes that would be used by default.
+ */
+unsigned long int
+wfs_init_wiping (
+#ifdef WFS_ANSIC
+	unsigned long int number_of_passes, const int verbose,
+	const int allzero, const char * const method)
+#else
+	number_of_passes, verbose, allzero, method)
+	unsigned long int number_of_passes;
+	const int verbose;
+	const int allzero;
+	const char * const method;
+#endif
+{
+	wfs_wipe_ctx_free (&wfs_default_ctx);
+	return wfs_wipe_ctx_init (&wfs_default_ctx, number_of_passes,
+		verbose, allzero, method);
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells how verbose the wiping should be.
+ * \return The verbosity level given to wfs_init_wiping().
+ */
+int
+wfs_is_verbose (WFS_VOID)
+{
+	return wfs_default_ctx.verbose;
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells which method the filesystem's wiping uses.
+ * \param wfs_fs The filesystem this wiping refers to.
+ * \return The wiping method.
+ */
+enum wfs_method GCC_WARN_UNUSED_RESULT
+wfs_get_method (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs)
+#else
+	wfs_fs)
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	return (wfs_fs.wipe_ctx != NULL)? wfs_fs.wipe_ctx->method
+		: wfs_default_ctx.method;
+}
+
+/* ======================================================================== */
+
+/**
+ * Gets the seed which decides the order of the patterns of the
+ *	filesystem's wiping.
+ * \param wfs_fs The filesystem this wiping refers to.
+ * \return The seed.
+ */
+unsigned long int GCC_WARN_UNUSED_RESULT
+wfs_get_seed (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs)
+#else
+	wfs_fs)
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	return (wfs_fs.wipe_ctx != NULL)? wfs_fs.wipe_ctx->seed
+		: wfs_default_ctx.seed;
+}
+
+/* ======================================================================== */
+
+/**
+ * Starts the filesystem's wiping again from the given seed, so that it uses
+ *	the same patterns in the same order as another wiping with that seed.
+ * \param wfs_fs The filesystem this wiping refers to.
+ * \param seed The seed, from wfs_get_seed().
+ */
+void
+wfs_set_seed (
+#ifdef WFS_ANSIC
+	const wfs_fsid_t wfs_fs, const unsigned long int seed)
+#else
+	wfs_fs, seed)
+	const wfs_fsid_t wfs_fs;
+	const unsigned long int seed;
+#endif
+{
+	wfs_wipe_ctx_t * ctx;
+
+	ctx = (wfs_fs.wipe_ctx != NULL)? wfs_fs.wipe_ctx : &wfs_default_ctx;
+	wfs_wipe_ctx_free (ctx);
+	wfs_wipe_ctx_seed (ctx, seed);
+}
+
+/* ======================================================================== */
+
+/**
+ * Tells if the given pass of the filesystem's wiping writes a random pattern.
+ *	Each call to wfs_fill_buffer() for such a pass gives a new pattern.
+ * \param pat_no Pass number.
+ * \param wfs_fs The filesystem this wiping refers to.
+ * \return 1 if the pass is random, 0 otherwise.
+ */
+int GCC_WARN_UNUSED_RESULT
+wfs_is_random_pass (
+#ifdef WFS_ANSIC
+	unsigned long int pat_no, const wfs_fsid_t wfs_fs)
+#else
+	pat_no, wfs_fs)
+	unsigned long int pat_no;
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	const wfs_wipe_ctx_t * ctx;
+
+	ctx = (wfs_fs.wipe_ctx != NULL)? wfs_fs.wipe_ctx : &wfs_default_ctx;
+	if ( (ctx->allzero != 0) || (ctx->npasses == 0) )
+	{
+		return 0;
+	}
+	pat_no %= ctx->npasses;
+	if ( ctx->schedule != NULL )
+	{
+		return (ctx->schedule[pat_no] == WFS_PATTERN_RANDOM)? 1 : 0;
+	}
+	return wfs_is_pass_random (pat_no, ctx);
+}
+
+/* ======================================================================== */
+
 /**
  * Fills the given buffer with one of predefined patterns.
  * \param pat_no Pass number.
  * \param buffer Buffer to be filled.
  * \param buflen Length of the buffer.
- * \param selected The array which tells which of the patterns have already been used.
- * \param wfs_fs The filesystem this wiping refers to.
+ * \param wfs_fs The filesystem this wiping refers to, with the wiping method
+ *	and its state in "wipe_ctx".
  */
 void
 #ifdef WFS_ANSIC
@@ -277,14 +632,12 @@ wfs_fill_buffer (
 	unsigned long int 		pat_no,
 	unsigned char * const 		buffer,
 	const size_t 			buflen,
-	int * const			selected,
 	const wfs_fsid_t		wfs_fs )
 #else
-	pat_no,	buffer,	buflen,	selected, wfs_fs )
+	pat_no,	buffer,	buflen,	wfs_fs )
 	unsigned long int 		pat_no;
 	unsigned char * const 		buffer;
 	const size_t 			buflen;
-	int * const			selected;
 	const wfs_fsid_t		wfs_fs;
 #endif
 		/*@requires notnull buffer @*/ /*@sets *buffer @*/
@@ -292,128 +645,52 @@ wfs_fill_buffer (
 
 	size_t i;
 	unsigned int bits;
+	unsigned int pattern;
 	char tmp[8];
 	int res;
 	size_t npat;
+	const unsigned int * patterns;
+	wfs_wipe_ctx_t * ctx;
 
 	if ( (buffer == NULL) || (buflen == 0) )
 	{
 		return;
 	}
+	ctx = (wfs_fs.wipe_ctx != NULL)? wfs_fs.wipe_ctx : &wfs_default_ctx;
 
-	if ( opt_method == WFS_METHOD_GUTMANN )
+	patterns = wfs_get_patterns (ctx, &npat);
+	if ( (patterns == NULL) || (ctx->npasses == 0) )
 	{
-		npat = sizeof (patterns_gutmann)/sizeof (patterns_gutmann[0]);
-	}
-	else if ( opt_method == WFS_METHOD_RANDOM )
-	{
-		npat = sizeof (patterns_random)/sizeof (patterns_random[0]);
+		return;
 	}
-	else if ( opt_method == WFS_METHOD_SCHNEIER )
+        pat_no %= ctx->npasses;
+
+	if ( ctx->schedule != NULL )
 	{
-		npat = sizeof (patterns_schneier)/sizeof (patterns_schneier[0]);
+		pattern = ctx->schedule[pat_no];
 	}
-	else if ( opt_method == WFS_METHOD_DOD )
+	else if ( wfs_is_pass_random (pat_no, ctx) == 1 )
 	{
-		npat = sizeof (patterns_dod)/sizeof (patterns_dod[0]);
+		pattern = WFS_PATTERN_RANDOM;
 	}
 	else
 	{
-		return;
+		/* no schedule - use the patterns in sequence */
+		pattern = patterns[pat_no % npat] & 0xFFF;
 	}
 
-	if ( selected != NULL )
+	if ( ctx->allzero != 0 )
 	{
-		for ( i = 0; i < npat; i++ )
-		{
-			if ( selected[i] == 0 )
-			{
-				break;
-			}
-		}
-		if ( (i >= npat) && (wfs_is_pass_random (pat_no, opt_method) != 1) )
-		{
-			/* no patterns left and this is not a "random" pass - deselect all the patterns */
-			for ( i = 0; (i < npat) && (sig_recvd == 0); i++ )
-			{
-				selected[i] = 0;
-			}
-		}
-	}
-        if ( sig_recvd != 0 )
-	{
-		return;
+		bits = 0;
 	}
-        pat_no %= wfs_npasses;
-
-	if ( opt_allzero != 0 )
+	else if ( pattern == WFS_PATTERN_RANDOM )
 	{
-		bits = 0;
+		bits = wfs_wipe_rand (ctx) & 0xFFF;
 	}
 	else
 	{
-		if ( wfs_is_pass_random (pat_no, opt_method) == 1 )
-		{
-#if (!defined __STRICT_ANSI__) && (defined HAVE_RANDOM)
-			bits = (unsigned int) ((size_t)random () & 0xFFF);
-#else
-			bits = (unsigned int) ((size_t)rand () & 0xFFF);
-#endif
-		}
-		else
-		{	/* For other passes, one of the fixed patterns is selected. */
-			if ( (opt_method == WFS_METHOD_GUTMANN)
-				|| (opt_method == WFS_METHOD_RANDOM) )
-			{
-				do
-				{
-#if (!defined __STRICT_ANSI__) && (defined HAVE_RANDOM)
-					i = (size_t)random () % npat;
-#else
-					i = (size_t)rand () % npat;
-#endif
-					if ( selected == NULL )
-					{
-						break;
-					}
-					else if ( selected[i] == 0 )
-					{
-						break;
-					}
-				}
-				while ( sig_recvd == 0 );
-				if ( sig_recvd != 0 )
-				{
-					return;
-				}
-			}
-			else
-			{
-				/* other methods use their patterns in sequence */
-				i = pat_no;
-			}
-			if ( opt_method == WFS_METHOD_GUTMANN )
-			{
-				bits = patterns_gutmann[i];
-			}
-			else if ( opt_method == WFS_METHOD_RANDOM )
-			{
-				bits = patterns_random[i];
-			}
-			else if ( opt_method == WFS_METHOD_SCHNEIER )
-			{
-				bits = patterns_schneier[i];
-			}
-			else /*if ( opt_method == WFS_METHOD_DOD )*/
-			{
-				bits = patterns_dod[i] & 0xFFF;
-			}
-			if ( selected != NULL )
-			{
-				selected[i] = 1;
-			}
-		}
-    	}
+		bits = pattern;
+	}
 
         if ( sig_recvd != 0 )
 	{
@@ -424,10 +701,10 @@ wfs_fill_buffer (
 	bits |= bits << 12;
 
 	/* display the patterns when at least two '-v' command line options were given */
-	if ( opt_verbose > 1 )
+	if ( ctx->verbose > 1 )
 	{
-		if ( (wfs_is_pass_random (pat_no, opt_method) == 1)
-			&& (opt_allzero == 0) )
+		if ( (pattern == WFS_PATTERN_RANDOM)
+			&& (ctx->allzero == 0) )
 		{
 			wfs_show_msg ( 1, msg_pattern, msg_random, wfs_fs );
 		}
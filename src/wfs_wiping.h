@@ -24,16 +24,69 @@
 
 # include "wipefreespace.h"
 
+enum wfs_method
+{
+	WFS_METHOD_GUTMANN,
+	WFS_METHOD_RANDOM,
+	WFS_METHOD_SCHNEIER,
+	WFS_METHOD_DOD
+};
+
+/* the value in the schedule of a pass which uses a random pattern,
+   outside of the 12 bits of the fixed patterns */
+# define WFS_PATTERN_RANDOM 0x1000U
+
+/* The wiping method and its state. Each filesystem (or region) wiped
+   at the same time as others should have its own. */
+struct wfs_wipe_ctx
+{
+	enum wfs_method		method;		/* the wiping method */
+	unsigned long int	npasses;	/* the number of passes */
+	int			allzero;	/* whether all patterns should be zero */
+	int			verbose;	/* the verbosity level */
+	unsigned int		patterns_dod[2];	/* the DoD method's patterns */
+	unsigned long int	rand_state;	/* the state of the random numbers */
+	unsigned long int	seed;		/* the first state of the random
+						   numbers, decides the schedule */
+	unsigned int *		schedule;	/* the pattern of each pass, or NULL */
+};
+
+typedef struct wfs_wipe_ctx wfs_wipe_ctx_t;
+
+extern unsigned long int wfs_wipe_ctx_init WFS_PARAMS ((
+	wfs_wipe_ctx_t * const ctx,
+	unsigned long int number_of_passes,
+	const int verbose, const int allzero,
+	const char * const method));
+
+extern void wfs_wipe_ctx_free WFS_PARAMS ((wfs_wipe_ctx_t * const ctx));
+
 extern unsigned long int wfs_init_wiping WFS_PARAMS ((
 	unsigned long int number_of_passes,
 	const int verbose, const int allzero,
 	const char * const method));
 
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_is_verbose WFS_PARAMS ((void));
+
+extern enum wfs_method GCC_WARN_UNUSED_RESULT
+	wfs_get_method WFS_PARAMS ((const wfs_fsid_t wfs_fs));
+
+extern unsigned long int GCC_WARN_UNUSED_RESULT
+	wfs_get_seed WFS_PARAMS ((const wfs_fsid_t wfs_fs));
+
+extern void
+	wfs_set_seed WFS_PARAMS ((const wfs_fsid_t wfs_fs,
+		const unsigned long int seed));
+
+extern int GCC_WARN_UNUSED_RESULT
+	wfs_is_random_pass WFS_PARAMS ((unsigned long int pat_no,
+		const wfs_fsid_t wfs_fs));
+
 extern void WFS_ATTR ((nonnull))
 	wfs_fill_buffer WFS_PARAMS ((unsigned long int pat_no,
 		unsigned char * const buffer,
 		const size_t buflen,
-		int * const selected,
 		const wfs_fsid_t wfs_fs));
 
 #endif /* WFS_WIPING_H */
@@ -30,6 +30,7 @@
 #include "wipefreespace.h"
 #include "wfs_wrappers.h"
 #include "wfs_util.h"
+#include "wfs_probe.h"
 
 #ifdef WFS_EXT234
 # include "wfs_ext234.h"
@@ -333,7 +334,9 @@ wipe_part (
 /* ======================================================================== */
 
 /**
- * Opens a filesystem on the given device.
+ * Opens a filesystem on the given device. The backend of the filesystem
+ *	recognized by its magic numbers is tried first, the others only when
+ *	it isn't recognized or can't be opened.
  * \param devname Device name, like /dev/hdXY
  * \param wfs_fs Pointer to where the result will be put.
  * \param whichfs Pointer to an int saying which fs is curently in use.
@@ -354,30 +357,102 @@ wfs_open_fs (
 #endif
 {
 	wfs_errcode_t ret_wfs = WFS_OPENFS;
+	wfs_curr_fs_t probed;
+
+	probed = wfs_probe_fs (wfs_fs->fsname);
+	if ( probed == WFS_CURR_FS_EXT234FS )
+	{
 #ifdef WFS_EXT234
-	ret_wfs = wfs_e234_open_fs (wfs_fs, data);
+		ret_wfs = wfs_e234_open_fs (wfs_fs, data);
 #endif
+	}
+	else if ( probed == WFS_CURR_FS_NTFS )
+	{
 #ifdef WFS_NTFS
-	if ( ret_wfs != WFS_SUCCESS )
+		ret_wfs = wfs_ntfs_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_XFS )
+	{
+#ifdef WFS_XFS
+		ret_wfs = wfs_xfs_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_REISERFS )
+	{
+#ifdef WFS_REISER
+		ret_wfs = wfs_reiser_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_REISER4 )
+	{
+#ifdef WFS_REISER4
+		ret_wfs = wfs_r4_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_FATFS )
+	{
+#ifdef WFS_FATFS
+		ret_wfs = wfs_fat_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_MINIXFS )
+	{
+#ifdef WFS_MINIXFS
+		ret_wfs = wfs_minixfs_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_JFS )
+	{
+#ifdef WFS_JFS
+		ret_wfs = wfs_jfs_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_HFSP )
+	{
+#ifdef WFS_HFSP
+		ret_wfs = wfs_hfsp_open_fs (wfs_fs, data);
+#endif
+	}
+	else if ( probed == WFS_CURR_FS_OCFS )
+	{
+#ifdef WFS_OCFS
+		ret_wfs = wfs_ocfs_open_fs (wfs_fs, data);
+#endif
+	}
+	if ( ret_wfs == WFS_SUCCESS )
+	{
+		return ret_wfs;
+	}
+
+	/* not recognized or not opened - try all the other backends */
+#ifdef WFS_EXT234
+	if ( probed != WFS_CURR_FS_EXT234FS )
+	{
+		ret_wfs = wfs_e234_open_fs (wfs_fs, data);
+	}
+#endif
+#ifdef WFS_NTFS
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_NTFS) )
 	{
 		ret_wfs = wfs_ntfs_open_fs (wfs_fs, data);
 	}
 #endif
 #ifdef WFS_REISER4
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_REISER4) )
 	{
 		ret_wfs = wfs_r4_open_fs (wfs_fs, data);
 	}
 #endif
 #ifdef WFS_XFS
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_XFS) )
 	{
 		ret_wfs = wfs_xfs_open_fs (wfs_fs, data);
 	}
 #endif
 /* JFS before ReiserFSv3 */
 #ifdef WFS_JFS
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_JFS) )
 	{
 		ret_wfs = wfs_jfs_open_fs (wfs_fs, data);
 	}
@@ -386,31 +461,31 @@ wfs_open_fs (
    XFS and ReiserFS3/4 as FAT, which is bad. But now we have more advanced checks
    than simply using TFFS, so this can be before ReiserFSv3. */
 #ifdef WFS_FATFS
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_FATFS) )
 	{
 		ret_wfs = wfs_fat_open_fs (wfs_fs, data);
 	}
 #endif
 #ifdef WFS_MINIXFS
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_MINIXFS) )
 	{
 		ret_wfs = wfs_minixfs_open_fs (wfs_fs, data);
 	}
 #endif
 #ifdef WFS_REISER
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_REISERFS) )
 	{
 		ret_wfs = wfs_reiser_open_fs (wfs_fs, data);
 	}
 #endif
 #ifdef WFS_HFSP
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_HFSP) )
 	{
 		ret_wfs = wfs_hfsp_open_fs (wfs_fs, data);
 	}
 #endif
 #ifdef WFS_OCFS
-	if ( ret_wfs != WFS_SUCCESS )
+	if ( (ret_wfs != WFS_SUCCESS) && (probed != WFS_CURR_FS_OCFS) )
 	{
 		ret_wfs = wfs_ocfs_open_fs (wfs_fs, data);
 	}
@@ -147,6 +147,10 @@ struct wfs_xfs
 # undef WFS_ANSIC
 #endif
 
+#ifdef WFS_WANT_WFS
+static const char * const msg_nodirect = N_("Direct I/O not supported or failed, using the system's cache");
+#endif
+
 /* ======================================================================== */
 
 #ifndef WFS_ANSIC
@@ -396,7 +400,6 @@ wfs_xfs_wipe_fs	(
 	unsigned long long int length;
 	unsigned char * buffer;
 	unsigned long long int j;
-	int selected[WFS_NPAT] = {0};
 	wfs_errcode_t ret_wfs = WFS_SUCCESS;
 	unsigned int prev_percent = 0;
 	unsigned long long int curr_block = 0;
@@ -418,6 +421,11 @@ wfs_xfs_wipe_fs	(
 	{
 		return WFS_BADPARAM;
 	}
+	if ( wfs_fs.use_direct != 0 )
+	{
+		/* only the wiping of the free-extent maps can use the direct I/O */
+		wfs_show_msg (0, msg_nodirect, "", wfs_fs);
+	}
 	/* Copy the file system name into the right places */
 	WFS_SET_ERRNO (0);
 	args_db[FSNAME_POS_FREESP] = xxfs->dev_name;
@@ -704,7 +712,7 @@ wfs_xfs_wipe_fs	(
 				}
 				if ( i != wfs_fs.npasses * 2 )
 				{
-					wfs_fill_buffer ( i, buffer, fs_block_size, selected, wfs_fs );
+					wfs_fill_buffer ( i, buffer, fs_block_size, wfs_fs );
 					if ( write (fs_fd, buffer, fs_block_size)
 						!= (ssize_t) fs_block_size )
 					{
@@ -921,7 +929,6 @@ wfs_xfs_wipe_part (
 	const char * pos1 = NULL;
 	const char * pos2 = NULL;
 	unsigned char * buffer;
-	int selected[WFS_NPAT] = {0};
 	unsigned long long int inode;
 	unsigned long long int inode_size;
 	unsigned long long int start_block;
@@ -1422,7 +1429,7 @@ wfs_xfs_wipe_part (
 				}
 				if ( i != wfs_fs.npasses * 2 )
 				{
-					wfs_fill_buffer ( i, buffer, fs_block_size, selected, wfs_fs );
+					wfs_fill_buffer ( i, buffer, fs_block_size, wfs_fs );
 					if ( write (fs_fd, buffer, (size_t)length_to_wipe) != length_to_wipe )
 					{
 						ret_part = WFS_BLKWR;
@@ -1788,6 +1795,12 @@ wfs_xfs_open_fs (
 	}
 	error_ret = (wfs_errcode_t *) wfs_fs->fs_error;
 	wfs_fs->whichfs = WFS_CURR_FS_NONE;
+	if ( wfs_fs->plan_only != 0 )
+	{
+		/* XFS is wiped by writing files, not from a list of free
+		   blocks - there is nothing to plan, so it's not opened */
+		return WFS_OPENFS;
+	}
 
 	WFS_SET_ERRNO (0);
 	xxfs = (struct wfs_xfs *) malloc (sizeof (struct wfs_xfs));
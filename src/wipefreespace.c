@@ -111,8 +111,13 @@ Stat macros broken. Change your C library.
 
 #include "wipefreespace.h"
 #include "wfs_wrappers.h"
+#include "wfs_probe.h"
 #include "wfs_secure.h"
 #include "wfs_signal.h"
+#include "wfs_state.h"
+#include "wfs_snapshot.h"
+#include "wfs_progress.h"
+#include "wfs_stats.h"
 #include "wfs_util.h"
 #include "wfs_wiping.h"
 
@@ -169,6 +174,9 @@ const char * const wfs_err_msg_diriter = N_("during iterating over a directory o
 const char * const wfs_err_msg_nowork  = N_("Nothing selected for wiping.");
 const char * const wfs_err_msg_suid    = N_("PLEASE do NOT set this program's suid bit. Use sgid instead.");
 const char * const wfs_err_msg_capset  = N_("during setting capabilities");
+const char * const wfs_err_msg_ionice  = N_("during setting the idle priority");
+const char * const wfs_err_msg_state   = N_("during saving the state to");
+const char * const wfs_err_msg_snapdir = N_("during opening the snapshot directory");
 const char * const wfs_err_msg_fork    = N_("during creation of child process");
 const char * const wfs_err_msg_nocache = N_("during disabling device cache");
 const char * const wfs_err_msg_cacheon = N_("during enabling device cache");
@@ -196,30 +204,45 @@ static const char * const msg_wipeused = N_("Wiping unused space in used blocks
 static const char * const msg_wipeunrm = N_("Wiping undelete data on");
 #endif
 static const char * const msg_closefs  = N_("Closing file system");
+static const char * const msg_resume   = N_("Resuming the wiping of");
 static const char * const msg_nobg     = N_("Going into background not supported or failed");
 static const char * const msg_cacheoff = N_("Disabling cache");
+static const char * const msg_planpart = N_("Only the free space is planned, not the undelete data and the partially used blocks");
+static const char * const msg_noplan   = N_("Planning is not supported for this filesystem");
 
 /* Command-line options. */
 static int opt_allzero       = 0;
 static int opt_bg            = 0;
+static int opt_direct        = 0;
 static int opt_force         = 0;
+static int opt_idle          = 0;
 static int opt_ioctl         = 0;
 static int opt_nopart        = 0;
 static int opt_nounrm        = 0;
 static int opt_nowfs         = 0;
 static int opt_no_wipe_zero  = 0;
+static int opt_plan          = 0;
+static int opt_stats         = 0;
 static int opt_use_dedicated = 0;
 static int opt_verbose       = 0;
 static int opt_zero          = 0;
+static char * opt_state_file_name = NULL;
+static char * opt_incremental_dir = NULL;
 
 static int wfs_optind        = 0;
 
 #if (defined HAVE_GETOPT_H) && (defined HAVE_GETOPT_LONG)
 static int opt_blksize       = 0;
 static int opt_help          = 0;
+static int opt_incremental   = 0;
+static int opt_ionice        = 0;
 static int opt_license       = 0;
+static int opt_max_rate      = 0;
 static int opt_number        = 0;
 static int opt_order         = 0;
+static int opt_progress_fd   = 0;
+static int opt_progress_fmt  = 0;
+static int opt_state_file    = 0;
 static int opt_super         = 0;
 static int opt_version       = 0;
 static int opt_method        = 0;
@@ -233,18 +256,27 @@ static const struct option opts[] =
 	{ "all-zeros",           no_argument,       &opt_allzero,       1 },
 	{ "background",          no_argument,       &opt_bg,            1 },
 	{ "blocksize",           required_argument, &opt_blksize,       1 },
+	{ "direct",              no_argument,       &opt_direct,        1 },
 	{ "force",               no_argument,       &opt_force,         1 },
 	{ "help",                no_argument,       &opt_help,          1 },
+	{ "incremental",         required_argument, &opt_incremental,   1 },
+	{ "ionice",              required_argument, &opt_ionice,        1 },
 	{ "iterations",          required_argument, &opt_number,        1 },
 	{ "last-zero",           no_argument,       &opt_zero,          1 },
 	{ "licence",             no_argument,       &opt_license,       1 },
 	{ "license",             no_argument,       &opt_license,       1 },
+	{ "max-rate",            required_argument, &opt_max_rate,      1 },
 	{ "method",              required_argument, &opt_method,        1 },
 	{ "nopart",              no_argument,       &opt_nopart,        1 },
 	{ "nounrm",              no_argument,       &opt_nounrm,        1 },
 	{ "nowfs",               no_argument,       &opt_nowfs,         1 },
 	{ "no-wipe-zero-blocks", no_argument,       &opt_no_wipe_zero,  1 },
 	{ "order",               required_argument, &opt_order,         1 },
+	{ "plan",                no_argument,       &opt_plan,          1 },
+	{ "progress-fd",         required_argument, &opt_progress_fd,   1 },
+	{ "progress-format",     required_argument, &opt_progress_fmt,  1 },
+	{ "state-file",          required_argument, &opt_state_file,    1 },
+	{ "stats",               no_argument,       &opt_stats,         1 },
 	{ "superblock",          required_argument, &opt_super,         1 },
 	{ "use-dedicated",       no_argument,       &opt_use_dedicated, 1 },
 	{ "use-ioctl",           no_argument,       &opt_ioctl,         1 },
@@ -267,6 +299,11 @@ const char * const wfs_sig_unk = N_("unknown");
 static unsigned long int blocksize = 0;
 static unsigned long int super_off = 0;
 static wfs_wipe_mode_t wiping_mode = WFS_WIPE_MODE_PATTERN;
+static unsigned long int chunk_size = WFS_DEFAULT_CHUNK_SIZE;
+static unsigned long int max_rate = 0;
+static unsigned long int max_iops = 0;
+static unsigned long int progress_fd = 0;
+static wfs_progress_format_t progress_format = WFS_PROGRESS_FORMAT_TEXT;
 
 static /*@observer@*/ const char *wfs_progname;	/* The name of the program */
 static int stdout_open = 1;
@@ -509,6 +546,11 @@ wfs_show_progress (
 {
 	unsigned int i;
 
+	if ( (type == WFS_PROGRESS_WFS) || (type == WFS_PROGRESS_PART)
+		|| (type == WFS_PROGRESS_UNRM) )
+	{
+		wfs_progress_percent (type, percent);
+	}
 	if ( (stdout_open == 0) || (opt_verbose == 0) || (prev_percent == NULL)
 		|| (
 			(type != WFS_PROGRESS_WFS)
@@ -600,17 +642,26 @@ print_help (
 	puts ( _("--background\t\tContinue work in the background, if possible") );
 	puts ( _("-b|--superblock <off>\tSuperblock offset on the given filesystems") );
 	puts ( _("-B|--blocksize <size>\tBlock size on the given filesystems") );
+	puts ( _("--direct\t\tUse direct I/O, bypassing the system's cache") );
 	puts ( _("-f|--force\t\tWipe even if the file system has errors") );
 	puts ( _("-h|--help\t\tPrint help") );
+	puts ( _("--incremental <dir>\tWipe only the blocks freed since the last run") );
+	puts ( _("--ionice idle\t\tWipe only when the disks and the processor are idle") );
 	puts ( _("-n|--iterations NNN\tNumber of passes (greater than 0)") );
 	puts ( _("--last-zero\t\tPerform additional wiping with zeros") );
 	puts ( _("-l|--license\t\tPrint license information") );
+	puts ( _("--max-rate <MB>[:<N>]\tWrite at most MB megabytes and N times per second") );
 	puts ( _("--method <name>\t\tUse the given method for wiping") );
 	puts ( _("--nopart\t\tDo NOT wipe free space in partially used blocks") );
 	puts ( _("--nounrm\t\tDo NOT wipe undelete information") );
 	puts ( _("--nowfs\t\t\tDo NOT wipe free space on file system") );
 	puts ( _("--no-wipe-zero-blocks\tDo NOT wipe all-zero blocks on file system") );
-	puts ( _("--order <mode>\t\tWiping order - pattern or block") );
+	puts ( _("--order <mode>\t\tWiping order - pattern, block or chunk[:size]") );
+	puts ( _("--plan\t\t\tOnly show how much would be wiped, writing nothing") );
+	puts ( _("--progress-fd <N>\tWrite a progress record every second to descriptor N") );
+	puts ( _("--progress-format <f>\tFormat of the progress records - text or json") );
+	puts ( _("--state-file <file>\tSave the progress to the file and resume from it") );
+	puts ( _("--stats\t\t\tShow the times and I/O statistics of each stage") );
 	puts ( _("--use-dedicated\t\tUse the program dedicated for the given filesystem type") );
 	puts ( _("--use-ioctl\t\tDisable device caching during work (can be DANGEROUS)") );
 	puts ( _("-v|--verbose\t\tVerbose output") );
@@ -620,6 +671,43 @@ print_help (
 
 /* ======================================================================== */
 
+#ifndef WFS_ANSIC
+static void wfs_show_state_error WFS_PARAMS ((const int res,
+	const wfs_fsid_t wfs_fs));
+#endif
+
+/**
+ * Displays an error of saving the progress to the state file, if any.
+ * \param res The result of saving the progress, an errno value.
+ * \param wfs_fs The filesystem whose progress was being saved.
+ */
+static void
+wfs_show_state_error (
+#ifdef WFS_ANSIC
+	const int res, const wfs_fsid_t wfs_fs)
+#else
+	res, wfs_fs)
+	const int res;
+	const wfs_fsid_t wfs_fs;
+#endif
+{
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err;
+
+	if ( res == 0 )
+	{
+		return;
+	}
+	/* an errno value, not an error of the filesystem's library */
+	wf_gen = wfs_fs;
+	wf_gen.whichfs = WFS_CURR_FS_NONE;
+	err = (wfs_errcode_t) res;
+	wf_gen.fs_error = &err;
+	wfs_show_error (wfs_err_msg_state, opt_state_file_name, wf_gen);
+}
+
+/* ======================================================================== */
+
 #ifndef WFS_ANSIC
 static wfs_errcode_t GCC_WARN_UNUSED_RESULT wfs_wipe_filesytem
 	WFS_PARAMS ((const char * const dev_name, const int total_fs));
@@ -639,6 +727,9 @@ wfs_wipe_filesytem (
 	wfs_fsid_t fs;			/* The file system we're working on */
 	wfs_fsdata_t data;
 	wfs_errcode_t res;
+	wfs_state_phase_t phase;	/* The stage to start from */
+	wfs_curr_fs_t probed;
+	wfs_wipe_ctx_t wipe_ctx;	/* The wiping method and its state */
 
 	WFS_MEMSET ( &fs, 0, sizeof (wfs_fsid_t) );
 	WFS_MEMSET ( &data, 0, sizeof (wfs_fsdata_t) );
@@ -650,6 +741,14 @@ wfs_wipe_filesytem (
 	fs.no_wipe_zero_blocks = opt_no_wipe_zero;
 	fs.use_dedicated = opt_use_dedicated;
 	fs.wipe_mode = wiping_mode;
+	fs.chunk_size = chunk_size;
+	fs.use_direct = opt_direct;
+	fs.max_rate = max_rate;
+	fs.max_iops = max_iops;
+	fs.plan_only = opt_plan;
+	wfs_wipe_ctx_init (&wipe_ctx, npasses, opt_verbose, opt_allzero,
+		opt_method_name);
+	fs.wipe_ctx = &wipe_ctx;
 
 	if ( dev_name == NULL )
 	{
@@ -657,6 +756,7 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return WFS_BAD_CMDLN;
 	}
 
@@ -666,6 +766,7 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return WFS_BAD_CMDLN;
 	}
 
@@ -680,11 +781,15 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return WFS_SIGNAL;
 	}
 
+	wfs_stats_set_fs (fs);
 	/* checking if fs mounted */
+	wfs_stats_begin (WFS_STATS_CHECK);
 	ret = wfs_chk_mount (fs);
+	wfs_stats_end ();
 	if ( ret != WFS_SUCCESS )
 	{
 		wfs_show_error ((ret==WFS_MNTCHK)? wfs_err_msg_checkmt : wfs_err_msg_mtrw,
@@ -693,6 +798,7 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return ret;
 	}
 
@@ -702,11 +808,29 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return WFS_SIGNAL;
 	}
 
+	if ( opt_plan != 0 )
+	{
+		probed = wfs_probe_fs (fs.fsname);
+		if ( (probed == WFS_CURR_FS_XFS) || (probed == WFS_CURR_FS_FATFS) )
+		{
+			/* these are wiped by writing, not from a list of free
+			   blocks - nothing to plan, so they are not even opened */
+			wfs_show_msg (0, msg_noplan, dev_name, fs);
+			if ( fs.fs_error != NULL )
+			{
+				free (fs.fs_error);
+			}
+			wfs_wipe_ctx_free (&wipe_ctx);
+			return WFS_SUCCESS;
+		}
+	}
+
 #ifdef HAVE_IOCTL
-	if ( opt_ioctl != 0 )
+	if ( (opt_ioctl != 0) && (ioctls != NULL) )
 	{
 		/* disabling the hardware disk cache */
 		if ( (sig_recvd == 0) && (opt_verbose > 0) )
@@ -729,11 +853,13 @@ wfs_wipe_filesytem (
 
 	data.e2fs.super_off = super_off;
 	data.e2fs.blocksize = (unsigned int) (blocksize & 0x0FFFFFFFF);
+	wfs_stats_begin (WFS_STATS_OPEN);
 	ret = wfs_open_fs (&fs, &data);
+	wfs_stats_end ();
 	if ( ret != WFS_SUCCESS )
 	{
 #ifdef HAVE_IOCTL
-		if ( opt_ioctl != 0 )
+		if ( (opt_ioctl != 0) && (ioctls != NULL) )
 		{
 			/* re-enabling the hardware disk cache in case of errors */
 			res = wfs_enable_drive_cache (fs, total_fs, ioctls);
@@ -749,6 +875,7 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return WFS_OPENFS;
 	}
 	if ( (fs.whichfs != WFS_CURR_FS_XFS) && (fs.use_dedicated == 0) )
@@ -772,7 +899,7 @@ wfs_wipe_filesytem (
 		/* close the filesystems if a signal was received */
 		wfs_close_fs (fs);
 #ifdef HAVE_IOCTL
-		if ( opt_ioctl != 0 )
+		if ( (opt_ioctl != 0) && (ioctls != NULL) )
 		{
 			/* re-enabling the hardware disk cache */
 			res = wfs_enable_drive_cache (fs, total_fs, ioctls);
@@ -787,16 +914,19 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return WFS_SIGNAL;
 	}
 
 	/* checking for filesystem errors */
+	wfs_stats_begin (WFS_STATS_CHECK);
 	if ( (opt_force == 0) && (wfs_check_err (fs) != 0) )
 	{
+		wfs_stats_end ();
 		wfs_show_msg (1, wfs_err_msg_fserr, dev_name, fs);
 		wfs_close_fs (fs);
 #ifdef HAVE_IOCTL
-		if ( opt_ioctl != 0 )
+		if ( (opt_ioctl != 0) && (ioctls != NULL) )
 		{
 			/* re-enabling the hardware disk cache in case of errors */
 			res = wfs_enable_drive_cache (fs, total_fs, ioctls);
@@ -811,8 +941,10 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
 		return WFS_FSHASERROR;
 	}
+	wfs_stats_end ();
 
 	/* ALWAYS flush the file system before starting. */
 	/*if ( (sig_recvd == 0) && (wfs_is_dirty (fs) != 0) )*/
@@ -821,7 +953,12 @@ wfs_wipe_filesytem (
 		{
 			wfs_show_msg (1, msg_flushfs, dev_name, fs);
 		}
-		wfs_flush_fs (fs);
+		if ( opt_plan == 0 )
+		{
+			wfs_stats_begin (WFS_STATS_FLUSH);
+			wfs_flush_fs (fs);
+			wfs_stats_end ();
+		}
 	}
 
         if ( sig_recvd != 0 )
@@ -829,7 +966,7 @@ wfs_wipe_filesytem (
 		/* close the filesystems if a signal was received */
 		wfs_close_fs (fs);
 #ifdef HAVE_IOCTL
-		if ( opt_ioctl != 0 )
+		if ( (opt_ioctl != 0) && (ioctls != NULL) )
 		{
 			/* re-enabling the hardware disk cache */
 			res = wfs_enable_drive_cache (fs, total_fs, ioctls);
@@ -844,17 +981,35 @@ wfs_wipe_filesytem (
 		{
 			free (fs.fs_error);
 		}
+		wfs_wipe_ctx_free (&wipe_ctx);
         	return WFS_SIGNAL;
         }
+
+	wfs_progress_set_fs (fs);
+	if ( (opt_plan != 0) && ((opt_nounrm == 0) || (opt_nopart == 0))
+		&& (sig_recvd == 0) )
+	{
+		wfs_show_msg (0, msg_planpart, "", fs);
+	}
+	/* skip the stages done by a previous, interrupted run */
+	phase = wfs_state_start (fs);
+	if ( (phase != WFS_STATE_NONE) && (opt_verbose > 0) )
+	{
+		wfs_show_msg (1, msg_resume, dev_name, fs);
+	}
 #ifdef WFS_WANT_UNRM
         /* removing undelete information */
-	if ( (opt_nounrm == 0) && (sig_recvd == 0) )
+	if ( (opt_nounrm == 0) && (opt_plan == 0) && (sig_recvd == 0)
+		&& (phase <= WFS_STATE_UNRM) )
 	{
 		if ( opt_verbose > 0 )
 		{
 			wfs_show_msg (1, msg_wipeunrm, dev_name, fs);
 		}
+		wfs_show_state_error (wfs_state_set_phase (fs, WFS_STATE_UNRM), fs);
+		wfs_stats_begin (WFS_STATS_UNRM);
 		res = wipe_unrm (fs);
+		wfs_stats_end ();
 		if ( res != WFS_SUCCESS )
 		{
 			if ( ret == WFS_SUCCESS )
@@ -868,14 +1023,18 @@ wfs_wipe_filesytem (
 #endif
 #ifdef WFS_WANT_PART
 	/* wiping partially occupied blocks */
-	if ( (opt_nopart == 0) && (sig_recvd == 0) )
+	if ( (opt_nopart == 0) && (opt_plan == 0) && (sig_recvd == 0)
+		&& (phase <= WFS_STATE_PART) )
 	{
 		if ( opt_verbose > 0 )
 		{
 			wfs_show_msg (1, msg_wipeused, dev_name, fs);
 		}
 
+		wfs_show_state_error (wfs_state_set_phase (fs, WFS_STATE_PART), fs);
+		wfs_stats_begin (WFS_STATS_PART);
 		res = wipe_part (fs);
+		wfs_stats_end ();
 		if ( res != WFS_SUCCESS )
 		{
 			if ( ret == WFS_SUCCESS )
@@ -889,13 +1048,18 @@ wfs_wipe_filesytem (
 #endif
 #ifdef WFS_WANT_WFS
 	/* wiping the free space in the filesystem */
-	if ( (opt_nowfs == 0) && (sig_recvd == 0) )
+	if ( (opt_nowfs == 0) && (sig_recvd == 0) && (phase <= WFS_STATE_WFS) )
 	{
 		if ( opt_verbose > 0 )
 		{
 			wfs_show_msg (1, msg_wipefs, dev_name, fs);
 		}
+		wfs_show_state_error (wfs_state_set_phase (fs, WFS_STATE_WFS), fs);
+		wfs_stats_begin (WFS_STATS_WFS);
 		res = wipe_fs (fs);
+		wfs_stats_end ();
+		/* the position is saved while wiping */
+		wfs_show_state_error (wfs_state_get_save_error (), fs);
 		if ( res != WFS_SUCCESS )
 		{
 			if ( ret == WFS_SUCCESS )
@@ -907,14 +1071,23 @@ wfs_wipe_filesytem (
 		}
 	}
 #endif
+	if ( (sig_recvd == 0) && (ret == WFS_SUCCESS) )
+	{
+		wfs_show_state_error (wfs_state_set_phase (fs, WFS_STATE_DONE), fs);
+	}
 	if ( opt_verbose > 0 )
 	{
 		wfs_show_msg (1, msg_closefs, dev_name, fs);
 	}
 
 	/* flush the changes and close the filesystem */
-	wfs_flush_fs (fs);
+	wfs_stats_begin (WFS_STATS_CLOSE);
+	if ( opt_plan == 0 )
+	{
+		wfs_flush_fs (fs);
+	}
 	res = wfs_close_fs (fs);
+	wfs_stats_end ();
 	if ( res != WFS_SUCCESS )
 	{
 		if ( ret == WFS_SUCCESS )
@@ -925,7 +1098,7 @@ wfs_wipe_filesytem (
 			dev_name, fs);
 	}
 #ifdef HAVE_IOCTL
-	if ( opt_ioctl != 0 )
+	if ( (opt_ioctl != 0) && (ioctls != NULL) )
 	{
 		/* re-enabling the hardware disk cache after work */
 		res = wfs_enable_drive_cache (fs, total_fs, ioctls);
@@ -936,10 +1109,13 @@ wfs_wipe_filesytem (
 		}
 	}
 #endif
+	/* here, because the filesystem may be wiped in a child process */
+	wfs_stats_report ();
 	if ( fs.fs_error != NULL )
 	{
 		free (fs.fs_error);
 	}
+	wfs_wipe_ctx_free (&wipe_ctx);
 	return ret;
 }
 
@@ -991,6 +1167,217 @@ static int GCC_WARN_UNUSED_RESULT wfs_read_ulong_param (
 	return 0;
 }
 
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_read_order_param
+	WFS_PARAMS ((const char param[], wfs_wipe_mode_t * const mode,
+		unsigned long int * const size));
+#endif
+
+/**
+ * Reads the wiping order: "pattern", "block", "chunk" or "chunk:<size>",
+ *	where the size can end with K, M or G.
+ * \param param The parameter to read.
+ * \param mode Pointer to the wiping mode to set.
+ * \param size Pointer to the chunk size to set, for chunk order.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT wfs_read_order_param (
+#ifdef WFS_ANSIC
+	const char param[], wfs_wipe_mode_t * const mode,
+	unsigned long int * const size)
+#else
+	param, mode, size)
+	const char param[];
+	wfs_wipe_mode_t * const mode;
+	unsigned long int * const size;
+#endif
+{
+	unsigned long int value;
+	unsigned long int multiplier = 1;
+	const unsigned long int max_value = ~0UL;
+	size_t i;
+
+	if ( (param == NULL) || (mode == NULL) || (size == NULL) )
+	{
+		return -1;
+	}
+	if ( WFS_STRCASECMP ( param, "block" ) == 0 )
+	{
+		*mode = WFS_WIPE_MODE_BLOCK;
+		return 0;
+	}
+	if ( WFS_STRCASECMP ( param, "pattern" ) == 0 )
+	{
+		*mode = WFS_WIPE_MODE_PATTERN;
+		return 0;
+	}
+	if ( WFS_STRCASECMP ( param, "chunk" ) == 0 )
+	{
+		*mode = WFS_WIPE_MODE_CHUNK;
+		*size = WFS_DEFAULT_CHUNK_SIZE;
+		return 0;
+	}
+	if ( (strlen (param) < 7) || ((param[0] != 'c') && (param[0] != 'C'))
+		|| ((param[1] != 'h') && (param[1] != 'H'))
+		|| ((param[2] != 'u') && (param[2] != 'U'))
+		|| ((param[3] != 'n') && (param[3] != 'N'))
+		|| ((param[4] != 'k') && (param[4] != 'K'))
+		|| (param[5] != ':') )
+	{
+		return -2;
+	}
+	value = 0;
+	for ( i = 6; (param[i] >= '0') && (param[i] <= '9'); i++ )
+	{
+		if ( value > (max_value - (unsigned long int)(param[i] - '0')) / 10 )
+		{
+			return -3;
+		}
+		value = value * 10 + (unsigned long int)(param[i] - '0');
+	}
+	if ( i == 6 )
+	{
+		return -2;
+	}
+	if ( (param[i] == 'k') || (param[i] == 'K') )
+	{
+		multiplier = 1024UL;
+		i++;
+	}
+	else if ( (param[i] == 'm') || (param[i] == 'M') )
+	{
+		multiplier = 1024UL * 1024;
+		i++;
+	}
+	else if ( (param[i] == 'g') || (param[i] == 'G') )
+	{
+		multiplier = 1024UL * 1024 * 1024;
+		i++;
+	}
+	if ( (param[i] != '\0') || (value == 0)
+		|| (value > max_value / multiplier) )
+	{
+		return -2;
+	}
+	*mode = WFS_WIPE_MODE_CHUNK;
+	*size = value * multiplier;
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_read_progress_format_param
+	WFS_PARAMS ((const char param[], wfs_progress_format_t * const format));
+#endif
+
+/**
+ * Reads the format of the progress records: "text" or "json".
+ * \param param The parameter to read.
+ * \param format Pointer to the format to set.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT wfs_read_progress_format_param (
+#ifdef WFS_ANSIC
+	const char param[], wfs_progress_format_t * const format)
+#else
+	param, format)
+	const char param[];
+	wfs_progress_format_t * const format;
+#endif
+{
+	if ( (param == NULL) || (format == NULL) )
+	{
+		return -1;
+	}
+	if ( WFS_STRCASECMP ( param, "text" ) == 0 )
+	{
+		*format = WFS_PROGRESS_FORMAT_TEXT;
+	}
+	else if ( WFS_STRCASECMP ( param, "json" ) == 0 )
+	{
+		*format = WFS_PROGRESS_FORMAT_JSON;
+	}
+	else
+	{
+		return -2;
+	}
+	return 0;
+}
+
+/* ======================================================================== */
+
+#ifndef WFS_ANSIC
+static int GCC_WARN_UNUSED_RESULT wfs_read_rate_param
+	WFS_PARAMS ((const char param[], unsigned long int * const rate,
+		unsigned long int * const iops));
+#endif
+
+/**
+ * Reads the writing rate limit: "<MB>" or "<MB>:<N>", where MB is the
+ *	number of megabytes and N is the number of writes per second. Zero
+ *	means no limit.
+ * \param param The parameter to read.
+ * \param rate Pointer to the number of bytes per second to set.
+ * \param iops Pointer to the number of writes per second to set.
+ * \return 0 in case of no errors, other values otherwise.
+ */
+static int GCC_WARN_UNUSED_RESULT wfs_read_rate_param (
+#ifdef WFS_ANSIC
+	const char param[], unsigned long int * const rate,
+	unsigned long int * const iops)
+#else
+	param, rate, iops)
+	const char param[];
+	unsigned long int * const rate;
+	unsigned long int * const iops;
+#endif
+{
+	unsigned long int values[2] = {0, 0};
+	const unsigned long int max_value = ~0UL;
+	size_t i = 0;
+	size_t start;
+	int v;
+
+	if ( (param == NULL) || (rate == NULL) || (iops == NULL) )
+	{
+		return -1;
+	}
+	for ( v = 0; v < 2; v++ )
+	{
+		start = i;
+		for ( ; (param[i] >= '0') && (param[i] <= '9'); i++ )
+		{
+			if ( values[v] > (max_value
+				- (unsigned long int)(param[i] - '0')) / 10 )
+			{
+				return -3;
+			}
+			values[v] = values[v] * 10
+				+ (unsigned long int)(param[i] - '0');
+		}
+		if ( i == start )
+		{
+			return -2;
+		}
+		if ( param[i] != ':' )
+		{
+			break;
+		}
+		i++;
+	}
+	if ( (param[i] != '\0')
+		|| (values[0] > max_value / (1024UL * 1024)) )
+	{
+		return -2;
+	}
+	*rate = values[0] * 1024UL * 1024;
+	*iops = values[1];
+	return 0;
+}
+
 /* ======================================================================== */
 #ifndef WFS_ANSIC
 int main WFS_PARAMS ((int argc, char* argv[]));
@@ -1028,6 +1415,13 @@ main (
 	wf_gen.no_wipe_zero_blocks = 0;
 	wf_gen.use_dedicated = 0;
 	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	wf_gen.chunk_size = WFS_DEFAULT_CHUNK_SIZE;
+	wf_gen.use_direct = 0;
+	wf_gen.max_rate = 0;
+	wf_gen.max_iops = 0;
+	wf_gen.plan_only = 0;
+	wf_gen.wipe_ctx = NULL;
+	wf_gen.fs_uuid[0] = '\0';
 	wfs_check_stds (&stdout_open, &stderr_open);
 
 #ifdef HAVE_LIBINTL_H
@@ -1196,15 +1590,34 @@ main (
 		}
 		if ( opt_order == 1 )
 		{
-			if ( WFS_STRCASECMP ( optarg, "block" ) == 0 )
+			res = wfs_read_order_param ( optarg, &wiping_mode,
+				&chunk_size );
+			if ( res != 0 )
 			{
-				wiping_mode = WFS_WIPE_MODE_BLOCK;
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
 			}
-			else if ( WFS_STRCASECMP ( optarg, "pattern" ) == 0 )
+			opt_order = 0;
+		}
+		if ( opt_max_rate == 1 )
+		{
+			res = wfs_read_rate_param ( optarg, &max_rate, &max_iops );
+			if ( res != 0 )
 			{
-				wiping_mode = WFS_WIPE_MODE_PATTERN;
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
 			}
-			else
+			opt_max_rate = 0;
+		}
+		if ( opt_ionice == 1 )
+		{
+			if ( WFS_STRCASECMP ( optarg, "idle" ) != 0 )
 			{
 				if ( stdout_open == 1 )
 				{
@@ -1212,7 +1625,45 @@ main (
 				}
 				return WFS_BAD_CMDLN;
 			}
-			opt_order = 0;
+			opt_idle = 1;
+			opt_ionice = 0;
+		}
+		if ( opt_state_file == 1 )
+		{
+			opt_state_file_name = optarg;
+			opt_state_file = 0;
+		}
+		if ( opt_incremental == 1 )
+		{
+			opt_incremental_dir = optarg;
+			opt_incremental = 0;
+		}
+		if ( opt_progress_fd == 1 )
+		{
+			res = wfs_read_ulong_param ( optarg, &progress_fd );
+			if ( res != 0 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			opt_progress_fd = 0;
+		}
+		if ( opt_progress_fmt == 1 )
+		{
+			res = wfs_read_progress_format_param ( optarg,
+				&progress_format );
+			if ( res != 0 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			opt_progress_fmt = 0;
 		}
 	}
 	wfs_optind = optind;
@@ -1423,6 +1874,27 @@ main (
 			continue;
 		}
 
+		if ( strcmp (argv[i], "--direct") == 0 )
+		{
+			opt_direct = 1;
+			argv[i] = NULL;
+			continue;
+		}
+
+		if ( strcmp (argv[i], "--stats") == 0 )
+		{
+			opt_stats = 1;
+			argv[i] = NULL;
+			continue;
+		}
+
+		if ( strcmp (argv[i], "--plan") == 0 )
+		{
+			opt_plan = 1;
+			argv[i] = NULL;
+			continue;
+		}
+
 		if ( strcmp (argv[i], "--order") == 0 )
 		{
 			if ( i >= argc-1 )
@@ -1433,15 +1905,48 @@ main (
 				}
 				return WFS_BAD_CMDLN;
 			}
-			if ( WFS_STRCASECMP ( argv[i+1], "block" ) == 0 )
+			if ( wfs_read_order_param ( argv[i+1], &wiping_mode,
+				&chunk_size ) != 0 )
 			{
-				wiping_mode = WFS_WIPE_MODE_BLOCK;
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
 			}
-			else if ( WFS_STRCASECMP ( argv[i+1], "pattern" ) == 0 )
+			argv[i] = NULL;
+			argv[i+1] = NULL;
+			continue;
+		}
+
+		if ( strcmp (argv[i], "--state-file") == 0 )
+		{
+			if ( i >= argc-1 )
 			{
-				wiping_mode = WFS_WIPE_MODE_PATTERN;
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			opt_state_file_name = argv[i+1];
+			argv[i] = NULL;
+			argv[i+1] = NULL;
+			continue;
+		}
+
+		if ( strcmp (argv[i], "--progress-fd") == 0 )
+		{
+			if ( i >= argc-1 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
 			}
-			else
+			res = wfs_read_ulong_param ( argv[i+1], &progress_fd );
+			if ( res != 0 )
 			{
 				if ( stdout_open == 1 )
 				{
@@ -1453,6 +1958,95 @@ main (
 			argv[i+1] = NULL;
 			continue;
 		}
+
+		if ( strcmp (argv[i], "--progress-format") == 0 )
+		{
+			if ( i >= argc-1 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			res = wfs_read_progress_format_param ( argv[i+1],
+				&progress_format );
+			if ( res != 0 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			argv[i] = NULL;
+			argv[i+1] = NULL;
+			continue;
+		}
+
+		if ( strcmp (argv[i], "--incremental") == 0 )
+		{
+			if ( i >= argc-1 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			opt_incremental_dir = argv[i+1];
+			argv[i] = NULL;
+			argv[i+1] = NULL;
+			continue;
+		}
+
+		if ( strcmp (argv[i], "--max-rate") == 0 )
+		{
+			if ( i >= argc-1 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			if ( wfs_read_rate_param ( argv[i+1], &max_rate,
+				&max_iops ) != 0 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			argv[i] = NULL;
+			argv[i+1] = NULL;
+			continue;
+		}
+
+		if ( strcmp (argv[i], "--ionice") == 0 )
+		{
+			if ( i >= argc-1 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			if ( WFS_STRCASECMP ( argv[i+1], "idle" ) != 0 )
+			{
+				if ( stdout_open == 1 )
+				{
+					print_help (wfs_progname);
+				}
+				return WFS_BAD_CMDLN;
+			}
+			opt_idle = 1;
+			argv[i] = NULL;
+			argv[i+1] = NULL;
+			continue;
+		}
 		if ( strcmp (argv[i], "--") == 0 )
 		{
 			/* end-of-arguments marker */
@@ -1505,6 +2099,17 @@ main (
 #endif
 	}
 
+	if ( opt_idle == 1 )
+	{
+		/* inherited by the child processes, too */
+		res = wfs_set_idle_priority ();
+		if ( res != 0 )
+		{
+			err = res;
+			wfs_show_error (wfs_err_msg_ionice, wfs_progname, wf_gen);
+		}
+	}
+
 #ifdef HAVE_SIGNAL_H
 	if ( opt_verbose > 0 )
 	{
@@ -1543,6 +2148,48 @@ main (
 		wfs_init_wiping (npasses, opt_verbose, opt_allzero, opt_method_name);
 	}
 
+	if ( opt_plan != 0 )
+	{
+		/* nothing may be written, not even the drives' settings,
+		   and the progress saved in the state file stays unchanged */
+		opt_ioctl = 0;
+		opt_use_dedicated = 0;
+		opt_direct = 0;
+		opt_state_file_name = NULL;
+	}
+
+	if ( opt_state_file_name != NULL )
+	{
+		res = wfs_state_init (opt_state_file_name);
+		if ( res != 0 )
+		{
+			err = res;
+			wfs_show_error (wfs_err_msg_state, opt_state_file_name, wf_gen);
+			return WFS_BAD_CMDLN;
+		}
+	}
+
+	if ( progress_fd != 0 )
+	{
+		wfs_progress_init ((int) progress_fd, progress_format);
+	}
+
+	if ( opt_stats != 0 )
+	{
+		wfs_stats_init ();
+	}
+
+	if ( opt_incremental_dir != NULL )
+	{
+		res = wfs_snapshot_init (opt_incremental_dir);
+		if ( res != 0 )
+		{
+			err = res;
+			wfs_show_error (wfs_err_msg_snapdir, opt_incremental_dir, wf_gen);
+			return WFS_BAD_CMDLN;
+		}
+	}
+
 	/* remove duplicate command-line parameters */
 	res = wfs_optind;
 	while ( wfs_optind < argc-1 )
@@ -1739,6 +2386,13 @@ subsequent loop iterations may fail, so don't enable. */
 	ioctls = NULL;
 #endif
 	wfs_lib_deinit ();
+	/* all wiped - the state file is not needed anymore */
+	res = wfs_state_finish ();
+	if ( res != 0 )
+	{
+		err = res;
+		wfs_show_error (wfs_err_msg_state, opt_state_file_name, wf_gen);
+	}
 
 	if ( sig_recvd != 0 )
 	{
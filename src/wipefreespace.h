@@ -104,6 +104,22 @@ Stat macros broken. Change your C library.
 
 # define	WFS_MNTBUFLEN 4096
 
+# ifdef WFS_DEFAULT_CHUNK_SIZE
+#  undef WFS_DEFAULT_CHUNK_SIZE
+# endif
+
+/* the default number of bytes wiped with all the patterns at a time,
+   in chunk-order mode */
+# define	WFS_DEFAULT_CHUNK_SIZE (64UL * 1024 * 1024)
+
+# ifdef WFS_UUID_SIZE
+#  undef WFS_UUID_SIZE
+# endif
+
+/* the size of a filesystem's UUID as text: 32 hexadecimal digits,
+   4 dashes and the terminating zero */
+# define	WFS_UUID_SIZE 37
+
 # ifdef WFS_IS_SYNC_NEEDED
 #  undef WFS_IS_SYNC_NEEDED
 # endif
@@ -183,7 +199,8 @@ typedef enum wfs_curr_fs wfs_curr_fs_t;
 enum wfs_wipe_mode
 {
 	WFS_WIPE_MODE_PATTERN	= 0,
-	WFS_WIPE_MODE_BLOCK
+	WFS_WIPE_MODE_BLOCK,
+	WFS_WIPE_MODE_CHUNK
 };
 
 typedef enum wfs_wipe_mode wfs_wipe_mode_t;
@@ -352,6 +369,9 @@ typedef unsigned short int __u16;
 # define	gettext_noop(String)	String
 # define	N_(String)		String
 
+/* The wiping method and its state, defined in wfs_wiping.h */
+struct wfs_wipe_ctx;
+
 struct wfs_fsid
 {
 		/* filesystem name, for informational purposes: */
@@ -372,8 +392,29 @@ struct wfs_fsid
 	int no_wipe_zero_blocks;
 		/* whether not to use the dedicated wiping tool: */
 	int use_dedicated;
-		/* the wiping mode - block-order or pattern-order: */
+		/* the wiping mode - block-order, pattern-order or chunk-order: */
 	wfs_wipe_mode_t wipe_mode;
+		/* the number of bytes wiped with all the patterns
+		at a time, in chunk-order mode: */
+	unsigned long int chunk_size;
+		/* whether to bypass the system's cache
+		when wiping (direct I/O): */
+	int use_direct;
+		/* the maximum number of bytes written
+		per second, 0 means no limit: */
+	unsigned long int max_rate;
+		/* the maximum number of writes
+		per second, 0 means no limit: */
+	unsigned long int max_iops;
+		/* whether to only show how much would be
+		wiped, opening the filesystem read-only: */
+	int plan_only;
+		/* the wiping method and its state for this
+		filesystem, NULL means the one set by wfs_init_wiping(): */
+	struct wfs_wipe_ctx * wipe_ctx;
+		/* the UUID from the filesystem's superblock,
+		empty if not known: */
+	char fs_uuid[WFS_UUID_SIZE];
 };
 
 typedef struct wfs_fsid wfs_fsid_t;
@@ -497,6 +538,9 @@ extern const char * const wfs_err_msg_diriter;
 extern const char * const wfs_err_msg_nowork;
 extern const char * const wfs_err_msg_suid;
 extern const char * const wfs_err_msg_capset;
+extern const char * const wfs_err_msg_ionice;
+extern const char * const wfs_err_msg_state;
+extern const char * const wfs_err_msg_snapdir;
 extern const char * const wfs_err_msg_fork;
 extern const char * const wfs_err_msg_nocache;
 extern const char * const wfs_err_msg_cacheon;
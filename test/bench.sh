@@ -0,0 +1,316 @@
+#!/bin/sh
+#
+# WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+#	-- bench.sh, benchmarks of the filesystem backends on generated images.
+#
+# Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+# License: GNU General Public License, v2+
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Creates an image of each filesystem that has a mkfs program installed,
+# wipes it with each of the selected modes, orders and methods and prints
+# one result per run - the throughput, the number of system calls and
+# the peak memory usage - as CSV or JSON. The settings are taken from
+# the environment:
+#
+# WFS		the program to run (default: ../src/wipefreespace)
+# BENCH_FS	the filesystems to test (default: ext4 vfat hfsp jfs minix
+#		ntfs ocfs reiser reiser4 xfs), those without a mkfs program
+#		or not supported by the program are skipped
+# BENCH_SIZE	the size of the images in megabytes (default: 64, XFS
+#		images are at least 300 MB)
+# BENCH_FILL	how many percent of each image to fill with files, every
+#		other of which is deleted to fragment the free space
+#		(default: 0 - no fragmentation, otherwise requires root)
+# BENCH_FILE_KB	the size of each of these files in kilobytes (default: 64)
+# BENCH_DIR	where to create the images, e.g. a tmpfs mount (default: .)
+# BENCH_LOOP	1 - wipe the images through loop devices (requires root)
+# BENCH_MODES	the wiping modes - any of: wfs part unrm (default: all)
+# BENCH_ORDERS	the wiping orders (default: pattern block chunk)
+# BENCH_METHODS	the wiping methods - "default", "zeros" or any method
+#		name accepted by '--method' (default: default zeros random)
+# BENCH_PASSES	the number of passes for "default" and "zeros" (default: 1)
+# BENCH_SYSCALLS 0 - don't count the system calls, which makes each run
+#		again under strace, if available (default: 1)
+# BENCH_FORMAT	csv or json (default: csv)
+# BENCH_OUT	the file to write the results to (default: standard output)
+#
+# Example: BENCH_DIR=/dev/shm BENCH_FS='ext4 ntfs' BENCH_FILL=50 make bench
+
+WFS=${WFS:-../src/wipefreespace}
+BENCH_FS=${BENCH_FS:-'ext4 vfat hfsp jfs minix ntfs ocfs reiser reiser4 xfs'}
+BENCH_SIZE=${BENCH_SIZE:-64}
+BENCH_FILL=${BENCH_FILL:-0}
+BENCH_FILE_KB=${BENCH_FILE_KB:-64}
+BENCH_DIR=${BENCH_DIR:-.}
+BENCH_LOOP=${BENCH_LOOP:-0}
+BENCH_MODES=${BENCH_MODES:-'wfs part unrm'}
+BENCH_ORDERS=${BENCH_ORDERS:-'pattern block chunk'}
+BENCH_METHODS=${BENCH_METHODS:-'default zeros random'}
+BENCH_PASSES=${BENCH_PASSES:-1}
+BENCH_SYSCALLS=${BENCH_SYSCALLS:-1}
+BENCH_FORMAT=${BENCH_FORMAT:-csv}
+BENCH_OUT=${BENCH_OUT:-/dev/stdout}
+
+tmp=$BENCH_DIR/bench-tmp.$$
+records=$tmp.records
+timing=$tmp.time
+counts=$tmp.strace
+mnt=$tmp.mnt
+nresults=0
+
+if ( test ! -x "$WFS" ); then
+	echo "$0: $WFS not found, run 'make' first" >&2
+	exit 1
+fi
+
+if ( test "`id -u`" != 0 ); then
+	if ( test "$BENCH_FILL" != 0 || test "$BENCH_LOOP" = 1 ); then
+		echo "$0: BENCH_FILL and BENCH_LOOP require root, ignored" >&2
+	fi
+	BENCH_FILL=0
+	BENCH_LOOP=0
+fi
+
+# GNU time gives the peak memory usage, 'date' gives just the time
+gnutime=
+if ( /usr/bin/time --version 2>&1 | grep GNU > /dev/null ); then
+	gnutime=/usr/bin/time
+fi
+strace=
+if ( test "$BENCH_SYSCALLS" != 0 && strace -V > /dev/null 2>&1 ); then
+	strace=strace
+fi
+
+trap 'rm -rf $tmp.*; exit 2' 1 2 15
+
+# Gets the command to create the given filesystem, empty if not installed
+mkfs_command()
+{
+	case $1 in
+		ext4)		cmd='mkfs.ext4 -F -q' ;;
+		vfat)		cmd='mkfs.vfat -F 32' ;;
+		hfsp)		cmd='hformat -l TEST' ;;
+		jfs)		cmd='mkfs.jfs -q' ;;
+		minix)		cmd='mkfs.minix -2' ;;
+		ntfs)		cmd='mkfs.ntfs -F -f -q' ;;
+		ocfs)		cmd='mkfs.ocfs2 -M local -q' ;;
+		reiser)		cmd='mkreiserfs -f -f -q' ;;
+		reiser4)	cmd='mkfs.reiser4 -y -f' ;;
+		xfs)		cmd='mkfs.xfs -f -q' ;;
+		*)		cmd= ;;
+	esac
+	if ( test -n "$cmd" && command -v ${cmd%% *} > /dev/null 2>&1 ); then
+		echo "$cmd"
+	fi
+}
+
+# Gets the type of the given filesystem for 'mount'
+mount_type()
+{
+	case $1 in
+		hfsp)	echo hfsplus ;;
+		ocfs)	echo ocfs2 ;;
+		reiser)	echo reiserfs ;;
+		*)	echo $1 ;;
+	esac
+}
+
+# Fills the mounted image with files and deletes every other one
+fragment()
+{
+	image=$1
+	type=`mount_type $2`
+	size=$3
+	mkdir -p $mnt
+	if ( ! mount -t $type -o loop $image $mnt 2> /dev/null ); then
+		echo "$0: cannot mount $image, not fragmented" >&2
+		rmdir $mnt
+		return
+	fi
+	nfiles=$(( size * 1024 * BENCH_FILL / 100 / BENCH_FILE_KB ))
+	i=0
+	while ( test $i -lt $nfiles ); do
+		dd if=/dev/urandom of=$mnt/f$i bs=1024 count=$BENCH_FILE_KB \
+			2> /dev/null || break
+		i=$(( i + 1 ))
+	done
+	i=0
+	while ( test $i -lt $nfiles ); do
+		rm -f $mnt/f$i
+		i=$(( i + 2 ))
+	done
+	umount $mnt
+	rmdir $mnt
+}
+
+# Prints one result in the selected format
+emit()
+{
+	if ( test "$BENCH_FORMAT" = json ); then
+		if ( test $nresults -eq 0 ); then
+			echo '['
+		else
+			echo ','
+		fi
+		printf '{"fs":"%s","size_mb":%s,"fill_pct":%s,"mode":"%s",' \
+			$1 $2 $3 $4
+		printf '"order":"%s","method":"%s","status":%s,' $5 $6 $7
+		printf '"elapsed_s":%s,"stage_s":%s,"bytes_written":%s,' \
+			${8:-null} ${9:-null} ${10:-null}
+		printf '"mb_per_s":%s,"syscalls":%s,"peak_rss_kb":%s}' \
+			${11:-null} ${12:-null} ${13:-null}
+	else
+		if ( test $nresults -eq 0 ); then
+			echo 'fs,size_mb,fill_pct,mode,order,method,status,elapsed_s,stage_s,bytes_written,mb_per_s,syscalls,peak_rss_kb'
+		fi
+		echo "$1,$2,$3,$4,$5,$6,$7,$8,$9,${10},${11},${12},${13}"
+	fi
+	nresults=$(( nresults + 1 ))
+}
+
+# Wipes the given device once and prints the result
+run()
+{
+	fs=$1
+	dev=$2
+	size=$3
+	mode=$4
+	order=$5
+	method=$6
+
+	case $mode in
+		wfs)	args='--nopart --nounrm' ;;
+		part)	args='--nowfs --nounrm' ;;
+		unrm)	args='--nowfs --nopart' ;;
+	esac
+	case $method in
+		default)	args="$args -n $BENCH_PASSES" ;;
+		zeros)		args="$args --all-zeros -n $BENCH_PASSES" ;;
+		*)		args="$args --method $method" ;;
+	esac
+	args="$args --order $order --stats --progress-format text --progress-fd 3"
+
+	rm -f $records $timing $counts
+	if ( test -n "$gnutime" ); then
+		$gnutime -o $timing -f '%e %M' $WFS $args $dev \
+			> /dev/null 2>&1 3> $records
+		status=$?
+	else
+		start=`date +%s.%N`
+		$WFS $args $dev > /dev/null 2>&1 3> $records
+		status=$?
+		end=`date +%s.%N`
+		echo "$start $end" | awk '{ printf "%.2f\n", $2 - $1 }' > $timing
+	fi
+	elapsed=`awk '{ print $1 }' $timing`
+	rss=`awk '{ print $2 }' $timing`
+
+	# the 'stats' records of the stage being measured
+	stage=`awk -v mode=$mode '
+		$1 == "stats=" mode {
+			for ( i = 2; i <= NF; i++ )
+			{
+				split ($i, kv, "=");
+				if ( kv[1] == "time_s" ) t += kv[2];
+				if ( kv[1] == "written" ) w += kv[2];
+			}
+			found = 1;
+		}
+		END {
+			if ( found ) printf "%.6f %.0f %.2f\n", t, w,
+				(t > 0)? w / t / 1048576 : 0;
+		}' $records`
+	set -- $stage
+	stage_s=$1
+	written=$2
+	speed=$3
+
+	calls=
+	if ( test -n "$strace" ); then
+		$strace -c -f -o $counts $WFS $args $dev \
+			> /dev/null 2>&1 3> /dev/null
+		# the columns of the total row may be empty, so take the
+		# one under the "calls" heading, the numbers are aligned to it
+		calls=`awk '
+			$NF == "syscall" { end = index ($0, "calls") + 4; }
+			$NF == "total" && end > 0 {
+				n = split (substr ($0, 1, end), f, " ");
+				print f[n];
+			}' $counts`
+	fi
+
+	emit $fs $size $BENCH_FILL $mode $order $method $status \
+		"$elapsed" "$stage_s" "$written" "$speed" "$calls" "$rss"
+}
+
+exec 4> $BENCH_OUT
+
+for fs in $BENCH_FS; do
+
+	mkfs=`mkfs_command $fs`
+	if ( test -z "$mkfs" ); then
+		echo "$0: no mkfs program for $fs, skipped" >&2
+		continue
+	fi
+	size=$BENCH_SIZE
+	if ( test $fs = xfs && test $size -lt 300 ); then
+		size=300
+	fi
+	image=$BENCH_DIR/bench-fs-$fs
+
+	echo "================= Creating $image" >&2
+	dd if=/dev/zero of=$image bs=1M count=$size 2> /dev/null
+	if ( ! $mkfs $image > /dev/null 2>&1 ); then
+		echo "$0: cannot create $fs, skipped" >&2
+		rm -f $image
+		continue
+	fi
+	if ( test "$BENCH_FILL" != 0 ); then
+		fragment $image $fs $size
+	fi
+
+	dev=$image
+	if ( test "$BENCH_LOOP" = 1 ); then
+		dev=`losetup -f --show $image` || dev=$image
+	fi
+
+	# the program has to support the filesystem
+	if ( ! $WFS --plan $dev > /dev/null 2>&1 ); then
+		echo "$0: $fs not supported by $WFS, skipped" >&2
+	else
+		for mode in $BENCH_MODES; do
+			for order in $BENCH_ORDERS; do
+				for method in $BENCH_METHODS; do
+					echo "================= $fs: $mode, $order, $method" >&2
+					run $fs $dev $size $mode $order $method >&4
+				done
+			done
+		done
+	fi
+
+	if ( test $dev != $image ); then
+		losetup -d $dev
+	fi
+	rm -f $image
+done
+
+if ( test "$BENCH_FORMAT" = json ); then
+	if ( test $nresults -eq 0 ); then
+		echo '[' >&4
+	fi
+	echo ']' >&4
+fi
+rm -rf $tmp.*
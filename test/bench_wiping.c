@@ -0,0 +1,246 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- micro-benchmarks of pattern generation and zero detection.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#define _XOPEN_SOURCE 600
+#define _GNU_SOURCE	1
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "wipefreespace.h"
+#include "src/wfs_wiping.h"
+#include "src/wfs_util.h"
+
+#include <stdio.h>
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif
+
+/* the smallest and the largest buffer measured */
+#define BENCH_MIN_SIZE 512
+#define BENCH_MAX_SIZE (64UL * 1024 * 1024)
+/* the default minimum time of measuring each case, in seconds */
+#define BENCH_MIN_TIME 0.1
+
+/* the time stamp counter, for cycles per byte */
+#if (defined __GNUC__) && ((defined __i386__) || (defined __x86_64__))
+# define BENCH_HAVE_TSC 1
+#endif
+
+/* The methods and which of their passes use a fixed and a random pattern */
+static const struct bench_method
+{
+	const char * name;
+	unsigned long int fixed_pass;
+	unsigned long int random_pass;
+} bench_methods[] =
+{
+	{ "gutmann", 4, 0 },
+	{ "random", 1, 0 },
+	{ "schneier", 0, 2 },
+	{ "dod", 0, 2 }
+};
+
+/* the stubs of the functions of the main program */
+int sig_recvd = 0;
+const char * const wfs_err_msg = "error";
+
+void
+wfs_show_msg (
+	const int		type WFS_ATTR ((unused)),
+	const char * const	msg WFS_ATTR ((unused)),
+	const char * const	extra WFS_ATTR ((unused)),
+	const wfs_fsid_t	wfs_fs WFS_ATTR ((unused)) )
+{
+}
+
+const char *
+wfs_get_program_name (void)
+{
+	return "WipeFreeSpace";
+}
+
+int
+wfs_is_stderr_open (void)
+{
+	return 1;
+}
+
+/* ============================================================= */
+
+static unsigned long long int bench_cycles (void)
+{
+#ifdef BENCH_HAVE_TSC
+	unsigned int lo, hi;
+
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((unsigned long long int)hi << 32) | lo;
+#else
+	return 0;
+#endif
+}
+
+/* ============================================================= */
+
+static void bench_print (const char * const function, const char * const method,
+	const char * const pass, const size_t size, const double bytes,
+	const double seconds, const unsigned long long int cycles)
+{
+	printf ("%s,%s,%s,%lu,%.3f,", function, method, pass,
+		(unsigned long int)size, bytes / seconds / 1e9);
+#ifdef BENCH_HAVE_TSC
+	printf ("%.3f\n", (double)cycles / bytes);
+#else
+	printf ("\n");
+#endif
+}
+
+/* ============================================================= */
+
+/*
+ * Fills the buffer with the given pass of the current method, each time
+ * repeating twice as many times as before until the minimum time passes.
+ */
+static void bench_fill (const char * const method, const char * const pass_type,
+	const unsigned long int pass, unsigned char * const buffer,
+	const size_t size, const wfs_fsid_t wfs_fs, const double min_time)
+{
+	unsigned long int i;
+	unsigned long int count = 1;
+	double start, seconds;
+	unsigned long long int cycles;
+
+	/* warm up - fault the pages in */
+	wfs_fill_buffer (pass, buffer, size, wfs_fs);
+	do
+	{
+		count *= 2;
+		start = wfs_get_time ();
+		cycles = bench_cycles ();
+		for ( i = 0; i < count; i++ )
+		{
+			wfs_fill_buffer (pass, buffer, size, wfs_fs);
+		}
+		cycles = bench_cycles () - cycles;
+		seconds = wfs_get_time () - start;
+	}
+	while ( seconds < min_time );
+	bench_print ("wfs_fill_buffer", method, pass_type, size,
+		(double)count * (double)size, seconds, cycles);
+}
+
+/* ============================================================= */
+
+/*
+ * Checks the all-zero buffer - the case when all of it must be read.
+ */
+static void bench_zero (unsigned char * const buffer, const size_t size,
+	const double min_time)
+{
+	unsigned long int i;
+	unsigned long int count = 1;
+	double start, seconds;
+	unsigned long long int cycles;
+	volatile int zero = 0;
+
+	memset (buffer, 0, size);
+	do
+	{
+		count *= 2;
+		start = wfs_get_time ();
+		cycles = bench_cycles ();
+		for ( i = 0; i < count; i++ )
+		{
+			zero += wfs_is_block_zero (buffer, size);
+		}
+		cycles = bench_cycles () - cycles;
+		seconds = wfs_get_time () - start;
+	}
+	while ( seconds < min_time );
+	bench_print ("wfs_is_block_zero", "", "zero", size,
+		(double)count * (double)size, seconds, cycles);
+}
+
+/* ============================================================= */
+
+int main (int argc, char * argv[])
+{
+	unsigned char * buffer;
+	size_t size;
+	size_t m;
+	double min_time = BENCH_MIN_TIME;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err;
+
+	if ( argc > 1 )
+	{
+		min_time = atof (argv[1]);
+		if ( min_time <= 0.0 )
+		{
+			fprintf (stderr, "Usage: %s [seconds per case]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	buffer = (unsigned char *) malloc (BENCH_MAX_SIZE);
+	if ( buffer == NULL )
+	{
+		fprintf (stderr, "%s: cannot allocate %lu bytes\n", argv[0],
+			BENCH_MAX_SIZE);
+		return 1;
+	}
+
+	memset (&wf_gen, 0, sizeof (wf_gen));
+	wf_gen.fsname = "";
+	wf_gen.fs_error = &err;
+	wf_gen.whichfs = WFS_CURR_FS_NONE;
+
+	/* cycles_per_byte counts the time stamp counter, which ticks
+	   at a constant rate, not at the current core frequency */
+	printf ("function,method,pass,size,gb_per_s,cycles_per_byte\n");
+	for ( m = 0; m < sizeof (bench_methods) / sizeof (bench_methods[0]); m++ )
+	{
+		wf_gen.npasses = wfs_init_wiping (0, 0, 0, bench_methods[m].name);
+		for ( size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size *= 2 )
+		{
+			bench_fill (bench_methods[m].name, "fixed",
+				bench_methods[m].fixed_pass, buffer, size,
+				wf_gen, min_time);
+			bench_fill (bench_methods[m].name, "random",
+				bench_methods[m].random_pass, buffer, size,
+				wf_gen, min_time);
+		}
+	}
+	for ( size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size *= 2 )
+	{
+		bench_zero (buffer, size, min_time);
+	}
+
+	free (buffer);
+	return 0;
+}
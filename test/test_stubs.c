@@ -25,6 +25,8 @@
 int sig_recvd = 0;
 int sigchld_recvd = 0;
 const char * const wfs_err_msg = "error";
+unsigned long int wfs_test_msgs = 0;
+int wfs_test_stdout_open = 0;
 
 void
 #ifdef WFS_ANSIC
@@ -44,6 +46,7 @@ wfs_show_msg (
 	const wfs_fsid_t	wfs_fs WFS_ATTR ((unused));
 #endif
 {
+	wfs_test_msgs++;
 }
 
 void
@@ -76,3 +79,328 @@ wfs_is_stderr_open (WFS_VOID)
 {
 	return 1;
 }
+
+int
+wfs_is_stdout_open (WFS_VOID)
+{
+	return wfs_test_stdout_open;
+}
+
+/* =================== I/O system call counter ================= */
+
+/*
+ * The functions below replace the C library's ones in the test programs
+ * and in the filesystem libraries they use. When counting is on, each call
+ * is counted before passing it on to the real function, so the tests can
+ * check how many requests the wiping makes.
+ */
+
+#ifdef HAVE_DLFCN_H
+# include <dlfcn.h>
+#endif
+
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+
+#if (defined RTLD_NEXT) && (defined __USE_LARGEFILE64) && (defined HAVE_OFF64_T)
+# define WFS_TEST_IO_COUNTER 1
+#endif
+
+struct wfs_test_io_counts wfs_test_io;
+size_t wfs_test_io_max_write = 0;
+static int wfs_test_io_counting = 0;
+
+int
+wfs_test_io_start (void)
+{
+	wfs_test_io.reads = 0;
+	wfs_test_io.writes = 0;
+	wfs_test_io.seeks = 0;
+	wfs_test_io.syncs = 0;
+	wfs_test_io.bytes_read = 0;
+	wfs_test_io.bytes_written = 0;
+	wfs_test_io.unaligned = 0;
+#ifdef WFS_TEST_IO_COUNTER
+	wfs_test_io_counting = 1;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void
+wfs_test_io_stop (void)
+{
+	wfs_test_io_counting = 0;
+}
+
+#ifdef WFS_TEST_IO_COUNTER
+
+/* finds the real function the first time it's called, fails the call if not found */
+# define WFS_TEST_IO_REAL(real, name) \
+	if ( (real) == NULL ) \
+	{ \
+		*(void **)(&(real)) = dlsym (RTLD_NEXT, name); \
+		if ( (real) == NULL ) \
+		{ \
+			errno = ENOSYS; \
+			return -1; \
+		} \
+	}
+
+static void
+wfs_test_io_count_read (const ssize_t res)
+{
+	if ( wfs_test_io_counting != 0 )
+	{
+		wfs_test_io.reads++;
+		if ( res > 0 )
+		{
+			wfs_test_io.bytes_read += (unsigned long long int) res;
+		}
+	}
+}
+
+static void
+wfs_test_io_count_write (const ssize_t res)
+{
+	if ( wfs_test_io_counting != 0 )
+	{
+		wfs_test_io.writes++;
+		if ( res > 0 )
+		{
+			wfs_test_io.bytes_written += (unsigned long long int) res;
+		}
+	}
+}
+
+/* counts the unaligned positioned writes, returns the number of bytes to write */
+static size_t
+wfs_test_io_pwrite_size (const size_t count, const long long int offset)
+{
+	if ( wfs_test_io_counting == 0 )
+	{
+		return count;
+	}
+	if ( (offset % 512) != 0 )
+	{
+		wfs_test_io.unaligned++;
+	}
+	if ( (wfs_test_io_max_write != 0) && (count > wfs_test_io_max_write) )
+	{
+		return wfs_test_io_max_write;
+	}
+	return count;
+}
+
+# ifdef HAVE_PWRITEV
+#  define WFS_TEST_IOV_MAX 1024
+
+/* cuts the buffers to the bytes which wfs_test_io_pwrite_size() allows,
+   returns their new number */
+static int
+wfs_test_io_cut_iov (const struct iovec * iov, const int iovcnt,
+	const long long int offset, struct iovec * const cut)
+{
+	size_t total = 0;
+	size_t allowed;
+	int i;
+
+	if ( iovcnt > WFS_TEST_IOV_MAX )
+	{
+		return -1;
+	}
+	for ( i = 0; i < iovcnt; i++ )
+	{
+		total += iov[i].iov_len;
+	}
+	allowed = wfs_test_io_pwrite_size (total, offset);
+	for ( i = 0; (i < iovcnt) && (allowed > 0); i++ )
+	{
+		cut[i] = iov[i];
+		if ( cut[i].iov_len > allowed )
+		{
+			cut[i].iov_len = allowed;
+		}
+		allowed -= cut[i].iov_len;
+	}
+	return i;
+}
+# endif
+
+ssize_t
+read (int fd, void * buf, size_t count)
+{
+	static ssize_t (*real) (int, void *, size_t) = NULL;
+	ssize_t res;
+
+	WFS_TEST_IO_REAL (real, "read");
+	res = (*real) (fd, buf, count);
+	wfs_test_io_count_read (res);
+	return res;
+}
+
+ssize_t
+pread (int fd, void * buf, size_t count, off_t offset)
+{
+	static ssize_t (*real) (int, void *, size_t, off_t) = NULL;
+	ssize_t res;
+
+	WFS_TEST_IO_REAL (real, "pread");
+	res = (*real) (fd, buf, count, offset);
+	wfs_test_io_count_read (res);
+	return res;
+}
+
+ssize_t
+pread64 (int fd, void * buf, size_t count, off64_t offset)
+{
+	static ssize_t (*real) (int, void *, size_t, off64_t) = NULL;
+	ssize_t res;
+
+	WFS_TEST_IO_REAL (real, "pread64");
+	res = (*real) (fd, buf, count, offset);
+	wfs_test_io_count_read (res);
+	return res;
+}
+
+ssize_t
+write (int fd, const void * buf, size_t count)
+{
+	static ssize_t (*real) (int, const void *, size_t) = NULL;
+	ssize_t res;
+
+	WFS_TEST_IO_REAL (real, "write");
+	res = (*real) (fd, buf, count);
+	wfs_test_io_count_write (res);
+	return res;
+}
+
+ssize_t
+pwrite (int fd, const void * buf, size_t count, off_t offset)
+{
+	static ssize_t (*real) (int, const void *, size_t, off_t) = NULL;
+	ssize_t res;
+
+	WFS_TEST_IO_REAL (real, "pwrite");
+	res = (*real) (fd, buf, wfs_test_io_pwrite_size (count, offset), offset);
+	wfs_test_io_count_write (res);
+	return res;
+}
+
+ssize_t
+pwrite64 (int fd, const void * buf, size_t count, off64_t offset)
+{
+	static ssize_t (*real) (int, const void *, size_t, off64_t) = NULL;
+	ssize_t res;
+
+	WFS_TEST_IO_REAL (real, "pwrite64");
+	res = (*real) (fd, buf, wfs_test_io_pwrite_size (count, offset), offset);
+	wfs_test_io_count_write (res);
+	return res;
+}
+
+# ifdef HAVE_PWRITEV
+ssize_t
+pwritev (int fd, const struct iovec * iov, int iovcnt, off_t offset)
+{
+	static ssize_t (*real) (int, const struct iovec *, int, off_t) = NULL;
+	ssize_t res;
+	struct iovec cut[WFS_TEST_IOV_MAX];
+	int cutcnt;
+
+	WFS_TEST_IO_REAL (real, "pwritev");
+	cutcnt = wfs_test_io_cut_iov (iov, iovcnt, offset, cut);
+	if ( cutcnt < 0 )
+	{
+		res = (*real) (fd, iov, iovcnt, offset);
+	}
+	else
+	{
+		res = (*real) (fd, cut, cutcnt, offset);
+	}
+	wfs_test_io_count_write (res);
+	return res;
+}
+
+ssize_t
+pwritev64 (int fd, const struct iovec * iov, int iovcnt, off64_t offset)
+{
+	static ssize_t (*real) (int, const struct iovec *, int, off64_t) = NULL;
+	ssize_t res;
+	struct iovec cut[WFS_TEST_IOV_MAX];
+	int cutcnt;
+
+	WFS_TEST_IO_REAL (real, "pwritev64");
+	cutcnt = wfs_test_io_cut_iov (iov, iovcnt, offset, cut);
+	if ( cutcnt < 0 )
+	{
+		res = (*real) (fd, iov, iovcnt, offset);
+	}
+	else
+	{
+		res = (*real) (fd, cut, cutcnt, offset);
+	}
+	wfs_test_io_count_write (res);
+	return res;
+}
+# endif
+
+off_t
+lseek (int fd, off_t offset, int whence)
+{
+	static off_t (*real) (int, off_t, int) = NULL;
+
+	WFS_TEST_IO_REAL (real, "lseek");
+	if ( wfs_test_io_counting != 0 )
+	{
+		wfs_test_io.seeks++;
+	}
+	return (*real) (fd, offset, whence);
+}
+
+off64_t
+lseek64 (int fd, off64_t offset, int whence)
+{
+	static off64_t (*real) (int, off64_t, int) = NULL;
+
+	WFS_TEST_IO_REAL (real, "lseek64");
+	if ( wfs_test_io_counting != 0 )
+	{
+		wfs_test_io.seeks++;
+	}
+	return (*real) (fd, offset, whence);
+}
+
+int
+fsync (int fd)
+{
+	static int (*real) (int) = NULL;
+
+	WFS_TEST_IO_REAL (real, "fsync");
+	if ( wfs_test_io_counting != 0 )
+	{
+		wfs_test_io.syncs++;
+	}
+	return (*real) (fd);
+}
+
+int
+fdatasync (int fd)
+{
+	static int (*real) (int) = NULL;
+
+	WFS_TEST_IO_REAL (real, "fdatasync");
+	if ( wfs_test_io_counting != 0 )
+	{
+		wfs_test_io.syncs++;
+	}
+	return (*real) (fd);
+}
+
+#endif /* WFS_TEST_IO_COUNTER */
@@ -32,6 +32,9 @@
 #endif
 
 #define FS_NAME_EXTFS "test-fs-extfs"
+/* Wiping the free space of the 35 MiB image a block at a time would take
+   tens of thousands of writes. The free ranges must be written at once. */
+#define EXTFS_MAX_WRITES 1024
 
 /* =================== stubs =================================== */
 
@@ -49,7 +52,7 @@ wfs_check_mounted (
 
 /* ============================================================= */
 
-static wfs_fsid_t wfs_fs = {FS_NAME_EXTFS, 1, 0, NULL, NULL, WFS_CURR_FS_EXT234FS, 0, 0, WFS_WIPE_MODE_PATTERN};
+static wfs_fsid_t wfs_fs = {FS_NAME_EXTFS, 1, 0, NULL, NULL, WFS_CURR_FS_EXT234FS, 0, 0, WFS_WIPE_MODE_PATTERN, WFS_DEFAULT_CHUNK_SIZE, 0, 0, 0, 0, NULL};
 static wfs_fsdata_t data = {{0, 0}};
 
 START_TEST(test_wfs_ext234_chk_mount)
@@ -68,6 +71,28 @@ START_TEST(test_wfs_ext234_wipe_fs)
 }
 END_TEST
 
+START_TEST(test_wfs_ext234_wipe_fs_syscalls)
+{
+	int counting;
+	wfs_errcode_t ret_wfs = wfs_e234_open_fs(&wfs_fs, &data);
+	ck_assert_int_eq(WFS_SUCCESS, ret_wfs);
+	counting = wfs_test_io_start();
+	ret_wfs = wfs_e234_wipe_fs(wfs_fs);
+	wfs_test_io_stop();
+	ck_assert_int_eq(WFS_SUCCESS, ret_wfs);
+	wfs_e234_close_fs(wfs_fs);
+	if (counting != 0)
+	{
+		ck_assert_msg(wfs_test_io.writes < EXTFS_MAX_WRITES,
+			"test_wfs_ext234_wipe_fs_syscalls: %lu writes, expected fewer than %d\n",
+			wfs_test_io.writes, EXTFS_MAX_WRITES);
+		ck_assert_msg(wfs_test_io.seeks < EXTFS_MAX_WRITES,
+			"test_wfs_ext234_wipe_fs_syscalls: %lu seeks, expected fewer than %d\n",
+			wfs_test_io.seeks, EXTFS_MAX_WRITES);
+	}
+}
+END_TEST
+
 START_TEST(test_wfs_ext234_wipe_unrm)
 {
 	wfs_errcode_t ret_wfs = wfs_e234_open_fs(&wfs_fs, &data);
@@ -155,6 +180,7 @@ static Suite * wfs_create_suite(void)
 
 	tcase_add_test(tests_ext234, test_wfs_ext234_chk_mount);
 	tcase_add_test(tests_ext234, test_wfs_ext234_wipe_fs);
+	tcase_add_test(tests_ext234, test_wfs_ext234_wipe_fs_syscalls);
 	tcase_add_test(tests_ext234, test_wfs_ext234_wipe_unrm);
 	tcase_add_test(tests_ext234, test_wfs_ext234_wipe_part);
 	tcase_add_test(tests_ext234, test_wfs_ext234_check_err);
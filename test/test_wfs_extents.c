@@ -0,0 +1,1392 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_extents.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_extents.h"
+#include "src/wfs_state.h"
+#include "src/wfs_snapshot.h"
+#include "src/wfs_progress.h"
+#include "src/wfs_stats.h"
+#include "src/wfs_util.h"
+#include "src/wfs_wiping.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+/* ============================================================= */
+
+START_TEST(test_extmap_add)
+{
+	wfs_extent_map_t map;
+
+	puts ("test_extmap_add");
+	wfs_extmap_init (&map);
+	ck_assert_int_eq (wfs_extmap_add (&map, 10, 5), WFS_SUCCESS);
+	/* contiguous - should be merged */
+	ck_assert_int_eq (wfs_extmap_add (&map, 15, 5), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 30, 1), WFS_SUCCESS);
+	/* empty ranges are ignored */
+	ck_assert_int_eq (wfs_extmap_add (&map, 40, 0), WFS_SUCCESS);
+	ck_assert_uint_eq (map.count, 2);
+	ck_assert_uint_eq (map.extents[0].start, 10);
+	ck_assert_uint_eq (map.extents[0].length, 10);
+	ck_assert_uint_eq (map.extents[1].start, 30);
+	ck_assert_uint_eq (map.extents[1].length, 1);
+	ck_assert_uint_eq (map.total_blocks, 11);
+	wfs_extmap_free (&map);
+	ck_assert_uint_eq (map.count, 0);
+	ck_assert_uint_eq (map.total_blocks, 0);
+}
+END_TEST
+
+START_TEST(test_extmap_add_overlap)
+{
+	wfs_extent_map_t map;
+
+	puts ("test_extmap_add_overlap");
+	wfs_extmap_init (&map);
+	ck_assert_int_eq (wfs_extmap_add (&map, 10, 5), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 12, 5), WFS_BADPARAM);
+	ck_assert_int_eq (wfs_extmap_add (&map, 2, 1), WFS_BADPARAM);
+	ck_assert_uint_eq (map.count, 1);
+	ck_assert_uint_eq (map.total_blocks, 5);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_extmap_add_many)
+{
+	wfs_extent_map_t map;
+	wfs_blkno_t i;
+
+	puts ("test_extmap_add_many");
+	wfs_extmap_init (&map);
+	for ( i = 0; i < 1000; i++ )
+	{
+		ck_assert_int_eq (wfs_extmap_add (&map, i * 3, 2), WFS_SUCCESS);
+	}
+	ck_assert_uint_eq (map.count, 1000);
+	ck_assert_uint_eq (map.total_blocks, 2000);
+	ck_assert_uint_eq (map.extents[999].start, 2997);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_extmap_sort)
+{
+	wfs_extent_map_t map;
+
+	puts ("test_extmap_sort");
+	wfs_extmap_init (&map);
+	ck_assert_int_eq (wfs_extmap_append (&map, 100, 10), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_append (&map, 0, 5), WFS_SUCCESS);
+	/* touches the first range */
+	ck_assert_int_eq (wfs_extmap_append (&map, 90, 10), WFS_SUCCESS);
+	/* overlaps the second range */
+	ck_assert_int_eq (wfs_extmap_append (&map, 3, 4), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_append (&map, 50, 1), WFS_SUCCESS);
+	wfs_extmap_sort (&map);
+	ck_assert_uint_eq (map.count, 3);
+	ck_assert_uint_eq (map.extents[0].start, 0);
+	ck_assert_uint_eq (map.extents[0].length, 7);
+	ck_assert_uint_eq (map.extents[1].start, 50);
+	ck_assert_uint_eq (map.extents[1].length, 1);
+	ck_assert_uint_eq (map.extents[2].start, 90);
+	ck_assert_uint_eq (map.extents[2].length, 20);
+	ck_assert_uint_eq (map.total_blocks, 28);
+	/* the map can be extended in order after sorting */
+	ck_assert_int_eq (wfs_extmap_add (&map, 110, 5), WFS_SUCCESS);
+	ck_assert_uint_eq (map.count, 3);
+	ck_assert_uint_eq (map.total_blocks, 33);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_extmap_subtract)
+{
+	wfs_extent_map_t map;
+	wfs_extent_map_t other;
+
+	puts ("test_extmap_subtract");
+	wfs_extmap_init (&map);
+	wfs_extmap_init (&other);
+	ck_assert_int_eq (wfs_extmap_add (&map, 0, 10), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 20, 10), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 40, 5), WFS_SUCCESS);
+	/* cuts the middle of the first range */
+	ck_assert_int_eq (wfs_extmap_add (&other, 2, 3), WFS_SUCCESS);
+	/* covers the end of the first range and the start of the second */
+	ck_assert_int_eq (wfs_extmap_add (&other, 8, 15), WFS_SUCCESS);
+	/* covers the whole third range */
+	ck_assert_int_eq (wfs_extmap_add (&other, 35, 20), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_subtract (&map, &other), WFS_SUCCESS);
+	ck_assert_uint_eq (map.count, 3);
+	ck_assert_uint_eq (map.extents[0].start, 0);
+	ck_assert_uint_eq (map.extents[0].length, 2);
+	ck_assert_uint_eq (map.extents[1].start, 5);
+	ck_assert_uint_eq (map.extents[1].length, 3);
+	ck_assert_uint_eq (map.extents[2].start, 23);
+	ck_assert_uint_eq (map.extents[2].length, 7);
+	ck_assert_uint_eq (map.total_blocks, 12);
+	/* nothing in common */
+	wfs_extmap_free (&other);
+	ck_assert_int_eq (wfs_extmap_add (&other, 100, 1), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_subtract (&map, &other), WFS_SUCCESS);
+	ck_assert_uint_eq (map.count, 3);
+	ck_assert_uint_eq (map.total_blocks, 12);
+	wfs_extmap_free (&other);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_extmap_chunk_blocks)
+{
+	ck_assert_uint_eq (wfs_extmap_chunk_blocks (0), 1);
+	ck_assert_uint_eq (wfs_extmap_chunk_blocks (WFS_WRITE_CHUNK_SIZE * 2), 1);
+	ck_assert_uint_eq (wfs_extmap_chunk_blocks (4096), WFS_WRITE_CHUNK_SIZE / 4096);
+}
+END_TEST
+
+START_TEST(test_extmap_io_sizes)
+{
+	wfs_io_hints_t hints;
+	size_t sizes[WFS_IO_SIZES];
+
+	/* nothing known about the device */
+	hints.optimal_io_size = 0;
+	hints.minimum_io_size = 0;
+	hints.max_io_size = 0;
+	hints.rotational = -1;
+	ck_assert_uint_eq (wfs_extmap_io_sizes (&hints, 4096, sizes), 4);
+	ck_assert_uint_eq (sizes[0], 64);
+	ck_assert_uint_eq (sizes[1], 256);
+	ck_assert_uint_eq (sizes[2], 1024);
+	ck_assert_uint_eq (sizes[3], 2048);
+
+	/* no largest size on a spinning disk */
+	hints.rotational = 1;
+	ck_assert_uint_eq (wfs_extmap_io_sizes (&hints, 4096, sizes), 3);
+	ck_assert_uint_eq (sizes[2], 1024);
+
+	/* whole RAID stripes only */
+	hints.rotational = 0;
+	hints.optimal_io_size = 3 * 1024 * 1024;
+	ck_assert_uint_eq (wfs_extmap_io_sizes (&hints, 4096, sizes), 3);
+	ck_assert_uint_eq (sizes[0], 768);
+	ck_assert_uint_eq (sizes[1], 1536);
+	ck_assert_uint_eq (sizes[2], 2304);
+
+	/* full requests of the largest size */
+	hints.optimal_io_size = 0;
+	hints.max_io_size = 1280 * 1024;
+	ck_assert_uint_eq (wfs_extmap_io_sizes (&hints, 4096, sizes), 4);
+	ck_assert_uint_eq (sizes[1], 256);
+	ck_assert_uint_eq (sizes[2], 1280);
+	ck_assert_uint_eq (sizes[3], 2240);
+
+	/* blocks larger than all the sizes */
+	ck_assert_uint_eq (wfs_extmap_io_sizes (&hints, 16 * 1024 * 1024, sizes), 1);
+	ck_assert_uint_eq (sizes[0], 1);
+}
+END_TEST
+
+/* a small in-memory device for the wiping tests */
+#define TEST_BLOCK_SIZE 512
+#define TEST_NBLOCKS 64
+
+struct test_device
+{
+	unsigned char data[TEST_NBLOCKS * TEST_BLOCK_SIZE];
+	unsigned int writes[TEST_NBLOCKS];
+};
+
+static wfs_errcode_t
+test_dev_read (void * const data, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	wfs_errcode_t * const error WFS_ATTR ((unused)))
+{
+	struct test_device * dev = (struct test_device *) data;
+
+	ck_assert_uint_le (start + count, TEST_NBLOCKS);
+	memcpy (buf, &dev->data[start * TEST_BLOCK_SIZE],
+		(size_t)(count * TEST_BLOCK_SIZE));
+	return WFS_SUCCESS;
+}
+
+/* in test_stubs.c */
+extern int sig_recvd;
+
+/* the number of writes after which a signal is simulated, 0 means never */
+static unsigned int test_interrupt_after = 0;
+
+/* the blocks in the order they were written */
+static wfs_blkno_t test_write_log[TEST_NBLOCKS * 8];
+static unsigned int test_write_log_len = 0;
+
+static wfs_errcode_t
+test_dev_write (void * const data, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	wfs_errcode_t * const error WFS_ATTR ((unused)))
+{
+	struct test_device * dev = (struct test_device *) data;
+	wfs_blkno_t i;
+
+	ck_assert_uint_le (start + count, TEST_NBLOCKS);
+	memcpy (&dev->data[start * TEST_BLOCK_SIZE], buf,
+		(size_t)(count * TEST_BLOCK_SIZE));
+	for ( i = 0; i < count; i++ )
+	{
+		dev->writes[start + i]++;
+		if ( test_write_log_len < sizeof (test_write_log)
+			/ sizeof (test_write_log[0]) )
+		{
+			test_write_log[test_write_log_len++] = start + i;
+		}
+	}
+	if ( test_interrupt_after > 0 )
+	{
+		test_interrupt_after--;
+		if ( test_interrupt_after == 0 )
+		{
+			sig_recvd = 1;
+		}
+	}
+	return WFS_SUCCESS;
+}
+
+static unsigned int test_pattern_writes = 0;
+
+static wfs_errcode_t
+test_dev_write_pattern (void * const data, unsigned char * const buf,
+	const wfs_blkno_t start, const wfs_blkno_t count,
+	wfs_errcode_t * const error WFS_ATTR ((unused)))
+{
+	struct test_device * dev = (struct test_device *) data;
+	size_t i;
+
+	ck_assert_uint_le (start + count, TEST_NBLOCKS);
+	for ( i = 0; i < (size_t)(count * TEST_BLOCK_SIZE); i++ )
+	{
+		dev->data[start * TEST_BLOCK_SIZE + i]
+			= buf[i % WFS_PATTERN_UNIT_SIZE];
+	}
+	for ( i = 0; i < count; i++ )
+	{
+		dev->writes[start + i]++;
+	}
+	test_pattern_writes++;
+	return WFS_SUCCESS;
+}
+
+static unsigned int test_flushes = 0;
+
+static wfs_errcode_t
+test_dev_flush (wfs_fsid_t wfs_fs WFS_ATTR ((unused)))
+{
+	test_flushes++;
+	return WFS_SUCCESS;
+}
+
+static unsigned int test_syncs = 0;
+
+static wfs_errcode_t
+test_dev_sync (void * const data WFS_ATTR ((unused)),
+	wfs_errcode_t * const error WFS_ATTR ((unused)))
+{
+	test_syncs++;
+	return WFS_SUCCESS;
+}
+
+static void
+test_wipe_setup (struct test_device * const dev, wfs_extent_map_t * const map,
+	wfs_extent_ops_t * const ops, wfs_fsid_t * const wf_gen,
+	wfs_errcode_t * const err)
+{
+	memset (dev->data, 0xEE, sizeof (dev->data));
+	memset (dev->writes, 0, sizeof (dev->writes));
+	/* a free block which already holds zeros */
+	memset (&dev->data[11 * TEST_BLOCK_SIZE], 0, TEST_BLOCK_SIZE);
+
+	wfs_extmap_init (map);
+	ck_assert_int_eq (wfs_extmap_add (map, 2, 4), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (map, 10, 2), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (map, 20, 10), WFS_SUCCESS);
+
+	ops->read_blocks = &test_dev_read;
+	ops->write_blocks = &test_dev_write;
+	ops->write_pattern = NULL;
+	ops->sync_blocks = NULL;
+	ops->flush_fs = &test_dev_flush;
+	ops->data = dev;
+
+	memset (wf_gen, 0, sizeof (*wf_gen));
+	wf_gen->fsname = "";
+	wf_gen->fs_error = err;
+	wf_gen->whichfs = WFS_CURR_FS_NONE;
+	wf_gen->npasses = 3;
+	wf_gen->zero_pass = 1;
+	wf_gen->fs_backend = NULL;
+	wf_gen->no_wipe_zero_blocks = 0;
+	wf_gen->chunk_size = WFS_DEFAULT_CHUNK_SIZE;
+	test_flushes = 0;
+	test_syncs = 0;
+	test_pattern_writes = 0;
+	test_write_log_len = 0;
+}
+
+static int
+test_is_free (const wfs_blkno_t block)
+{
+	return ((block >= 2) && (block < 6)) || ((block >= 10) && (block < 12))
+		|| ((block >= 20) && (block < 30));
+}
+
+static void
+test_check_device (const struct test_device * const dev,
+	const unsigned int writes_per_free_block, const wfs_blkno_t skipped)
+{
+	wfs_blkno_t i;
+
+	for ( i = 0; i < TEST_NBLOCKS; i++ )
+	{
+		if ( (test_is_free (i) != 0) && (i != skipped) )
+		{
+			ck_assert_uint_eq (dev->writes[i], writes_per_free_block);
+			/* the zero pass was the last one */
+			ck_assert_int_ne (wfs_is_block_zero (
+				&dev->data[i * TEST_BLOCK_SIZE],
+				TEST_BLOCK_SIZE), 0);
+		}
+		else if ( test_is_free (i) == 0 )
+		{
+			ck_assert_uint_eq (dev->writes[i], 0);
+			ck_assert_uint_eq (dev->data[i * TEST_BLOCK_SIZE], 0xEE);
+		}
+		else
+		{
+			ck_assert_uint_eq (dev->writes[i], 0);
+		}
+	}
+}
+
+START_TEST(test_wipe_extents_block)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_wipe_extents_block");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_block_group)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_blkno_t block;
+	unsigned int i = 0;
+	unsigned int e;
+	unsigned int j;
+
+	puts ("test_wipe_extents_block_group");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	/* all the passes over a free extent before the next one is written */
+	ck_assert_uint_eq (test_write_log_len, 16 * (3 + 1));
+	for ( e = 0; e < map.count; e++ )
+	{
+		for ( j = 0; j < 3 + 1; j++ )
+		{
+			for ( block = map.extents[e].start;
+				block < map.extents[e].start + map.extents[e].length;
+				block++ )
+			{
+				ck_assert_uint_eq (test_write_log[i], block);
+				i++;
+			}
+		}
+	}
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_pattern)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_wipe_extents_pattern");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_skip_zero)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_wipe_extents_skip_zero");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	wf_gen.no_wipe_zero_blocks = 1;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	/* the all-zero block 11 must be left alone */
+	test_check_device (&dev, 3 + 1, 11);
+	ck_assert_uint_eq (map.total_blocks, 15);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_chunk)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_wipe_extents_chunk");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_CHUNK;
+	/* 16 free blocks in groups of 5, crossing the extents' borders */
+	wf_gen.chunk_size = 5 * TEST_BLOCK_SIZE;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	/* one flush per group and pass */
+	ck_assert_uint_eq (test_flushes, 4 * 3);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_chunk_small)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_wipe_extents_chunk_small");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_CHUNK;
+	/* smaller than a block - one block at a time */
+	wf_gen.chunk_size = 1;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	ck_assert_uint_eq (test_flushes, 16 * 3);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_sync_block)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_wipe_extents_sync_block");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	ops.sync_blocks = &test_dev_sync;
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	/* one barrier per pass of each free extent, not of each block */
+	ck_assert_uint_eq (test_syncs, 3 * 3);
+	ck_assert_uint_eq (test_flushes, 0);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_sync_pattern)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_wipe_extents_sync_pattern");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	ops.sync_blocks = &test_dev_sync;
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	/* one barrier after each pass, the filesystem flushed once at the end */
+	ck_assert_uint_eq (test_syncs, 3 + 1);
+	ck_assert_uint_eq (test_flushes, 1);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_direct_off)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_direct_io_t direct;
+
+	puts ("test_wipe_extents_direct_off");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.use_direct = 0;
+	wfs_test_msgs = 0;
+	wfs_extmap_direct_open (wf_gen, TEST_BLOCK_SIZE, &direct, &ops);
+	/* not requested - the backend's functions must stay, silently */
+	ck_assert_int_eq (direct.fd, -1);
+	ck_assert_ptr_eq (ops.data, &dev);
+	ck_assert_uint_eq (wfs_test_msgs, 0);
+	wfs_extmap_direct_close (&direct);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_direct)
+{
+	static struct test_device dev;
+	static unsigned char file_data[TEST_NBLOCKS * TEST_BLOCK_SIZE];
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_direct_io_t direct;
+	FILE * f;
+	wfs_blkno_t i;
+
+	puts ("test_wipe_extents_direct");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	f = fopen ("test_wfs_extents.img", "wb");
+	ck_assert_ptr_ne (f, NULL);
+	ck_assert_uint_eq (fwrite (dev.data, 1, sizeof (dev.data), f),
+		sizeof (dev.data));
+	fclose (f);
+
+	wf_gen.fsname = "test_wfs_extents.img";
+	wf_gen.use_direct = 1;
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	wfs_extmap_direct_open (wf_gen, TEST_BLOCK_SIZE, &direct, &ops);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	wfs_extmap_direct_close (&direct);
+	ck_assert_int_eq (direct.fd, -1);
+
+	if ( ops.data == &direct )
+	{
+		/* direct I/O was used - the file must have been wiped */
+		f = fopen ("test_wfs_extents.img", "rb");
+		ck_assert_ptr_ne (f, NULL);
+		ck_assert_uint_eq (fread (file_data, 1, sizeof (file_data), f),
+			sizeof (file_data));
+		fclose (f);
+		for ( i = 0; i < TEST_NBLOCKS; i++ )
+		{
+			if ( test_is_free (i) != 0 )
+			{
+				ck_assert_int_ne (wfs_is_block_zero (
+					&file_data[i * TEST_BLOCK_SIZE],
+					TEST_BLOCK_SIZE), 0);
+			}
+			else
+			{
+				ck_assert_uint_eq (file_data[i * TEST_BLOCK_SIZE], 0xEE);
+			}
+		}
+		ck_assert_uint_eq (dev.writes[2], 0);
+	}
+	else
+	{
+		/* direct I/O unavailable here - the backend's functions were used */
+		test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+		ck_assert_uint_eq (wfs_test_msgs, 1);
+	}
+	remove ("test_wfs_extents.img");
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_direct_unavailable)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_direct_io_t direct;
+
+	puts ("test_wipe_extents_direct_unavailable");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.fsname = "test_wfs_extents-nonexistent.img";
+	wf_gen.use_direct = 1;
+	wfs_test_msgs = 0;
+	wfs_extmap_direct_open (wf_gen, TEST_BLOCK_SIZE, &direct, &ops);
+	/* the backend's functions must stay and the user must be told */
+	ck_assert_int_eq (direct.fd, -1);
+	ck_assert_ptr_eq (ops.data, &dev);
+	ck_assert_uint_eq (wfs_test_msgs, 1);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	wfs_extmap_direct_close (&direct);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_direct_fallback)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_direct_io_t direct;
+	FILE * f;
+	static const wfs_wipe_mode_t modes[] = { WFS_WIPE_MODE_PATTERN,
+		WFS_WIPE_MODE_BLOCK, WFS_WIPE_MODE_CHUNK };
+	unsigned int m;
+
+	puts ("test_wipe_extents_direct_fallback");
+	for ( m = 0; m < sizeof (modes) / sizeof (modes[0]); m++ )
+	{
+		test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+		f = fopen ("test_wfs_extents.img", "wb");
+		ck_assert_ptr_ne (f, NULL);
+		ck_assert_uint_eq (fwrite (dev.data, 1, sizeof (dev.data), f),
+			sizeof (dev.data));
+		fclose (f);
+
+		wf_gen.fsname = "test_wfs_extents.img";
+		wf_gen.use_direct = 1;
+		wf_gen.wipe_mode = modes[m];
+		wfs_extmap_direct_open (wf_gen, TEST_BLOCK_SIZE, &direct, &ops);
+		if ( ops.data != &direct )
+		{
+			/* direct I/O unavailable here */
+			remove ("test_wfs_extents.img");
+			wfs_extmap_free (&map);
+			break;
+		}
+		/* make every direct write fail, like on a bad sector */
+		close (direct.fd);
+		direct.fd = open ("test_wfs_extents.img", O_RDONLY);
+		ck_assert_int_ne (direct.fd, -1);
+		ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+			&ops, &err), WFS_SUCCESS);
+		wfs_extmap_direct_close (&direct);
+		/* each block was given to the backend's function */
+		test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+		remove ("test_wfs_extents.img");
+		wfs_extmap_free (&map);
+	}
+}
+END_TEST
+
+START_TEST(test_wipe_extents_gather)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_wipe_ctx_t wipe_ctx;
+
+	puts ("test_wipe_extents_gather");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	ops.write_pattern = &test_dev_write_pattern;
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	/* fixed patterns only */
+	wf_gen.npasses = 2;
+	wfs_wipe_ctx_init (&wipe_ctx, 2, 0, 0, "dod");
+	wf_gen.wipe_ctx = &wipe_ctx;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 2 + 1, TEST_NBLOCKS);
+	/* 3 extents, 2 passes and the zero pass, all gathered */
+	ck_assert_uint_eq (test_pattern_writes, 3 * (2 + 1));
+	wfs_extmap_free (&map);
+	wfs_wipe_ctx_free (&wipe_ctx);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_gather_same)
+{
+	static struct test_device dev;
+	static unsigned char plain_data[TEST_NBLOCKS * TEST_BLOCK_SIZE];
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_wipe_ctx_t wipe_ctx;
+
+	puts ("test_wipe_extents_gather_same");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	wf_gen.npasses = 1;
+	wf_gen.zero_pass = 0;
+	srandom (0xabcd);
+	wfs_wipe_ctx_init (&wipe_ctx, 1, 0, 0, "dod");
+	wf_gen.wipe_ctx = &wipe_ctx;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	memcpy (plain_data, dev.data, sizeof (plain_data));
+	wfs_extmap_free (&map);
+	wfs_wipe_ctx_free (&wipe_ctx);
+
+	/* the same pattern must reach the device when gathering */
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	ops.write_pattern = &test_dev_write_pattern;
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	wf_gen.npasses = 1;
+	wf_gen.zero_pass = 0;
+	srandom (0xabcd);
+	wfs_wipe_ctx_init (&wipe_ctx, 1, 0, 0, "dod");
+	wf_gen.wipe_ctx = &wipe_ctx;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	ck_assert_int_eq (memcmp (plain_data, dev.data, sizeof (plain_data)), 0);
+	ck_assert_uint_eq (test_pattern_writes, 3);
+	wfs_extmap_free (&map);
+	wfs_wipe_ctx_free (&wipe_ctx);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_random)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_wipe_ctx_t wipe_ctx;
+	wfs_blkno_t i;
+	size_t j;
+	unsigned int mode;
+	unsigned int different;
+	static const enum wfs_wipe_mode modes[] =
+	{
+		WFS_WIPE_MODE_PATTERN, WFS_WIPE_MODE_CHUNK
+	};
+
+	puts ("test_wipe_extents_random");
+	for ( mode = 0; mode < sizeof (modes) / sizeof (modes[0]); mode++ )
+	{
+		test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+		ops.write_pattern = &test_dev_write_pattern;
+		wf_gen.wipe_mode = modes[mode];
+		wf_gen.npasses = 1;
+		wf_gen.zero_pass = 0;
+		/* the only pass of this method is random */
+		wfs_wipe_ctx_init (&wipe_ctx, 1, 0, 0, "random");
+		wf_gen.wipe_ctx = &wipe_ctx;
+		ck_assert_int_eq (wfs_is_random_pass (0, wf_gen), 1);
+		ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+			&ops, &err), WFS_SUCCESS);
+		/* each block filled separately, so not gathered */
+		ck_assert_uint_eq (test_pattern_writes, 0);
+		different = 0;
+		for ( i = 0; i < TEST_NBLOCKS; i++ )
+		{
+			if ( test_is_free (i) == 0 )
+			{
+				continue;
+			}
+			ck_assert_uint_eq (dev.writes[i], 1);
+			/* one pattern repeated within the block */
+			for ( j = 3; j < TEST_BLOCK_SIZE; j++ )
+			{
+				ck_assert_uint_eq (dev.data[i * TEST_BLOCK_SIZE + j],
+					dev.data[i * TEST_BLOCK_SIZE + j % 3]);
+			}
+			/* blocks written together must get their own patterns */
+			if ( (test_is_free (i + 1) != 0)
+				&& (memcmp (&dev.data[i * TEST_BLOCK_SIZE],
+					&dev.data[(i + 1) * TEST_BLOCK_SIZE], 3) != 0) )
+			{
+				different++;
+			}
+		}
+		/* 13 pairs of neighbouring free blocks, a few may match by chance */
+		ck_assert_uint_le (10, different);
+		wfs_extmap_free (&map);
+		wfs_wipe_ctx_free (&wipe_ctx);
+	}
+}
+END_TEST
+
+START_TEST(test_extmap_pwrite_pattern)
+{
+	static unsigned char unit[WFS_PATTERN_UNIT_SIZE];
+	static unsigned char file_data[3 * WFS_PATTERN_UNIT_SIZE + 200];
+	int fd;
+	size_t i;
+
+	puts ("test_extmap_pwrite_pattern");
+	for ( i = 0; i < sizeof (unit); i++ )
+	{
+		unit[i] = (unsigned char) (i % 251);
+	}
+	memset (file_data, 0xEE, sizeof (file_data));
+	fd = open ("test_wfs_extents.img", O_RDWR | O_CREAT | O_TRUNC, 0600);
+	ck_assert_int_ne (fd, -1);
+	ck_assert_uint_eq (write (fd, file_data, sizeof (file_data)),
+		sizeof (file_data));
+	/* more than one copy, not ending on a copy's boundary */
+	ck_assert_int_eq (wfs_extmap_pwrite_pattern (fd, unit, 100,
+		2 * WFS_PATTERN_UNIT_SIZE + 50), 0);
+	ck_assert_uint_eq (pread (fd, file_data, sizeof (file_data), 0),
+		sizeof (file_data));
+	close (fd);
+	remove ("test_wfs_extents.img");
+	for ( i = 0; i < sizeof (file_data); i++ )
+	{
+		if ( (i < 100) || (i >= 100 + 2 * WFS_PATTERN_UNIT_SIZE + 50) )
+		{
+			ck_assert_uint_eq (file_data[i], 0xEE);
+		}
+		else
+		{
+			ck_assert_uint_eq (file_data[i],
+				unit[(i - 100) % WFS_PATTERN_UNIT_SIZE]);
+		}
+	}
+}
+END_TEST
+
+START_TEST(test_extmap_pwrite_pattern_partial)
+{
+	static unsigned char unit[WFS_PATTERN_UNIT_SIZE];
+	static unsigned char file_data[4 * WFS_PATTERN_UNIT_SIZE];
+	int fd;
+	size_t i;
+	int counting;
+	int res;
+
+	puts ("test_extmap_pwrite_pattern_partial");
+	for ( i = 0; i < sizeof (unit); i++ )
+	{
+		unit[i] = (unsigned char) (i % 251);
+	}
+	memset (file_data, 0xEE, sizeof (file_data));
+	fd = open ("test_wfs_extents.img", O_RDWR | O_CREAT | O_TRUNC, 0600);
+	ck_assert_int_ne (fd, -1);
+	ck_assert_uint_eq (write (fd, file_data, sizeof (file_data)),
+		sizeof (file_data));
+	/* the device writes only a part of each request, not ending
+	   on a copy's boundary - the next write must start on one */
+	counting = wfs_test_io_start ();
+	wfs_test_io_max_write = WFS_PATTERN_UNIT_SIZE + 1000;
+	res = wfs_extmap_pwrite_pattern (fd, unit, WFS_PATTERN_UNIT_SIZE,
+		2 * WFS_PATTERN_UNIT_SIZE + 512);
+	wfs_test_io_stop ();
+	ck_assert_int_eq (res, 0);
+	if ( counting != 0 )
+	{
+		ck_assert_uint_eq (wfs_test_io.unaligned, 0);
+		/* the second write repeats the part of the copy after the first */
+		ck_assert_uint_eq (wfs_test_io.writes, 2);
+		ck_assert_uint_eq (wfs_test_io.bytes_written,
+			WFS_PATTERN_UNIT_SIZE + 1000 + WFS_PATTERN_UNIT_SIZE + 512);
+	}
+	ck_assert_uint_eq (pread (fd, file_data, sizeof (file_data), 0),
+		sizeof (file_data));
+	for ( i = 0; i < sizeof (file_data); i++ )
+	{
+		if ( (i < WFS_PATTERN_UNIT_SIZE)
+			|| (i >= 3 * WFS_PATTERN_UNIT_SIZE + 512) )
+		{
+			ck_assert_uint_eq (file_data[i], 0xEE);
+		}
+		else
+		{
+			ck_assert_uint_eq (file_data[i],
+				unit[i % WFS_PATTERN_UNIT_SIZE]);
+		}
+	}
+
+	/* not even one whole copy written - an error, not an endless loop */
+	counting = wfs_test_io_start ();
+	wfs_test_io_max_write = 100;
+	res = wfs_extmap_pwrite_pattern (fd, unit, 0, 2 * WFS_PATTERN_UNIT_SIZE);
+	wfs_test_io_stop ();
+	wfs_test_io_max_write = 0;
+	if ( counting != 0 )
+	{
+		ck_assert_int_eq (res, EIO);
+	}
+	close (fd);
+	remove ("test_wfs_extents.img");
+}
+END_TEST
+
+START_TEST(test_wipe_extents_resume_pattern)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	FILE * state;
+
+	puts ("test_wipe_extents_resume_pattern");
+	remove ("test_wfs_extents.state");
+	ck_assert_int_eq (wfs_state_init ("test_wfs_extents.state"), 0);
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.fsname = "test_wfs_extents.dev";
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_WFS), 0);
+	/* interrupted in the second pass, after its second extent */
+	test_interrupt_after = 3 + 2;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SIGNAL);
+	sig_recvd = 0;
+	ck_assert_uint_eq (dev.writes[11], 2);
+	ck_assert_uint_eq (dev.writes[20], 1);
+
+	/* the same free space - only the rest is wiped */
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_WFS);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_WFS), 0);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	wfs_extmap_free (&map);
+
+	/* all done - the state file is removed */
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_DONE), 0);
+	ck_assert_int_eq (wfs_state_finish (), 0);
+	state = fopen ("test_wfs_extents.state", "r");
+	ck_assert_ptr_eq (state, NULL);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_resume_chunk)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_blkno_t i;
+
+	puts ("test_wipe_extents_resume_chunk");
+	remove ("test_wfs_extents.state");
+	ck_assert_int_eq (wfs_state_init ("test_wfs_extents.state"), 0);
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.fsname = "test_wfs_extents.dev";
+	wf_gen.wipe_mode = WFS_WIPE_MODE_CHUNK;
+	wf_gen.chunk_size = 4 * TEST_BLOCK_SIZE;
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_WFS), 0);
+	/* groups: 2-5, 10-11 with 20-21, 22-25, 26-29; interrupted
+	   in the third group */
+	test_interrupt_after = 4 + 2 * 4 + 2;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SIGNAL);
+	sig_recvd = 0;
+
+	/* the unfinished group is wiped again, the finished ones are not */
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	for ( i = 0; i < TEST_NBLOCKS; i++ )
+	{
+		if ( (i >= 22) && (i < 26) )
+		{
+			ck_assert_uint_eq (dev.writes[i], 2 + 3 + 1);
+		}
+		else if ( test_is_free (i) != 0 )
+		{
+			ck_assert_uint_eq (dev.writes[i], 3 + 1);
+		}
+		else
+		{
+			ck_assert_uint_eq (dev.writes[i], 0);
+		}
+	}
+
+	/* a different free space - everything is wiped again */
+	ck_assert_int_eq (wfs_extmap_add (&map, 40, 2), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_state_save_position (wf_gen, 1, 0, 26), 0);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	ck_assert_uint_eq (dev.writes[2], 2 * (3 + 1));
+	ck_assert_uint_eq (dev.writes[40], 3 + 1);
+	wfs_extmap_free (&map);
+
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_DONE), 0);
+	ck_assert_int_eq (wfs_state_finish (), 0);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_incremental)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_blkno_t i;
+	FILE * snapshot;
+
+	puts ("test_wipe_extents_incremental");
+	remove ("test_wfs_extents.dev.snap");
+	ck_assert_int_eq (wfs_state_init (NULL), 0);
+	ck_assert_int_eq (wfs_snapshot_init ("."), 0);
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.fsname = "test_wfs_extents.dev";
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	strcpy (wf_gen.fs_uuid, "0123456789abcdef");
+	/* no snapshot yet - everything is wiped */
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	wfs_extmap_free (&map);
+	snapshot = fopen ("test_wfs_extents.dev.snap", "rb");
+	ck_assert_ptr_ne (snapshot, NULL);
+	fclose (snapshot);
+
+	/* blocks 10-11 were allocated, 40-41 were freed */
+	memset (dev.writes, 0, sizeof (dev.writes));
+	ck_assert_int_eq (wfs_extmap_add (&map, 2, 4), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 20, 10), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 40, 2), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	wfs_extmap_free (&map);
+	for ( i = 0; i < TEST_NBLOCKS; i++ )
+	{
+		ck_assert_uint_eq (dev.writes[i], ((i == 40) || (i == 41))?
+			3 + 1 : 0);
+	}
+
+	/* an interrupted wiping doesn't replace the snapshot */
+	memset (dev.writes, 0, sizeof (dev.writes));
+	ck_assert_int_eq (wfs_extmap_add (&map, 2, 4), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 10, 2), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 20, 10), WFS_SUCCESS);
+	test_interrupt_after = 1;
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SIGNAL);
+	sig_recvd = 0;
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_extmap_add (&map, 2, 4), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 10, 2), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (&map, 20, 10), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	wfs_extmap_free (&map);
+	/* only the first pass of the first extent was written before
+	   the signal */
+	ck_assert_uint_eq (dev.writes[10], 1 + 3 + 1);
+	ck_assert_uint_eq (dev.writes[11], 1 + 3 + 1);
+	ck_assert_uint_eq (dev.writes[2], 0);
+
+	/* a different filesystem - everything is wiped */
+	memset (dev.writes, 0, sizeof (dev.writes));
+	wf_gen.whichfs = WFS_CURR_FS_EXT234FS;
+	ck_assert_int_eq (wfs_extmap_add (&map, 2, 4), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	wfs_extmap_free (&map);
+	ck_assert_uint_eq (dev.writes[2], 3 + 1);
+
+	ck_assert_int_eq (wfs_snapshot_init (NULL), 0);
+	remove ("test_wfs_extents.dev.snap");
+}
+END_TEST
+
+START_TEST(test_wipe_extents_progress)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	int fds[2];
+	char records[4096];
+	ssize_t len;
+
+	puts ("test_wipe_extents_progress");
+	ck_assert_int_eq (pipe (fds), 0);
+	wfs_progress_init (fds[1], WFS_PROGRESS_FORMAT_JSON);
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.fsname = "testdev";
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	wfs_progress_set_fs (wf_gen);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	/* done by wfs_show_progress() in the program */
+	wfs_progress_percent (WFS_PROGRESS_WFS, 100);
+	wfs_progress_init (-1, WFS_PROGRESS_FORMAT_TEXT);
+	wfs_extmap_free (&map);
+	close (fds[1]);
+	len = read (fds[0], records, sizeof (records) - 1);
+	close (fds[0]);
+	ck_assert_int_ne (len, -1);
+	records[len] = '\0';
+	/* 16 free blocks, 3 passes and the zero pass */
+	ck_assert_ptr_ne (strstr (records, "\"phase\":\"wfs\""), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"passes\":4,"), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"bytes_written\":32768,"), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"bytes_total\":32768,"), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"percent\":100,"), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"eta_s\":0}\n"), NULL);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_stats)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	int fds[2];
+	char records[4096];
+	ssize_t len;
+
+	puts ("test_wipe_extents_stats");
+	ck_assert_int_eq (pipe (fds), 0);
+	wfs_progress_init (fds[1], WFS_PROGRESS_FORMAT_TEXT);
+	wfs_stats_init ();
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.fsname = "testdev";
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	wfs_progress_set_fs (wf_gen);
+	wfs_stats_set_fs (wf_gen);
+	wfs_stats_begin (WFS_STATS_WFS);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	wfs_stats_end ();
+	wfs_progress_init (-1, WFS_PROGRESS_FORMAT_TEXT);
+	wfs_extmap_free (&map);
+	close (fds[1]);
+	len = read (fds[0], records, sizeof (records) - 1);
+	close (fds[0]);
+	ck_assert_int_ne (len, -1);
+	records[len] = '\0';
+	/* 16 free blocks, 3 passes and the zero pass, nothing read */
+	ck_assert_ptr_ne (strstr (records, "stats=wfs "), NULL);
+	ck_assert_ptr_ne (strstr (records, " read=0 written=32768 reads=0 "),
+		NULL);
+	ck_assert_ptr_eq (strstr (records, " writes=0 "), NULL);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_plan)
+{
+	static struct test_device dev;
+	static unsigned char copy[TEST_NBLOCKS * TEST_BLOCK_SIZE];
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	unsigned int i;
+
+	puts ("test_wipe_extents_plan");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.plan_only = 1;
+	wf_gen.no_wipe_zero_blocks = 1;
+	memcpy (copy, dev.data, sizeof (copy));
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	/* nothing written or flushed, the map untouched */
+	for ( i = 0; i < TEST_NBLOCKS; i++ )
+	{
+		ck_assert_uint_eq (dev.writes[i], 0);
+	}
+	ck_assert_int_eq (memcmp (copy, dev.data, sizeof (copy)), 0);
+	ck_assert_int_eq (test_flushes, 0);
+	ck_assert_int_eq (test_syncs, 0);
+	ck_assert_uint_eq (map.count, 3);
+	ck_assert_uint_eq (map.total_blocks, 16);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_max_iops)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	time_t start;
+
+	puts ("test_wipe_extents_max_iops");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	/* 12 writes, 4 of them at once and the rest at 4 per second */
+	wf_gen.max_iops = 4;
+	start = time (NULL);
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	ck_assert_int_ne (time (NULL) - start, 0);
+	test_check_device (&dev, 3 + 1, TEST_NBLOCKS);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_wipe_extents_syscalls)
+{
+	static struct test_device dev;
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+	wfs_direct_io_t direct;
+	FILE * f;
+	wfs_blkno_t i;
+	int counting;
+
+	puts ("test_wipe_extents_syscalls");
+	test_wipe_setup (&dev, &map, &ops, &wf_gen, &err);
+	/* single free blocks next to each other - must be written as one range */
+	for ( i = 40; i < 56; i++ )
+	{
+		ck_assert_int_eq (wfs_extmap_add (&map, i, 1), WFS_SUCCESS);
+	}
+	f = fopen ("test_wfs_extents.img", "wb");
+	ck_assert_ptr_ne (f, NULL);
+	ck_assert_uint_eq (fwrite (dev.data, 1, sizeof (dev.data), f),
+		sizeof (dev.data));
+	fclose (f);
+
+	wf_gen.fsname = "test_wfs_extents.img";
+	wf_gen.use_direct = 1;
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	wfs_extmap_direct_open (wf_gen, TEST_BLOCK_SIZE, &direct, &ops);
+	counting = wfs_test_io_start ();
+	ck_assert_int_eq (wfs_wipe_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	wfs_test_io_stop ();
+	wfs_extmap_direct_close (&direct);
+
+	if ( (ops.data == &direct) && (counting != 0) )
+	{
+		/* 4 ranges, 3 passes and the zero pass - one write for each */
+		ck_assert_uint_le (wfs_test_io.writes, 4 * (3 + 1));
+		ck_assert_uint_eq (wfs_test_io.bytes_written,
+			(4 + 2 + 10 + 16) * TEST_BLOCK_SIZE * (3 + 1));
+		ck_assert_uint_eq (wfs_test_io.reads, 0);
+		ck_assert_uint_eq (wfs_test_io.seeks, 0);
+		ck_assert_uint_le (wfs_test_io.syncs, 3 + 1);
+	}
+	remove ("test_wfs_extents.img");
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_extents");
+
+	TCase * tests_extents = tcase_create("extents");
+
+	tcase_add_test(tests_extents, test_extmap_add);
+	tcase_add_test(tests_extents, test_extmap_add_overlap);
+	tcase_add_test(tests_extents, test_extmap_add_many);
+	tcase_add_test(tests_extents, test_extmap_sort);
+	tcase_add_test(tests_extents, test_extmap_subtract);
+	tcase_add_test(tests_extents, test_extmap_chunk_blocks);
+	tcase_add_test(tests_extents, test_extmap_io_sizes);
+	tcase_add_test(tests_extents, test_wipe_extents_block);
+	tcase_add_test(tests_extents, test_wipe_extents_block_group);
+	tcase_add_test(tests_extents, test_wipe_extents_pattern);
+	tcase_add_test(tests_extents, test_wipe_extents_skip_zero);
+	tcase_add_test(tests_extents, test_wipe_extents_chunk);
+	tcase_add_test(tests_extents, test_wipe_extents_chunk_small);
+	tcase_add_test(tests_extents, test_wipe_extents_sync_block);
+	tcase_add_test(tests_extents, test_wipe_extents_sync_pattern);
+	tcase_add_test(tests_extents, test_wipe_extents_direct_off);
+	tcase_add_test(tests_extents, test_wipe_extents_direct);
+	tcase_add_test(tests_extents, test_wipe_extents_direct_unavailable);
+	tcase_add_test(tests_extents, test_wipe_extents_direct_fallback);
+	tcase_add_test(tests_extents, test_wipe_extents_gather);
+	tcase_add_test(tests_extents, test_wipe_extents_gather_same);
+	tcase_add_test(tests_extents, test_wipe_extents_random);
+	tcase_add_test(tests_extents, test_extmap_pwrite_pattern);
+	tcase_add_test(tests_extents, test_extmap_pwrite_pattern_partial);
+	tcase_add_test(tests_extents, test_wipe_extents_resume_pattern);
+	tcase_add_test(tests_extents, test_wipe_extents_resume_chunk);
+	tcase_add_test(tests_extents, test_wipe_extents_incremental);
+	tcase_add_test(tests_extents, test_wipe_extents_progress);
+	tcase_add_test(tests_extents, test_wipe_extents_stats);
+	tcase_add_test(tests_extents, test_wipe_extents_plan);
+	tcase_add_test(tests_extents, test_wipe_extents_max_iops);
+	tcase_add_test(tests_extents, test_wipe_extents_syscalls);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_extents, 30);
+
+	suite_add_tcase(s, tests_extents);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
@@ -42,7 +42,7 @@ wfs_check_mounted (
 
 /* ============================================================= */
 
-static wfs_fsid_t wfs_fs = {FS_NAME_HFSP, 1, 0, NULL, NULL, WFS_CURR_FS_NONE, 0, 0, WFS_WIPE_MODE_PATTERN};
+static wfs_fsid_t wfs_fs = {FS_NAME_HFSP, 1, 0, NULL, NULL, WFS_CURR_FS_NONE, 0, 0, WFS_WIPE_MODE_PATTERN, WFS_DEFAULT_CHUNK_SIZE, 0, 0, 0, 0, NULL};
 static wfs_fsdata_t data = {{0, 0}};
 
 START_TEST(test_wfs_hfsp_chk_mount)
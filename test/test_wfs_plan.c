@@ -0,0 +1,255 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_plan.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_plan.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+
+#define TEST_BLOCK_SIZE 512
+#define TEST_NBLOCKS 64
+#define TEST_PLAN_FILE "test_wfs_plan.out"
+
+static unsigned int test_reads = 0;
+static char output[4096];
+
+static wfs_errcode_t
+test_plan_read (void * const data WFS_ATTR ((unused)),
+	unsigned char * const buf, const wfs_blkno_t start,
+	const wfs_blkno_t count, wfs_errcode_t * const error WFS_ATTR ((unused)))
+{
+	/* only the largest free extent is read */
+	ck_assert_uint_le (40, start);
+	ck_assert_uint_le (start + count, 50);
+	memset (buf, 0, (size_t)(count * TEST_BLOCK_SIZE));
+	test_reads++;
+	return WFS_SUCCESS;
+}
+
+static wfs_errcode_t
+test_plan_write (void * const data WFS_ATTR ((unused)),
+	unsigned char * const buf WFS_ATTR ((unused)),
+	const wfs_blkno_t start WFS_ATTR ((unused)),
+	const wfs_blkno_t count WFS_ATTR ((unused)),
+	wfs_errcode_t * const error WFS_ATTR ((unused)))
+{
+	ck_abort_msg ("the plan wrote to the device");
+	return WFS_BLKWR;
+}
+
+static void
+test_plan_setup (wfs_extent_map_t * const map, wfs_extent_ops_t * const ops,
+	wfs_fsid_t * const wf_gen)
+{
+	/* extents of 1, 2, 3 and 10 blocks */
+	wfs_extmap_init (map);
+	ck_assert_int_eq (wfs_extmap_add (map, 2, 1), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (map, 10, 2), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (map, 20, 3), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (map, 40, 10), WFS_SUCCESS);
+
+	memset (ops, 0, sizeof (*ops));
+	ops->read_blocks = &test_plan_read;
+	ops->write_blocks = &test_plan_write;
+	ops->write_pattern = &test_plan_write;
+
+	memset (wf_gen, 0, sizeof (*wf_gen));
+	wf_gen->fsname = "testdev";
+	wf_gen->npasses = 3;
+	wf_gen->zero_pass = 1;
+	test_reads = 0;
+}
+
+/* runs the plan with the standard output going to the output buffer */
+static wfs_errcode_t
+test_plan_run (const wfs_fsid_t wf_gen, const wfs_extent_map_t * const map,
+	const wfs_extent_ops_t * const ops)
+{
+	wfs_errcode_t err = 0;
+	wfs_errcode_t ret;
+	int saved;
+	int fd;
+	ssize_t len;
+
+	fflush (stdout);
+	saved = dup (1);
+	ck_assert_int_ne (saved, -1);
+	fd = open (TEST_PLAN_FILE, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	ck_assert_int_ne (fd, -1);
+	ck_assert_int_ne (dup2 (fd, 1), -1);
+	wfs_test_stdout_open = 1;
+	ret = wfs_plan_extents (wf_gen, map, TEST_BLOCK_SIZE, ops, &err);
+	wfs_test_stdout_open = 0;
+	fflush (stdout);
+	ck_assert_int_ne (dup2 (saved, 1), -1);
+	close (saved);
+	ck_assert_int_ne (lseek (fd, 0, SEEK_SET), -1);
+	len = read (fd, output, sizeof (output) - 1);
+	close (fd);
+	remove (TEST_PLAN_FILE);
+	ck_assert_int_ne (len, -1);
+	output[len] = '\0';
+	return ret;
+}
+
+/* ============================================================= */
+
+START_TEST(test_plan_summary)
+{
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+
+	puts ("test_plan_summary");
+	test_plan_setup (&map, &ops, &wf_gen);
+	ck_assert_int_eq (test_plan_run (wf_gen, &map, &ops), WFS_SUCCESS);
+	ck_assert_int_ne (test_reads, 0);
+	ck_assert_ptr_eq (strstr (output, "WipeFreeSpace:testdev: "), output);
+	ck_assert_ptr_ne (strstr (output, "  Free extents: 4\n"), NULL);
+	ck_assert_ptr_ne (strstr (output, "  Free bytes: 8192\n"), NULL);
+	ck_assert_ptr_ne (strstr (output, "  Passes, including the zero pass: 4\n"),
+		NULL);
+	ck_assert_ptr_ne (strstr (output, "  Bytes to write: 32768\n"), NULL);
+	ck_assert_ptr_eq (strstr (output, "Read speed (MB/s): unknown"), NULL);
+	ck_assert_ptr_eq (strstr (output, "Estimated time (s): unknown"), NULL);
+	ck_assert_ptr_eq (strstr (output, "Write speed limit"), NULL);
+	ck_assert_ptr_eq (strstr (output, "all-zero blocks"), NULL);
+	/* the map is not changed */
+	ck_assert_uint_eq (map.count, 4);
+	ck_assert_uint_eq (map.total_blocks, 16);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_plan_sizes)
+{
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+
+	puts ("test_plan_sizes");
+	test_plan_setup (&map, &ops, &wf_gen);
+	ck_assert_int_eq (test_plan_run (wf_gen, &map, &ops), WFS_SUCCESS);
+	/* powers of 2 of blocks, the empty ones not shown */
+	ck_assert_ptr_ne (strstr (output, "\n    [512, 1024): 1, 512\n"
+		"    [1024, 2048): 2, 2560\n"
+		"    [4096, 8192): 1, 5120\n"), NULL);
+	ck_assert_ptr_eq (strstr (output, "[2048, 4096)"), NULL);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_plan_limits)
+{
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+
+	puts ("test_plan_limits");
+	test_plan_setup (&map, &ops, &wf_gen);
+	/* nothing to measure the speed with */
+	ops.read_blocks = NULL;
+	ck_assert_int_eq (test_plan_run (wf_gen, &map, &ops), WFS_SUCCESS);
+	ck_assert_ptr_ne (strstr (output, "  Read speed (MB/s): unknown\n"), NULL);
+	ck_assert_ptr_ne (strstr (output, "  Estimated time (s): unknown\n"), NULL);
+
+	/* the limit gives the time: 32768 bytes at 1 MB/s */
+	wf_gen.max_rate = 1024 * 1024;
+	wf_gen.no_wipe_zero_blocks = 1;
+	ck_assert_int_eq (test_plan_run (wf_gen, &map, &ops), WFS_SUCCESS);
+	ck_assert_ptr_ne (strstr (output, "  Write speed limit (MB/s): 1.00\n"),
+		NULL);
+	ck_assert_ptr_ne (strstr (output, "  Estimated time (s): 0\n"), NULL);
+	ck_assert_ptr_ne (strstr (output, "all-zero blocks"), NULL);
+
+	/* the writes per second also limit the speed */
+	wf_gen.max_rate = 0;
+	wf_gen.max_iops = 1;
+	ck_assert_int_eq (test_plan_run (wf_gen, &map, &ops), WFS_SUCCESS);
+	ck_assert_ptr_ne (strstr (output, "  Write speed limit (MB/s): "), NULL);
+	ck_assert_ptr_eq (strstr (output, "Estimated time (s): unknown"), NULL);
+	ck_assert_uint_eq (test_reads, 0);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_plan_errors)
+{
+	wfs_extent_map_t map;
+	wfs_extent_ops_t ops;
+	wfs_fsid_t wf_gen;
+	wfs_errcode_t err = 0;
+
+	puts ("test_plan_errors");
+	test_plan_setup (&map, &ops, &wf_gen);
+	ck_assert_int_eq (wfs_plan_extents (wf_gen, &map, 0, &ops, &err),
+		WFS_BADPARAM);
+	/* nothing shown without the standard output */
+	ck_assert_int_eq (wfs_plan_extents (wf_gen, &map, TEST_BLOCK_SIZE,
+		&ops, &err), WFS_SUCCESS);
+	wfs_extmap_free (&map);
+
+	/* no free space */
+	wfs_extmap_init (&map);
+	test_reads = 0;
+	ck_assert_int_eq (test_plan_run (wf_gen, &map, &ops), WFS_SUCCESS);
+	ck_assert_uint_eq (test_reads, 0);
+	ck_assert_ptr_ne (strstr (output, "  Free extents: 0\n"), NULL);
+	ck_assert_ptr_ne (strstr (output, "  Bytes to write: 0\n"), NULL);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_plan");
+
+	TCase * tests_plan = tcase_create("plan");
+
+	tcase_add_test(tests_plan, test_plan_summary);
+	tcase_add_test(tests_plan, test_plan_sizes);
+	tcase_add_test(tests_plan, test_plan_limits);
+	tcase_add_test(tests_plan, test_plan_errors);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_plan, 30);
+
+	suite_add_tcase(s, tests_plan);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
@@ -0,0 +1,142 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_probe.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_probe.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static unsigned char buf[WFS_PROBE_SIZE];
+
+static wfs_curr_fs_t test_probe_magic (const size_t offset, const char * const magic,
+	const size_t len)
+{
+	memset (buf, 0, sizeof (buf));
+	memcpy (&buf[offset], magic, len);
+	return wfs_probe_buffer (buf, sizeof (buf));
+}
+
+/* ============================================================= */
+
+START_TEST(test_probe_magics)
+{
+	puts ("test_probe_magics");
+	ck_assert_int_eq (test_probe_magic (0, "XFSB", 4), WFS_CURR_FS_XFS);
+	ck_assert_int_eq (test_probe_magic (3, "NTFS    ", 8), WFS_CURR_FS_NTFS);
+	ck_assert_int_eq (test_probe_magic (1080, "\x53\xEF", 2), WFS_CURR_FS_EXT234FS);
+	ck_assert_int_eq (test_probe_magic (1024, "H+", 2), WFS_CURR_FS_HFSP);
+	ck_assert_int_eq (test_probe_magic (1024, "HX", 2), WFS_CURR_FS_HFSP);
+	ck_assert_int_eq (test_probe_magic (32768, "JFS1", 4), WFS_CURR_FS_JFS);
+	ck_assert_int_eq (test_probe_magic (65536, "ReIsEr4", 7), WFS_CURR_FS_REISER4);
+	ck_assert_int_eq (test_probe_magic (65536 + 52, "ReIsEr2Fs", 9), WFS_CURR_FS_REISERFS);
+	ck_assert_int_eq (test_probe_magic (8192 + 52, "ReIsErFs", 8), WFS_CURR_FS_REISERFS);
+	ck_assert_int_eq (test_probe_magic (4096, "OCFSV2", 6), WFS_CURR_FS_OCFS);
+	ck_assert_int_eq (test_probe_magic (1040, "\x7F\x13", 2), WFS_CURR_FS_MINIXFS);
+	ck_assert_int_eq (test_probe_magic (1040, "\x78\x24", 2), WFS_CURR_FS_MINIXFS);
+	ck_assert_int_eq (test_probe_magic (1048, "\x5A\x4D", 2), WFS_CURR_FS_MINIXFS);
+	ck_assert_int_eq (test_probe_magic (100, "XFSB", 4), WFS_CURR_FS_NONE);
+}
+END_TEST
+
+START_TEST(test_probe_fat)
+{
+	puts ("test_probe_fat");
+	/* no boot sector signature */
+	ck_assert_int_eq (test_probe_magic (82, "FAT32   ", 8), WFS_CURR_FS_NONE);
+	buf[510] = 0x55;
+	buf[511] = 0xAA;
+	ck_assert_int_eq (wfs_probe_buffer (buf, sizeof (buf)), WFS_CURR_FS_FATFS);
+	memcpy (&buf[54], "FAT16   ", 8);
+	ck_assert_int_eq (wfs_probe_buffer (buf, sizeof (buf)), WFS_CURR_FS_FATFS);
+	/* FAT wins over an accidental MinixFS magic */
+	memcpy (&buf[1040], "\x7F\x13", 2);
+	ck_assert_int_eq (wfs_probe_buffer (buf, sizeof (buf)), WFS_CURR_FS_FATFS);
+	/* NTFS has the same signature */
+	memcpy (&buf[3], "NTFS    ", 8);
+	ck_assert_int_eq (wfs_probe_buffer (buf, sizeof (buf)), WFS_CURR_FS_NTFS);
+}
+END_TEST
+
+START_TEST(test_probe_short)
+{
+	puts ("test_probe_short");
+	/* the magic is beyond the data read */
+	memset (buf, 0, sizeof (buf));
+	memcpy (&buf[32768], "JFS1", 4);
+	ck_assert_int_eq (wfs_probe_buffer (buf, 32770), WFS_CURR_FS_NONE);
+	ck_assert_int_eq (wfs_probe_buffer (buf, 32772), WFS_CURR_FS_JFS);
+	ck_assert_int_eq (wfs_probe_buffer (buf, 0), WFS_CURR_FS_NONE);
+}
+END_TEST
+
+START_TEST(test_probe_fs)
+{
+	FILE * f;
+
+	puts ("test_probe_fs");
+	memset (buf, 0, sizeof (buf));
+	memcpy (&buf[1080], "\x53\xEF", 2);
+	f = fopen ("test_wfs_probe.img", "wb");
+	ck_assert_ptr_ne (f, NULL);
+	/* smaller than the probed size */
+	ck_assert_uint_eq (fwrite (buf, 1, 4096, f), 4096);
+	fclose (f);
+	ck_assert_int_eq (wfs_probe_fs ("test_wfs_probe.img"), WFS_CURR_FS_EXT234FS);
+	remove ("test_wfs_probe.img");
+	ck_assert_int_eq (wfs_probe_fs ("test_wfs_probe.img"), WFS_CURR_FS_NONE);
+	ck_assert_int_eq (wfs_probe_fs (NULL), WFS_CURR_FS_NONE);
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_probe");
+
+	TCase * tests_probe = tcase_create("probe");
+
+	tcase_add_test(tests_probe, test_probe_magics);
+	tcase_add_test(tests_probe, test_probe_fat);
+	tcase_add_test(tests_probe, test_probe_short);
+	tcase_add_test(tests_probe, test_probe_fs);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_probe, 30);
+
+	suite_add_tcase(s, tests_probe);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
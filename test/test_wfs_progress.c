@@ -0,0 +1,218 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_progress.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_progress.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+static int test_fds[2];
+static char records[4096];
+static volatile sig_atomic_t test_sigpipe = 0;
+
+static void
+test_sigpipe_received (int signum)
+{
+	test_sigpipe = signum;
+}
+
+static void
+test_progress_start (const wfs_progress_format_t format,
+	const char * const device)
+{
+	wfs_fsid_t wf_gen;
+
+	memset (&wf_gen, 0, sizeof (wf_gen));
+	wf_gen.fsname = device;
+	ck_assert_int_eq (pipe (test_fds), 0);
+	wfs_progress_init (test_fds[1], format);
+	ck_assert_int_eq (wfs_progress_is_enabled (), 1);
+	wfs_progress_set_fs (wf_gen);
+}
+
+/* returns the number of the records written */
+static unsigned int
+test_progress_stop (void)
+{
+	ssize_t len;
+	unsigned int lines = 0;
+	ssize_t i;
+
+	wfs_progress_init (-1, WFS_PROGRESS_FORMAT_TEXT);
+	ck_assert_int_eq (wfs_progress_is_enabled (), 0);
+	close (test_fds[1]);
+	len = read (test_fds[0], records, sizeof (records) - 1);
+	close (test_fds[0]);
+	ck_assert_int_ne (len, -1);
+	records[len] = '\0';
+	for ( i = 0; i < len; i++ )
+	{
+		if ( records[i] == '\n' )
+		{
+			lines++;
+		}
+	}
+	return lines;
+}
+
+/* ============================================================= */
+
+START_TEST(test_progress_text)
+{
+	puts ("test_progress_text");
+	test_progress_start (WFS_PROGRESS_FORMAT_TEXT, "test dev");
+	wfs_progress_phase (WFS_PROGRESS_WFS, 4);
+	wfs_progress_set_total (1000);
+	wfs_progress_set_pass (2);
+	/* too early for a record */
+	wfs_progress_add (250, 100);
+	wfs_progress_percent (WFS_PROGRESS_WFS, 100);
+	/* the stage has ended, no more records */
+	wfs_progress_percent (WFS_PROGRESS_WFS, 100);
+	ck_assert_uint_eq (test_progress_stop (), 1);
+	/* the stage's end is always 100%, the device name goes last */
+	ck_assert_ptr_eq (strstr (records, "phase=wfs pass=3/4 written=250"
+		" scanned=100 total=1000 percent=100 mb_per_s="), records);
+	ck_assert_ptr_ne (strstr (records, " eta_s=0 device=test dev\n"), NULL);
+}
+END_TEST
+
+START_TEST(test_progress_json)
+{
+	puts ("test_progress_json");
+	test_progress_start (WFS_PROGRESS_FORMAT_JSON, "a\"b\\c\001");
+	wfs_progress_phase (WFS_PROGRESS_WFS, 2);
+	wfs_progress_add (512, 0);
+	wfs_progress_percent (WFS_PROGRESS_WFS, 100);
+	ck_assert_uint_eq (test_progress_stop (), 1);
+	ck_assert_ptr_eq (strstr (records, "{\"device\":\"a\\\"b\\\\c\\u0001\","
+		"\"phase\":\"wfs\",\"pass\":1,\"passes\":2,\"bytes_written\":512,"
+		"\"bytes_scanned\":0,\"bytes_total\":0,\"percent\":100,"
+		"\"mb_per_s\":"), records);
+	ck_assert_ptr_ne (strstr (records, ",\"eta_s\":0}\n"), NULL);
+}
+END_TEST
+
+START_TEST(test_progress_stages)
+{
+	puts ("test_progress_stages");
+	test_progress_start (WFS_PROGRESS_FORMAT_TEXT, "dev");
+	/* a backend's stage, with only the percentage known */
+	wfs_progress_percent (WFS_PROGRESS_UNRM, 50);
+	wfs_progress_percent (WFS_PROGRESS_UNRM, 100);
+	/* a new stage starts with the counters set to zero */
+	wfs_progress_phase (WFS_PROGRESS_WFS, 1);
+	wfs_progress_add (100, 0);
+	wfs_progress_percent (WFS_PROGRESS_PART, 100);
+	ck_assert_uint_eq (test_progress_stop (), 2);
+	ck_assert_ptr_ne (strstr (records, "phase=unrm pass=1/0 written=0"
+		" scanned=0 total=0 percent=100 "), NULL);
+	ck_assert_ptr_ne (strstr (records, "phase=part pass=1/0 written=0"
+		" scanned=0 total=0 percent=100 "), NULL);
+	ck_assert_ptr_eq (strstr (records, "phase=wfs"), NULL);
+}
+END_TEST
+
+START_TEST(test_progress_record)
+{
+	puts ("test_progress_record");
+	test_progress_start (WFS_PROGRESS_FORMAT_TEXT, "dev");
+	wfs_progress_record ("\"a\":1", "a=1");
+	ck_assert_uint_eq (test_progress_stop (), 1);
+	ck_assert_str_eq (records, "a=1 device=dev\n");
+
+	test_progress_start (WFS_PROGRESS_FORMAT_JSON, "dev");
+	wfs_progress_record ("\"a\":1", "a=1");
+	ck_assert_uint_eq (test_progress_stop (), 1);
+	ck_assert_str_eq (records, "{\"device\":\"dev\",\"a\":1}\n");
+
+	/* nothing written when disabled */
+	wfs_progress_record ("\"a\":1", "a=1");
+	wfs_progress_percent (WFS_PROGRESS_WFS, 100);
+}
+END_TEST
+
+START_TEST(test_progress_closed)
+{
+	struct sigaction sa;
+	struct sigaction old_sa;
+
+	puts ("test_progress_closed");
+	/* SIGPIPE is handled like in the program */
+	memset (&sa, 0, sizeof (sa));
+	sa.sa_handler = &test_sigpipe_received;
+	ck_assert_int_eq (sigaction (SIGPIPE, &sa, &old_sa), 0);
+	test_sigpipe = 0;
+	test_progress_start (WFS_PROGRESS_FORMAT_TEXT, "dev");
+	wfs_progress_record ("\"a\":1", "a=1");
+	/* the reader goes away in the middle of the wiping */
+	close (test_fds[0]);
+	wfs_progress_phase (WFS_PROGRESS_WFS, 1);
+	wfs_progress_add (512, 0);
+	wfs_progress_percent (WFS_PROGRESS_WFS, 100);
+	ck_assert_int_eq (test_sigpipe, 0);
+	ck_assert_int_eq (wfs_progress_is_enabled (), 0);
+	/* nothing more is written and the handler is back */
+	wfs_progress_record ("\"a\":1", "a=1");
+	ck_assert_int_eq (test_sigpipe, 0);
+	ck_assert_int_eq (sigaction (SIGPIPE, &old_sa, &sa), 0);
+	ck_assert (sa.sa_handler == &test_sigpipe_received);
+	wfs_progress_init (-1, WFS_PROGRESS_FORMAT_TEXT);
+	close (test_fds[1]);
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_progress");
+
+	TCase * tests_progress = tcase_create("progress");
+
+	tcase_add_test(tests_progress, test_progress_text);
+	tcase_add_test(tests_progress, test_progress_json);
+	tcase_add_test(tests_progress, test_progress_stages);
+	tcase_add_test(tests_progress, test_progress_record);
+	tcase_add_test(tests_progress, test_progress_closed);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_progress, 30);
+
+	suite_add_tcase(s, tests_progress);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
@@ -0,0 +1,299 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_snapshot.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+/* the name of the device, with the characters not allowed in file names */
+#define TEST_SNAP_DEVICE "test snap/dev"
+#define TEST_SNAP_FILE "test_snap_dev.snap"
+#define TEST_SNAP_NEW_FILE "test_snap_dev.snap.new"
+#define TEST_SNAP_UUID "01234567-89ab-cdef-0123-456789abcdef"
+
+static void
+test_snap_fs (wfs_fsid_t * const wf_gen)
+{
+	memset (wf_gen, 0, sizeof (*wf_gen));
+	wf_gen->fsname = TEST_SNAP_DEVICE;
+	wf_gen->whichfs = WFS_CURR_FS_EXT234FS;
+	wf_gen->npasses = 3;
+	strcpy (wf_gen->fs_uuid, TEST_SNAP_UUID);
+}
+
+static void
+test_snap_map (wfs_extent_map_t * const map, const int with_new)
+{
+	wfs_extmap_init (map);
+	ck_assert_int_eq (wfs_extmap_add (map, 2, 4), WFS_SUCCESS);
+	ck_assert_int_eq (wfs_extmap_add (map, 10, 2), WFS_SUCCESS);
+	if ( with_new != 0 )
+	{
+		ck_assert_int_eq (wfs_extmap_add (map, 40, 2), WFS_SUCCESS);
+	}
+}
+
+static int
+test_snap_exists (const char * const name)
+{
+	FILE * f;
+
+	f = fopen (name, "rb");
+	if ( f == NULL )
+	{
+		return 0;
+	}
+	fclose (f);
+	return 1;
+}
+
+/* ============================================================= */
+
+START_TEST(test_snapshot_init)
+{
+	FILE * f;
+
+	puts ("test_snapshot_init");
+	ck_assert_int_eq (wfs_snapshot_init (NULL), 0);
+	ck_assert_int_eq (wfs_snapshot_is_enabled (), 0);
+	ck_assert_int_ne (wfs_snapshot_init ("test_wfs_snapshot.nodir"), 0);
+	ck_assert_int_eq (wfs_snapshot_is_enabled (), 0);
+	f = fopen ("test_wfs_snapshot.file", "w");
+	ck_assert_ptr_ne (f, NULL);
+	fclose (f);
+	ck_assert_int_eq (wfs_snapshot_init ("test_wfs_snapshot.file"), ENOTDIR);
+	ck_assert_int_eq (wfs_snapshot_is_enabled (), 0);
+	remove ("test_wfs_snapshot.file");
+	ck_assert_int_eq (wfs_snapshot_init ("."), 0);
+	ck_assert_int_eq (wfs_snapshot_is_enabled (), 1);
+	ck_assert_int_eq (wfs_snapshot_init (NULL), 0);
+}
+END_TEST
+
+START_TEST(test_snapshot_disabled)
+{
+	wfs_fsid_t wf_gen;
+	wfs_extent_map_t map;
+	int applied = 1;
+
+	puts ("test_snapshot_disabled");
+	test_snap_fs (&wf_gen);
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_init (NULL), 0);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 0);
+	ck_assert_uint_eq (map.count, 3);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 1), 0);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_FILE), 0);
+	wfs_extmap_free (&map);
+}
+END_TEST
+
+START_TEST(test_snapshot_subtract)
+{
+	wfs_fsid_t wf_gen;
+	wfs_extent_map_t map;
+	int applied = 1;
+
+	puts ("test_snapshot_subtract");
+	remove (TEST_SNAP_FILE);
+	ck_assert_int_eq (wfs_snapshot_init ("."), 0);
+	test_snap_fs (&wf_gen);
+
+	/* no snapshot yet - all the free space stays */
+	test_snap_map (&map, 0);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 0);
+	ck_assert_uint_eq (map.count, 2);
+	ck_assert_uint_eq (map.total_blocks, 6);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_NEW_FILE), 1);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_FILE), 0);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 1), 0);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_NEW_FILE), 0);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_FILE), 1);
+
+	/* only the blocks freed since then stay */
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 1);
+	ck_assert_uint_eq (map.count, 1);
+	ck_assert_uint_eq (map.extents[0].start, 40);
+	ck_assert_uint_eq (map.extents[0].length, 2);
+	ck_assert_uint_eq (map.total_blocks, 2);
+	wfs_extmap_free (&map);
+
+	/* an unfinished wiping keeps the previous snapshot */
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 0), 0);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_NEW_FILE), 0);
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 1);
+	ck_assert_uint_eq (map.total_blocks, 2);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 0), 0);
+
+	ck_assert_int_eq (wfs_snapshot_init (NULL), 0);
+	remove (TEST_SNAP_FILE);
+}
+END_TEST
+
+START_TEST(test_snapshot_identity)
+{
+	wfs_fsid_t wf_gen;
+	wfs_extent_map_t map;
+	int applied = 1;
+	FILE * f;
+
+	puts ("test_snapshot_identity");
+	remove (TEST_SNAP_FILE);
+	ck_assert_int_eq (wfs_snapshot_init ("."), 0);
+	test_snap_fs (&wf_gen);
+	test_snap_map (&map, 0);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 1), 0);
+
+	/* a different block size */
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 1024, &applied), 0);
+	ck_assert_int_eq (applied, 0);
+	ck_assert_uint_eq (map.count, 3);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 0), 0);
+
+	/* a different filesystem */
+	wf_gen.whichfs = WFS_CURR_FS_NTFS;
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 0);
+	ck_assert_uint_eq (map.count, 3);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 0), 0);
+	wf_gen.whichfs = WFS_CURR_FS_EXT234FS;
+
+	/* another filesystem made on the same device */
+	strcpy (wf_gen.fs_uuid, "89abcdef01234567");
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 0);
+	ck_assert_uint_eq (map.count, 3);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 0), 0);
+	strcpy (wf_gen.fs_uuid, TEST_SNAP_UUID);
+
+	/* a damaged snapshot */
+	f = fopen (TEST_SNAP_FILE, "wb");
+	ck_assert_ptr_ne (f, NULL);
+	fputs ("garbage\n", f);
+	fclose (f);
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 0);
+	ck_assert_uint_eq (map.count, 3);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 0), 0);
+
+	ck_assert_int_eq (wfs_snapshot_init (NULL), 0);
+	remove (TEST_SNAP_FILE);
+}
+END_TEST
+
+START_TEST(test_snapshot_unknown)
+{
+	wfs_fsid_t wf_gen;
+	wfs_extent_map_t map;
+	int applied = 1;
+
+	puts ("test_snapshot_unknown");
+	remove (TEST_SNAP_FILE);
+	ck_assert_int_eq (wfs_snapshot_init ("."), 0);
+	test_snap_fs (&wf_gen);
+	test_snap_map (&map, 0);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 1), 0);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_FILE), 1);
+
+	/* an image without a UUID - all the free space is wiped and the
+	   snapshot of the filesystem which had the UUID stays */
+	wf_gen.fs_uuid[0] = '\0';
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 0);
+	ck_assert_uint_eq (map.count, 3);
+	ck_assert_uint_eq (map.total_blocks, 8);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_NEW_FILE), 0);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 1), 0);
+	ck_assert_int_eq (test_snap_exists (TEST_SNAP_NEW_FILE), 0);
+
+	/* the snapshot is still there for the filesystem */
+	strcpy (wf_gen.fs_uuid, TEST_SNAP_UUID);
+	test_snap_map (&map, 1);
+	ck_assert_int_eq (wfs_snapshot_begin (wf_gen, &map, 512, &applied), 0);
+	ck_assert_int_eq (applied, 1);
+	ck_assert_uint_eq (map.total_blocks, 2);
+	wfs_extmap_free (&map);
+	ck_assert_int_eq (wfs_snapshot_end (wf_gen, 0), 0);
+
+	ck_assert_int_eq (wfs_snapshot_init (NULL), 0);
+	remove (TEST_SNAP_FILE);
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_snapshot");
+
+	TCase * tests_snapshot = tcase_create("snapshot");
+
+	tcase_add_test(tests_snapshot, test_snapshot_init);
+	tcase_add_test(tests_snapshot, test_snapshot_disabled);
+	tcase_add_test(tests_snapshot, test_snapshot_subtract);
+	tcase_add_test(tests_snapshot, test_snapshot_identity);
+	tcase_add_test(tests_snapshot, test_snapshot_unknown);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_snapshot, 30);
+
+	suite_add_tcase(s, tests_snapshot);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
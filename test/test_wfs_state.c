@@ -0,0 +1,320 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_state.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_state.h"
+#include "src/wfs_wiping.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_STATE_FILE "test_wfs_state.state"
+
+static void
+test_state_fs (wfs_fsid_t * const wf_gen, const char * const name)
+{
+	memset (wf_gen, 0, sizeof (*wf_gen));
+	wf_gen->fsname = name;
+	wf_gen->whichfs = WFS_CURR_FS_EXT234FS;
+	wf_gen->npasses = 3;
+	wf_gen->zero_pass = 1;
+	wf_gen->wipe_mode = WFS_WIPE_MODE_BLOCK;
+}
+
+static int
+test_state_exists (void)
+{
+	FILE * f;
+
+	f = fopen (TEST_STATE_FILE, "r");
+	if ( f == NULL )
+	{
+		return 0;
+	}
+	fclose (f);
+	return 1;
+}
+
+/* ============================================================= */
+
+START_TEST(test_state_disabled)
+{
+	wfs_fsid_t wf_gen;
+	unsigned long int pass = 5;
+	wfs_blkno_t cursor = 5;
+
+	puts ("test_state_disabled");
+	test_state_fs (&wf_gen, "dev1");
+	ck_assert_int_eq (wfs_state_init (NULL), 0);
+	ck_assert_int_eq (wfs_state_is_enabled (), 0);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_UNRM), 0);
+	ck_assert_int_eq (wfs_state_save_position (wf_gen, 7, 1, 2), 0);
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 0);
+	ck_assert_uint_eq (pass, 5);
+	ck_assert_uint_eq (cursor, 5);
+	ck_assert_int_eq (wfs_state_finish (), 0);
+}
+END_TEST
+
+START_TEST(test_state_phases)
+{
+	wfs_fsid_t wf_gen;
+	wfs_fsid_t other;
+
+	puts ("test_state_phases");
+	remove (TEST_STATE_FILE);
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	ck_assert_int_eq (wfs_state_is_enabled (), 1);
+	/* created at once, to check that it can be written */
+	ck_assert_int_eq (test_state_exists (), 1);
+
+	test_state_fs (&wf_gen, "dev1");
+	test_state_fs (&other, "dev2");
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_UNRM), 0);
+	ck_assert_int_eq (wfs_state_set_phase (other, WFS_STATE_PART), 0);
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_UNRM);
+	ck_assert_int_eq (wfs_state_start (other), WFS_STATE_PART);
+
+	/* wiped in a different way - starts from the beginning */
+	wf_gen.npasses = 4;
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	wf_gen.npasses = 3;
+	wf_gen.zero_pass = 0;
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	wf_gen.zero_pass = 1;
+	wf_gen.wipe_mode = WFS_WIPE_MODE_PATTERN;
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	wf_gen.wipe_mode = WFS_WIPE_MODE_BLOCK;
+	wf_gen.whichfs = WFS_CURR_FS_NTFS;
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	wf_gen.whichfs = WFS_CURR_FS_EXT234FS;
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_UNRM);
+
+	/* the records survive restarting the program */
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_UNRM);
+	ck_assert_int_eq (wfs_state_start (other), WFS_STATE_PART);
+	ck_assert_int_eq (wfs_state_init (NULL), 0);
+	remove (TEST_STATE_FILE);
+}
+END_TEST
+
+START_TEST(test_state_position)
+{
+	wfs_fsid_t wf_gen;
+	unsigned long int pass = 0;
+	wfs_blkno_t cursor = 0;
+
+	puts ("test_state_position");
+	remove (TEST_STATE_FILE);
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	test_state_fs (&wf_gen, "dev1");
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_WFS), 0);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 0);
+
+	ck_assert_int_eq (wfs_state_save_position (wf_gen, 7, 2, 20), 0);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 1);
+	ck_assert_uint_eq (pass, 2);
+	ck_assert_uint_eq (cursor, 20);
+	/* a different free space */
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 8, &pass, &cursor), 0);
+
+	/* entering the same stage again keeps the position */
+	pass = 0;
+	cursor = 0;
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_WFS), 0);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 1);
+	ck_assert_uint_eq (pass, 2);
+	ck_assert_uint_eq (cursor, 20);
+
+	/* but not when wiping in a different way */
+	wf_gen.npasses = 4;
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 0);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_WFS), 0);
+	wf_gen.npasses = 3;
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 0);
+
+	/* no position outside of the wiping of the free space */
+	ck_assert_int_eq (wfs_state_save_position (wf_gen, 7, 1, 10), 0);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_DONE), 0);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 0);
+
+	/* key 0 means the free space can't be identified */
+	ck_assert_int_eq (wfs_state_save_position (wf_gen, 0, 1, 10), 0);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 0, &pass, &cursor), 0);
+	ck_assert_int_eq (wfs_state_init (NULL), 0);
+	remove (TEST_STATE_FILE);
+}
+END_TEST
+
+START_TEST(test_state_method)
+{
+	wfs_fsid_t wf_gen;
+	wfs_wipe_ctx_t saved_ctx;
+	wfs_wipe_ctx_t ctx;
+	unsigned int schedule[3];
+	unsigned long int pass = 0;
+	wfs_blkno_t cursor = 0;
+
+	puts ("test_state_method");
+	remove (TEST_STATE_FILE);
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	test_state_fs (&wf_gen, "dev1");
+	wfs_wipe_ctx_init (&saved_ctx, 3, 0, 0, "gutmann");
+	ck_assert_ptr_ne (saved_ctx.schedule, NULL);
+	memcpy (schedule, saved_ctx.schedule, sizeof (schedule));
+	wf_gen.wipe_ctx = &saved_ctx;
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_WFS), 0);
+	ck_assert_int_eq (wfs_state_save_position (wf_gen, 7, 1, 10), 0);
+	wfs_wipe_ctx_free (&saved_ctx);
+
+	/* a different method with the same number of passes */
+	wfs_wipe_ctx_init (&ctx, 3, 0, 0, "random");
+	wf_gen.wipe_ctx = &ctx;
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 0);
+	wfs_wipe_ctx_free (&ctx);
+
+	/* the same method, but the patterns in a different order */
+	wfs_wipe_ctx_init (&ctx, 3, 0, 0, "gutmann");
+	wfs_set_seed (wf_gen, wfs_get_seed (wf_gen) + 1);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 0);
+
+	/* resuming gives the saved patterns in the saved order */
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_WFS);
+	ck_assert_ptr_ne (ctx.schedule, NULL);
+	ck_assert_int_eq (memcmp (ctx.schedule, schedule, sizeof (schedule)), 0);
+	ck_assert_int_eq (wfs_state_get_position (wf_gen, 7, &pass, &cursor), 1);
+	ck_assert_uint_eq (pass, 1);
+	ck_assert_uint_eq (cursor, 10);
+	wfs_wipe_ctx_free (&ctx);
+
+	ck_assert_int_eq (wfs_state_init (NULL), 0);
+	remove (TEST_STATE_FILE);
+}
+END_TEST
+
+START_TEST(test_state_finish)
+{
+	wfs_fsid_t wf_gen;
+	wfs_fsid_t other;
+
+	puts ("test_state_finish");
+	remove (TEST_STATE_FILE);
+	test_state_fs (&wf_gen, "dev1");
+	test_state_fs (&other, "dev2");
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_DONE), 0);
+	ck_assert_int_eq (wfs_state_set_phase (other, WFS_STATE_WFS), 0);
+	/* one filesystem not finished - the file is kept */
+	ck_assert_int_eq (wfs_state_finish (), 0);
+	ck_assert_int_eq (wfs_state_is_enabled (), 0);
+	ck_assert_int_eq (test_state_exists (), 1);
+
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_DONE);
+	ck_assert_int_eq (wfs_state_set_phase (other, WFS_STATE_DONE), 0);
+	ck_assert_int_eq (wfs_state_finish (), 0);
+	ck_assert_int_eq (test_state_exists (), 0);
+}
+END_TEST
+
+START_TEST(test_state_invalid)
+{
+	wfs_fsid_t wf_gen;
+	FILE * f;
+
+	puts ("test_state_invalid");
+	test_state_fs (&wf_gen, "dev1");
+	f = fopen (TEST_STATE_FILE, "w");
+	ck_assert_ptr_ne (f, NULL);
+	/* a comment, garbage, a record without the method and the seed,
+	   an unknown stage and an unfinished line */
+	fputs ("# comment\n", f);
+	fputs ("garbage\n", f);
+	fputs ("wfs 1 3 1 1 0 0 0 dev1\n", f);
+	fputs ("bogus 1 3 1 1 0 1 0 0 0 dev1\n", f);
+	fputs ("wfs 1 3 1 1 0 1 0 0 0 dev1", f);
+	fclose (f);
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_NONE);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_PART), 0);
+	ck_assert_int_eq (wfs_state_start (wf_gen), WFS_STATE_PART);
+	ck_assert_int_eq (wfs_state_set_phase (wf_gen, WFS_STATE_DONE), 0);
+	ck_assert_int_eq (wfs_state_finish (), 0);
+	ck_assert_int_eq (test_state_exists (), 0);
+
+	/* can't be replaced - the first failure of saving the position
+	   is remembered until checked */
+	ck_assert_int_eq (wfs_state_init (TEST_STATE_FILE), 0);
+	ck_assert_int_eq (wfs_state_get_save_error (), 0);
+	remove (TEST_STATE_FILE);
+	ck_assert_int_eq (mkdir (TEST_STATE_FILE, 0700), 0);
+	ck_assert_int_ne (wfs_state_save_position (wf_gen, 7, 1, 10), 0);
+	ck_assert_int_ne (wfs_state_save_position (wf_gen, 7, 2, 10), 0);
+	ck_assert_int_ne (wfs_state_get_save_error (), 0);
+	ck_assert_int_eq (wfs_state_get_save_error (), 0);
+	ck_assert_int_eq (wfs_state_init (NULL), 0);
+	rmdir (TEST_STATE_FILE);
+
+	/* can't be created */
+	ck_assert_int_ne (wfs_state_init ("test_wfs_state.nodir/state"), 0);
+	ck_assert_int_eq (wfs_state_is_enabled (), 0);
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_state");
+
+	TCase * tests_state = tcase_create("state");
+
+	tcase_add_test(tests_state, test_state_disabled);
+	tcase_add_test(tests_state, test_state_phases);
+	tcase_add_test(tests_state, test_state_position);
+	tcase_add_test(tests_state, test_state_method);
+	tcase_add_test(tests_state, test_state_finish);
+	tcase_add_test(tests_state, test_state_invalid);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_state, 30);
+
+	suite_add_tcase(s, tests_state);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
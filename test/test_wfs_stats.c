@@ -0,0 +1,180 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_stats.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_stats.h"
+#include "src/wfs_progress.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_fds[2];
+static char records[4096];
+
+static void
+test_stats_start (const wfs_progress_format_t format)
+{
+	wfs_fsid_t wf_gen;
+
+	memset (&wf_gen, 0, sizeof (wf_gen));
+	wf_gen.fsname = "testdev";
+	ck_assert_int_eq (pipe (test_fds), 0);
+	wfs_progress_init (test_fds[1], format);
+	wfs_progress_set_fs (wf_gen);
+	wfs_stats_init ();
+	ck_assert_int_eq (wfs_stats_is_enabled (), 1);
+	wfs_stats_set_fs (wf_gen);
+}
+
+/* returns the number of the records written */
+static unsigned int
+test_stats_stop (void)
+{
+	ssize_t len;
+	unsigned int lines = 0;
+	ssize_t i;
+
+	wfs_progress_init (-1, WFS_PROGRESS_FORMAT_TEXT);
+	close (test_fds[1]);
+	len = read (test_fds[0], records, sizeof (records) - 1);
+	close (test_fds[0]);
+	ck_assert_int_ne (len, -1);
+	records[len] = '\0';
+	for ( i = 0; i < len; i++ )
+	{
+		if ( records[i] == '\n' )
+		{
+			lines++;
+		}
+	}
+	return lines;
+}
+
+/* ============================================================= */
+
+START_TEST(test_stats_counters)
+{
+	puts ("test_stats_counters");
+	test_stats_start (WFS_PROGRESS_FORMAT_TEXT);
+	wfs_stats_begin (WFS_STATS_WFS);
+	wfs_stats_add_read (512, 0.001);
+	wfs_stats_add_write (4096, 0.0000005);
+	wfs_stats_add_write (4096, 0.000003);
+	wfs_stats_add_write (4096, 0.001);
+	wfs_stats_add_sync (0.01);
+	wfs_stats_add_fill (0.01);
+	wfs_stats_end ();
+	ck_assert_uint_eq (test_stats_stop (), 1);
+	ck_assert_ptr_eq (strstr (records, "stats=wfs time_s="), records);
+	ck_assert_ptr_ne (strstr (records, " write_s=0.001004 sync_s=0.010000"
+		" fill_s=0.010000 read=512 written=12288 reads=1 writes=3"
+		" syncs=1 "), NULL);
+	/* below 1 microsecond, [2, 4) and [512, 1024) microseconds */
+	ck_assert_ptr_ne (strstr (records, " latency_us_log2=1,0,1,0,0,0,0,0,0,0,1,"
+		"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 device=testdev\n"), NULL);
+}
+END_TEST
+
+START_TEST(test_stats_phases)
+{
+	puts ("test_stats_phases");
+	test_stats_start (WFS_PROGRESS_FORMAT_JSON);
+	/* not counted outside of a stage */
+	wfs_stats_add_write (4096, 0.001);
+	wfs_stats_begin (WFS_STATS_CHECK);
+	wfs_stats_add_read (1024, 0.001);
+	/* the next stage ends the previous one */
+	wfs_stats_begin (WFS_STATS_WFS);
+	wfs_stats_add_write (512, 0.001);
+	wfs_stats_end ();
+	/* nothing to end */
+	wfs_stats_end ();
+	/* the stages entered again add up */
+	wfs_stats_begin (WFS_STATS_WFS);
+	wfs_stats_add_write (512, 0.001);
+	wfs_stats_end ();
+	ck_assert_uint_eq (test_stats_stop (), 3);
+	ck_assert_ptr_ne (strstr (records, "{\"device\":\"testdev\","
+		"\"stats\":\"check\","), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"bytes_read\":1024,"
+		"\"bytes_written\":0,\"reads\":1,\"writes\":0,"), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"bytes_read\":0,"
+		"\"bytes_written\":512,\"reads\":0,\"writes\":1,"), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"bytes_read\":0,"
+		"\"bytes_written\":1024,\"reads\":0,\"writes\":2,"), NULL);
+	ck_assert_ptr_ne (strstr (records, "\"write_latency_us_log2\":[0,0,0,0,"
+		"0,0,0,0,0,0,2,"), NULL);
+}
+END_TEST
+
+START_TEST(test_stats_new_fs)
+{
+	puts ("test_stats_new_fs");
+	test_stats_start (WFS_PROGRESS_FORMAT_TEXT);
+	wfs_stats_begin (WFS_STATS_WFS);
+	wfs_stats_add_write (512, 0.001);
+	wfs_stats_end ();
+	/* a new filesystem starts from zero */
+	ck_assert_uint_eq (test_stats_stop (), 1);
+	test_stats_start (WFS_PROGRESS_FORMAT_TEXT);
+	wfs_stats_begin (WFS_STATS_WFS);
+	wfs_stats_end ();
+	ck_assert_uint_eq (test_stats_stop (), 1);
+	ck_assert_ptr_ne (strstr (records, " written=0 "), NULL);
+
+	/* no records without the progress records */
+	wfs_stats_begin (WFS_STATS_CLOSE);
+	wfs_stats_end ();
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_stats");
+
+	TCase * tests_stats = tcase_create("stats");
+
+	tcase_add_test(tests_stats, test_stats_counters);
+	tcase_add_test(tests_stats, test_stats_phases);
+	tcase_add_test(tests_stats, test_stats_new_fs);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_stats, 30);
+
+	suite_add_tcase(s, tests_stats);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
@@ -0,0 +1,178 @@
+/*
+ * WipeFreeSpace - A program for secure cleaning of free space on filesystems.
+ *	-- unit test for the wfs_util.c file.
+ *
+ * Copyright (C) 2026 Bogdan Drozdowski, bogdro (at) users . sourceforge . net
+ * License: GNU General Public License, v3+
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wfs_test_common.h"
+#include "src/wfs_util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* ============================================================= */
+
+START_TEST(test_rate_limit_unlimited)
+{
+	wfs_rate_limit_t limit;
+	double start;
+	int i;
+
+	puts ("test_rate_limit_unlimited");
+	wfs_rate_limit_init (&limit, 0, 0);
+	start = wfs_get_time ();
+	for ( i = 0; i < 100000; i++ )
+	{
+		wfs_rate_limit_wait (&limit, 1024 * 1024);
+	}
+	ck_assert (wfs_get_time () - start <= 1.0);
+	/* no bucket - nothing to do */
+	wfs_rate_limit_init (NULL, 1, 1);
+	wfs_rate_limit_wait (NULL, 1);
+}
+END_TEST
+
+START_TEST(test_rate_limit_bytes)
+{
+	wfs_rate_limit_t limit;
+	double start;
+	double elapsed;
+
+	puts ("test_rate_limit_bytes");
+	wfs_rate_limit_init (&limit, 1024 * 1024, 0);
+	start = wfs_get_time ();
+	/* the bucket starts full - the first second's worth goes at once */
+	wfs_rate_limit_wait (&limit, 1024 * 1024);
+	ck_assert (wfs_get_time () - start < 0.25);
+	/* the next half of a second's worth has to wait */
+	wfs_rate_limit_wait (&limit, 512 * 1024);
+	elapsed = wfs_get_time () - start;
+	ck_assert (elapsed >= 0.4);
+	ck_assert (elapsed < 2.0);
+}
+END_TEST
+
+START_TEST(test_rate_limit_iops)
+{
+	wfs_rate_limit_t limit;
+	double start;
+	double elapsed;
+	int i;
+
+	puts ("test_rate_limit_iops");
+	/* the size doesn't matter, only the number of writes */
+	wfs_rate_limit_init (&limit, 0, 10);
+	start = wfs_get_time ();
+	for ( i = 0; i < 10; i++ )
+	{
+		wfs_rate_limit_wait (&limit, 1024 * 1024 * 1024);
+	}
+	ck_assert (wfs_get_time () - start < 0.25);
+	for ( i = 0; i < 5; i++ )
+	{
+		wfs_rate_limit_wait (&limit, 1);
+	}
+	elapsed = wfs_get_time () - start;
+	ck_assert (elapsed >= 0.4);
+	ck_assert (elapsed < 2.0);
+}
+END_TEST
+
+START_TEST(test_is_block_zero)
+{
+	unsigned char buf[4096 + 3];
+
+	puts ("test_is_block_zero");
+	memset (buf, 0, sizeof (buf));
+	ck_assert_int_ne (wfs_is_block_zero (buf, sizeof (buf)), 0);
+	/* unaligned, with the non-zero byte at each end */
+	ck_assert_int_ne (wfs_is_block_zero (&buf[1], 4096), 0);
+	buf[sizeof (buf) - 1] = 1;
+	ck_assert_int_eq (wfs_is_block_zero (buf, sizeof (buf)), 0);
+	ck_assert_int_ne (wfs_is_block_zero (&buf[1], 4096), 0);
+	buf[sizeof (buf) - 1] = 0;
+	buf[1] = 0x80;
+	ck_assert_int_eq (wfs_is_block_zero (&buf[1], 4096), 0);
+	ck_assert_int_ne (wfs_is_block_zero (&buf[2], 4096), 0);
+}
+END_TEST
+
+START_TEST(test_set_uuid)
+{
+	wfs_fsid_t wf_gen;
+	unsigned char uuid[17];
+	unsigned int i;
+
+	puts ("test_set_uuid");
+	memset (&wf_gen, 0, sizeof (wf_gen));
+	for ( i = 0; i < sizeof (uuid); i++ )
+	{
+		uuid[i] = (unsigned char) (i * 0x11 + 0x0F);
+	}
+	wfs_set_uuid (&wf_gen, uuid, 16);
+	ck_assert_str_eq (wf_gen.fs_uuid, "0f203142-5364-7586-97a8-b9cadbecfd0e");
+	/* a serial number */
+	wfs_set_uuid (&wf_gen, uuid, 8);
+	ck_assert_str_eq (wf_gen.fs_uuid, "0f20314253647586");
+	/* the UUIDs not identifying anything */
+	wfs_set_uuid (&wf_gen, uuid, 17);
+	ck_assert_str_eq (wf_gen.fs_uuid, "");
+	wfs_set_uuid (&wf_gen, uuid, 8);
+	wfs_set_uuid (&wf_gen, NULL, 16);
+	ck_assert_str_eq (wf_gen.fs_uuid, "");
+	memset (uuid, 0, sizeof (uuid));
+	wfs_set_uuid (&wf_gen, uuid, 16);
+	ck_assert_str_eq (wf_gen.fs_uuid, "");
+	wfs_set_uuid (NULL, uuid, 16);
+}
+END_TEST
+
+static Suite * wfs_create_suite(void)
+{
+	Suite * s = suite_create("wfs_util");
+
+	TCase * tests_util = tcase_create("util");
+
+	tcase_add_test(tests_util, test_rate_limit_unlimited);
+	tcase_add_test(tests_util, test_rate_limit_bytes);
+	tcase_add_test(tests_util, test_rate_limit_iops);
+	tcase_add_test(tests_util, test_is_block_zero);
+	tcase_add_test(tests_util, test_set_uuid);
+
+	/* set 30-second timeouts */
+	tcase_set_timeout(tests_util, 30);
+
+	suite_add_tcase(s, tests_util);
+
+	return s;
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	Suite * s = wfs_create_suite();
+	SRunner * sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+
+	failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return failed;
+}
@@ -23,6 +23,8 @@
 #include "src/wfs_wiping.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /* ============================================================= */
 
@@ -31,7 +33,6 @@ START_TEST(test_fill_buffer)
 #define OFFSET 20
 	unsigned char buffer[100];
 	size_t i, j;
-	int selected[WFS_NPAT] = {0};
 #ifdef ALL_PASSES_ZERO
 	unsigned char marker = '\x55';
 #else
@@ -47,6 +48,7 @@ START_TEST(test_fill_buffer)
 	wf_gen.zero_pass = 0;
 	wf_gen.fs_backend = NULL;
 	wf_gen.no_wipe_zero_blocks = 0;
+	wf_gen.wipe_ctx = NULL;
 
 	puts ("test_fill_buffer");
 
@@ -56,7 +58,7 @@ START_TEST(test_fill_buffer)
 		{
 			buffer[j] = marker;
 		}
-		wfs_fill_buffer (0, &buffer[OFFSET], i, selected, wf_gen);
+		wfs_fill_buffer (0, &buffer[OFFSET], i, wf_gen);
 		for ( j = 0; j < OFFSET; j++ )
 		{
 			if ( buffer[j] != marker )
@@ -114,6 +116,142 @@ START_TEST(test_init_wiping)
 	ck_assert_uint_eq (wfs_init_wiping (0, 1, 1, "blah"), WFS_PASSES /* the default number of patterns in the Gutmann method */);
 }
 
+START_TEST(test_wipe_ctx)
+{
+	unsigned char buffer[64];
+	size_t j;
+	unsigned int bits;
+	wfs_wipe_ctx_t zeros;
+	wfs_wipe_ctx_t dod;
+	wfs_fsid_t wf_zeros;
+	wfs_fsid_t wf_dod;
+	wfs_errcode_t err;
+
+	puts ("test_wipe_ctx");
+
+	memset (&wf_zeros, 0, sizeof (wf_zeros));
+	wf_zeros.fsname = "";
+	wf_zeros.fs_error = &err;
+	wf_zeros.whichfs = WFS_CURR_FS_NONE;
+	wf_dod = wf_zeros;
+	wf_zeros.wipe_ctx = &zeros;
+	wf_dod.wipe_ctx = &dod;
+
+	ck_assert_uint_eq (wfs_wipe_ctx_init (&zeros, 0, 0, 1, "gutmann"), 27 + 9);
+	ck_assert_uint_eq (wfs_wipe_ctx_init (&dod, 0, 0, 0, "dod"), 2 + 1);
+	ck_assert_uint_eq (zeros.npasses, 27 + 9);
+	ck_assert_uint_eq (dod.npasses, 2 + 1);
+	ck_assert_uint_eq (dod.patterns_dod[1], ~dod.patterns_dod[0]);
+	/* the other wipings don't change the default one */
+	ck_assert_uint_eq (wfs_init_wiping (5, 2, 0, "random"), 22 + 3);
+	wfs_wipe_ctx_free (&zeros);
+	ck_assert_uint_eq (wfs_wipe_ctx_init (&zeros, 0, 0, 1, "gutmann"), 27 + 9);
+	ck_assert_int_eq (wfs_is_verbose (), 2);
+
+	/* the wipings used alternately keep their own methods */
+	for ( j = 0; j < 4; j++ )
+	{
+		memset (buffer, 0x77, sizeof (buffer));
+		wfs_fill_buffer (j, buffer, sizeof (buffer), wf_zeros);
+		ck_assert_uint_eq (buffer[0], 0);
+		ck_assert_uint_eq (buffer[sizeof (buffer) - 1], 0);
+
+		/* the first pass of the DoD method is the random pattern */
+		wfs_fill_buffer (0, buffer, sizeof (buffer), wf_dod);
+		bits = dod.patterns_dod[0] & 0xFFF;
+		bits |= bits << 12;
+		ck_assert_uint_eq (buffer[0], (bits >> 4) & 0xFF);
+		ck_assert_uint_eq (buffer[1], (bits >> 8) & 0xFF);
+		ck_assert_uint_eq (buffer[2], bits & 0xFF);
+		/* the second - its complement */
+		wfs_fill_buffer (1, buffer, sizeof (buffer), wf_dod);
+		bits = dod.patterns_dod[1] & 0xFFF;
+		bits |= bits << 12;
+		ck_assert_uint_eq (buffer[0], (bits >> 4) & 0xFF);
+		ck_assert_uint_eq (buffer[1], (bits >> 8) & 0xFF);
+	}
+	wfs_wipe_ctx_free (&zeros);
+	wfs_wipe_ctx_free (&dod);
+	ck_assert_ptr_eq (zeros.schedule, NULL);
+}
+END_TEST
+
+static int compare_patterns (const void * a, const void * b)
+{
+	return (int)(*(const unsigned int *)a) - (int)(*(const unsigned int *)b);
+}
+
+START_TEST(test_wipe_schedule)
+{
+	/* the Gutmann method's patterns */
+	unsigned int expected[] =
+	{
+		0x000, 0xFFF, 0x555, 0xAAA, 0x249, 0x492, 0x6DB, 0x924, 0xB6D, 0xDB6,
+		0x111, 0x222, 0x333, 0x444, 0x666, 0x777, 0x888, 0x999, 0xBBB, 0xCCC,
+		0xDDD, 0xEEE, 0x555, 0xAAA, 0x249, 0x492, 0x924
+	};
+	unsigned int fixed[2 * 27];
+	size_t nfixed = 0;
+	size_t nrandom = 0;
+	size_t i;
+	wfs_wipe_ctx_t ctx;
+
+	puts ("test_wipe_schedule");
+
+	/* the default number of passes - each pattern once */
+	ck_assert_uint_eq (wfs_wipe_ctx_init (&ctx, 0, 0, 0, "gutmann"), 27 + 9);
+	ck_assert_ptr_ne (ctx.schedule, NULL);
+	for ( i = 0; i < ctx.npasses; i++ )
+	{
+		if ( ctx.schedule[i] == WFS_PATTERN_RANDOM )
+		{
+			nrandom++;
+		}
+		else
+		{
+			fixed[nfixed++] = ctx.schedule[i];
+		}
+	}
+	ck_assert_uint_eq (nrandom, 9);
+	ck_assert_uint_eq (nfixed, 27);
+	qsort (fixed, nfixed, sizeof (fixed[0]), &compare_patterns);
+	qsort (expected, 27, sizeof (expected[0]), &compare_patterns);
+	ck_assert_int_eq (memcmp (fixed, expected, sizeof (expected)), 0);
+	wfs_wipe_ctx_free (&ctx);
+
+	/* twice as many fixed passes - each pattern twice */
+	ck_assert_uint_eq (wfs_wipe_ctx_init (&ctx, 2 * 27 + 9, 0, 0, "gutmann"), 27 + 9);
+	ck_assert_ptr_ne (ctx.schedule, NULL);
+	nfixed = 0;
+	for ( i = 0; i < ctx.npasses; i++ )
+	{
+		if ( ctx.schedule[i] != WFS_PATTERN_RANDOM )
+		{
+			ck_assert_uint_le (nfixed + 1, 2 * 27);
+			fixed[nfixed++] = ctx.schedule[i];
+		}
+	}
+	ck_assert_uint_eq (nfixed, 2 * 27);
+	/* each half is a full set of the patterns */
+	qsort (fixed, 27, sizeof (fixed[0]), &compare_patterns);
+	qsort (&fixed[27], 27, sizeof (fixed[0]), &compare_patterns);
+	ck_assert_int_eq (memcmp (fixed, expected, sizeof (expected)), 0);
+	ck_assert_int_eq (memcmp (&fixed[27], expected, sizeof (expected)), 0);
+	wfs_wipe_ctx_free (&ctx);
+
+	/* the Schneier method uses its patterns in sequence */
+	ck_assert_uint_eq (wfs_wipe_ctx_init (&ctx, 0, 0, 0, "schneier"), 2 + 5);
+	ck_assert_ptr_ne (ctx.schedule, NULL);
+	ck_assert_uint_eq (ctx.schedule[0], 0xFFF);
+	ck_assert_uint_eq (ctx.schedule[1], 0x000);
+	for ( i = 2; i < ctx.npasses; i++ )
+	{
+		ck_assert_uint_eq (ctx.schedule[i], WFS_PATTERN_RANDOM);
+	}
+	wfs_wipe_ctx_free (&ctx);
+}
+END_TEST
+
 static Suite * wfs_create_suite(void)
 {
 	Suite * s = suite_create("wfs_wiping");
@@ -122,6 +260,8 @@ static Suite * wfs_create_suite(void)
 
 	tcase_add_test(tests_wiping, test_fill_buffer);
 	tcase_add_test(tests_wiping, test_init_wiping);
+	tcase_add_test(tests_wiping, test_wipe_ctx);
+	tcase_add_test(tests_wiping, test_wipe_schedule);
 
 	/*tcase_add_checked_fixture(tests_wiping, &setup_test, &teardown_test);*/
 	/*tcase_add_unchecked_fixture(tests_wiping, &setup_global, &teardown_global);*/
@@ -81,4 +81,33 @@
 # define WFS_AUTOMAKE_TEST_SKIP 77
 # define WFS_TEST_FILESYSTEM "test-fs"
 
+/* The I/O system calls counted by the shim in test_stubs.c */
+struct wfs_test_io_counts
+{
+	unsigned long int reads;	/* read(), pread() */
+	unsigned long int writes;	/* write(), pwrite(), pwritev() */
+	unsigned long int seeks;	/* lseek() */
+	unsigned long int syncs;	/* fsync(), fdatasync() */
+	unsigned long long int bytes_read;
+	unsigned long long int bytes_written;
+	unsigned long int unaligned;	/* positioned writes at offsets which
+					   aren't a multiple of 512 */
+};
+
+extern struct wfs_test_io_counts wfs_test_io;
+
+/* The most bytes a counted positioned write writes, to test the partial
+   writes, 0 (no limit) by default */
+extern size_t wfs_test_io_max_write;
+
+/* The number of messages shown through the wfs_show_msg() stub */
+extern unsigned long int wfs_test_msgs;
+
+/* The value returned by the wfs_is_stdout_open() stub, 0 by default */
+extern int wfs_test_stdout_open;
+
+/* Clears the counters and starts counting, returns 0 if the calls can't be counted */
+extern int wfs_test_io_start (void);
+extern void wfs_test_io_stop (void);
+
 #endif /* WFS_TEST_COMMON */